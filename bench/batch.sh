@@ -0,0 +1,106 @@
+#!/bin/sh
+#
+# SOURCE FILE: batch.sh
+#
+# PROGRAM: Super File Transfer
+#
+# DATE: October 17, 2026
+#
+# NOTES:
+# Compares uploading many small files one at a time with uploading them as
+# one batch. A directory of FILES files of SIZE bytes each is made. It is
+# uploaded to a fresh server once with one client run per file, the way a
+# script would have to before batches, and once with the p command. The
+# total time of the uploads and the files per second are printed.
+#
+# Usage: bench/batch.sh [server options], run from the top of the tree after
+# make. FILES (default 1000), SIZE (default 4096) and CLIENT_OPTS are read
+# from the environment.
+
+ROOT=$(pwd)
+FILES=${FILES:-1000}
+SIZE=${SIZE:-4096}
+WORK=$(mktemp -d)
+
+cleanup()
+{
+    [ -n "$SERVER" ] && kill $SERVER 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+if [ ! -x "$ROOT/bin/server" ] || [ ! -x "$ROOT/bin/client" ]
+then
+    echo "Build the programs with make first" >&2
+    exit 1
+fi
+
+mkdir -p "$WORK/client/share" "$WORK/client/small"
+i=0
+while [ $i -lt $FILES ]
+do
+    head -c $SIZE /dev/urandom > "$WORK/client/small/f$i"
+    i=$((i + 1))
+done
+
+# Prints the milliseconds since the epoch
+now()
+{
+    echo $(($(date +%s%N) / 1000000))
+}
+
+# Starts a fresh server
+startServer()
+{
+    rm -rf "$WORK/server"
+    mkdir -p "$WORK/server/share"
+    (cd "$WORK/server" && exec "$ROOT/bin/server" $SERVER_OPTS \
+        > /dev/null 2>&1) &
+    SERVER=$!
+    sleep 0.5
+}
+
+# Stops the server and prints the time of the uploads since $1
+stopServer()
+{
+    elapsed=$(($(now) - $1))
+    kill $SERVER 2>/dev/null
+    wait $SERVER 2>/dev/null
+    SERVER=
+
+    if [ $status -ne 0 ] || \
+        ! diff -r "$WORK/client/small" "$WORK/server/share/small" > /dev/null
+    then
+        printf "%12s\n" failed
+    else
+        [ $elapsed -gt 0 ] || elapsed=1
+        printf "%12d %12d\n" $elapsed $((FILES * 1000 / elapsed))
+    fi
+}
+
+SERVER_OPTS="$*"
+printf "%d files of %d bytes\n" $FILES $SIZE
+printf "%10s %12s %12s\n" upload ms files/s
+
+printf "%10s " single
+startServer
+mkdir -p "$WORK/server/share/small"
+start=$(now)
+status=0
+for file in "$WORK"/client/small/*
+do
+    (cd "$WORK/client/small" && printf "s\n${file##*/}\n" | \
+        "$ROOT/bin/client" -i 127.0.0.1 $CLIENT_OPTS > /dev/null 2>&1) || \
+        status=1
+done
+# Single uploads land in share, move them where the batch puts them
+mv "$WORK"/server/share/f* "$WORK/server/share/small/" 2>/dev/null
+stopServer $start
+
+printf "%10s " batch
+startServer
+start=$(now)
+status=0
+(cd "$WORK/client" && printf "p\nsmall\n" | \
+    "$ROOT/bin/client" -i 127.0.0.1 $CLIENT_OPTS > /dev/null 2>&1) || status=1
+stopServer $start
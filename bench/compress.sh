@@ -0,0 +1,101 @@
+#!/bin/sh
+#
+# SOURCE FILE: compress.sh
+#
+# PROGRAM: Super File Transfer
+#
+# DATE: October 17, 2026
+#
+# NOTES:
+# Compares plain uploads with compressed uploads. Two files of SIZE megabytes
+# are made, one of text repeated from test.txt and one of random data that
+# does not compress. Each is uploaded to a fresh server once plain and once
+# with compression. The time of the upload and the bytes that crossed the
+# loopback device are printed. The random file shows what sampling costs
+# when the sender decides compression is not worth it.
+#
+# Usage: bench/compress.sh [server options], run from the top of the tree
+# after make. SIZE (default 64) and CLIENT_OPTS are read from the
+# environment.
+
+ROOT=$(pwd)
+SIZE=${SIZE:-64}
+WORK=$(mktemp -d)
+
+cleanup()
+{
+    [ -n "$SERVER" ] && kill $SERVER 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+if [ ! -x "$ROOT/bin/server" ] || [ ! -x "$ROOT/bin/client" ]
+then
+    echo "Build the programs with make first" >&2
+    exit 1
+fi
+
+mkdir -p "$WORK/client/share"
+while [ $(stat -c %s "$WORK/client/text.bin" 2>/dev/null || echo 0) -lt \
+    $((SIZE * 1048576)) ]
+do
+    cat "$ROOT/test.txt" "$ROOT/test.txt" "$ROOT/test.txt" \
+        >> "$WORK/client/text.bin"
+done
+truncate -s ${SIZE}M "$WORK/client/text.bin"
+dd if=/dev/urandom of="$WORK/client/random.bin" bs=1M count=$SIZE \
+    2>/dev/null
+
+# Prints the milliseconds since the epoch
+now()
+{
+    echo $(($(date +%s%N) / 1000000))
+}
+
+# Prints the bytes received by the loopback device so far
+wire()
+{
+    awk '/^ *lo:/ { sub(/.*:/, ""); print $1 }' /proc/net/dev
+}
+
+# Uploads $1 to a fresh server, $2 holds extra client options
+upload()
+{
+    rm -rf "$WORK/server"
+    mkdir -p "$WORK/server/share"
+    (cd "$WORK/server" && exec "$ROOT/bin/server" $SERVER_OPTS \
+        > /dev/null 2>&1) &
+    SERVER=$!
+    sleep 0.5
+
+    bytes=$(wire)
+    start=$(now)
+    status=0
+    (cd "$WORK/client" && printf "s\n$1\n" | \
+        "$ROOT/bin/client" -i 127.0.0.1 $2 $CLIENT_OPTS \
+        > /dev/null 2>&1) || status=1
+    elapsed=$(($(now) - start))
+    bytes=$(($(wire) - bytes))
+
+    kill $SERVER 2>/dev/null
+    wait $SERVER 2>/dev/null
+    SERVER=
+
+    if [ $status -ne 0 ] || ! cmp -s "$WORK/client/$1" "$WORK/server/share/$1"
+    then
+        printf "%12s\n" failed
+    else
+        printf "%12d %16d\n" $elapsed $bytes
+    fi
+}
+
+SERVER_OPTS="$*"
+printf "%d MB files\n" $SIZE
+printf "%8s %10s %12s %16s\n" file upload ms "bytes on wire"
+for file in text random
+do
+    printf "%8s %10s " $file plain
+    upload $file.bin ""
+    printf "%8s %10s " $file compressed
+    upload $file.bin -Z
+done
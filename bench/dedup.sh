@@ -0,0 +1,112 @@
+#!/bin/sh
+#
+# SOURCE FILE: dedup.sh
+#
+# PROGRAM: Super File Transfer
+#
+# DATE: October 17, 2026
+#
+# NOTES:
+# Compares plain uploads with deduplicated uploads of files that are mostly
+# the same data. A file of SIZE megabytes is made and COPIES versions of it,
+# each with a few kilobytes inserted at a random place, so every boundary
+# after the insert moves. All of them are uploaded to a fresh server once
+# with plain uploads and once deduplicated. The total time of the uploads,
+# the bytes that crossed the loopback device and the disk space the share
+# directory takes afterwards are printed.
+#
+# Usage: bench/dedup.sh [server options], run from the top of the tree after
+# make. SIZE (default 64), COPIES (default 8) and CLIENT_OPTS are read from
+# the environment.
+
+ROOT=$(pwd)
+SIZE=${SIZE:-64}
+COPIES=${COPIES:-8}
+WORK=$(mktemp -d)
+
+cleanup()
+{
+    [ -n "$SERVER" ] && kill $SERVER 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+if [ ! -x "$ROOT/bin/server" ] || [ ! -x "$ROOT/bin/client" ]
+then
+    echo "Build the programs with make first" >&2
+    exit 1
+fi
+
+mkdir -p "$WORK/client/share"
+dd if=/dev/urandom of="$WORK/client/file0.bin" bs=1M count=$SIZE \
+    2>/dev/null
+
+# Every version inserts 4 KB at a random place of the one before it
+i=1
+while [ $i -le $COPIES ]
+do
+    at=$(od -An -N4 -tu4 /dev/urandom | awk -v n=$SIZE \
+        '{ print $1 % (n * 1048576) }')
+    { head -c $at "$WORK/client/file$((i - 1)).bin"
+      head -c 4096 /dev/urandom
+      tail -c +$((at + 1)) "$WORK/client/file$((i - 1)).bin"
+    } > "$WORK/client/file$i.bin"
+    i=$((i + 1))
+done
+
+# Prints the milliseconds since the epoch
+now()
+{
+    echo $(($(date +%s%N) / 1000000))
+}
+
+# Prints the bytes received by the loopback device so far
+wire()
+{
+    awk '/^ *lo:/ { sub(/.*:/, ""); print $1 }' /proc/net/dev
+}
+
+# Uploads every version to a fresh server, $1 holds extra client options
+upload()
+{
+    rm -rf "$WORK/server"
+    mkdir -p "$WORK/server/share"
+    (cd "$WORK/server" && exec "$ROOT/bin/server" $SERVER_OPTS \
+        > /dev/null 2>&1) &
+    SERVER=$!
+    sleep 0.5
+
+    bytes=$(wire)
+    start=$(now)
+    status=0
+    i=0
+    while [ $i -le $COPIES ]
+    do
+        (cd "$WORK/client" && printf "s\nfile$i.bin\n" | \
+            "$ROOT/bin/client" -i 127.0.0.1 $1 $CLIENT_OPTS \
+            > /dev/null 2>&1) || status=1
+        i=$((i + 1))
+    done
+    elapsed=$(($(now) - start))
+    bytes=$(($(wire) - bytes))
+
+    kill $SERVER 2>/dev/null
+    wait $SERVER 2>/dev/null
+    SERVER=
+
+    if [ $status -ne 0 ]
+    then
+        printf "%12s\n" failed
+    else
+        printf "%12d %16d %12d\n" $elapsed $bytes \
+            $(du -sk "$WORK/server/share" | awk '{ print $1 }')
+    fi
+}
+
+SERVER_OPTS="$*"
+printf "%d versions of a %d MB file\n" $((COPIES + 1)) $SIZE
+printf "%8s %12s %16s %12s\n" upload ms "bytes on wire" "share KB"
+printf "%8s " plain
+upload ""
+printf "%8s " dedup
+upload -C
@@ -0,0 +1,97 @@
+#!/bin/sh
+#
+# SOURCE FILE: delta.sh
+#
+# PROGRAM: Super File Transfer
+#
+# DATE: October 17, 2026
+#
+# NOTES:
+# Compares a delta upload with a full upload of a file the server already has
+# an older copy of. A server is started in a scratch directory and given a
+# file of SIZE megabytes. CHANGES blocks of 1 KB at random places in the
+# client's copy are then overwritten, and the new file is uploaded once in
+# full and once as a delta against the old copy. The time of each upload and
+# the bytes that crossed the loopback device, both ways and with the TCP/IP
+# headers, are printed.
+#
+# Usage: bench/delta.sh [server options], run from the top of the tree after
+# make. SIZE (default 256), CHANGES (default 8) and CLIENT_OPTS are read from
+# the environment.
+
+ROOT=$(pwd)
+SIZE=${SIZE:-256}
+CHANGES=${CHANGES:-8}
+WORK=$(mktemp -d)
+
+cleanup()
+{
+    [ -n "$SERVER" ] && kill $SERVER 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+if [ ! -x "$ROOT/bin/server" ] || [ ! -x "$ROOT/bin/client" ]
+then
+    echo "Build the programs with make first" >&2
+    exit 1
+fi
+
+mkdir -p "$WORK/server/share" "$WORK/client/share"
+dd if=/dev/urandom of="$WORK/server/share/put.bin" bs=1M count=$SIZE \
+    2>/dev/null
+cp "$WORK/server/share/put.bin" "$WORK/old.bin"
+cp "$WORK/server/share/put.bin" "$WORK/client/put.bin"
+
+# Overwrite CHANGES kilobytes of the client's copy at random places
+i=0
+while [ $i -lt $CHANGES ]
+do
+    dd if=/dev/urandom of="$WORK/client/put.bin" bs=1024 count=1 \
+        seek=$(od -An -N4 -tu4 /dev/urandom | awk -v n=$SIZE \
+        '{ print $1 % (n * 1024) }') conv=notrunc 2>/dev/null
+    i=$((i + 1))
+done
+
+(cd "$WORK/server" && exec "$ROOT/bin/server" "$@" > /dev/null 2>&1) &
+SERVER=$!
+sleep 0.5
+
+# Prints the milliseconds since the epoch
+now()
+{
+    echo $(($(date +%s%N) / 1000000))
+}
+
+# Prints the bytes received by the loopback device so far
+wire()
+{
+    awk '/^ *lo:/ { sub(/.*:/, ""); print $1 }' /proc/net/dev
+}
+
+# Uploads the file, $1 holds extra client options, and prints the result
+upload()
+{
+    cp "$WORK/old.bin" "$WORK/server/share/put.bin"
+    bytes=$(wire)
+    start=$(now)
+    cd "$WORK/client" && printf "s\nput.bin\n" | \
+        "$ROOT/bin/client" -i 127.0.0.1 $1 $CLIENT_OPTS > /dev/null 2>&1
+    status=$?
+    elapsed=$(($(now) - start))
+    bytes=$(($(wire) - bytes))
+    if [ $status -ne 0 ] || ! cmp -s "$WORK/client/put.bin" \
+        "$WORK/server/share/put.bin"
+    then
+        printf "%12s\n" failed
+    else
+        printf "%12d %16d\n" $elapsed $bytes
+    fi
+}
+
+printf "%d MB file with %d KB changed\n" $SIZE $CHANGES
+printf "%8s %12s %16s\n" upload ms "bytes on wire"
+printf "%8s " full
+upload ""
+printf "%8s " delta
+upload -D
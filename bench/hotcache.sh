@@ -0,0 +1,88 @@
+#!/bin/sh
+#
+# SOURCE FILE: hotcache.sh
+#
+# PROGRAM: Super File Transfer
+#
+# DATE: October 17, 2026
+#
+# NOTES:
+# Compares downloads of small files with the hot files kept in memory and
+# without. For each size of 1, 4, 16 and 64 kilobytes a few files are made
+# and a fresh server is started once with the default budget of hot files
+# and once with -H 0. The load generator then keeps CLIENTS sessions getting
+# the files, REQUESTS each, all at once from the one process, see load.c, and
+# the requests per second are printed. No process is started per request, so
+# the numbers are those of the server and the difference between the two
+# columns is the cache.
+#
+# Usage: bench/hotcache.sh [server options], run from the top of the tree
+# after make. The server runs in the epoll mode unless the options pick
+# another event driven mode, the fork mode has no cache. CLIENTS (default 4),
+# REQUESTS (default 2000) and LOAD_OPTS (default -P) are read from the
+# environment. The transfers are passive by default, the retries of the
+# connect back to the load generator take longer than a small file.
+
+ROOT=$(pwd)
+CLIENTS=${CLIENTS:-4}
+REQUESTS=${REQUESTS:-2000}
+LOAD_OPTS=${LOAD_OPTS:--P}
+FILES=4
+WORK=$(mktemp -d)
+
+cleanup()
+{
+    [ -n "$SERVER" ] && kill $SERVER 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+if [ ! -x "$ROOT/bin/server" ] || [ ! -x "$ROOT/bin/load" ]
+then
+    echo "Build the programs with make first" >&2
+    exit 1
+fi
+
+# Gets the files of $1 kilobytes with every client against a fresh server
+# with the extra options $2 and prints the requests per second
+measure()
+{
+    (cd "$WORK/server" && exec "$ROOT/bin/server" -m epoll $SERVER_OPTS $2 \
+        > /dev/null 2>&1) &
+    SERVER=$!
+    sleep 0.5
+
+    ls "$WORK/server" | grep "^$1k-" > "$WORK/names"
+    "$ROOT/bin/load" -i 127.0.0.1 -c $CLIENTS -n $((CLIENTS * REQUESTS)) \
+        -g 100 -f "$WORK/names" -r 0 $LOAD_OPTS > "$WORK/load.log" 2>&1
+
+    kill $SERVER 2>/dev/null
+    wait $SERVER 2>/dev/null
+    SERVER=
+
+    # The get line of the totals: requests, failures, MB/s and requests/s
+    awk '$1 == "get" { if ($3 > 0) printf "%12s", "failed";
+        else printf "%12d", $5; found = 1 }
+        END { if (!found) printf "%12s", "failed" }' "$WORK/load.log"
+}
+
+SERVER_OPTS="$*"
+mkdir -p "$WORK/server/share"
+printf "%d clients, %d requests each\n" $CLIENTS $REQUESTS
+printf "%8s %12s %12s\n" size "cached/s" "uncached/s"
+for size in 1 4 16 64
+do
+    i=0
+    while [ $i -lt $FILES ]
+    do
+        dd if=/dev/urandom of="$WORK/server/${size}k-$i.bin" bs=1k \
+            count=$size 2>/dev/null
+        i=$((i + 1))
+    done
+
+    printf "%7dk " $size
+    measure $size ""
+    printf " "
+    measure $size "-H 0"
+    printf "\n"
+done
@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+# SOURCE FILE: stripes.sh
+#
+# PROGRAM: Super File Transfer
+#
+# DATE: October 17, 2026
+#
+# NOTES:
+# Measures how the throughput of a download and an upload scales with the
+# number of stripes. A server is started in a scratch directory, a file of
+# SIZE megabytes is moved with 1, 2, 4, ... STRIPES stripes and the rate of
+# every transfer is printed.
+#
+# Loopback has no latency, so a single connection already fills it. Set DELAY
+# to a number of milliseconds to add that much delay to the loopback device
+# with netem, which needs root, and see what striping does for a long fat
+# link.
+#
+# Usage: bench/stripes.sh [server options], run from the top of the tree
+# after make. SIZE (default 256), STRIPES (default 8), DELAY and CLIENT_OPTS
+# are read from the environment.
+
+ROOT=$(pwd)
+SIZE=${SIZE:-256}
+STRIPES=${STRIPES:-8}
+WORK=$(mktemp -d)
+
+cleanup()
+{
+    [ -n "$SERVER" ] && kill $SERVER 2>/dev/null
+    [ -n "$DELAY" ] && tc qdisc del dev lo root 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+if [ ! -x "$ROOT/bin/server" ] || [ ! -x "$ROOT/bin/client" ]
+then
+    echo "Build the programs with make first" >&2
+    exit 1
+fi
+
+if [ -n "$DELAY" ] && ! tc qdisc add dev lo root netem delay ${DELAY}ms
+then
+    echo "Cannot add ${DELAY}ms of delay to lo" >&2
+    DELAY=
+    exit 1
+fi
+
+mkdir -p "$WORK/server/share" "$WORK/client/share"
+dd if=/dev/urandom of="$WORK/server/get.bin" bs=1M count=$SIZE 2>/dev/null
+cp "$WORK/server/get.bin" "$WORK/client/put.bin"
+
+(cd "$WORK/server" && exec "$ROOT/bin/server" "$@" > /dev/null 2>&1) &
+SERVER=$!
+sleep 0.5
+
+# Prints the milliseconds since the epoch
+now()
+{
+    echo $(($(date +%s%N) / 1000000))
+}
+
+# Runs one transfer, $1 is the command and $2 the file, and prints the rate
+transfer()
+{
+    start=$(now)
+    cd "$WORK/client" && printf "%s\n%s\n" $1 $2 | \
+        "$ROOT/bin/client" -i 127.0.0.1 -S $stripes $CLIENT_OPTS \
+        > /dev/null 2>&1
+    status=$?
+    elapsed=$(($(now) - start))
+    [ $elapsed -gt 0 ] || elapsed=1
+    if [ $status -ne 0 ]
+    then
+        printf "%12s" failed
+    else
+        printf "%9d MB/s" $((SIZE * 1000 / elapsed))
+    fi
+}
+
+printf "%8s %17s %17s\n" stripes download upload
+stripes=1
+while [ $stripes -le $STRIPES ]
+do
+    printf "%8d " $stripes
+    transfer r get.bin
+    rm -f "$WORK/client/share/get.bin"
+    printf " "
+    transfer s put.bin
+    rm -f "$WORK/server/share/put.bin"
+    printf "\n"
+    stripes=$((stripes * 2))
+done
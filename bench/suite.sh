@@ -0,0 +1,217 @@
+#!/bin/sh
+#
+# SOURCE FILE: suite.sh
+#
+# PROGRAM: Super File Transfer
+#
+# DATE: October 17, 2026
+#
+# NOTES:
+# Measures the throughput and the latency of whole transfers, run by make
+# bench. A server is started on loopback and for every file size of SIZES,
+# every number of clients of CLIENTS and both directions a phase is run: the
+# clients all move their file at once, each again and again, until every
+# client has moved about TARGET bytes or made REQUESTS requests. A phase
+# prints the megabytes and files per second of all the clients together and
+# the 50th, 99th and 99.9th percentile of the time a request took.
+#
+# Every request is a client process of its own, so the times include
+# starting it, connecting and the connect back, as a user sees them. A
+# request is done when its client exits and counts if the client exited with
+# success. Gets and puts run the client with the same CLIENT_OPTS, so both
+# directions measure the same pipeline. A plain put is done once the client
+# has sent the whole file. With -V in CLIENT_OPTS it is only done once the
+# server has written the file and said it checked out, and gets are
+# verified too. The time of a request runs from the end of the one before
+# it. A phase that
+# would keep more than MAX_BYTES on disk at once is skipped, the larger sizes
+# only run with few clients by default.
+#
+# Every phase is also appended to RESULTS as a line of comma separated
+# values, with the commit and the time of the run, so the runs of different
+# commits can be compared.
+#
+# Usage: bench/suite.sh [server options], run from the top of the tree after
+# make. SIZES (default 1k 64k 1m 64m 1g 4g), CLIENTS (default 1 4 16),
+# REQUESTS (default 200), TARGET (default 256m), MAX_BYTES (default 8g),
+# RESULTS (default bench-results.csv) and CLIENT_OPTS are read from the
+# environment.
+
+ROOT=$(pwd)
+SIZES=${SIZES:-"1k 64k 1m 64m 1g 4g"}
+CLIENTS=${CLIENTS:-"1 4 16"}
+REQUESTS=${REQUESTS:-200}
+TARGET=${TARGET:-256m}
+MAX_BYTES=${MAX_BYTES:-8g}
+RESULTS=${RESULTS:-bench-results.csv}
+WORK=$(mktemp -d)
+
+cleanup()
+{
+    [ -n "$SERVER" ] && kill $SERVER 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+if [ ! -x "$ROOT/bin/server" ] || [ ! -x "$ROOT/bin/client" ]
+then
+    echo "Build the programs with make first" >&2
+    exit 1
+fi
+
+# Prints the bytes of a size such as 64k, 1m or 4g
+bytes()
+{
+    case $1 in
+        *k) echo $((${1%k} * 1024)) ;;
+        *m) echo $((${1%m} * 1048576)) ;;
+        *g) echo $((${1%g} * 1073741824)) ;;
+        *) echo $1 ;;
+    esac
+}
+
+# Prints the nanoseconds since the epoch
+now()
+{
+    date +%s%N
+}
+
+# Moves the file of size $2 in the direction $1 (get or put) $3 times from
+# the client directory $4, printing the nanoseconds of every request or
+# failed, as the exit status of the client says
+client()
+{
+    cd "$4" || exit 1
+    prefix=$(basename "$4")-$2
+
+    # Every put has a name of its own, linked before the clock starts
+    i=0
+    while [ $i -lt $3 ]
+    do
+        ln -f "$WORK/$2.bin" "$prefix-$i.bin"
+        i=$((i + 1))
+    done
+
+    i=0
+    start=$(now)
+    while [ $i -lt $3 ]
+    do
+        if [ $1 = get ]
+        then
+            command="r\n$2.bin\n"
+        else
+            command="s\n$prefix-$i.bin\n"
+        fi
+        printf "$command" | "$ROOT/bin/client" -i 127.0.0.1 $CLIENT_OPTS \
+            > /dev/null 2>&1
+        status=$?
+        end=$(now)
+        if [ $status -eq 0 ]
+        then
+            echo $((end - start))
+        else
+            echo failed
+        fi
+        [ $1 = put ] && rm -f "$WORK/server/share/$prefix-$i.bin"
+        start=$end
+        i=$((i + 1))
+    done
+}
+
+# Runs the phase of direction $1, size $2 and $3 clients, the variables of
+# the shell are all global so the loops of the caller use other names
+phase()
+{
+    length=$(bytes $2)
+    repeats=$(($(bytes $TARGET) / length))
+    [ $repeats -gt $REQUESTS ] && repeats=$REQUESTS
+    [ $repeats -lt 1 ] && repeats=1
+
+    printf "%4s %6s %7d " $1 $2 $3
+    if [ $((length * $3)) -gt $(bytes $MAX_BYTES) ]
+    then
+        printf "%8s\n" skipped
+        return
+    fi
+
+    pids=
+    j=0
+    while [ $j -lt $3 ]
+    do
+        mkdir -p "$WORK/client$j/share"
+        j=$((j + 1))
+    done
+    start=$(now)
+    j=0
+    while [ $j -lt $3 ]
+    do
+        client $1 $2 $repeats "$WORK/client$j" > "$WORK/client$j.log" &
+        pids="$pids $!"
+        j=$((j + 1))
+    done
+    wait $pids
+    elapsed=$(($(now) - start))
+
+    # The request times in milliseconds, in order, then the totals
+    cat "$WORK"/client*.log | grep -v failed | sort -n > "$WORK/times"
+    failures=$(cat "$WORK"/client*.log | grep -c failed)
+    awk -v size=$length -v elapsed=$elapsed -v failures=$failures \
+        -v direction=$1 -v clients=$3 -v commit="$COMMIT" \
+        -v date="$DATE" -v options="$SERVER_OPTS" -v results="$RESULTS" '
+        { times[NR] = $1 / 1000000 }
+        function percentile(p,    i)
+        {
+            i = int(p * NR + 0.999999)
+            return NR > 0 ? times[i < 1 ? 1 : i] : 0
+        }
+        END {
+            seconds = elapsed / 1000000000
+            mbs = NR * size / 1048576 / seconds
+            files = NR / seconds
+            printf "%8d %10.2f %9.1f %9.2f %9.2f %9.2f %8d\n", NR, mbs,
+                files, percentile(0.5), percentile(0.99), percentile(0.999),
+                failures
+            printf "%s,%s,%s,%s,%d,%d,%d,%.3f,%.2f,%.1f,%.3f,%.3f,%.3f,%d\n",
+                commit, date, options, direction, size, clients, NR,
+                seconds, mbs, files, percentile(0.5), percentile(0.99),
+                percentile(0.999), failures >> results
+        }' "$WORK/times"
+
+    rm -rf "$WORK"/client* "$WORK"/server/share/client*
+}
+
+SERVER_OPTS="$*"
+COMMIT=$(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)
+DATE=$(date +%Y-%m-%dT%H:%M:%S)
+[ -s "$RESULTS" ] || echo "commit,date,server options,direction,bytes,\
+clients,requests,seconds,MB/s,files/s,p50 ms,p99 ms,p99.9 ms,failures" \
+    > "$RESULTS"
+
+# Every size is made once, the server and the clients share it
+mkdir -p "$WORK/server/share"
+for size in $SIZES
+do
+    dd if=/dev/urandom of="$WORK/$size.bin" bs=65536 \
+        count=$((($(bytes $size) + 65535) / 65536)) 2>/dev/null
+    truncate -s $(bytes $size) "$WORK/$size.bin"
+    ln -f "$WORK/$size.bin" "$WORK/server/$size.bin"
+done
+
+(cd "$WORK/server" && exec "$ROOT/bin/server" $SERVER_OPTS \
+    > /dev/null 2>&1) &
+SERVER=$!
+sleep 0.5
+
+printf "%4s %6s %7s %8s %10s %9s %9s %9s %9s %8s\n" dir size clients \
+    requests "MB/s" "files/s" "p50 ms" "p99 ms" "p99.9 ms" failures
+for size in $SIZES
+do
+    for clients in $CLIENTS
+    do
+        for direction in get put
+        do
+            phase $direction $size $clients
+        done
+    done
+done
+echo "Results appended to $RESULTS"
@@ -4,10 +4,44 @@
 -- PROGRAM: Super File Transfer
 --
 -- FUNCTIONS:
--- void processCommand(int* controlSocket);
--- void receiveFile(int port, const char* fileName);
--- void sendFile(int port, const char* fileName);
+-- void processCommand(int* controlSocket, const char* ip, int passive,
+--				int resume, int delta, int dedup, int compress, int verify,
+--				int stripes);
+-- void processStriped(int* controlSocket, char* cmd, const char* ip,
+--				int passive, int stripes);
+-- int transferStripe(int* controlSocket, char* cmd, int passive, int stripe,
+--				int stripes);
+-- int processBatch(int* controlSocket, char* cmd, int passive);
+-- void printEntry(const char* name, off_t size, int success);
+-- int processList(int* controlSocket, char* cmd, int passive, int verify);
+-- void printListed(const struct listEntry* entry);
+-- int receiveFile(int transferSocket, const char* fileName, int stripe,
+--				int stripes, int resume, int compress, int verify);
+-- int sendFile(int transferSocket, const char* fileName, int stripe,
+--				int stripes, int resume, int compress, int verify);
+-- void findPartial(const char* fileName, struct resumePoint* resume);
+-- int sendDeltaFile(int transferSocket, const char* fileName);
+-- int sendChunkedFile(int transferSocket, const char* fileName);
 -- int initConnection(int port, const char* ip);
+-- int initTransfer(int* controlSocket, int port, int passive);
+-- int readFileName(char* fileName);
+-- char* readFileList();
+-- void processMultiplexed(int* controlSocket, const char* ip, int idle);
+-- struct muxSession* openSession(int* controlSocket, const char* ip,
+--	int idle);
+-- int closeSession(struct muxSession* session, int* controlSocket);
+-- int processInput(struct muxSession* session, char* input, int* inputCount,
+--				char* command);
+-- int processLine(struct muxSession* session, char* line, char* command);
+-- void printTransfer(struct muxStream* stream, int success);
+-- int parseWords(struct script* script, char** words, int count);
+-- int readScript(struct script* script, FILE* file);
+-- int addCommand(struct script* script, int put, const char* name);
+-- void runScript(int* controlSocket, const char* ip, struct script* script);
+-- void startCommands(struct muxSession* session, struct script* script);
+-- void endCommand(struct script* script, struct scriptCommand* command,
+--	int success);
+-- void finishCommand(struct muxStream* stream, int success);
 -- void initalizeServer(int* port, int* socket);
 -- void printHelp(); 
 -- int getPort(int* socket);
@@ -25,12 +59,42 @@
 -- NOTES:
 -- This file contains the necessary functions that will connect to the server
 -- and process the different commands that the user specifies.
+--
+-- All buffers come from a pool of page aligned buffers that are one transfer
+-- chunk long. The chunk size can be changed with the -b option.
+--
+-- With the -S option a file is split into stripes that are moved over
+-- parallel connections, one process per stripe. With the -R option a transfer
+-- that died part way picks up where it left off. With the -D option a file
+-- sent to the server only sends what changed from the server's copy. With the
+-- -C option a file sent to the server only sends the chunks of it the server
+-- does not have under any name. With the -Z option files that compress well
+-- are sent compressed both ways. With the -V option every file is
+-- checksummed as it moves and a file that arrived damaged is a failure.
+-- With the -O option downloads of at least the given size are written to
+-- disk around the page cache. With the -W option downloads are received
+-- straight into a mapping of the file. With the -T option the client talks
+-- to a server on this machine over Unix domain sockets instead of TCP, the
+-- server must use the same transport.
+--
+-- With the -M option every transfer runs over one session that lasts for as
+-- many commands as the user types, so a command costs no new connection. The
+-- session is closed after it was idle for the seconds given with the -K
+-- option and opened again by the next command.
+--
+-- The g and p commands move a batch of files, directories and patterns over
+-- a single data connection, see batch.c. The l command lists the files on
+-- the server.
+--
+-- For scripts and cron jobs the transfers can be given after the options
+-- instead of typed into the menu, e.g. get a b c put d, with - reading more
+-- of them from stdin. They all run over one multiplexed session.
 */
 
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/sendfile.h>
+#include <sys/wait.h>
 #include <netinet/in.h>
 #include <fcntl.h>
 #include <stdlib.h>
@@ -40,18 +104,46 @@
 #include <strings.h>
 #include <time.h>
 #include <string.h>
+#include <poll.h>
+#include <signal.h>
 
 #include "client.h"
 
-#define USAGE		"Usage: %s -i [ip address]\n"
+#define USAGE		"Usage: %s -i [ip address] -P (passive transfers) " \
+					"-M (multiplexed session) -b [chunk size, e.g. 1m] " \
+					"-S [stripes] -R (resume transfers) " \
+					"-D (delta uploads) -C (deduplicated uploads) " \
+					"-Z (compressed transfers) -V (verified transfers) " \
+					"-O [downloads written directly from this size, e.g. 1g] " \
+					"-W (downloads received into a mapping) " \
+					"-T [tcp|unix] -K [idle seconds of a -M session] " \
+					"[get|put files ...] [- (get and put lines on stdin)]\n"
 #define DEF_DIR 	"./share/"
 
+static struct bufferPool buffers;
+static struct script* activeScript = NULL;
+
 /*
 -- FUNCTION: main
 --
 -- DATE: September 23, 2011
 --
 -- REVISIONS:
+-- October 17, 2026 - added the -P option for passive transfers.
+-- October 17, 2026 - added the -M option for a multiplexed session.
+-- October 17, 2026 - added the -b option for the transfer chunk size.
+-- October 17, 2026 - added the -S option for striped transfers.
+-- October 17, 2026 - added the -R option to resume transfers.
+-- October 17, 2026 - added the -D option for delta uploads.
+-- October 17, 2026 - added the -C option for deduplicated uploads.
+-- October 17, 2026 - added the -Z option for compressed transfers.
+-- October 17, 2026 - added the -V option for verified transfers.
+-- October 17, 2026 - added the -O option for direct writes.
+-- October 17, 2026 - added the -W option for mapped receives.
+-- October 17, 2026 - added the -T option for the transport.
+-- October 17, 2026 - added the -K option for the idle timeout of a session.
+-- October 17, 2026 - gets and puts can follow the options, they are run by
+-- runScript.
 --
 -- DESIGNER: Karl Castillo
 --
@@ -66,12 +158,33 @@
 -- NOTES:
 -- This is the main function where the arguments are parsed and proper 
 -- preparations are done. These preparations include initializing sockets.
+--
+-- SIGPIPE is ignored so a server that gave up on an upload, for example
+-- because a checksum did not match, fails the send instead of killing the
+-- client before it can read why.
+--
+-- Gets and puts after the options are all parsed before the client connects,
+-- so a mistake in them costs nothing. They run over a multiplexed session,
+-- the options that do not apply to one are refused as they are for -M.
 */
 int main(int argc, char** argv)
 {
 	char* ipAddr = 0;
 	int option = 0;
 	int controlSocket = 0;
+	int passive = 0;
+	int multiplex = 0;
+	int resume = 0;
+	int delta = 0;
+	int dedup = 0;
+	int compress = 0;
+	int verify = 0;
+	int stripes = 1;
+	int chunkSize = DEF_CHUNK_SIZE;
+	int idle = DEF_IDLE;
+	long long direct = 0;
+	const struct transport* transport = NULL;
+	struct script script;
 
 	if(argc < 3) {
 		fprintf(stderr, "Not Enough Arguments\n");
@@ -79,21 +192,125 @@ int main(int argc, char** argv)
         exit(EXIT_FAILURE);
 	}
 
-	while((option = getopt(argc, argv, ":i:")) != -1)
+	while((option = getopt(argc, argv, ":i:PMb:S:RDCZVO:WT:K:")) != -1)
     {
         switch(option)
         {
         case 'i':
             ipAddr = optarg;
             break;
+        case 'P':
+            passive = 1;
+            break;
+        case 'M':
+            multiplex = 1;
+            break;
+        case 'b':
+            if((chunkSize = parseChunkSize(optarg)) == -1) {
+                fprintf(stderr, USAGE, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'R':
+            resume = 1;
+            break;
+        case 'D':
+            delta = 1;
+            break;
+        case 'C':
+            dedup = 1;
+            break;
+        case 'Z':
+            compress = 1;
+            break;
+        case 'V':
+            verify = 1;
+            break;
+        case 'O':
+            if((direct = parseSize(optarg)) == -1) {
+                fprintf(stderr, USAGE, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            setDirectSize(direct);
+            break;
+        case 'W':
+            setMappedReceive(1);
+            break;
+        case 'T':
+            // The memory transport only reaches this process
+            if((transport = findTransport(optarg)) == NULL ||
+                    transport == &memoryTransport) {
+                fprintf(stderr, USAGE, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            setTransport(transport);
+            break;
+        case 'K':
+            if((idle = atoi(optarg)) < 0) {
+                fprintf(stderr, USAGE, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'S':
+            stripes = atoi(optarg);
+            if(stripes < 1 || stripes > MAX_STRIPES) {
+                fprintf(stderr, "Stripes must be between 1 and %d\n",
+                    MAX_STRIPES);
+                exit(EXIT_FAILURE);
+            }
+            break;
         default:
             fprintf(stderr, USAGE, argv[0]);
             exit(EXIT_FAILURE);
         }
     }
     
+    
+    bzero(&script, sizeof(struct script));
+    if(optind < argc) {
+        multiplex = 1;
+        if(parseWords(&script, argv + optind, argc - optind) == -1) {
+            fprintf(stderr, USAGE, argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(resume && (stripes > 1 || multiplex)) {
+        fprintf(stderr, "Only plain transfers can be resumed\n");
+        exit(EXIT_FAILURE);
+    }
+    if(delta && (stripes > 1 || multiplex || resume)) {
+        fprintf(stderr, "Only plain uploads can be sent as a delta\n");
+        exit(EXIT_FAILURE);
+    }
+    if(dedup && (stripes > 1 || multiplex || resume || delta)) {
+        fprintf(stderr, "Only plain uploads can be deduplicated\n");
+        exit(EXIT_FAILURE);
+    }
+    if(compress && (stripes > 1 || multiplex || delta || dedup)) {
+        fprintf(stderr, "Only plain transfers can be compressed\n");
+        exit(EXIT_FAILURE);
+    }
+    if(verify && (multiplex || delta || dedup)) {
+        fprintf(stderr, "Delta, deduplicated and multiplexed transfers "
+            "can not be verified\n");
+        exit(EXIT_FAILURE);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    
+	if(optind < argc && script.count == 0) {
+		exit(EXIT_SUCCESS);
+	}
+	
+	initializeBufferPool(&buffers, chunkSize);
 	controlSocket = initConnection(DEF_PORT, ipAddr);
-	processCommand(&controlSocket);
+	if(script.count > 0) {
+		runScript(&controlSocket, ipAddr, &script);
+	}
+	if(multiplex) {
+		processMultiplexed(&controlSocket, ipAddr, idle);
+	}
+	processCommand(&controlSocket, ipAddr, passive, resume, delta, dedup,
+		compress, verify, stripes);
 
 	return 0;
 }
@@ -108,14 +325,36 @@ int main(int argc, char** argv)
 -- creation of the socket inside.
 -- September 27, 2011 - moved the creation of the socket to a helper function
 -- September 27, 2011 - changed arguments to controlSocket and transferSocket
+-- October 17, 2026 - changed arguments to controlSocket and passive, the
+-- transfer socket is set up by initTransfer after the command is sent.
+-- October 17, 2026 - the command uses a pooled buffer.
+-- October 17, 2026 - added ip and stripes, the transfer is carried out by
+-- transferStripe or by processStriped.
+-- October 17, 2026 - added resume.
+-- October 17, 2026 - added delta.
+-- October 17, 2026 - added dedup.
+-- October 17, 2026 - added compress.
+-- October 17, 2026 - added verify.
+-- October 17, 2026 - added the g and p commands for batches.
+-- October 17, 2026 - added the l command to list the server's files.
+-- October 17, 2026 - exits with EXIT_FAILURE at the end of the input.
 --
 -- DESIGNER: Karl Castillo
 --
 -- PROGRAMMER: Karl Castillo
 --
--- INTERFACE: void processCommand(int* controlSocket, int* transferSocket);
+-- INTERFACE: void processCommand(int* controlSocket, const char* ip,
+--				int passive, int resume, int delta, int dedup, int compress,
+--				int verify, int stripes)
 --				controlSocket - pointer to the controlSocket
---				transferSocket - pointer to the transferSocket
+--				ip - ip address of the server
+--				passive - ask the server for passive transfers
+--				resume - resume transfers that died part way
+--				delta - send only what changed in uploaded files
+--				dedup - send only the chunks the server does not have
+--				compress - take and send compressed bodies
+--				verify - checksum bodies as they move
+--				stripes - the number of stripes a file is moved in
 --
 -- RETURNS: void
 --
@@ -132,21 +371,43 @@ int main(int argc, char** argv)
 -- e - exit the program
 -- r - receive a file from the server
 -- s - send a file to the server
+-- g - receive a batch of files from the server
+-- p - send a batch of files to the server
+-- l - list the files on the server
 -- f - show local files
 -- h - show a list of available commands
+--
+-- The program exits with EXIT_FAILURE if the input ends before a command
+-- that transfers, such as a send of a file that does not exist.
 */
-void processCommand(int* controlSocket)
+void processCommand(int* controlSocket, const char* ip, int passive,
+	int resume, int delta, int dedup, int compress, int verify, int stripes)
 {
 	FILE* temp = NULL;
-	char* cmd = (char*)malloc(sizeof(char) * BUFFER_LENGTH);
-	int port = getPort(controlSocket);
+	char* cmd = takeBuffer(&buffers);
+	int input = 0;
+	int flags = (passive ? FLAG_PASSIVE : 0) | (resume ? FLAG_RESUME : 0) |
+		(delta ? FLAG_DELTA : 0) | (dedup ? FLAG_DEDUP : 0) |
+		(compress ? FLAG_COMPRESS : 0) | (verify ? FLAG_VERIFY : 0);
+	
+	if(cmd == NULL) {
+		systemFatal("Error allocating buffer");
+	}
+	bzero(cmd, BUFFER_LENGTH);
+	
+	// Control flags are the same for every command
+	memmove(cmd + CONTROL_FLAGS, (void*)&flags, sizeof(int));
 	
 	// Print help
 	printHelp();
 	printf("$ ");
 	
 	while(TRUE) {		
-		cmd[0] = getc(stdin);
+		if((input = getc(stdin)) == EOF) {
+			closeSocket(controlSocket);
+			exit(EXIT_FAILURE);
+		}
+		cmd[0] = (char)input;
 		
 		switch(cmd[0]) {
 		case 'e': // exit
@@ -155,30 +416,48 @@ void processCommand(int* controlSocket)
 		case 'r': // receive file
 			cmd[0] = (char)0;
 			printf("Enter Filename: ");
-			scanf("%s", cmd + 1);
-			// Send Command and file name
-			if(sendData(controlSocket, cmd, BUFFER_LENGTH) == -1) {
-				systemFatal("Error sending receive command");
+			if(readFileName(cmd + 1) == -1) {
+				continue;
 			}
-			closeSocket(controlSocket);
-			receiveFile(port, cmd + 1);
-			exit(EXIT_SUCCESS);
+			if(stripes > 1) {
+				processStriped(controlSocket, cmd, ip, passive, stripes);
+			}
+			exit(transferStripe(controlSocket, cmd, passive, 0, 1) == -1 ?
+				EXIT_FAILURE : EXIT_SUCCESS);
 		case 's': // send file
 			cmd[0] = (char)1;
 			printf("Enter Filename: ");
-			scanf("%s", cmd + 1);
-			// Send Command and file name
-			if(sendData(controlSocket, cmd, BUFFER_LENGTH) == -1) {
-				systemFatal("Error sending send command.");
+			if(readFileName(cmd + 1) == -1) {
+				continue;
 			}
 			if((temp = fopen(cmd + 1, "r"))== NULL) {
 				fprintf(stderr, "%s does not exist\n", cmd + 1);
 				continue;
 			}
 			fclose(temp);
-			closeSocket(controlSocket);
-			sendFile(port, cmd + 1);
-			exit(EXIT_SUCCESS);
+			if(stripes > 1) {
+				processStriped(controlSocket, cmd, ip, passive, stripes);
+			}
+			exit(transferStripe(controlSocket, cmd, passive, 0, 1) == -1 ?
+				EXIT_FAILURE : EXIT_SUCCESS);
+		case 'g': // receive a batch of files
+			cmd[0] = (char)BATCH_GET;
+			printf("Enter Files: ");
+			exit(processBatch(controlSocket, cmd, passive) == -1 ?
+				EXIT_FAILURE : EXIT_SUCCESS);
+		case 'p': // send a batch of files
+			cmd[0] = (char)BATCH_SEND;
+			printf("Enter Files: ");
+			exit(processBatch(controlSocket, cmd, passive) == -1 ?
+				EXIT_FAILURE : EXIT_SUCCESS);
+		case 'l': // list the files on the server
+			cmd[0] = (char)REQUEST_LIST;
+			printf("Enter Prefix (* for all): ");
+			if(readFileName(cmd + 1) == -1) {
+				continue;
+			}
+			exit(processList(controlSocket, cmd, passive, verify) == -1 ?
+				EXIT_FAILURE : EXIT_SUCCESS);
 		case 'h': // show commands
 			printHelp();
 			printf("$ ");
@@ -193,153 +472,1716 @@ void processCommand(int* controlSocket)
 }
 
 /*
--- FUNCTION: receiveFile
+-- FUNCTION: processStriped
 --
--- DATE: September 23, 2011
+-- DATE: October 17, 2026
 --
 -- REVISIONS:
 --
--- DESIGNER: Karl Castillo
+-- INTERFACE: void processStriped(int* controlSocket, char* cmd,
+--				const char* ip, int passive, int stripes)
+--				controlSocket - pointer to the controlSocket
+--				cmd - the command packet holding the command and file name
+--				ip - ip address of the server
+--				passive - ask the server for passive transfers
+--				stripes - the number of stripes to move the file in
 --
--- PROGRAMMER: Karl Castillo
+-- RETURNS: void, the program exits when every stripe is done
 --
--- INTERFACE: void receiveFile(int port, const char* fileName)
---				socket - the current socket the client is connected as
---				fileName - the name of the file to be received/downloaded
+-- NOTES:
+-- This function moves a file in stripes. A child process is forked for every
+-- stripe and each one sends the command with its stripe on a control
+-- connection of its own, the first one reusing the control socket, and then
+-- moves its byte range of the file over its own data connection. The server
+-- serves every connection on its own, so the stripes run in parallel.
 --
--- RETURNS: void
+-- All control connections are made before any stripe starts. The server
+-- connects back to the port of each control socket, and a control connection
+-- made later could be given the port a stripe just closed and is about to
+-- listen on.
 --
--- NOTES:
--- This function sends the receive command and waits for the reply of the 
--- transfer server. The transfer server will reply with the contents of the
--- file. If the file is not present, the server will return an error message.
--- This error message will be printed out.
+-- A received file is truncated here once, the stripes only write their own
+-- ranges of it.
 --
--- Once all the contents of the file are received and written to a file, the
--- program will print out a success message.
+-- The program exits with EXIT_FAILURE if any stripe failed.
 */
-void receiveFile(int port, const char* fileName)
+void processStriped(int* controlSocket, char* cmd, const char* ip,
+	int passive, int stripes)
 {
-	char* buffer = (char*)malloc(sizeof(char) * BUFFER_LENGTH);
-	FILE* file = NULL;
-	off_t fileSize = 0;
-	int bytesRead = 0;
-	int count = 0;
-	int transferSocket = 0;
+	pid_t* children = (pid_t*)malloc(sizeof(pid_t) * stripes);
+	int* sockets = (int*)malloc(sizeof(int) * stripes);
 	char* fileNamePath = (char*)malloc(sizeof(char) * FILENAME_MAX);
+	int file = 0;
+	int status = 0;
+	int failures = 0;
+	int i = 0;
+	int j = 0;
 	
-	initalizeServer(&port, &transferSocket);
+	if(cmd[0] == GET_FILE) {
+		sprintf(fileNamePath, "%s%s", DEF_DIR, cmd + 1);
+		if((file = open(fileNamePath, O_WRONLY | O_CREAT | O_TRUNC,
+				00400 | 00200 | 00100)) == -1) {
+			fprintf(stderr, "Error opening file: %s\n", cmd + 1);
+			exit(EXIT_FAILURE);
+		}
+		close(file);
+	}
 	
-	// Get Size of file
-	readData(&transferSocket, buffer, BUFFER_LENGTH);
-	memmove((void*)&fileSize, buffer, sizeof(off_t));
-	printf("Size of File: %d\n", (int)fileSize);
+	sockets[0] = *controlSocket;
+	for(i = 1; i < stripes; i++) {
+		sockets[i] = initConnection(DEF_PORT, ip);
+	}
 	
-	// Create file path
-	sprintf(fileNamePath, "%s%s", DEF_DIR, fileName);
-    printf("Save Path: %s\n", fileNamePath);
+	for(i = 0; i < stripes; i++) {
+		if((children[i] = fork()) == 0) {
+			// Keep only the control socket of this stripe
+			for(j = 0; j < stripes; j++) {
+				if(j != i) {
+					close(sockets[j]);
+				}
+			}
+			exit(transferStripe(&sockets[i], cmd, passive, i, stripes) ==
+				-1 ? EXIT_FAILURE : EXIT_SUCCESS);
+		}
+		if(children[i] == -1) {
+			systemFatal("Error creating stripe");
+		}
+	}
+	for(i = 0; i < stripes; i++) {
+		close(sockets[i]);
+	}
 	
-	// Opening file for writing
-	if((file = fopen(fileNamePath, "wb")) == NULL) {
-		fprintf(stderr, "Error opening file: %s\n", fileName);
-		return;
+	for(i = 0; i < stripes; i++) {
+		if(waitpid(children[i], &status, 0) == -1 || !WIFEXITED(status) ||
+				WEXITSTATUS(status) != EXIT_SUCCESS) {
+			failures++;
+		}
 	}
 	
-	// Hide Cursor
-	fprintf(stderr, "\033[?25l");
+	free(children);
+	free(sockets);
+	free(fileNamePath);
 	
-	// Start Reading from socket
-	while (count < (fileSize - BUFFER_LENGTH)) {
-        bytesRead = readData(&transferSocket, buffer, BUFFER_LENGTH);
-        fwrite(buffer, sizeof(char), bytesRead, file);
-        count += bytesRead;
-        printProgressBar(fileSize, count);
-    }
+	// Print Success message
+	if(failures > 0) {
+		printf("Transfer Failed! %d of %d stripes failed\n", failures,
+			stripes);
+		exit(EXIT_FAILURE);
+	}
+	printf("Transfer Complete!\n");
+	exit(EXIT_SUCCESS);
+}
+
+/*
+-- FUNCTION: transferStripe
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+-- October 17, 2026 - delta uploads are sent by sendDeltaFile.
+-- October 17, 2026 - deduplicated uploads are sent by sendChunkedFile.
+-- October 17, 2026 - passes on whether bodies may be compressed.
+-- October 17, 2026 - passes on whether bodies are verified.
+--
+-- INTERFACE: int transferStripe(int* controlSocket, char* cmd, int passive,
+--				int stripe, int stripes)
+--				controlSocket - pointer to the controlSocket
+--				cmd - the command packet holding the command and file name
+--				passive - ask the server for passive transfers
+--				stripe - the stripe to move
+--				stripes - the number of stripes the file is moved in
+--
+-- RETURNS: int - 0 on success, -1 if the transfer failed
+--
+-- NOTES:
+-- This function sends the command for one stripe of a file, sets up the
+-- transfer socket and moves the stripe. A whole file is stripe 0 of 1.
+--
+-- A download that is resumed sends the resume point of the part of the file
+-- that is already here along with the command. A delta upload is sent by
+-- sendDeltaFile and a deduplicated upload by sendChunkedFile.
+*/
+int transferStripe(int* controlSocket, char* cmd, int passive, int stripe,
+	int stripes)
+{
+	struct resumePoint resume;
+	int port = getPort(controlSocket);
+	int transferSocket = 0;
+	int flags = 0;
 	
-	bytesRead = readData(&transferSocket, buffer, fileSize - count);
-	printProgressBar(fileSize, count + bytesRead);
-    fwrite(buffer, sizeof(char), bytesRead, file);
-	// End Reading from socket
+	memmove(cmd + CONTROL_STRIPE, (void*)&stripe, sizeof(int));
+	memmove(cmd + CONTROL_STRIPES, (void*)&stripes, sizeof(int));
+	memmove((void*)&flags, cmd + CONTROL_FLAGS, sizeof(int));
+	if((flags & FLAG_RESUME) && cmd[0] == GET_FILE) {
+		findPartial(cmd + 1, &resume);
+		packResume(cmd + CONTROL_RESUME, &resume);
+	}
 	
-	// Show Cursor
-	fprintf(stderr, "\033[?25h\n");
+	// Send Command and file name
+	if(sendData(controlSocket, cmd, BUFFER_LENGTH) == -1) {
+		systemFatal("Error sending command");
+	}
+	transferSocket = initTransfer(controlSocket, port, passive);
 	
-	// Close file
-	fclose(file);
+	if(cmd[0] == GET_FILE) {
+		return receiveFile(transferSocket, cmd + 1, stripe, stripes,
+			flags & FLAG_RESUME, flags & FLAG_COMPRESS, flags & FLAG_VERIFY);
+	}
+	if(flags & FLAG_DELTA) {
+		return sendDeltaFile(transferSocket, cmd + 1);
+	}
+	if(flags & FLAG_DEDUP) {
+		return sendChunkedFile(transferSocket, cmd + 1);
+	}
+	return sendFile(transferSocket, cmd + 1, stripe, stripes,
+		flags & FLAG_RESUME, flags & FLAG_COMPRESS, flags & FLAG_VERIFY);
+}
+
+/*
+-- FUNCTION: processBatch
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int processBatch(int* controlSocket, char* cmd, int passive)
+--				controlSocket - pointer to the controlSocket
+--				cmd - the command packet, BATCH_GET or BATCH_SEND
+--				passive - ask the server for passive transfers
+--
+-- RETURNS: int - 0 on success, -1 if any file failed
+--
+-- NOTES:
+-- This function moves a batch of files over one data connection, see
+-- batch.c. The user enters the names on one line, each a file, a directory
+-- or a pattern like *.txt. A batch sent to the server is worked out here from
+-- the local files. A batch received from the server is worked out by the
+-- server, the names are sent to it as they are typed.
+--
+-- Every file follows the one before it without waiting, so a batch of many
+-- small files costs one connection instead of one per file. Files are moved
+-- whole, the options for single transfers do not apply.
+*/
+int processBatch(int* controlSocket, char* cmd, int passive)
+{
+	struct batchList names;
+	struct batchStats stats;
+	char* buffer = takeBuffer(&buffers);
+	char* line = NULL;
+	char* name = NULL;
+	int port = getPort(controlSocket);
+	int transferSocket = 0;
+	int receivePipe[2];
+	int result = 0;
 	
-	chmod(fileName, 00400 | 00200 | 00100);
-    
-    // Free memory allocated for buffer
-    free(buffer);
-    
-    // Print Success message
-    printf("Transfer Complete!\n");
+	if(buffer == NULL) {
+		systemFatal("Error allocating buffer");
+	}
+	bzero(&names, sizeof(struct batchList));
+	if((line = readFileList()) == NULL) {
+		returnBuffer(&buffers, buffer);
+		return -1;
+	}
+	
+	// A batch sent is expanded here, a batch received by the server
+	for(name = strtok(line, " \t"); name != NULL; name = strtok(NULL, " \t")) {
+		if(cmd[0] == BATCH_GET) {
+			result = addName(&names, name);
+		} else if((result = addPaths(&names, "", name)) == 0) {
+			fprintf(stderr, "%s does not exist\n", name);
+		}
+		if(result == -1) {
+			systemFatal("Error reading file names");
+		}
+	}
+	free(line);
+	if(names.count == 0) {
+		fprintf(stderr, "No files to transfer\n");
+		returnBuffer(&buffers, buffer);
+		return -1;
+	}
+	
+	// Send Command, the names follow on the transfer socket
+	cmd[1] = '\0';
+	if(sendData(controlSocket, cmd, BUFFER_LENGTH) == -1) {
+		systemFatal("Error sending command");
+	}
+	transferSocket = initTransfer(controlSocket, port, passive);
+	
+	if(cmd[0] == BATCH_GET) {
+		openReceivePipe(receivePipe, buffers.size);
+		result = sendNames(transferSocket, &names) == -1 ||
+			receiveEntries(transferSocket, DEF_DIR, receivePipe, buffer,
+			buffers.size, &stats, printEntry) == -1 ? -1 : 0;
+		closeReceivePipe(receivePipe);
+	} else {
+		result = sendEntries(transferSocket, "", &names, &stats,
+			printEntry);
+		if(readResult(transferSocket) == -1) {
+			result = -1;
+		}
+	}
+	closeSocket(&transferSocket);
+	
+	printf("%d files, %lld bytes\n", stats.files, (long long)stats.bytes);
+	if(result == -1 || stats.failures > 0) {
+		printf("Transfer Failed!\n");
+		result = -1;
+	} else {
+		printf("Transfer Complete!\n");
+	}
+	
+	freeNames(&names);
+	returnBuffer(&buffers, buffer);
+	return result;
 }
 
+/*
+-- FUNCTION: printEntry
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: void printEntry(const char* name, off_t size, int success)
+--				name - the name of the file
+--				size - the size of the file, ENTRY_MISSING if not found
+--				success - whether the file was moved
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function is called for every file of a batch and prints the ones
+-- that failed.
+*/
+void printEntry(const char* name, off_t size, int success)
+{
+	if(size == ENTRY_MISSING) {
+		fprintf(stderr, "%s does not exist\n", name);
+	} else if(!success) {
+		fprintf(stderr, "%s: Transfer Failed!\n", name);
+	}
+}
 
 /*
--- FUNCTION: sendFile
+-- FUNCTION: processList
 --
--- DATE: September 23, 2011
+-- DATE: October 17, 2026
 --
 -- REVISIONS:
 --
--- DESIGNER: Karl Castillo
+-- INTERFACE: int processList(int* controlSocket, char* cmd, int passive,
+--				int verify)
+--				controlSocket - pointer to the controlSocket
+--				cmd - the command packet holding the prefix of the names
+--				passive - ask the server for passive transfers
+--				verify - ask for the checksum of every file
 --
--- PROGRAMMER: Karl Castillo
+-- RETURNS: int - 0 on success, -1 on failure
 --
--- INTERFACE: void sendFile(int port, const char* fileName)
---				socket - the current socket the client is connected as
---				fileName - the name of the file to be received/downloaded
+-- NOTES:
+-- This function lists the files on the server whose names start with the
+-- prefix in the command packet, a star at the end of it is dropped so * lists
+-- every file. The server sends the list a page at a time from an index it
+-- keeps of its files, see list.c, and the next page is asked for on the same
+-- connection once one is printed.
+*/
+int processList(int* controlSocket, char* cmd, int passive, int verify)
+{
+	struct listEntry entry;
+	unsigned int matches = 0;
+	int port = getPort(controlSocket);
+	int transferSocket = 0;
+	int more = 1;
+	int result = 0;
+	size_t length = strlen(cmd + 1);
+	
+	if(length > 0 && cmd[length] == '*') {
+		cmd[length] = '\0';
+	}
+	bzero(&entry, sizeof(struct listEntry));
+	
+	// Send Command, the pages are asked for on the transfer socket
+	if(sendData(controlSocket, cmd, BUFFER_LENGTH) == -1) {
+		systemFatal("Error sending command");
+	}
+	transferSocket = initTransfer(controlSocket, port, passive);
+	
+	while(more && result != -1) {
+		if(sendListRequest(transferSocket, entry.name, LIST_PAGE,
+				verify ? LIST_HASH : 0) == -1) {
+			result = -1;
+			break;
+		}
+		result = readListPage(transferSocket, &entry, printListed, &matches,
+			&more);
+	}
+	closeSocket(&transferSocket);
+	
+	if(result == -1) {
+		printf("Listing Failed!\n");
+		return -1;
+	}
+	printf("%u files\n", matches);
+	
+	return 0;
+}
+
+/*
+-- FUNCTION: printListed
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: void printListed(const struct listEntry* entry)
+--				entry - a file of the listing
 --
 -- RETURNS: void
 --
 -- NOTES:
--- This function sends the receive command and waits for the reply of the 
--- transfer server. The transfer server will reply with the contents of the
--- file. If the file is not present, the server will return an error message.
--- This error message will be printed out.
+-- This function prints a file of a listing, its size, when it last changed,
+-- its checksum if the server sent one and its name.
+*/
+void printListed(const struct listEntry* entry)
+{
+	char modified[32];
+	time_t seconds = (time_t)entry->modified;
+	
+	strftime(modified, sizeof(modified), "%Y-%m-%d %H:%M",
+		localtime(&seconds));
+	if(entry->hashed) {
+		printf("%12lld %s %08x %s\n", (long long)entry->size, modified,
+			entry->hash, entry->name);
+	} else {
+		printf("%12lld %s %s\n", (long long)entry->size, modified,
+			entry->name);
+	}
+}
+
+/*
+-- FUNCTION: findPartial
 --
--- Once all the contents of the file are received and written to a file, the
--- program will print out a success message.
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: void findPartial(const char* fileName,
+--				struct resumePoint* resume)
+--				fileName - the name of the file being downloaded
+--				resume - where the resume point is stored
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function finds the resume point of what an earlier download left of
+-- the file, see findResume. Without a file the resume point is empty and the
+-- whole file is downloaded.
 */
-void sendFile(int port, const char* fileName)
+void findPartial(const char* fileName, struct resumePoint* resume)
 {
-	struct stat statBuffer;
-	char *buffer = (char*)calloc(BUFFER_LENGTH, sizeof(char));
+	char* buffer = takeBuffer(&buffers);
+	char* fileNamePath = (char*)malloc(sizeof(char) * FILENAME_MAX);
 	int file = 0;
-    int transferSocket = 0;
 	
-	initalizeServer(&port, &transferSocket);
+	if(buffer == NULL) {
+		systemFatal("Error allocating buffer");
+	}
 	
-	if ((file = open(fileName, O_RDONLY)) == -1) {
-        systemFatal("Unable To Open File");
+	resume->length = 0;
+	resume->checksum = 0;
+	sprintf(fileNamePath, "%s%s", DEF_DIR, fileName);
+	if((file = open(fileNamePath, O_RDONLY)) != -1) {
+		findResume(file, resume, buffer, buffers.size);
+		close(file);
 	}
 	
-	// Get size of file
-	if (fstat(file, &statBuffer) == -1) {
-        systemFatal("Error Getting File Information");
-    }
-    memmove(buffer, (void*)&statBuffer.st_size, sizeof(off_t));
-    
-    printf("Connected to server and sending %s\n", fileName);
-    
-    // Send file size
-    if (sendData(&transferSocket, buffer, BUFFER_LENGTH) == -1) {
-        systemFatal("Send Failed");
-    }
-    
-    // Send the file to the client
-    if (sendfile(transferSocket, file, NULL, statBuffer.st_size) == -1) {
-        fprintf(stderr, "Error sending %s\n", fileName);
-    }
-    
-    // Close the file
-    close(file);
-    free(buffer);
-    
-    // Print Success message
-    printf("Transfer Complete!\n");
+	free(fileNamePath);
+	returnBuffer(&buffers, buffer);
+}
+
+/*
+-- FUNCTION: processMultiplexed
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+-- October 17, 2026 - the command uses a pooled buffer.
+-- October 17, 2026 - added ip and idle, the session is kept alive, closed
+-- when idle and opened again by the next command.
+--
+-- INTERFACE: void processMultiplexed(int* controlSocket, const char* ip,
+--				int idle)
+--				controlSocket - pointer to the controlSocket
+--				ip - ip address of the server
+--				idle - seconds the session may be idle, 0 for no limit
+--
+-- RETURNS: void, the program exits when the session is over
+--
+-- NOTES:
+-- This function runs the same menu as processCommand over a multiplexed
+-- session. The control socket stays open and every file travels over it as a
+-- stream of frames, so there is no connect back and no second connection.
+-- Commands are read while transfers are running, so several files can be in
+-- flight at once. Exiting waits for the running transfers to finish.
+--
+-- The session outlives its transfers, a command costs a frame instead of a
+-- connection. The poll wakes up at least every MUX_CHECK_INTERVAL so the
+-- session can ping a quiet server and notice one that stopped answering. A
+-- session that was idle for too long, or that the server closed while idle,
+-- is closed here without a word and opened again when the user types.
+--
+-- The program exits with EXIT_FAILURE if any transfer failed.
+*/
+void processMultiplexed(int* controlSocket, const char* ip, int idle)
+{
+	struct muxSession* session = NULL;
+	struct pollfd fds[2];
+	char* input = (char*)malloc(sizeof(char) * FILENAME_MAX);
+	int inputCount = 0;
+	char command = 0;
+	int exiting = 0;
+	int failures = 0;
+	int result = 0;
+	
+	session = openSession(controlSocket, ip, idle);
+	
+	printHelp();
+	printf("$ ");
+	fflush(stdout);
+	
+	while(!exiting || (session != NULL && session->active > 0)) {
+		fds[0].fd = exiting ? -1 : STDIN_FILENO;
+		fds[0].events = POLLIN;
+		fds[1].fd = session == NULL ? -1 : *controlSocket;
+		fds[1].events = POLLIN;
+		if(session != NULL && muxWantsWrite(session)) {
+			fds[1].events |= POLLOUT;
+		}
+		
+		if(poll(fds, 2, MUX_CHECK_INTERVAL) == -1) {
+			if(errno == EINTR) {
+				continue;
+			}
+			systemFatal("poll Error");
+		}
+		
+		if(fds[0].revents & (POLLIN | POLLHUP)) {
+			if(session == NULL) {
+				session = openSession(controlSocket, ip, idle);
+			}
+			exiting = processInput(session, input, &inputCount,
+				&command) == -1;
+		}
+		if(session == NULL) {
+			continue;
+		}
+		
+		if(((fds[1].revents & (POLLIN | POLLHUP | POLLERR)) &&
+			muxRead(session) == -1) || muxWrite(session) == -1) {
+			result = MUX_DEAD;
+		} else {
+			result = muxCheck(session);
+		}
+		if(result == MUX_ALIVE) {
+			continue;
+		}
+		
+		// A session lost with nothing running is opened again when needed
+		if(session->active > 0) {
+			fprintf(stderr, "Connection to server lost\n");
+		}
+		failures += closeSession(session, controlSocket);
+		session = NULL;
+	}
+	
+	if(session != NULL) {
+		failures += closeSession(session, controlSocket);
+	}
+	free(input);
+	
+	exit(failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/*
+-- FUNCTION: openSession
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: struct muxSession* openSession(int* controlSocket,
+--				const char* ip, int idle)
+--				controlSocket - pointer to the controlSocket, -1 if the
+--				client is not connected
+--				ip - ip address of the server
+--				idle - seconds the session may be idle, 0 for no limit
+--
+-- RETURNS: struct muxSession* - the new session
+--
+-- NOTES:
+-- This function asks the server for a multiplexed session on the control
+-- socket, connecting first if the client is not connected.
+*/
+struct muxSession* openSession(int* controlSocket, const char* ip, int idle)
+{
+	struct muxSession* session = NULL;
+	char* cmd = takeBuffer(&buffers);
+	
+	if(cmd == NULL) {
+		systemFatal("Error allocating buffer");
+	}
+	bzero(cmd, BUFFER_LENGTH);
+	
+	if(*controlSocket == -1) {
+		*controlSocket = initConnection(DEF_PORT, ip);
+	}
+	
+	// Ask the server for a multiplexed session
+	cmd[0] = (char)MULTIPLEX;
+	if(sendData(controlSocket, cmd, BUFFER_LENGTH) == -1) {
+		systemFatal("Error sending multiplex command");
+	}
+	if(makeSocketNonBlocking(controlSocket) == -1) {
+		systemFatal("Error making socket non blocking");
+	}
+	if((session = muxCreate(*controlSocket, 0, DEF_DIR,
+		printTransfer)) == NULL) {
+		systemFatal("Error creating session");
+	}
+	session->idleTimeout = (long long)idle * 1000;
+	
+	returnBuffer(&buffers, cmd);
+	return session;
+}
+
+/*
+-- FUNCTION: closeSession
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int closeSession(struct muxSession* session,
+--				int* controlSocket)
+--				session - the multiplexed session
+--				controlSocket - pointer to the controlSocket, set to -1
+--
+-- RETURNS: int - the number of transfers of the session that failed
+--
+-- NOTES:
+-- This function closes a session and its socket. Transfers that are still
+-- running fail.
+*/
+int closeSession(struct muxSession* session, int* controlSocket)
+{
+	int failures = session->failures + session->active;
+	
+	muxDestroy(session);
+	closeSocket(controlSocket);
+	*controlSocket = -1;
+	
+	return failures;
+}
+
+/*
+-- FUNCTION: processInput
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int processInput(struct muxSession* session, char* input,
+--				int* inputCount, char* command)
+--				session - the multiplexed session
+--				input - the buffer holding a partial line
+--				inputCount - the number of bytes in the buffer
+--				command - the command waiting for a file name
+--
+-- RETURNS: int - 0 to keep going, -1 on exit or end of input
+--
+-- NOTES:
+-- This function reads what the user typed so far and hands every complete
+-- line to processLine. Lines that do not fit the buffer are dropped.
+*/
+int processInput(struct muxSession* session, char* input, int* inputCount,
+	char* command)
+{
+	char* newline = NULL;
+	int bytesRead = 0;
+	int length = 0;
+	
+	bytesRead = read(STDIN_FILENO, input + *inputCount,
+		FILENAME_MAX - 1 - *inputCount);
+	if(bytesRead <= 0) {
+		return -1;
+	}
+	*inputCount += bytesRead;
+	
+	while((newline = (char*)memchr(input, '\n', *inputCount)) != NULL) {
+		*newline = '\0';
+		length = newline - input + 1;
+		if(processLine(session, input, command) == -1) {
+			return -1;
+		}
+		memmove(input, input + length, *inputCount - length);
+		*inputCount -= length;
+	}
+	
+	if(*inputCount == FILENAME_MAX - 1) {
+		*inputCount = 0;
+	}
+	
+	return 0;
+}
+
+/*
+-- FUNCTION: processLine
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int processLine(struct muxSession* session, char* line,
+--				char* command)
+--				session - the multiplexed session
+--				line - one line typed by the user
+--				command - the command waiting for a file name
+--
+-- RETURNS: int - 0 to keep going, -1 on exit
+--
+-- NOTES:
+-- This function handles one line of the menu. A line starts with a command
+-- character. The file name for r and s can follow on the same line or is asked
+-- for on the next one.
+*/
+int processLine(struct muxSession* session, char* line, char* command)
+{
+	char* name = line;
+	
+	if(*command == 0) {
+		while(*line == ' ') {
+			line++;
+		}
+		if(*line == '\0') {
+			return 0;
+		}
+		*command = *line;
+		name = line + 1;
+		
+		switch(*command) {
+		case 'e': // exit
+			return -1;
+		case 'h': // show commands
+			printHelp();
+			*command = 0;
+			break;
+		case 'f':
+			system("ls");
+			*command = 0;
+			break;
+		case 'r': // receive file
+		case 's': // send file
+			break;
+		default:
+			*command = 0;
+			break;
+		}
+	}
+	
+	if(*command == 0) {
+		printf("$ ");
+		fflush(stdout);
+		return 0;
+	}
+	
+	while(*name == ' ') {
+		name++;
+	}
+	if(*name == '\0') {
+		printf("Enter Filename: ");
+		fflush(stdout);
+		return 0;
+	}
+	
+	if(strlen(name) > MAX_NAME_LENGTH) {
+		fprintf(stderr, "File name is too long\n");
+	} else if(*command == 'r' && muxGet(session, name) == -1) {
+		fprintf(stderr, "Error receiving %s\n", name);
+	} else if(*command == 's' && muxPut(session, name) == -1) {
+		fprintf(stderr, "%s does not exist\n", name);
+	}
+	
+	*command = 0;
+	printf("$ ");
+	fflush(stdout);
+	return 0;
+}
+
+/*
+-- FUNCTION: printTransfer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: void printTransfer(struct muxStream* stream, int success)
+--				stream - the stream that finished
+--				success - whether the transfer succeeded
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function is called by the session when a transfer finishes.
+*/
+void printTransfer(struct muxStream* stream, int success)
+{
+	printf("\n%s: %s\n", stream->name,
+		success ? "Transfer Complete!" : "Transfer Failed!");
+	fflush(stdout);
+}
+
+/*
+-- FUNCTION: parseWords
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int parseWords(struct script* script, char** words, int count)
+--				script - the script the files are added to
+--				words - the words after the options
+--				count - the number of words
+--
+-- RETURNS: int - 0 on success, -1 if the words do not make sense
+--
+-- NOTES:
+-- This function adds the transfers given on the command line to the script.
+-- A get or put applies to every name after it up to the next get or put. A
+-- - reads more transfers from stdin, see readScript.
+*/
+int parseWords(struct script* script, char** words, int count)
+{
+	int put = -1;
+	int i = 0;
+	
+	for(i = 0; i < count; i++) {
+		if(strcmp(words[i], "-") == 0) {
+			if(readScript(script, stdin) == -1) {
+				return -1;
+			}
+		} else if(strcmp(words[i], "get") == 0) {
+			put = 0;
+		} else if(strcmp(words[i], "put") == 0) {
+			put = 1;
+		} else if(put == -1) {
+			fprintf(stderr, "%s: get or put must come first\n", words[i]);
+			return -1;
+		} else if(addCommand(script, put, words[i]) == -1) {
+			return -1;
+		}
+	}
+	
+	return 0;
+}
+
+/*
+-- FUNCTION: readScript
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int readScript(struct script* script, FILE* file)
+--				script - the script the files are added to
+--				file - the script to read
+--
+-- RETURNS: int - 0 on success, -1 if a line does not make sense
+--
+-- NOTES:
+-- This function reads a script to the end and adds its transfers to the
+-- script. Every line is a get or a put followed by the names of the files,
+-- blank lines and everything after a # are skipped.
+*/
+int readScript(struct script* script, FILE* file)
+{
+	char* line = NULL;
+	char* word = NULL;
+	char* comment = NULL;
+	size_t size = 0;
+	int lineNumber = 0;
+	int put = 0;
+	int result = 0;
+	
+	while(result == 0 && getline(&line, &size, file) != -1) {
+		lineNumber++;
+		if((comment = strchr(line, '#')) != NULL) {
+			*comment = '\0';
+		}
+		if((word = strtok(line, " \t\r\n")) == NULL) {
+			continue;
+		}
+		
+		if(strcmp(word, "get") == 0) {
+			put = 0;
+		} else if(strcmp(word, "put") == 0) {
+			put = 1;
+		} else {
+			fprintf(stderr, "Line %d: %s is not get or put\n", lineNumber,
+				word);
+			result = -1;
+		}
+		while(result == 0 && (word = strtok(NULL, " \t\r\n")) != NULL) {
+			result = addCommand(script, put, word);
+		}
+	}
+	
+	free(line);
+	return result;
+}
+
+/*
+-- FUNCTION: addCommand
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int addCommand(struct script* script, int put,
+--				const char* name)
+--				script - the script the file is added to
+--				put - 1 to send the file, 0 to receive it
+--				name - the name of the file
+--
+-- RETURNS: int - 0 on success, -1 if the name is too long
+--
+-- NOTES:
+-- This function adds one transfer to the end of the script.
+*/
+int addCommand(struct script* script, int put, const char* name)
+{
+	struct scriptCommand* commands = NULL;
+	
+	if(strlen(name) > MAX_NAME_LENGTH) {
+		fprintf(stderr, "%s: File name is too long\n", name);
+		return -1;
+	}
+	
+	if(script->count == script->size) {
+		script->size = script->size == 0 ? 16 : script->size * 2;
+		if((commands = (struct scriptCommand*)realloc(script->commands,
+				sizeof(struct scriptCommand) * script->size)) == NULL) {
+			systemFatal("Error allocating commands");
+		}
+		script->commands = commands;
+	}
+	
+	bzero(&script->commands[script->count], sizeof(struct scriptCommand));
+	script->commands[script->count].put = put;
+	strcpy(script->commands[script->count].name, name);
+	script->count++;
+	
+	return 0;
+}
+
+/*
+-- FUNCTION: runScript
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: void runScript(int* controlSocket, const char* ip,
+--				struct script* script)
+--				controlSocket - pointer to the controlSocket
+--				ip - ip address of the server
+--				script - the transfers to run
+--
+-- RETURNS: void, the program exits when every transfer is done
+--
+-- NOTES:
+-- This function runs a script over one multiplexed session. There is no
+-- menu and nothing is read from the user. Up to SCRIPT_STREAMS transfers are
+-- in flight at once, the next one is started as soon as one finishes, so the
+-- server never waits for the client between files.
+--
+-- A line is printed for every file as it finishes and a total at the end.
+-- The program exits with EXIT_FAILURE if any file failed. A lost connection
+-- fails every file that was not done.
+*/
+void runScript(int* controlSocket, const char* ip, struct script* script)
+{
+	struct muxSession* session = NULL;
+	struct pollfd pollSocket;
+	int i = 0;
+	
+	activeScript = script;
+	session = openSession(controlSocket, ip, 0);
+	session->finished = finishCommand;
+	startCommands(session, script);
+	
+	while(script->first < script->count) {
+		pollSocket.fd = *controlSocket;
+		pollSocket.events = POLLIN | (muxWantsWrite(session) ? POLLOUT : 0);
+		if(poll(&pollSocket, 1, MUX_CHECK_INTERVAL) == -1) {
+			if(errno == EINTR) {
+				continue;
+			}
+			systemFatal("poll Error");
+		}
+		
+		if(((pollSocket.revents & (POLLIN | POLLHUP | POLLERR)) &&
+			muxRead(session) == -1) || muxWrite(session) == -1 ||
+			muxCheck(session) == MUX_DEAD) {
+			fprintf(stderr, "Connection to server lost\n");
+			break;
+		}
+		startCommands(session, script);
+	}
+	
+	closeSession(session, controlSocket);
+	for(i = script->first; i < script->count; i++) {
+		if(script->commands[i].state == SCRIPT_WAITING) {
+			endCommand(script, &script->commands[i], 0);
+		}
+	}
+	
+	printf("%d of %d files transferred\n", script->count - script->failures,
+		script->count);
+	free(script->commands);
+	exit(script->failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/*
+-- FUNCTION: startCommands
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: void startCommands(struct muxSession* session,
+--				struct script* script)
+--				session - the multiplexed session
+--				script - the transfers to run
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function opens a stream for the next transfers of the script until
+-- SCRIPT_STREAMS of them are running. A file that can not be opened, such as
+-- a put of a file that does not exist, fails on its own.
+*/
+void startCommands(struct muxSession* session, struct script* script)
+{
+	struct scriptCommand* command = NULL;
+	
+	while(script->next < script->count && script->running < SCRIPT_STREAMS) {
+		command = &script->commands[script->next++];
+		command->state = SCRIPT_RUNNING;
+		script->running++;
+		
+		command->stream = command->put ? muxPut(session, command->name) :
+			muxGet(session, command->name);
+		if(command->stream == -1) {
+			fprintf(stderr, "%s: %s\n", command->name, strerror(errno));
+			endCommand(script, command, 0);
+		}
+	}
+}
+
+/*
+-- FUNCTION: endCommand
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: void endCommand(struct script* script,
+--				struct scriptCommand* command, int success)
+--				script - the transfers being run
+--				command - the transfer that ended
+--				success - whether the transfer succeeded
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function records and prints the result of one transfer.
+*/
+void endCommand(struct script* script, struct scriptCommand* command,
+	int success)
+{
+	if(command->state == SCRIPT_RUNNING) {
+		script->running--;
+	}
+	command->state = success ? SCRIPT_DONE : SCRIPT_FAILED;
+	if(!success) {
+		script->failures++;
+	}
+	printf("%s %s: %s\n", command->put ? "put" : "get", command->name,
+		success ? "ok" : "failed");
+	
+	// Everything before first is done
+	while(script->first < script->count &&
+		script->commands[script->first].state >= SCRIPT_DONE) {
+		script->first++;
+	}
+}
+
+/*
+-- FUNCTION: finishCommand
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: void finishCommand(struct muxStream* stream, int success)
+--				stream - the stream that finished
+--				success - whether the transfer succeeded
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function is called by the session of a script when a transfer
+-- finishes. Only the transfers between the first one not done and the next
+-- one to start can be running.
+*/
+void finishCommand(struct muxStream* stream, int success)
+{
+	struct script* script = activeScript;
+	int i = 0;
+	
+	for(i = script->first; i < script->next; i++) {
+		if(script->commands[i].state == SCRIPT_RUNNING &&
+			script->commands[i].stream == (int)stream->id) {
+			endCommand(script, &script->commands[i], success);
+			return;
+		}
+	}
+}
+
+/*
+-- FUNCTION: receiveFile
+--
+-- DATE: September 23, 2011
+--
+-- REVISIONS:
+-- October 17, 2026 - takes the transfer socket set up by initTransfer.
+-- October 17, 2026 - splices the data from the socket to the file.
+-- October 17, 2026 - moves the data in chunks of the buffer pool's size.
+-- October 17, 2026 - receives a single stripe of the file.
+-- October 17, 2026 - resumes a download that died part way.
+-- October 17, 2026 - decodes a compressed body.
+-- October 17, 2026 - checks the checksums of a verified body.
+-- October 17, 2026 - preallocates the file, writes it behind and writes very
+-- large files directly.
+-- October 17, 2026 - receives into a mapping of the file.
+-- October 17, 2026 - fails when the server closes before the size.
+--
+-- DESIGNER: Karl Castillo
+--
+-- PROGRAMMER: Karl Castillo
+--
+-- INTERFACE: int receiveFile(int transferSocket, const char* fileName,
+--				int stripe, int stripes, int resume, int compress, int verify)
+--				transferSocket - the socket the file is received on
+--				fileName - the name of the file to be received/downloaded
+--				stripe - the stripe of the file that is received
+--				stripes - the number of stripes the file is moved in
+--				resume - whether the download is resumed
+--				compress - whether the server may send a compressed body
+--				verify - whether the body comes with checksums
+--
+-- RETURNS: int - 0 on success, -1 if the transfer failed
+--
+-- NOTES:
+-- This function sends the receive command and waits for the reply of the 
+-- transfer server. The transfer server will reply with the contents of the
+-- file. If the file is not present, the server closes the connection before
+-- the size control message and the transfer fails.
+--
+-- Once all the contents of the file are received and written to a file, the
+-- program will print out a success message.
+--
+-- The contents are moved from the socket to the file with splice so they are
+-- never copied into the program, see transfer.c.
+--
+-- A stripe is written at its own offset in the file, which is not truncated
+-- since the other stripes are written to it at the same time. Only a whole
+-- file shows the progress bar and the result.
+--
+-- When the download is resumed the size control message says where the
+-- server starts, the end of what is already here or the start of the file if
+-- that did not match. The file is cut back to that point.
+--
+-- When the size control message says the body is compressed its frames are
+-- decoded to the file, see compress.c.
+--
+-- A verified body is checked as it arrives, see verify.c. When it does not
+-- check out the transfer fails and a whole file is cut back to the part that
+-- did, so resuming the download fetches the rest again.
+--
+-- The blocks of the file are allocated before the body arrives and it is
+-- written back as it comes in, see transfer.c. A plain body of at least the
+-- size given with -O is written around the page cache. With -W any other
+-- plain body is received straight into a mapping of the file, and a whole
+-- file that ended early is cut back to what arrived.
+*/
+int receiveFile(int transferSocket, const char* fileName, int stripe,
+	int stripes, int resume, int compress, int verify)
+{
+	struct stat statBuffer;
+	struct frameDecoder decoder;
+	struct verifier verifier;
+	char* buffer = takeBuffer(&buffers);
+	int file = 0;
+	off_t fileSize = 0;
+	int bytesRead = 0;
+	off_t count = 0;
+	off_t offset = 0;
+	off_t length = 0;
+	off_t start = 0;
+	int flags = 0;
+	int result = 0;
+	int direct = 0;
+	int mapped = 0;
+	int receivePipe[2];
+	struct writeBehind behind;
+	struct fileMapping mapping;
+	char* fileNamePath = (char*)malloc(sizeof(char) * FILENAME_MAX);
+	
+	if(buffer == NULL) {
+		systemFatal("Error allocating buffer");
+	}
+	
+	// Get Size of file
+	if(readAll(&transferSocket, buffer, BUFFER_LENGTH) == -1) {
+		fprintf(stderr, "%s: Transfer Failed!\n", fileName);
+		closeSocket(&transferSocket);
+		free(fileNamePath);
+		returnBuffer(&buffers, buffer);
+		return -1;
+	}
+	memmove((void*)&fileSize, buffer, sizeof(off_t));
+	stripeRange(fileSize, stripe, stripes, &offset, &length);
+	if(resume) {
+		memmove((void*)&offset, buffer + HEADER_OFFSET, sizeof(off_t));
+		length = fileSize - offset;
+	}
+	if(compress) {
+		memmove((void*)&flags, buffer + HEADER_FLAGS, sizeof(int));
+	}
+	start = offset;
+	
+	// Create file path
+	sprintf(fileNamePath, "%s%s", DEF_DIR, fileName);
+	if(stripes == 1) {
+		printf("Size of File: %d\n", (int)fileSize);
+		printf("Save Path: %s\n", fileNamePath);
+	}
+	
+	// Opening file for writing, a resumed file must have what is kept and a
+	// mapping of it needs it readable too
+	if((file = open(fileNamePath, O_RDWR | O_CREAT,
+			00400 | 00200 | 00100)) == -1 || fstat(file, &statBuffer) == -1 ||
+			offset < 0 || length < 0 ||
+			(resume && offset > statBuffer.st_size) ||
+			ftruncate(file, stripes > 1 ? fileSize : offset) == -1 ||
+			((flags & BODY_COMPRESSED) && openDecoder(&decoder) == -1) ||
+			(verify && startVerifier(&verifier, file, offset, length, 1) ==
+			-1)) {
+		fprintf(stderr, "Error opening file: %s\n", fileName);
+		closeSocket(&transferSocket);
+		free(fileNamePath);
+		returnBuffer(&buffers, buffer);
+		return -1;
+	}
+	if(start > 0 && stripes == 1) {
+		printf("Resuming at %d\n", (int)start);
+	}
+	startReceive(&behind, file, offset, length);
+	direct = !(flags & BODY_COMPRESSED) && !verify && receiveDirectly(length);
+	mapped = !(flags & BODY_COMPRESSED) && !direct &&
+		openMapping(&mapping, file, fileSize) == 0;
+	
+	// Hide Cursor
+	if(stripes == 1) {
+		fprintf(stderr, "\033[?25l");
+	}
+	
+	// Start Reading from socket
+	openReceivePipe(receivePipe, buffers.size);
+	while(count < length) {
+		if(flags & BODY_COMPRESSED) {
+			bytesRead = receiveFrame(transferSocket, file, receivePipe,
+				&decoder, length - count < COMPRESS_BLOCK ? length - count :
+				COMPRESS_BLOCK, &offset);
+		} else if(direct) {
+			bytesRead = receiveDirect(transferSocket, file, buffer,
+				chunkLeft(verify ? &verifier : NULL, count,
+				length - count < buffers.size ? length - count :
+				buffers.size), &offset);
+		} else if(mapped) {
+			bytesRead = receiveMapped(transferSocket, &mapping,
+				chunkLeft(verify ? &verifier : NULL, count,
+				length - count < buffers.size ? length - count :
+				buffers.size), &offset);
+		} else {
+			bytesRead = receiveChunk(transferSocket, file, receivePipe,
+				buffer, chunkLeft(verify ? &verifier : NULL, count,
+				length - count < buffers.size ? length - count :
+				buffers.size), &offset);
+		}
+		if(bytesRead <= 0) {
+			break;
+		}
+		count += bytesRead;
+		writeBehind(&behind, offset);
+		if(stripes == 1) {
+			printProgressBar(fileSize, start + count);
+		}
+		if(takeChecksums(transferSocket, verify ? &verifier : NULL,
+				count) == -1) {
+			break;
+		}
+	}
+	closeReceivePipe(receivePipe);
+	if(flags & BODY_COMPRESSED) {
+		closeDecoder(&decoder);
+	}
+	result = count < length ? -1 : 0;
+	if(mapped) {
+		closeMapping(&mapping);
+		if(stripes == 1 && result == -1 && ftruncate(file, offset) == -1) {
+			fprintf(stderr, "Error cutting back file: %s\n", fileName);
+		}
+	}
+	// End Reading from socket
+	
+	// Keep only what checked out
+	if(verify && stopVerifier(&verifier) == -1) {
+		fprintf(stderr, "\nChecksum of %s failed after %d bytes\n",
+			fileName, (int)verifier.checked);
+		if(stripes == 1 && ftruncate(file, start + verifier.checked) == -1) {
+			fprintf(stderr, "Error cutting back file: %s\n", fileName);
+		}
+		result = -1;
+	}
+	
+	// Show Cursor
+	if(stripes == 1) {
+		fprintf(stderr, "\033[?25h\n");
+	}
+	
+	// Close file
+	close(file);
+	closeSocket(&transferSocket);
+    
+    // Free memory allocated for buffer
+    free(fileNamePath);
+    returnBuffer(&buffers, buffer);
+    
+	// Print Success message
+	if(result == -1) {
+		if(stripes == 1) {
+			printf("Transfer Failed!\n");
+		} else {
+			fprintf(stderr, "Stripe %d of %s failed\n", stripe, fileName);
+		}
+		return -1;
+	}
+	if(stripes == 1) {
+		printf("Transfer Complete!\n");
+	}
+	return 0;
+}
+
+
+/*
+-- FUNCTION: sendFile
+--
+-- DATE: September 23, 2011
+--
+-- REVISIONS:
+-- October 17, 2026 - takes the transfer socket set up by initTransfer.
+-- October 17, 2026 - the size header uses a pooled buffer.
+-- October 17, 2026 - sends a single stripe of the file.
+-- October 17, 2026 - resumes an upload that died part way.
+-- October 17, 2026 - sends a compressed body when it is worth it.
+-- October 17, 2026 - sends the checksums of a verified body.
+--
+-- DESIGNER: Karl Castillo
+--
+-- PROGRAMMER: Karl Castillo
+--
+-- INTERFACE: int sendFile(int transferSocket, const char* fileName,
+--				int stripe, int stripes, int resume, int compress, int verify)
+--				transferSocket - the socket the file is sent on
+--				fileName - the name of the file to be received/downloaded
+--				stripe - the stripe of the file that is sent
+--				stripes - the number of stripes the file is moved in
+--				resume - whether the upload is resumed
+--				compress - send a compressed body if the file shrinks
+--				verify - send the checksums of the body with it
+--
+-- RETURNS: int - 0 on success, -1 if the transfer failed
+--
+-- NOTES:
+-- This function sends the receive command and waits for the reply of the 
+-- transfer server. The transfer server will reply with the contents of the
+-- file. If the file is not present, the server will return an error message.
+-- This error message will be printed out.
+--
+-- Once all the contents of the file are received and written to a file, the
+-- program will print out a success message.
+--
+-- The size header holds the size of the whole file, the server works out the
+-- range of the stripe from it the same way.
+--
+-- When the upload is resumed the server first sends the resume point of what
+-- it has of the file. The upload starts at the end of that if it matches the
+-- file, see checkResume, and the size header tells the server where.
+--
+-- With compress a sample of the file is compressed first and if it shrinks
+-- the body is sent compressed, see compress.c, which the size header says.
+--
+-- With verify the checksums of the body are sent with it, see verify.c, and
+-- the server replies whether the body it got checked out.
+*/
+int sendFile(int transferSocket, const char* fileName, int stripe,
+	int stripes, int resume, int compress, int verify)
+{
+	struct resumePoint resumePoint;
+	struct compressStats stats;
+	struct verifier verifier;
+	struct stat statBuffer;
+	char *buffer = takeBuffer(&buffers);
+	int file = 0;
+	int result = 0;
+	int flags = 0;
+	off_t offset = 0;
+	off_t length = 0;
+	
+	if(buffer == NULL) {
+		systemFatal("Error allocating buffer");
+	}
+	bzero(buffer, BUFFER_LENGTH);
+	
+	if ((file = open(fileName, O_RDONLY)) == -1) {
+        systemFatal("Unable To Open File");
+	}
+	
+	// Get size of file
+	if (fstat(file, &statBuffer) == -1) {
+        systemFatal("Error Getting File Information");
+    }
+    stripeRange(statBuffer.st_size, stripe, stripes, &offset, &length);
+    
+    // Find out where the server wants the file to start
+    if(resume) {
+        if(readData(&transferSocket, buffer, BUFFER_LENGTH) <= 0) {
+            systemFatal("Error reading resume point");
+        }
+        unpackResume(buffer, &resumePoint);
+        offset = checkResume(file, statBuffer.st_size, &resumePoint, buffer,
+            buffers.size);
+        length = statBuffer.st_size - offset;
+        bzero(buffer, BUFFER_LENGTH);
+    }
+    if(compress && worthCompressing(file, offset, length)) {
+        flags |= BODY_COMPRESSED;
+    }
+    memmove(buffer, (void*)&statBuffer.st_size, sizeof(off_t));
+    memmove(buffer + HEADER_OFFSET, (void*)&offset, sizeof(off_t));
+    memmove(buffer + HEADER_FLAGS, (void*)&flags, sizeof(int));
+    
+    if(stripes == 1) {
+        printf("Connected to server and sending %s\n", fileName);
+    }
+    if(resume && offset > 0) {
+        printf("Resuming at %d\n", (int)offset);
+    }
+    
+    // Send file size
+    if (sendData(&transferSocket, buffer, BUFFER_LENGTH) == -1) {
+        systemFatal("Send Failed");
+    }
+    
+    // Send the stripe of the file to the server
+    if(flags & BODY_COMPRESSED) {
+        if(verify && startVerifier(&verifier, file, offset, length, 0) ==
+                -1) {
+            systemFatal("Error starting verifier");
+        }
+        result = sendCompressed(transferSocket, file, offset, length,
+            &stats, verify ? &verifier : NULL);
+        if(verify && stopVerifier(&verifier) == -1) {
+            result = -1;
+        }
+        if(result == 0) {
+            printf("Sent %lld bytes compressed to %lld\n",
+                (long long)stats.raw, (long long)stats.sent);
+        }
+    } else if(verify) {
+        result = sendVerified(transferSocket, file, offset, length);
+    } else {
+        result = sendRange(transferSocket, file, offset, length);
+    }
+    if (result == -1) {
+        fprintf(stderr, "Error sending %s\n", fileName);
+    }
+    
+    // The server says whether the body checked out, even after a failure
+    if(verify && readResult(transferSocket) == -1) {
+        fprintf(stderr, "Checksum of %s failed on the server\n", fileName);
+        result = -1;
+    }
+    
+    // Close the file
+    close(file);
+    closeSocket(&transferSocket);
+    returnBuffer(&buffers, buffer);
+    
+    // Print Success message
+    if(stripes == 1) {
+        printf(result == -1 ? "Transfer Failed!\n" : "Transfer Complete!\n");
+    }
+    return result;
+}
+
+/*
+-- FUNCTION: sendDeltaFile
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int sendDeltaFile(int transferSocket, const char* fileName)
+--				transferSocket - the socket the file is sent on
+--				fileName - the name of the file to be sent
+--
+-- RETURNS: int - 0 on success, -1 if the transfer failed
+--
+-- NOTES:
+-- This function sends a file as a delta against the copy the server already
+-- has, see delta.c. Only the parts of the file the server does not have are
+-- sent. Without a copy on the server the whole file is sent. The server
+-- checks the file it rebuilt and replies whether it worked.
+*/
+int sendDeltaFile(int transferSocket, const char* fileName)
+{
+	struct deltaStats stats;
+	char *buffer = takeBuffer(&buffers);
+	int file = 0;
+	int result = 0;
+	
+	if(buffer == NULL) {
+		systemFatal("Error allocating buffer");
+	}
+	if((file = open(fileName, O_RDONLY)) == -1) {
+		systemFatal("Unable To Open File");
+	}
+	
+	printf("Connected to server and sending the changes to %s\n", fileName);
+	if((result = sendDelta(transferSocket, file, buffer, buffers.size,
+			&stats)) == 0) {
+		printf("Sent %lld bytes, %lld literal and %lld matched\n",
+			(long long)stats.sent, (long long)stats.literal,
+			(long long)stats.matched);
+	}
+	
+	close(file);
+	closeSocket(&transferSocket);
+	returnBuffer(&buffers, buffer);
+	
+	printf(result == -1 ? "Transfer Failed!\n" : "Transfer Complete!\n");
+	return result;
+}
+
+/*
+-- FUNCTION: sendChunkedFile
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int sendChunkedFile(int transferSocket, const char* fileName)
+--				transferSocket - the socket the file is sent on
+--				fileName - the name of the file to be sent
+--
+-- RETURNS: int - 0 on success, -1 if the transfer failed
+--
+-- NOTES:
+-- This function sends a file as a manifest of its chunks, see dedup.c. Only
+-- the chunks the server does not have in its store are sent. The server
+-- checks every chunk it receives and replies whether it stored the file.
+*/
+int sendChunkedFile(int transferSocket, const char* fileName)
+{
+	struct dedupStats stats;
+	char *buffer = takeBuffer(&buffers);
+	int file = 0;
+	int result = 0;
+	
+	if(buffer == NULL) {
+		systemFatal("Error allocating buffer");
+	}
+	if((file = open(fileName, O_RDONLY)) == -1) {
+		systemFatal("Unable To Open File");
+	}
+	
+	printf("Connected to server and sending the new chunks of %s\n",
+		fileName);
+	if((result = sendChunked(transferSocket, file, buffer, buffers.size,
+			&stats)) == 0) {
+		printf("Sent %lld bytes, %d of %d chunks were new\n",
+			(long long)stats.sent, stats.missing, stats.chunks);
+	}
+	
+	close(file);
+	closeSocket(&transferSocket);
+	returnBuffer(&buffers, buffer);
+	
+	printf(result == -1 ? "Transfer Failed!\n" : "Transfer Complete!\n");
+	return result;
+}
+
+/*
+-- FUNCTION: initTransfer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+-- October 17, 2026 - the port reply is read into a pooled buffer.
+--
+-- INTERFACE: int initTransfer(int* controlSocket, int port, int passive)
+--				controlSocket - the socket the command was sent on
+--				port - the local port of the control socket
+--				passive - whether the server was asked for a passive transfer
+--
+-- RETURNS: int - the transfer socket
+--
+-- NOTES:
+-- This function sets up the transfer socket once a command is sent and closes
+-- the control socket. Normally the client listens on the port of the control
+-- socket and waits for the server to connect back. In passive mode the server
+-- replies with a data port and the client connects to it instead, which saves
+-- the connect back and works from behind a firewall or NAT.
+*/
+int initTransfer(int* controlSocket, int port, int passive)
+{
+	char* buffer = NULL;
+	char ip[16];
+	int dataPort = 0;
+	int transferSocket = 0;
+	
+	if(!passive) {
+		closeSocket(controlSocket);
+		initalizeServer(&port, &transferSocket);
+		return transferSocket;
+	}
+	
+	// Get the data port from the server
+	if((buffer = takeBuffer(&buffers)) == NULL) {
+		systemFatal("Error allocating buffer");
+	}
+	if(readData(controlSocket, buffer, BUFFER_LENGTH) <= 0) {
+		systemFatal("Error reading data port");
+	}
+	memmove((void*)&dataPort, buffer, sizeof(int));
+	if(dataPort <= 0) {
+		fprintf(stderr, "Server has no data port available\n");
+		exit(EXIT_FAILURE);
+	}
+	
+	// Connect to the data port on the same address as the control socket
+	if(getPeerIp(controlSocket, ip) == -1) {
+		systemFatal("getpeername Error");
+	}
+	if((transferSocket = tcpSocket()) == -1) {
+		systemFatal("Error Creating Socket");
+	}
+	if(connectToIp(&dataPort, &transferSocket, ip) == -1) {
+		systemFatal("Cannot Connect to data port");
+	}
+	
+	closeSocket(controlSocket);
+	returnBuffer(&buffers, buffer);
+	
+	return transferSocket;
+}
+
+/*
+-- FUNCTION: readFileName
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: int readFileName(char* fileName)
+--				fileName - where the name is stored, at least
+--				MAX_NAME_LENGTH + 1 bytes
+--
+-- RETURNS: int - 0 on success, -1 if the name does not fit the control packet
+--
+-- NOTES:
+-- This function reads a file name from the user. Names longer than
+-- MAX_NAME_LENGTH would run into the option fields of the control packet.
+*/
+int readFileName(char* fileName)
+{
+	char name[FILENAME_MAX];
+	
+	if(scanf("%s", name) != 1) {
+		return -1;
+	}
+	if(strlen(name) > MAX_NAME_LENGTH) {
+		fprintf(stderr, "File name is too long\n");
+		return -1;
+	}
+	strcpy(fileName, name);
+	
+	return 0;
+}
+
+/*
+-- FUNCTION: readFileList
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS:
+--
+-- INTERFACE: char* readFileList()
+--
+-- RETURNS: char* - the line the user entered, to be freed, or NULL
+--
+-- NOTES:
+-- This function reads a line of file names from the user. The line can be
+-- of any length, a batch can name many files.
+*/
+char* readFileList()
+{
+	char* line = NULL;
+	size_t size = 0;
+	ssize_t length = 0;
+	int c = 0;
+	
+	// Skip what is left of the command line
+	while((c = getc(stdin)) == '\n' || c == ' ' || c == '\t') {
+	}
+	if(c == EOF) {
+		return NULL;
+	}
+	ungetc(c, stdin);
+	
+	if((length = getline(&line, &size, stdin)) == -1) {
+		free(line);
+		return NULL;
+	}
+	if(length > 0 && line[length - 1] == '\n') {
+		line[length - 1] = '\0';
+	}
+	
+	return line;
 }
 
 /*
@@ -390,6 +2232,7 @@ int initConnection(int port, const char* ip)
 -- DATE: September 23, 2011
 --
 -- REVISIONS:
+-- October 17, 2026 - no longer clears the screen.
 --
 -- DESIGNER: Karl Castillo
 --
@@ -404,10 +2247,12 @@ int initConnection(int port, const char* ip)
 */
 void printHelp()
 {
-	system("clear");
 	printf("Super File Transfer\n");
 	printf("r - receive file\n");
 	printf("s - send file\n");
+	printf("g - receive a batch of files\n");
+	printf("p - send a batch of files\n");
+	printf("l - list server files\n");
 	printf("f - list local files\n");
 	printf("h - help\n");
 	printf("e - exit\n");
@@ -470,6 +2315,7 @@ void initalizeServer(int* port, int* socket)
 -- DATE: September 23, 2011
 --
 -- REVISIONS:
+-- October 17, 2026 - asks the transport for the port.
 --
 -- DESIGNER: Karl Castillo
 --
@@ -481,16 +2327,16 @@ void initalizeServer(int* port, int* socket)
 -- RETURNS: void
 --
 -- NOTES:
--- This function will get the port that the socket is bound to.
+-- This function will get the port that the socket is bound to, whatever the
+-- transport.
 */
 int getPort(int* socket)
 {
-	struct sockaddr_in sin;
-	socklen_t len = sizeof(sin);
-	if (getsockname(*socket, (struct sockaddr *)&sin, &len) == -1) {
+	int port = 0;
+	if ((port = getSocketPort(socket)) == -1) {
 		systemFatal("getsockname Error");
 	}
-	return ntohs(sin.sin_port);
+	return port;
 }
 
 /*
@@ -2,19 +2,96 @@
 #define CLIENT_H
 
 #include "../network/network.h"
+#include "../network/mux.h"
+#include "../network/transfer.h"
+#include "../network/delta.h"
+#include "../network/dedup.h"
+#include "../network/compress.h"
+#include "../network/verify.h"
+#include "../network/batch.h"
+#include "../network/list.h"
+#include "../network/buffer.h"
 
 #define MAX_PORT_SIZE 	5
 #define TRUE 			1
 
+// Files asked for in every page of a listing
+#define LIST_PAGE		1000
+
+// Seconds a multiplexed session may sit idle before the client closes it
+#define DEF_IDLE		120
+
+// Transfers a script keeps going at once, well under the streams a session
+// may have so the server has room for the ones it is still finishing
+#define SCRIPT_STREAMS	64
+
+// States of a scripted command
+#define SCRIPT_WAITING	0
+#define SCRIPT_RUNNING	1
+#define SCRIPT_DONE		2
+#define SCRIPT_FAILED	3
+
+// A file to get or put, named on the command line or in a script
+struct scriptCommand
+{
+	int put;
+	int stream;
+	int state;
+	char name[MAX_NAME_LENGTH + 1];
+};
+
+struct script
+{
+	struct scriptCommand* commands;
+	int count;
+	int size;
+	int next;
+	int first;
+	int running;
+	int failures;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
-void processCommand(int* controlSocket);
-void receiveFile(int port, const char* fileName);
-void sendFile(int port, const char* fileName);
+void processCommand(int* controlSocket, const char* ip, int passive,
+	int resume, int delta, int dedup, int compress, int verify, int stripes);
+void processStriped(int* controlSocket, char* cmd, const char* ip,
+	int passive, int stripes);
+int transferStripe(int* controlSocket, char* cmd, int passive, int stripe,
+	int stripes);
+int processBatch(int* controlSocket, char* cmd, int passive);
+void printEntry(const char* name, off_t size, int success);
+int processList(int* controlSocket, char* cmd, int passive, int verify);
+void printListed(const struct listEntry* entry);
+int receiveFile(int transferSocket, const char* fileName, int stripe,
+	int stripes, int resume, int compress, int verify);
+int sendFile(int transferSocket, const char* fileName, int stripe,
+	int stripes, int resume, int compress, int verify);
+void findPartial(const char* fileName, struct resumePoint* resume);
+int sendDeltaFile(int transferSocket, const char* fileName);
+int sendChunkedFile(int transferSocket, const char* fileName);
 
 // Helper functions
 int initConnection(int port, const char* ip);
+int initTransfer(int* controlSocket, int port, int passive);
+int readFileName(char* fileName);
+char* readFileList();
+void processMultiplexed(int* controlSocket, const char* ip, int idle);
+struct muxSession* openSession(int* controlSocket, const char* ip, int idle);
+int closeSession(struct muxSession* session, int* controlSocket);
+int processInput(struct muxSession* session, char* input, int* inputCount,
+	char* command);
+int processLine(struct muxSession* session, char* line, char* command);
+void printTransfer(struct muxStream* stream, int success);
+int parseWords(struct script* script, char** words, int count);
+int readScript(struct script* script, FILE* file);
+int addCommand(struct script* script, int put, const char* name);
+void runScript(int* controlSocket, const char* ip, struct script* script);
+void startCommands(struct muxSession* session, struct script* script);
+void endCommand(struct script* script, struct scriptCommand* command,
+	int success);
+void finishCommand(struct muxStream* stream, int success);
 void initalizeServer(int* port, int* socket);
 void printHelp(); 
 int getPort(int* socket);
@@ -0,0 +1,1592 @@
+/*
+-- SOURCE FILE: load.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int main(int argc, char **argv);
+-- int parseSizes(const char *text, struct loadOptions *options);
+-- int readNameFile(const char *path, struct loadOptions *options);
+-- int runLoad(struct loadOptions *options);
+-- static void startRequest(struct loadGenerator *load,
+--                          struct session *session);
+-- static void handleSession(struct loadGenerator *load,
+--                           struct session *session, unsigned int events);
+-- static int finishConnect(struct session *session);
+-- static int sendCommand(struct loadGenerator *load, struct session *session);
+-- static int readReply(struct loadGenerator *load, struct session *session);
+-- static int acceptData(struct loadGenerator *load, struct session *session);
+-- static int startData(struct loadGenerator *load, struct session *session);
+-- static int readHeader(struct session *session);
+-- static int readBody(struct loadGenerator *load, struct session *session);
+-- static int sendHeader(struct session *session);
+-- static int sendBody(struct loadGenerator *load, struct session *session);
+-- static int waitClose(struct session *session);
+-- static void finishRequest(struct loadGenerator *load,
+--                           struct session *session, int success);
+-- static int replaceSocket(struct loadGenerator *load,
+--                          struct session *session, int socket,
+--                          unsigned int events);
+-- static int watchSession(struct loadGenerator *load,
+--                         struct session *session, unsigned int events);
+-- static void pushTimer(struct loadGenerator *load, struct session *session);
+-- static struct session *popTimer(struct loadGenerator *load);
+-- static void expireRequests(struct loadGenerator *load, long long now);
+-- static int stopping(struct loadGenerator *load, long long now);
+-- static off_t pickSize(struct loadGenerator *load);
+-- static long long pickThinkTime(struct loadGenerator *load);
+-- static double nextRandom(struct loadGenerator *load);
+-- static void printProgress(struct loadGenerator *load, long long now);
+-- static void printSummary(struct loadGenerator *load, long long now);
+-- static long long currentTime();
+-- static void raiseFileLimit(int sessions);
+-- static void systemFatal(const char* message);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The histograms moved to histogram.c.
+-- October 17, 2026 - Runs the server in the process over the memory
+-- transport, see loopback.c.
+--
+-- NOTES:
+-- This file contains the load generator. One process keeps many sessions
+-- going against a server at once, each one a small state machine driven by
+-- epoll in the same way as the sessions of the reactor, see reactor.c:
+--
+-- LOAD_CONNECT -> LOAD_COMMAND -> LOAD_ACCEPT       -> LOAD_GET_HEADER ...
+--                              -> LOAD_REPLY -> LOAD_DATA_CONNECT
+--
+-- A download goes on to LOAD_GET_HEADER and LOAD_GET_BODY, an upload to
+-- LOAD_SEND_HEADER, LOAD_SEND_BODY and LOAD_SEND_CLOSE, which waits for the
+-- server to close the data connection so an upload is only done once the
+-- server has all of it. A session that is done thinks for a while in
+-- LOAD_IDLE and then starts its next request.
+--
+-- Every request is a get with the chance of the get percentage and a put
+-- otherwise. A get asks for one of the names read from a file, or without
+-- names for the file the session last put, in the directory the server keeps
+-- uploads in. A session that has not put anything yet puts first. A put
+-- sends a file of a size picked from the list of sizes, named after the
+-- process and the session so the files on the server are overwritten rather
+-- than piling up. Bodies are sent from and read into memory, the disk of the
+-- load generator plays no part.
+--
+-- Think times are picked from an exponential distribution around the mean,
+-- so the requests of the sessions arrive like those of independent users.
+-- The sessions waiting to start are kept in a heap ordered by the time they
+-- wake up.
+--
+-- Every second the requests and bytes of the last second are printed, and at
+-- the end the totals and the latency percentiles of each direction. The
+-- latency of a request runs from the connect of its control socket to the
+-- end of its transfer.
+--
+-- With the memory transport the load generator starts the server itself, see
+-- loopback.c, and needs no server address.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <math.h>
+
+#include "load.h"
+#include "../network/network.h"
+#include "../network/buffer.h"
+
+#define MAX_EVENTS 256
+#define USAGE "Usage: %s -i [server] -p [port] -c [sessions] " \
+    "-n [requests] -d [seconds] -g [percent of gets] " \
+    "-t [mean think time in ms] -s [sizes, e.g. 1k:80,64k-1m:15,64m:5] " \
+    "-f [file of names to get] -P (passive transfers) " \
+    "-b [chunk size, e.g. 1m] -r [seconds between reports] " \
+    "-T [tcp|unix|memory]\n"
+
+static void startRequest(struct loadGenerator *load,
+                         struct session *session);
+static void handleSession(struct loadGenerator *load,
+                          struct session *session, unsigned int events);
+static int finishConnect(struct session *session);
+static int sendCommand(struct loadGenerator *load, struct session *session);
+static int readReply(struct loadGenerator *load, struct session *session);
+static int acceptData(struct loadGenerator *load, struct session *session);
+static int startData(struct loadGenerator *load, struct session *session);
+static int readHeader(struct session *session);
+static int readBody(struct loadGenerator *load, struct session *session);
+static int sendHeader(struct session *session);
+static int sendBody(struct loadGenerator *load, struct session *session);
+static int waitClose(struct session *session);
+static void finishRequest(struct loadGenerator *load,
+                          struct session *session, int success);
+static int replaceSocket(struct loadGenerator *load,
+                         struct session *session, int socket,
+                         unsigned int events);
+static int watchSession(struct loadGenerator *load,
+                        struct session *session, unsigned int events);
+static void pushTimer(struct loadGenerator *load, struct session *session);
+static struct session *popTimer(struct loadGenerator *load);
+static void expireRequests(struct loadGenerator *load, long long now);
+static int stopping(struct loadGenerator *load, long long now);
+static off_t pickSize(struct loadGenerator *load);
+static long long pickThinkTime(struct loadGenerator *load);
+static double nextRandom(struct loadGenerator *load);
+static void printProgress(struct loadGenerator *load, long long now);
+static void printSummary(struct loadGenerator *load, long long now);
+static long long currentTime();
+static void raiseFileLimit(int sessions);
+static void systemFatal(const char* message);
+
+int main(int argc, char **argv)
+{
+    // Initialize options and give defaults in case of no user input
+    struct loadOptions options;
+    int option = 0;
+    int loopback = 0;
+    int status = 0;
+    const struct transport *transport = NULL;
+
+    bzero(&options, sizeof(options));
+    options.port = DEF_PORT;
+    options.sessions = DEF_SESSIONS;
+    options.duration = DEF_DURATION;
+    options.getPercent = DEF_GET_PERCENT;
+    options.chunkSize = DEF_CHUNK_SIZE;
+    options.report = DEF_REPORT;
+    parseSizes(DEF_SIZES, &options);
+
+    // Parse command line parameters using getopt
+    while ((option = getopt(argc, argv, "i:p:c:n:d:g:t:s:f:Pb:r:T:")) != -1)
+    {
+        switch (option)
+        {
+            case 'i':
+                options.host = optarg;
+                break;
+            case 'p':
+                options.port = atoi(optarg);
+                break;
+            case 'c':
+                options.sessions = atoi(optarg);
+                break;
+            case 'n':
+                options.requests = atoll(optarg);
+                options.duration = 0;
+                break;
+            case 'd':
+                options.duration = atoi(optarg);
+                break;
+            case 'g':
+                options.getPercent = atoi(optarg);
+                break;
+            case 't':
+                options.thinkTime = atoi(optarg);
+                break;
+            case 'P':
+                options.passive = 1;
+                break;
+            case 'r':
+                options.report = atoi(optarg);
+                break;
+            case 's':
+                if (parseSizes(optarg, &options) == -1)
+                {
+                    fprintf(stderr, USAGE, argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'f':
+                if (readNameFile(optarg, &options) == -1)
+                {
+                    perror(optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'b':
+                if ((options.chunkSize = parseChunkSize(optarg)) == -1)
+                {
+                    fprintf(stderr, USAGE, argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'T':
+                if ((transport = findTransport(optarg)) == NULL)
+                {
+                    fprintf(stderr, USAGE, argv[0]);
+                    return EXIT_FAILURE;
+                }
+                // The memory transport only reaches a server in this process
+                loopback = transport == &memoryTransport;
+                setTransport(transport);
+                break;
+            default:
+                fprintf(stderr, USAGE, argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((options.host == NULL && !loopback) || options.sessions < 1 ||
+        options.getPercent < 0 || options.getPercent > 100 ||
+        options.thinkTime < 0 || options.requests < 0 ||
+        options.duration < 0 || options.report < 0)
+    {
+        fprintf(stderr, USAGE, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (loopback)
+    {
+        startLoopback(&options);
+    }
+    status = runLoad(&options);
+    stopLoopback();
+
+    return status;
+}
+
+/*
+-- FUNCTION: parseSizes
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int parseSizes(const char *text, struct loadOptions *options);
+--
+-- RETURNS: 0 on success, -1 if the list is not valid
+--
+-- NOTES:
+-- This function reads the sizes of the uploads, a comma separated list of
+-- entries like 64k, 1k-1m or 64m:5. An entry is a size or a range of sizes,
+-- optionally followed by its weight, which is 1 if it is left out. A range is
+-- spread evenly over its orders of magnitude, so a file of 1k-1m is as likely
+-- to be under 32k as over it.
+*/
+int parseSizes(const char *text, struct loadOptions *options)
+{
+    char entry[64];
+    char *weight = NULL;
+    char *high = NULL;
+    struct sizeClass *sizeClass = NULL;
+    size_t length = 0;
+
+    options->classCount = 0;
+    options->totalWeight = 0;
+    while (*text != '\0')
+    {
+        if ((length = strcspn(text, ",")) >= sizeof(entry) ||
+            options->classCount == MAX_SIZE_CLASSES)
+        {
+            return -1;
+        }
+        memcpy(entry, text, length);
+        entry[length] = '\0';
+        text += text[length] == ',' ? length + 1 : length;
+
+        sizeClass = &options->classes[options->classCount++];
+        sizeClass->weight = 1;
+        if ((weight = strchr(entry, ':')) != NULL)
+        {
+            *weight++ = '\0';
+            if ((sizeClass->weight = atoi(weight)) < 1)
+            {
+                return -1;
+            }
+        }
+        if ((high = strchr(entry, '-')) != NULL)
+        {
+            *high++ = '\0';
+        }
+        if ((sizeClass->low = parseSize(entry)) == -1 ||
+            (sizeClass->high = high == NULL ? sizeClass->low :
+            parseSize(high)) < sizeClass->low)
+        {
+            return -1;
+        }
+        options->totalWeight += sizeClass->weight;
+    }
+
+    return options->classCount > 0 ? 0 : -1;
+}
+
+/*
+-- FUNCTION: readNameFile
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Renamed from readNames, the load generator
+-- links the server and its batch.c.
+--
+-- INTERFACE: int readNameFile(const char *path, struct loadOptions *options);
+--
+-- RETURNS: 0 on success, -1 if the file could not be read
+--
+-- NOTES:
+-- This function reads the names of the files on the server that are gotten,
+-- one per line. Empty lines and names too long for the control packet are
+-- skipped.
+*/
+int readNameFile(const char *path, struct loadOptions *options)
+{
+    FILE *file = NULL;
+    char line[FILENAME_MAX];
+    char **names = NULL;
+    int capacity = 0;
+
+    if ((file = fopen(path, "r")) == NULL)
+    {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || strlen(line) > MAX_NAME_LENGTH)
+        {
+            continue;
+        }
+        if (options->nameCount == capacity)
+        {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            if ((names = (char**)realloc(options->names,
+                sizeof(char*) * capacity)) == NULL)
+            {
+                fclose(file);
+                return -1;
+            }
+            options->names = names;
+        }
+        if ((options->names[options->nameCount] = strdup(line)) == NULL)
+        {
+            fclose(file);
+            return -1;
+        }
+        options->nameCount++;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+/*
+-- FUNCTION: runLoad
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Returns the exit status, so a server run in
+-- this process can be stopped first.
+--
+-- INTERFACE: int runLoad(struct loadOptions *options);
+--
+-- RETURNS: EXIT_FAILURE if any request failed, EXIT_SUCCESS otherwise
+--
+-- NOTES:
+-- This function runs the sessions until the number of requests has been
+-- started or the duration is over, and then until the requests that were
+-- started are done. Every session starts after a think time of its own, so
+-- the sessions do not all connect at once.
+--
+-- The body of every upload is a buffer of random bytes one chunk long that is
+-- sent again and again, downloads are read into the same buffer.
+*/
+int runLoad(struct loadOptions *options)
+{
+    struct loadGenerator load;
+    struct epoll_event events[MAX_EVENTS];
+    struct session *session = NULL;
+    struct hostent *host = NULL;
+    struct bufferPool buffers;
+    long long now = 0;
+    long long nextReport = 0;
+    long long timeout = 0;
+    int count = 0;
+    int i = 0;
+
+    // A server closing early must fail the request, not the program
+    signal(SIGPIPE, SIG_IGN);
+    raiseFileLimit(options->sessions);
+
+    bzero(&load, sizeof(load));
+    load.options = options;
+    if ((host = gethostbyname(options->host)) == NULL ||
+        inet_ntop(AF_INET, host->h_addr, load.ip, sizeof(load.ip)) == NULL)
+    {
+        fprintf(stderr, "Unknown server: %s\n", options->host);
+        exit(EXIT_FAILURE);
+    }
+    if ((load.epoll = epoll_create1(0)) == -1)
+    {
+        systemFatal("epoll_create1");
+    }
+
+    initializeBufferPool(&buffers, options->chunkSize);
+    if ((load.body = takeBuffer(&buffers)) == NULL ||
+        (load.sessions = (struct session*)calloc(options->sessions,
+        sizeof(struct session))) == NULL ||
+        (load.timers = (struct session**)malloc(sizeof(struct session*) *
+        options->sessions)) == NULL)
+    {
+        systemFatal("Cannot Allocate Sessions");
+    }
+    load.random = (unsigned long long)time(NULL) * 2654435761u ^ getpid();
+    for (i = 0; i < options->chunkSize; i++)
+    {
+        load.body[i] = (char)(nextRandom(&load) * 256);
+    }
+
+    load.started = currentTime();
+    load.deadline = options->duration > 0 ?
+        load.started + options->duration * 1000000LL : 0;
+    nextReport = load.started + options->report * 1000000LL;
+    for (i = 0; i < options->sessions; i++)
+    {
+        session = &load.sessions[i];
+        session->id = i;
+        session->socket = -1;
+        session->wakeTime = load.started + pickThinkTime(&load);
+        pushTimer(&load, session);
+    }
+
+    printf("%d sessions against %s:%d, %d%% gets\n", options->sessions,
+        options->host, options->port, options->getPercent);
+    if (options->report > 0)
+    {
+        printf("%8s %8s %8s %8s %10s %10s %8s\n", "seconds", "active",
+            "gets/s", "puts/s", "MB/s in", "MB/s out", "failures");
+    }
+
+    while (load.active > 0 || (load.timerCount > 0 &&
+        !stopping(&load, currentTime())))
+    {
+        // Sleep until the next session wakes up or the next report is due
+        now = currentTime();
+        timeout = options->report > 0 ? nextReport : now + 1000000;
+        if (load.timerCount > 0 && load.timers[0]->wakeTime < timeout)
+        {
+            timeout = load.timers[0]->wakeTime;
+        }
+        timeout = timeout > now ? (timeout - now + 999) / 1000 : 0;
+
+        if ((count = epoll_wait(load.epoll, events, MAX_EVENTS,
+            (int)timeout)) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            systemFatal("epoll_wait");
+        }
+        for (i = 0; i < count; i++)
+        {
+            handleSession(&load, (struct session*)events[i].data.ptr,
+                events[i].events);
+        }
+
+        now = currentTime();
+        while (load.timerCount > 0 && load.timers[0]->wakeTime <= now &&
+            !stopping(&load, now))
+        {
+            startRequest(&load, popTimer(&load));
+        }
+        if (now >= nextReport && options->report > 0)
+        {
+            printProgress(&load, now);
+            expireRequests(&load, now);
+            nextReport += options->report * 1000000LL;
+        }
+        else if (options->report == 0)
+        {
+            expireRequests(&load, now);
+        }
+    }
+
+    printSummary(&load, currentTime());
+    close(load.epoll);
+    returnBuffer(&buffers, load.body);
+    destroyBufferPool(&buffers);
+    free(load.sessions);
+    free(load.timers);
+    return load.stats[GET_FILE].failures + load.stats[SEND_FILE].failures > 0 ?
+        EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+-- FUNCTION: startRequest
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void startRequest(struct loadGenerator *load,
+--                                     struct session *session);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function picks the next request of a session, fills in its control
+-- packet and starts connecting to the server. A connect that fails right
+-- away fails the request.
+*/
+static void startRequest(struct loadGenerator *load, struct session *session)
+{
+    struct loadOptions *options = load->options;
+    int flags = options->passive ? FLAG_PASSIVE : 0;
+    int stripe = 0;
+    int stripes = 1;
+    int socket = -1;
+    int port = 0;
+
+    session->command = nextRandom(load) * 100 < options->getPercent ?
+        GET_FILE : SEND_FILE;
+    if (session->command == GET_FILE && options->nameCount > 0)
+    {
+        strcpy(session->name, options->names[(int)(nextRandom(load) *
+            options->nameCount)]);
+    }
+    else
+    {
+        if (!session->uploaded)
+        {
+            session->command = SEND_FILE;
+        }
+        sprintf(session->name, "%s" PUT_PREFIX "%d-%d",
+            session->command == GET_FILE ? UPLOAD_DIR : "", (int)getpid(),
+            session->id);
+    }
+    session->size = session->command == SEND_FILE ? pickSize(load) : 0;
+    session->count = 0;
+    session->started = currentTime();
+    load->issued++;
+    load->active++;
+
+    bzero(session->buffer, BUFFER_LENGTH);
+    session->buffer[0] = (char)session->command;
+    strcpy(session->buffer + 1, session->name);
+    memmove(session->buffer + CONTROL_FLAGS, (void*)&flags, sizeof(int));
+    memmove(session->buffer + CONTROL_STRIPE, (void*)&stripe, sizeof(int));
+    memmove(session->buffer + CONTROL_STRIPES, (void*)&stripes, sizeof(int));
+    session->bufferCount = 0;
+
+    // The port of the control socket is listened on once it is closed. TCP
+    // lets connections share a local port the kernel picked, the server's
+    // own connections back among them, so the port is bound first to keep
+    // it to this session.
+    session->state = LOAD_CONNECT;
+    if ((socket = tcpSocket()) == -1 || setReuse(&socket) == -1 ||
+        (!options->passive && (getTransport()->flags & TRANSPORT_INET) &&
+        bindAddress(&port, &socket) == -1) ||
+        makeSocketNonBlocking(&socket) == -1 ||
+        (connectToIp(&options->port, &socket, load->ip) == -1 &&
+        errno != EINPROGRESS))
+    {
+        if (socket != -1)
+        {
+            close(socket);
+        }
+        finishRequest(load, session, 0);
+        return;
+    }
+    if (replaceSocket(load, session, socket, EPOLLOUT) == -1)
+    {
+        finishRequest(load, session, 0);
+    }
+}
+
+/*
+-- FUNCTION: handleSession
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void handleSession(struct loadGenerator *load,
+--                                      struct session *session,
+--                                      unsigned int events);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function advances a session whose socket is ready. Every step returns
+-- 1 when the request is done, 0 when it waits for the socket again and -1
+-- when it failed.
+*/
+static void handleSession(struct loadGenerator *load, struct session *session,
+                          unsigned int events)
+{
+    int result = 0;
+
+    // Errors without data to read are only seen by the step that reads
+    if ((events & (EPOLLERR | EPOLLHUP)) && !(events & EPOLLIN) &&
+        session->state != LOAD_CONNECT && session->state != LOAD_DATA_CONNECT)
+    {
+        finishRequest(load, session, 0);
+        return;
+    }
+
+    switch (session->state)
+    {
+        case LOAD_CONNECT:
+            if ((result = finishConnect(session)) == 0)
+            {
+                session->state = LOAD_COMMAND;
+                result = sendCommand(load, session);
+            }
+            break;
+        case LOAD_COMMAND:
+            result = sendCommand(load, session);
+            break;
+        case LOAD_REPLY:
+            result = readReply(load, session);
+            break;
+        case LOAD_DATA_CONNECT:
+            if ((result = finishConnect(session)) == 0)
+            {
+                result = startData(load, session);
+            }
+            break;
+        case LOAD_ACCEPT:
+            result = acceptData(load, session);
+            break;
+        case LOAD_GET_HEADER:
+            if ((result = readHeader(session)) == 0 &&
+                session->state == LOAD_GET_BODY)
+            {
+                result = readBody(load, session);
+            }
+            break;
+        case LOAD_GET_BODY:
+            result = readBody(load, session);
+            break;
+        case LOAD_SEND_HEADER:
+            if ((result = sendHeader(session)) == 0 &&
+                session->state == LOAD_SEND_BODY)
+            {
+                result = sendBody(load, session);
+            }
+            break;
+        case LOAD_SEND_BODY:
+            result = sendBody(load, session);
+            break;
+        case LOAD_SEND_CLOSE:
+            result = waitClose(session);
+            break;
+    }
+
+    if (result != 0)
+    {
+        finishRequest(load, session, result == 1);
+    }
+}
+
+/*
+-- FUNCTION: finishConnect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int finishConnect(struct session *session);
+--
+-- RETURNS: 0 if the connect worked, -1 if it failed
+--
+-- NOTES:
+-- This function checks how the non blocking connect of a session's socket
+-- turned out once the socket is writable.
+*/
+static int finishConnect(struct session *session)
+{
+    int error = 0;
+    socklen_t length = sizeof(error);
+
+    if (getsockopt(session->socket, SOL_SOCKET, SO_ERROR, &error,
+        &length) == -1 || error != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+-- FUNCTION: sendCommand
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int sendCommand(struct loadGenerator *load,
+--                                   struct session *session);
+--
+-- RETURNS: 0 while the request goes on, -1 if it failed
+--
+-- NOTES:
+-- This function sends the rest of the control packet. Once it is sent a
+-- passive request waits for the data port, and any other request closes the
+-- control socket and listens on its port for the server to connect back, as
+-- the client does, see initTransfer in client.c.
+*/
+static int sendCommand(struct loadGenerator *load, struct session *session)
+{
+    int bytesSent = 0;
+    int port = 0;
+    int socket = -1;
+
+    bytesSent = sendData(&session->socket, session->buffer +
+        session->bufferCount, BUFFER_LENGTH - session->bufferCount);
+    if (bytesSent == -1)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    if ((session->bufferCount += bytesSent) < BUFFER_LENGTH)
+    {
+        return watchSession(load, session, EPOLLOUT);
+    }
+
+    session->bufferCount = 0;
+    if (load->options->passive)
+    {
+        session->state = LOAD_REPLY;
+        return watchSession(load, session, EPOLLIN);
+    }
+
+    // The port is only free once the control socket is closed
+    session->state = LOAD_ACCEPT;
+    port = getSocketPort(&session->socket);
+    close(session->socket);
+    session->socket = -1;
+    if (port == -1 || (socket = tcpSocket()) == -1 ||
+        setReuse(&socket) == -1 || bindAddress(&port, &socket) == -1 ||
+        setListen(&socket) == -1 || makeSocketNonBlocking(&socket) == -1)
+    {
+        if (socket != -1)
+        {
+            close(socket);
+        }
+        return -1;
+    }
+    return replaceSocket(load, session, socket, EPOLLIN);
+}
+
+/*
+-- FUNCTION: readReply
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int readReply(struct loadGenerator *load,
+--                                 struct session *session);
+--
+-- RETURNS: 0 while the request goes on, -1 if it failed
+--
+-- NOTES:
+-- This function reads the data port of a passive request and starts
+-- connecting to it, closing the control socket.
+*/
+static int readReply(struct loadGenerator *load, struct session *session)
+{
+    int bytesRead = 0;
+    int dataPort = 0;
+    int socket = -1;
+
+    bytesRead = readData(&session->socket, session->buffer +
+        session->bufferCount, BUFFER_LENGTH - session->bufferCount);
+    if (bytesRead == -1)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    if (bytesRead == 0)
+    {
+        return -1;
+    }
+    if ((session->bufferCount += bytesRead) < BUFFER_LENGTH)
+    {
+        return 0;
+    }
+
+    session->bufferCount = 0;
+    memmove((void*)&dataPort, session->buffer, sizeof(int));
+    session->state = LOAD_DATA_CONNECT;
+    if (dataPort <= 0 || (socket = tcpSocket()) == -1 ||
+        makeSocketNonBlocking(&socket) == -1 ||
+        (connectToIp(&dataPort, &socket, load->ip) == -1 &&
+        errno != EINPROGRESS))
+    {
+        if (socket != -1)
+        {
+            close(socket);
+        }
+        return -1;
+    }
+    return replaceSocket(load, session, socket, EPOLLOUT);
+}
+
+/*
+-- FUNCTION: acceptData
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int acceptData(struct loadGenerator *load,
+--                                  struct session *session);
+--
+-- RETURNS: 0 while the request goes on, -1 if it failed
+--
+-- NOTES:
+-- This function accepts the data connection of the server and closes the
+-- listening socket.
+*/
+static int acceptData(struct loadGenerator *load, struct session *session)
+{
+    int socket = -1;
+
+    if ((socket = acceptConnection(&session->socket)) == -1)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    if (makeSocketNonBlocking(&socket) == -1 ||
+        replaceSocket(load, session, socket, 0) == -1)
+    {
+        close(socket);
+        return -1;
+    }
+    return startData(load, session);
+}
+
+/*
+-- FUNCTION: startData
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int startData(struct loadGenerator *load,
+--                                 struct session *session);
+--
+-- RETURNS: 0 while the request goes on, -1 if it failed
+--
+-- NOTES:
+-- This function starts the transfer once the data connection is up. A
+-- download waits for the size control message, an upload sends its own, the
+-- whole file from the start without any flags.
+*/
+static int startData(struct loadGenerator *load, struct session *session)
+{
+    off_t offset = 0;
+    int flags = 0;
+
+    session->bufferCount = 0;
+    if (session->command == GET_FILE)
+    {
+        session->state = LOAD_GET_HEADER;
+        return watchSession(load, session, EPOLLIN);
+    }
+
+    bzero(session->buffer, BUFFER_LENGTH);
+    memmove(session->buffer, (void*)&session->size, sizeof(off_t));
+    memmove(session->buffer + HEADER_OFFSET, (void*)&offset, sizeof(off_t));
+    memmove(session->buffer + HEADER_FLAGS, (void*)&flags, sizeof(int));
+    session->state = LOAD_SEND_HEADER;
+    return watchSession(load, session, EPOLLOUT);
+}
+
+/*
+-- FUNCTION: readHeader
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int readHeader(struct session *session);
+--
+-- RETURNS: 0 while the request goes on, 1 for an empty file, -1 if it failed
+--
+-- NOTES:
+-- This function reads the size control message of a download. A server that
+-- does not have the file closes the connection instead.
+*/
+static int readHeader(struct session *session)
+{
+    int bytesRead = 0;
+
+    bytesRead = readData(&session->socket, session->buffer +
+        session->bufferCount, BUFFER_LENGTH - session->bufferCount);
+    if (bytesRead == -1)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    if (bytesRead == 0)
+    {
+        return -1;
+    }
+    if ((session->bufferCount += bytesRead) < BUFFER_LENGTH)
+    {
+        return 0;
+    }
+
+    memmove((void*)&session->size, session->buffer, sizeof(off_t));
+    if (session->size < 0)
+    {
+        return -1;
+    }
+    session->state = LOAD_GET_BODY;
+    return session->size == 0 ? 1 : 0;
+}
+
+/*
+-- FUNCTION: readBody
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int readBody(struct loadGenerator *load,
+--                                struct session *session);
+--
+-- RETURNS: 0 while the request goes on, 1 once the body is read, -1 if it
+-- failed
+--
+-- NOTES:
+-- This function reads at most a chunk of a download and drops it. A body
+-- that ends early fails the request.
+*/
+static int readBody(struct loadGenerator *load, struct session *session)
+{
+    off_t remaining = session->size - session->count;
+    int bytesRead = 0;
+
+    bytesRead = readData(&session->socket, load->body,
+        remaining < load->options->chunkSize ? remaining :
+        load->options->chunkSize);
+    if (bytesRead == -1)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    if (bytesRead == 0)
+    {
+        return -1;
+    }
+
+    session->count += bytesRead;
+    load->interval[GET_FILE].bytes += bytesRead;
+    return session->count < session->size ? 0 : 1;
+}
+
+/*
+-- FUNCTION: sendHeader
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int sendHeader(struct session *session);
+--
+-- RETURNS: 0 while the request goes on, -1 if it failed
+--
+-- NOTES:
+-- This function sends the rest of the size control message of an upload.
+*/
+static int sendHeader(struct session *session)
+{
+    int bytesSent = 0;
+
+    bytesSent = sendData(&session->socket, session->buffer +
+        session->bufferCount, BUFFER_LENGTH - session->bufferCount);
+    if (bytesSent == -1)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    if ((session->bufferCount += bytesSent) == BUFFER_LENGTH)
+    {
+        session->state = LOAD_SEND_BODY;
+    }
+    return 0;
+}
+
+/*
+-- FUNCTION: sendBody
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int sendBody(struct loadGenerator *load,
+--                                struct session *session);
+--
+-- RETURNS: 0 while the request goes on, -1 if it failed
+--
+-- NOTES:
+-- This function sends at most a chunk of an upload from the buffer of random
+-- bytes. Once the whole body is sent the sending side of the socket is shut
+-- down and the session waits for the server to close its side.
+*/
+static int sendBody(struct loadGenerator *load, struct session *session)
+{
+    off_t remaining = session->size - session->count;
+    int bytesSent = 0;
+
+    if (remaining > 0)
+    {
+        bytesSent = sendData(&session->socket, load->body,
+            remaining < load->options->chunkSize ? remaining :
+            load->options->chunkSize);
+        if (bytesSent == -1)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        session->count += bytesSent;
+        load->interval[SEND_FILE].bytes += bytesSent;
+        if (session->count < session->size)
+        {
+            return 0;
+        }
+    }
+
+    session->state = LOAD_SEND_CLOSE;
+    if (shutdown(session->socket, SHUT_WR) == -1)
+    {
+        return -1;
+    }
+    return watchSession(load, session, EPOLLIN);
+}
+
+/*
+-- FUNCTION: waitClose
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int waitClose(struct session *session);
+--
+-- RETURNS: 0 while the request goes on, 1 once the server closed, -1 if the
+-- connection failed
+--
+-- NOTES:
+-- This function waits for the server to close the data connection of an
+-- upload, which it does once the whole file is written.
+*/
+static int waitClose(struct session *session)
+{
+    char scratch[64];
+    int bytesRead = 0;
+
+    while ((bytesRead = readData(&session->socket, scratch,
+        sizeof(scratch))) > 0)
+    {
+    }
+    if (bytesRead == -1)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    return 1;
+}
+
+/*
+-- FUNCTION: finishRequest
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void finishRequest(struct loadGenerator *load,
+--                                      struct session *session,
+--                                      int success);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function closes the socket of a request, counts it and puts the
+-- session to sleep for a think time before its next request. Only requests
+-- that worked count towards the latency.
+*/
+static void finishRequest(struct loadGenerator *load, struct session *session,
+                          int success)
+{
+    struct loadStats *interval = &load->interval[session->command];
+    long long now = currentTime();
+
+    if (session->socket != -1)
+    {
+        close(session->socket);
+        session->socket = -1;
+    }
+    session->state = LOAD_IDLE;
+    load->active--;
+
+    interval->requests++;
+    if (success)
+    {
+        recordValue(&load->stats[session->command].latency,
+            now - session->started);
+        if (session->command == SEND_FILE)
+        {
+            session->uploaded = 1;
+        }
+    }
+    else
+    {
+        interval->failures++;
+    }
+
+    session->wakeTime = now + pickThinkTime(load);
+    pushTimer(load, session);
+}
+
+/*
+-- FUNCTION: replaceSocket
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int replaceSocket(struct loadGenerator *load,
+--                                     struct session *session, int socket,
+--                                     unsigned int events);
+--
+-- RETURNS: 0 on success, -1 if the socket could not be watched
+--
+-- NOTES:
+-- This function closes the socket of a session, which also takes it out of
+-- epoll, and watches the new one for the events instead. The session owns
+-- the new socket even if it could not be watched, so it is closed with the
+-- request.
+*/
+static int replaceSocket(struct loadGenerator *load, struct session *session,
+                         int socket, unsigned int events)
+{
+    struct epoll_event event;
+
+    if (session->socket != -1)
+    {
+        close(session->socket);
+    }
+    session->socket = socket;
+
+    event.events = events;
+    event.data.ptr = session;
+    return epoll_ctl(load->epoll, EPOLL_CTL_ADD, socket, &event);
+}
+
+/*
+-- FUNCTION: watchSession
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int watchSession(struct loadGenerator *load,
+--                                    struct session *session,
+--                                    unsigned int events);
+--
+-- RETURNS: 0 on success, -1 on failure
+--
+-- NOTES:
+-- This function changes the events the socket of a session is watched for.
+*/
+static int watchSession(struct loadGenerator *load, struct session *session,
+                        unsigned int events)
+{
+    struct epoll_event event;
+
+    event.events = events;
+    event.data.ptr = session;
+    return epoll_ctl(load->epoll, EPOLL_CTL_MOD, session->socket, &event);
+}
+
+/*
+-- FUNCTION: pushTimer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void pushTimer(struct loadGenerator *load,
+--                                  struct session *session);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function adds a sleeping session to the heap of sessions, ordered by
+-- the time they wake up, with the earliest at the top.
+*/
+static void pushTimer(struct loadGenerator *load, struct session *session)
+{
+    int i = load->timerCount++;
+    int parent = 0;
+
+    while (i > 0)
+    {
+        parent = (i - 1) / 2;
+        if (load->timers[parent]->wakeTime <= session->wakeTime)
+        {
+            break;
+        }
+        load->timers[i] = load->timers[parent];
+        i = parent;
+    }
+    load->timers[i] = session;
+}
+
+/*
+-- FUNCTION: popTimer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static struct session *popTimer(struct loadGenerator *load);
+--
+-- RETURNS: the session that wakes up first
+--
+-- NOTES:
+-- This function takes the top of the heap of sleeping sessions and moves the
+-- last one down from the top to where it belongs.
+*/
+static struct session *popTimer(struct loadGenerator *load)
+{
+    struct session *top = load->timers[0];
+    struct session *last = load->timers[--load->timerCount];
+    int i = 0;
+    int child = 0;
+
+    while ((child = 2 * i + 1) < load->timerCount)
+    {
+        if (child + 1 < load->timerCount &&
+            load->timers[child + 1]->wakeTime < load->timers[child]->wakeTime)
+        {
+            child++;
+        }
+        if (last->wakeTime <= load->timers[child]->wakeTime)
+        {
+            break;
+        }
+        load->timers[i] = load->timers[child];
+        i = child;
+    }
+    load->timers[i] = last;
+
+    return top;
+}
+
+/*
+-- FUNCTION: expireRequests
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void expireRequests(struct loadGenerator *load,
+--                                       long long now);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function fails the requests that have taken more than
+-- REQUEST_TIMEOUT seconds, for example because the server never connected
+-- back. It looks at every session and runs once per report.
+*/
+static void expireRequests(struct loadGenerator *load, long long now)
+{
+    struct session *session = NULL;
+    int i = 0;
+
+    for (i = 0; i < load->options->sessions; i++)
+    {
+        session = &load->sessions[i];
+        if (session->state != LOAD_IDLE &&
+            now - session->started > REQUEST_TIMEOUT * 1000000LL)
+        {
+            finishRequest(load, session, 0);
+        }
+    }
+}
+
+/*
+-- FUNCTION: stopping
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int stopping(struct loadGenerator *load, long long now);
+--
+-- RETURNS: 1 if no more requests are started, 0 otherwise
+--
+-- NOTES:
+-- This function tells whether every request has been started or the
+-- duration is over.
+*/
+static int stopping(struct loadGenerator *load, long long now)
+{
+    return (load->options->requests > 0 &&
+        load->issued >= load->options->requests) ||
+        (load->deadline > 0 && now >= load->deadline);
+}
+
+/*
+-- FUNCTION: pickSize
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static off_t pickSize(struct loadGenerator *load);
+--
+-- RETURNS: the size of the next upload
+--
+-- NOTES:
+-- This function picks an entry of the list of sizes by its weight and a size
+-- in its range, evenly over the orders of magnitude of the range.
+*/
+static off_t pickSize(struct loadGenerator *load)
+{
+    struct loadOptions *options = load->options;
+    struct sizeClass *sizeClass = options->classes;
+    int weight = (int)(nextRandom(load) * options->totalWeight);
+    double low = 0;
+    double high = 0;
+
+    while (weight >= sizeClass->weight)
+    {
+        weight -= sizeClass->weight;
+        sizeClass++;
+    }
+    if (sizeClass->low == sizeClass->high)
+    {
+        return sizeClass->low;
+    }
+
+    low = log(sizeClass->low > 0 ? sizeClass->low : 1);
+    high = log(sizeClass->high + 1);
+    return (off_t)exp(low + nextRandom(load) * (high - low));
+}
+
+/*
+-- FUNCTION: pickThinkTime
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static long long pickThinkTime(struct loadGenerator *load);
+--
+-- RETURNS: the microseconds a session waits before its next request
+--
+-- NOTES:
+-- This function picks a think time from an exponential distribution with the
+-- mean think time, none if the mean is 0.
+*/
+static long long pickThinkTime(struct loadGenerator *load)
+{
+    if (load->options->thinkTime == 0)
+    {
+        return 0;
+    }
+    return (long long)(-log(1 - nextRandom(load)) *
+        load->options->thinkTime * 1000);
+}
+
+/*
+-- FUNCTION: nextRandom
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static double nextRandom(struct loadGenerator *load);
+--
+-- RETURNS: a random number from 0 up to but not including 1
+--
+-- NOTES:
+-- This function steps the xorshift generator of the load generator. It is
+-- fast and good enough for picking requests.
+*/
+static double nextRandom(struct loadGenerator *load)
+{
+    load->random ^= load->random >> 12;
+    load->random ^= load->random << 25;
+    load->random ^= load->random >> 27;
+    return (double)((load->random * 2685821657736338717ULL) >> 11) /
+        9007199254740992.0;
+}
+
+/*
+-- FUNCTION: printProgress
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void printProgress(struct loadGenerator *load,
+--                                      long long now);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function prints the requests, bytes and failures since the last
+-- report and adds them to the totals.
+*/
+static void printProgress(struct loadGenerator *load, long long now)
+{
+    double seconds = load->options->report;
+    int i = 0;
+
+    printf("%8.1f %8d %8.1f %8.1f %10.2f %10.2f %8lld\n",
+        (now - load->started) / 1000000.0, load->active,
+        load->interval[GET_FILE].requests / seconds,
+        load->interval[SEND_FILE].requests / seconds,
+        load->interval[GET_FILE].bytes / seconds / 1048576,
+        load->interval[SEND_FILE].bytes / seconds / 1048576,
+        load->interval[GET_FILE].failures +
+        load->interval[SEND_FILE].failures);
+    fflush(stdout);
+
+    for (i = GET_FILE; i <= SEND_FILE; i++)
+    {
+        load->stats[i].requests += load->interval[i].requests;
+        load->stats[i].failures += load->interval[i].failures;
+        load->stats[i].bytes += load->interval[i].bytes;
+        load->interval[i].requests = 0;
+        load->interval[i].failures = 0;
+        load->interval[i].bytes = 0;
+    }
+}
+
+/*
+-- FUNCTION: printSummary
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void printSummary(struct loadGenerator *load,
+--                                     long long now);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function prints the totals of each direction over the whole run and
+-- the percentiles of the latency of the requests that worked.
+*/
+static void printSummary(struct loadGenerator *load, long long now)
+{
+    const char *names[] = { "get", "put" };
+    struct loadStats *stats = NULL;
+    double seconds = (now - load->started) / 1000000.0;
+    int i = 0;
+
+    // The last interval has not been added to the totals yet
+    for (i = GET_FILE; i <= SEND_FILE; i++)
+    {
+        load->stats[i].requests += load->interval[i].requests;
+        load->stats[i].failures += load->interval[i].failures;
+        load->stats[i].bytes += load->interval[i].bytes;
+    }
+
+    printf("\n%.1f seconds, %lld requests\n", seconds, load->issued);
+    printf("%4s %9s %8s %10s %8s %9s %9s %9s %9s %9s\n", "dir", "requests",
+        "failures", "MB/s", "req/s", "p50 ms", "p90 ms", "p99 ms",
+        "p99.9 ms", "max ms");
+    for (i = GET_FILE; i <= SEND_FILE; i++)
+    {
+        stats = &load->stats[i];
+        printf("%4s %9lld %8lld %10.2f %8.1f %9.2f %9.2f %9.2f %9.2f "
+            "%9.2f\n", names[i], stats->requests, stats->failures,
+            stats->bytes / seconds / 1048576, stats->requests / seconds,
+            valueAt(&stats->latency, 0.5) / 1000.0,
+            valueAt(&stats->latency, 0.9) / 1000.0,
+            valueAt(&stats->latency, 0.99) / 1000.0,
+            valueAt(&stats->latency, 0.999) / 1000.0,
+            stats->latency.max / 1000.0);
+    }
+}
+
+/*
+-- FUNCTION: currentTime
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static long long currentTime();
+--
+-- RETURNS: the microseconds on the monotonic clock
+--
+-- NOTES:
+-- Latencies are kept in microseconds, a transfer over loopback can take less
+-- than a millisecond.
+*/
+static long long currentTime()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/*
+-- FUNCTION: raiseFileLimit
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void raiseFileLimit(int sessions);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function raises the limit of open files as far as it goes. A session
+-- has one socket open at a time, a request that is closing its control
+-- socket can briefly have two.
+*/
+static void raiseFileLimit(int sessions)
+{
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1)
+    {
+        return;
+    }
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+        limit.rlim_cur < (rlim_t)sessions + 16)
+    {
+        fprintf(stderr, "Only %d files can be open, sessions may fail\n",
+            (int)limit.rlim_cur);
+    }
+}
+
+/*
+-- FUNCTION: systemFatal
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void systemFatal(const char* message);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function prints the error and exits.
+*/
+static void systemFatal(const char* message)
+{
+    perror(message);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,123 @@
+#ifndef LOAD_H
+#define LOAD_H
+
+#include <sys/types.h>
+
+#include "../network/network.h"
+#include "../network/histogram.h"
+
+#define DEF_SESSIONS 100
+#define DEF_DURATION 10
+#define DEF_GET_PERCENT 50
+#define DEF_SIZES "64k"
+#define DEF_REPORT 1
+
+// Seconds a request may take before it is counted as a failure
+#define REQUEST_TIMEOUT 60
+
+// Uploads are named after the process and the session that sent them
+#define PUT_PREFIX "load-"
+
+// The server keeps uploads here and gets files from where it was started
+#define UPLOAD_DIR "share/"
+
+// Most entries in a list of sizes
+#define MAX_SIZE_CLASSES 16
+
+// Session states
+#define LOAD_IDLE 0
+#define LOAD_CONNECT 1
+#define LOAD_COMMAND 2
+#define LOAD_REPLY 3
+#define LOAD_DATA_CONNECT 4
+#define LOAD_ACCEPT 5
+#define LOAD_GET_HEADER 6
+#define LOAD_GET_BODY 7
+#define LOAD_SEND_HEADER 8
+#define LOAD_SEND_BODY 9
+#define LOAD_SEND_CLOSE 10
+
+// Sizes from low to high, picked weight times out of the total weight
+struct sizeClass
+{
+    long long low;
+    long long high;
+    int weight;
+};
+
+struct loadOptions
+{
+    const char *host;
+    int port;
+    int sessions;
+    long long requests;
+    int duration;
+    int getPercent;
+    int thinkTime;
+    int passive;
+    int chunkSize;
+    int report;
+    int classCount;
+    int totalWeight;
+    struct sizeClass classes[MAX_SIZE_CLASSES];
+    char **names;
+    int nameCount;
+};
+
+// Totals of one direction, GET_FILE or SEND_FILE
+struct loadStats
+{
+    long long requests;
+    long long failures;
+    long long bytes;
+    struct histogram latency;
+};
+
+struct session
+{
+    int id;
+    int socket;
+    int state;
+    int command;
+    int uploaded;
+    int heapIndex;
+    char name[BUFFER_LENGTH];
+    char buffer[BUFFER_LENGTH];
+    int bufferCount;
+    off_t size;
+    off_t count;
+    long long started;
+    long long wakeTime;
+};
+
+struct loadGenerator
+{
+    struct loadOptions *options;
+    char ip[16];
+    int epoll;
+    char *body;
+    struct session *sessions;
+    struct session **timers;
+    int timerCount;
+    int active;
+    long long issued;
+    long long started;
+    long long deadline;
+    unsigned long long random;
+    struct loadStats stats[2];
+    struct loadStats interval[2];
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int parseSizes(const char *text, struct loadOptions *options);
+int readNameFile(const char *path, struct loadOptions *options);
+int runLoad(struct loadOptions *options);
+void startLoopback(struct loadOptions *options);
+void stopLoopback();
+#ifdef __cplusplus
+}
+#endif
+#endif
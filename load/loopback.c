@@ -0,0 +1,161 @@
+/*
+-- SOURCE FILE: loopback.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- void startLoopback(struct loadOptions *options);
+-- void stopLoopback();
+-- static void *loopbackThread(void *argument);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The server is stopped before the load
+-- generator exits.
+-- October 17, 2026 - Says that the connections are kernel sockets.
+--
+-- NOTES:
+-- This file runs the server inside the load generator over the memory
+-- transport, see local.c, so the load measures the protocol and the server
+-- without the TCP/IP stack. The connections are still Unix domain sockets of
+-- the kernel, every transfer makes system calls. The server runs in the
+-- epoll mode on a thread of its own and the sessions of the load generator
+-- connect to it like to any other server. Every transfer is passive, the
+-- memory transport can not connect back to the load generator. The server is
+-- stopped and its thread joined with stopLoopback before the process exits.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "load.h"
+#include "../server/server.h"
+#include "../server/filecache.h"
+#include "../network/network.h"
+#include "../network/buffer.h"
+
+// Connects tried while the server thread binds its port
+#define LOOPBACK_RETRIES 1000
+#define LOOPBACK_RETRY_DELAY 1000
+
+static void *loopbackThread(void *argument);
+
+// The thread of the server, while it runs
+static pthread_t serverThread;
+static int serverRunning = 0;
+
+/*
+-- FUNCTION: startLoopback
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Probes the server with a socket of the
+-- transport and keeps the thread to join it.
+--
+-- INTERFACE: void startLoopback(struct loadOptions *options);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function starts the server on the port of the options over the memory
+-- transport and returns once it takes connections. The options are changed
+-- to passive transfers to the server of this process. The server serves the
+-- share directory of the working directory, as it does when started on its
+-- own, and runs until stopLoopback is called.
+*/
+void startLoopback(struct loadOptions *options)
+{
+    static struct serverOptions serverOptions;
+    int socket = -1;
+    int i = 0;
+
+    setTransport(&memoryTransport);
+    options->host = "127.0.0.1";
+    options->passive = 1;
+
+    serverOptions.port = options->port;
+    serverOptions.mode = MODE_EPOLL;
+    serverOptions.threads = 1;
+    serverOptions.dataLow = 0;
+    serverOptions.dataHigh = 0;
+    serverOptions.chunkSize = options->chunkSize;
+    serverOptions.cacheSize = FILE_CACHE_SIZE;
+    serverOptions.hotSize = HOT_CACHE_SIZE;
+    serverOptions.metricsFile = NULL;
+
+    if (pthread_create(&serverThread, NULL, loopbackThread,
+        &serverOptions) != 0)
+    {
+        perror("Cannot Start Server Thread");
+        exit(EXIT_FAILURE);
+    }
+    serverRunning = 1;
+
+    // The server accepts and drops the connection that finds it bound
+    for (i = 0; i < LOOPBACK_RETRIES; i++)
+    {
+        if ((socket = tcpSocket()) == -1)
+        {
+            perror("Cannot Create Socket");
+            exit(EXIT_FAILURE);
+        }
+        if (connectToServer(&options->port, &socket, options->host) != -1)
+        {
+            closeSocket(&socket);
+            return;
+        }
+        closeSocket(&socket);
+        usleep(LOOPBACK_RETRY_DELAY);
+    }
+    fprintf(stderr, "Server did not start on port %d\n", options->port);
+    exit(EXIT_FAILURE);
+}
+
+/*
+-- FUNCTION: stopLoopback
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void stopLoopback();
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function stops the server started by startLoopback and waits for its
+-- thread, so the process does not exit while the server is in the middle of
+-- an event.
+*/
+void stopLoopback()
+{
+    if (!serverRunning)
+    {
+        return;
+    }
+    stopReactors();
+    pthread_join(serverThread, NULL);
+    serverRunning = 0;
+}
+
+/*
+-- FUNCTION: loopbackThread
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void *loopbackThread(void *argument);
+--
+-- RETURNS: NULL once the server is stopped
+--
+-- NOTES:
+-- This function is the thread of the server, the argument is its options.
+*/
+static void *loopbackThread(void *argument)
+{
+    server((struct serverOptions*)argument);
+    return NULL;
+}
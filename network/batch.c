@@ -0,0 +1,695 @@
+/*
+-- SOURCE FILE: batch.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int addPaths(struct batchList *list, const char *base,
+--              const char *pattern);
+-- int addName(struct batchList *list, const char *name);
+-- void freeNames(struct batchList *list);
+-- int checkName(const char *name);
+-- int sendNames(int socket, const struct batchList *list);
+-- int readNames(int socket, struct batchList *list);
+-- int sendEntries(int socket, const char *base,
+--                 const struct batchList *list, struct batchStats *stats,
+--                 entryFinished finished);
+-- int receiveEntries(int socket, const char *base, int *pipe, char *buffer,
+--                    int size, struct batchStats *stats,
+--                    entryFinished finished);
+-- static int addTree(struct batchList *list, const char *base,
+--                    const char *name);
+-- static int packEntry(char *header, off_t size, const char *name);
+-- static int readEntry(int socket, off_t *size, char *name);
+-- static int openEntry(const char *base, const char *name);
+-- static int skipBody(int socket, char *buffer, int size, off_t length);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- NOTES:
+-- This file contains batch transfers, many files moved over one data
+-- connection. A batch is a run of entries, each the entry header, the name of
+-- the file and its body, ended by an entry with an empty name. The names are
+-- relative to the directory of the sender and the receiver writes the files
+-- under its own directory, making the directories in the names as it goes.
+--
+-- Entries follow each other without waiting for the receiver, so moving a
+-- file costs no round trip. The socket is corked for the whole batch, so the
+-- header of a small file leaves in the same segment as its body and the ones
+-- after it. Bodies are sent with sendfile and spliced to disk like any other
+-- body, see transfer.c.
+--
+-- A download asks for its files by name, with the same entries without
+-- bodies. A name can be a file, a directory, whose files are all sent, or a
+-- pattern, see glob(3). Files and directories starting with a dot are left
+-- out of directories, so the chunk store and partial uploads are never sent.
+-- A name that matches nothing is sent as a missing entry so the receiver can
+-- say which one it was.
+*/
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#include <glob.h>
+#include <string.h>
+
+#include "network.h"
+#include "batch.h"
+#include "transfer.h"
+
+static int addTree(struct batchList *list, const char *base,
+                   const char *name);
+static int packEntry(char *header, off_t size, const char *name);
+static int readEntry(int socket, off_t *size, char *name);
+static int openEntry(const char *base, const char *name);
+static int skipBody(int socket, char *buffer, int size, off_t length);
+
+/*
+-- FUNCTION: addPaths
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int addPaths(struct batchList *list, const char *base,
+--                         const char *pattern);
+--
+-- RETURNS: the number of files added or -1 on failure
+--
+-- NOTES:
+-- This function adds the files the pattern names under the directory base to
+-- the list. The pattern is expanded with glob, every regular file it matches
+-- is added and every directory is added with all of its files. The names
+-- added are relative to base.
+*/
+int addPaths(struct batchList *list, const char *base, const char *pattern)
+{
+    char path[FILENAME_MAX];
+    const char *name = NULL;
+    struct stat statBuffer;
+    glob_t matches;
+    int count = list->count;
+    size_t i = 0;
+
+    if (snprintf(path, FILENAME_MAX, "%s%s", base, pattern) >= FILENAME_MAX)
+    {
+        return 0;
+    }
+    if (glob(path, 0, NULL, &matches) != 0)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < matches.gl_pathc; i++)
+    {
+        // Drop the directory and the ./ glob keeps from the pattern
+        name = matches.gl_pathv[i] + strlen(base);
+        while (strncmp(name, "./", 2) == 0)
+        {
+            name += 2;
+        }
+        if (strcmp(name, ".") == 0)
+        {
+            name = "";
+        }
+        if (stat(matches.gl_pathv[i], &statBuffer) == -1)
+        {
+            continue;
+        }
+        if ((S_ISDIR(statBuffer.st_mode) ? addTree(list, base, name) :
+            S_ISREG(statBuffer.st_mode) ? addName(list, name) : 0) == -1)
+        {
+            globfree(&matches);
+            return -1;
+        }
+    }
+
+    globfree(&matches);
+    return list->count - count;
+}
+
+/*
+-- FUNCTION: addName
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int addName(struct batchList *list, const char *name);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function adds a copy of the name to the end of the list, doubling the
+-- list when it is full. Names longer than an entry holds are a failure.
+*/
+int addName(struct batchList *list, const char *name)
+{
+    char **names = NULL;
+
+    if (strlen(name) > MAX_ENTRY_NAME)
+    {
+        return -1;
+    }
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        if ((names = (char**)realloc(list->names,
+            sizeof(char*) * list->capacity)) == NULL)
+        {
+            return -1;
+        }
+        list->names = names;
+    }
+    if ((list->names[list->count] = strdup(name)) == NULL)
+    {
+        return -1;
+    }
+
+    list->count++;
+    return 0;
+}
+
+/*
+-- FUNCTION: freeNames
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void freeNames(struct batchList *list);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function frees the names of the list and leaves it empty.
+*/
+void freeNames(struct batchList *list)
+{
+    int i = 0;
+
+    for (i = 0; i < list->count; i++)
+    {
+        free(list->names[i]);
+    }
+    free(list->names);
+    list->names = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+/*
+-- FUNCTION: checkName
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int checkName(const char *name);
+--
+-- RETURNS: 0 if the name stays inside the directory, -1 if it does not
+--
+-- NOTES:
+-- This function checks a name that came from the network before it is
+-- opened. An empty name, an absolute one and one with a .. in it are refused.
+*/
+int checkName(const char *name)
+{
+    const char *part = name;
+
+    if (name[0] == '\0' || name[0] == '/')
+    {
+        return -1;
+    }
+
+    while (part != NULL)
+    {
+        if (strncmp(part, "..", 2) == 0 &&
+            (part[2] == '/' || part[2] == '\0'))
+        {
+            return -1;
+        }
+        if ((part = strchr(part, '/')) != NULL)
+        {
+            part++;
+        }
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: sendNames
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendNames(int socket, const struct batchList *list);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function sends the names of the list as entries without bodies, ended
+-- by the empty entry. A download sends the names it wants this way.
+*/
+int sendNames(int socket, const struct batchList *list)
+{
+    char entry[ENTRY_HEADER + FILENAME_MAX];
+    int i = 0;
+
+    for (i = 0; i <= list->count; i++)
+    {
+        if (sendAll(&socket, entry, packEntry(entry, 0, i < list->count ?
+            list->names[i] : "")) == -1)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: readNames
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int readNames(int socket, struct batchList *list);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function reads names sent by sendNames into the list until the empty
+-- entry.
+*/
+int readNames(int socket, struct batchList *list)
+{
+    char name[FILENAME_MAX];
+    off_t size = 0;
+
+    while (readEntry(socket, &size, name) == 0)
+    {
+        if (name[0] == '\0')
+        {
+            return 0;
+        }
+        if (addName(list, name) == -1)
+        {
+            return -1;
+        }
+    }
+
+    return -1;
+}
+
+/*
+-- FUNCTION: sendEntries
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendEntries(int socket, const char *base,
+--                            const struct batchList *list,
+--                            struct batchStats *stats,
+--                            entryFinished finished);
+--
+-- RETURNS: 0 on success or -1 if the batch could not be finished
+--
+-- NOTES:
+-- This function sends the files of the list under the directory base, back
+-- to back, and the empty entry after them. A file that can not be opened and
+-- a name that does not stay under base are sent as missing entries and the
+-- batch goes on. A file that ends before its
+-- size leaves the receiver out of step, so it ends the batch. The socket is
+-- corked while the entries are sent and uncorked at the end, which sends what
+-- is left. Every entry is passed to finished if there is one.
+*/
+int sendEntries(int socket, const char *base, const struct batchList *list,
+                struct batchStats *stats, entryFinished finished)
+{
+    char entry[ENTRY_HEADER + FILENAME_MAX];
+    char path[FILENAME_MAX];
+    struct stat statBuffer;
+    int cork = 1;
+    int file = 0;
+    int result = 0;
+    int i = 0;
+    off_t size = 0;
+
+    bzero(stats, sizeof(struct batchStats));
+    setsockopt(socket, IPPROTO_TCP, TCP_CORK, &cork, sizeof(int));
+
+    for (i = 0; i < list->count && result == 0; i++)
+    {
+        snprintf(path, FILENAME_MAX, "%s%s", base, list->names[i]);
+        size = ENTRY_MISSING;
+        file = -1;
+        if (checkName(list->names[i]) == 0 &&
+            (file = open(path, O_RDONLY)) != -1 &&
+            fstat(file, &statBuffer) == 0 && S_ISREG(statBuffer.st_mode))
+        {
+            size = statBuffer.st_size;
+        }
+
+        if (sendAll(&socket, entry, packEntry(entry, size,
+            list->names[i])) == -1 ||
+            (size > 0 && sendRange(socket, file, 0, size) == -1))
+        {
+            result = -1;
+        }
+        if (file != -1)
+        {
+            close(file);
+        }
+
+        if (size == ENTRY_MISSING || result == -1)
+        {
+            stats->failures++;
+        }
+        else
+        {
+            stats->files++;
+            stats->bytes += size;
+        }
+        if (finished != NULL)
+        {
+            finished(list->names[i], size, size != ENTRY_MISSING &&
+                result == 0);
+        }
+    }
+
+    if (result == 0)
+    {
+        result = sendAll(&socket, entry, packEntry(entry, 0, ""));
+    }
+    cork = 0;
+    setsockopt(socket, IPPROTO_TCP, TCP_CORK, &cork, sizeof(int));
+    return result;
+}
+
+/*
+-- FUNCTION: receiveEntries
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Preallocates the files and writes them behind.
+--
+-- INTERFACE: int receiveEntries(int socket, const char *base, int *pipe,
+--                               char *buffer, int size,
+--                               struct batchStats *stats,
+--                               entryFinished finished);
+--
+-- RETURNS: 0 when the batch ended or -1 if the connection failed first
+--
+-- NOTES:
+-- This function receives entries into files under the directory base until
+-- the empty entry. The bodies are moved with receiveChunk through the pipe,
+-- in pieces of at most size bytes, the size of the buffer. A missing entry,
+-- a name that is refused and a file that can not be created only fail that
+-- entry, the body of the last two is read and dropped. Every entry is passed
+-- to finished if there is one. Each file is preallocated and written behind,
+-- see transfer.c.
+*/
+int receiveEntries(int socket, const char *base, int *pipe, char *buffer,
+                   int size, struct batchStats *stats,
+                   entryFinished finished)
+{
+    char name[FILENAME_MAX];
+    off_t length = 0;
+    struct writeBehind behind;
+    off_t count = 0;
+    int bytesRead = 0;
+    int file = 0;
+
+    bzero(stats, sizeof(struct batchStats));
+    while (readEntry(socket, &length, name) == 0)
+    {
+        if (name[0] == '\0')
+        {
+            return 0;
+        }
+        if (length == ENTRY_MISSING)
+        {
+            stats->failures++;
+            if (finished != NULL)
+            {
+                finished(name, length, 0);
+            }
+            continue;
+        }
+        if (length < 0)
+        {
+            return -1;
+        }
+
+        if ((file = openEntry(base, name)) == -1)
+        {
+            if (skipBody(socket, buffer, size, length) == -1)
+            {
+                return -1;
+            }
+            stats->failures++;
+            if (finished != NULL)
+            {
+                finished(name, length, 0);
+            }
+            continue;
+        }
+
+        startReceive(&behind, file, 0, length);
+        for (count = 0; count < length; count += bytesRead)
+        {
+            if ((bytesRead = receiveChunk(socket, file, pipe, buffer,
+                length - count < size ? length - count : size, NULL)) <= 0)
+            {
+                close(file);
+                return -1;
+            }
+            writeBehind(&behind, count + bytesRead);
+        }
+        close(file);
+
+        stats->files++;
+        stats->bytes += length;
+        if (finished != NULL)
+        {
+            finished(name, length, 1);
+        }
+    }
+
+    return -1;
+}
+
+/*
+-- FUNCTION: addTree
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int addTree(struct batchList *list, const char *base,
+--                               const char *name);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function adds every regular file in the directory name under base to
+-- the list, and the files of the directories in it. Names starting with a dot
+-- are skipped. A directory that can not be read adds nothing.
+*/
+static int addTree(struct batchList *list, const char *base,
+                   const char *name)
+{
+    char path[FILENAME_MAX];
+    char child[FILENAME_MAX];
+    struct stat statBuffer;
+    struct dirent *entry = NULL;
+    DIR *directory = NULL;
+    int result = 0;
+
+    snprintf(path, FILENAME_MAX, "%s%s", base, name);
+    if ((directory = opendir(path)) == NULL)
+    {
+        return 0;
+    }
+
+    while (result == 0 && (entry = readdir(directory)) != NULL)
+    {
+        if (entry->d_name[0] == '.' ||
+            snprintf(child, FILENAME_MAX, "%s%s%s", name,
+            name[0] == '\0' || name[strlen(name) - 1] == '/' ? "" : "/",
+            entry->d_name) >= FILENAME_MAX)
+        {
+            continue;
+        }
+        snprintf(path, FILENAME_MAX, "%s%s", base, child);
+        if (lstat(path, &statBuffer) == -1)
+        {
+            continue;
+        }
+        if (S_ISDIR(statBuffer.st_mode))
+        {
+            result = addTree(list, base, child);
+        }
+        else if (S_ISREG(statBuffer.st_mode))
+        {
+            result = addName(list, child);
+        }
+    }
+
+    closedir(directory);
+    return result;
+}
+
+/*
+-- FUNCTION: packEntry
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int packEntry(char *header, off_t size,
+--                                 const char *name);
+--
+-- RETURNS: the bytes of the entry before its body
+--
+-- NOTES:
+-- This function writes the header of an entry and its name after it, so both
+-- are sent with one call. The name must fit in an entry, see addName.
+*/
+static int packEntry(char *header, off_t size, const char *name)
+{
+    unsigned short length = (unsigned short)strlen(name);
+
+    memmove(header, (void*)&size, sizeof(off_t));
+    memmove(header + sizeof(off_t), (void*)&length, sizeof(short));
+    memmove(header + ENTRY_HEADER, name, length);
+    return ENTRY_HEADER + length;
+}
+
+/*
+-- FUNCTION: readEntry
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int readEntry(int socket, off_t *size, char *name);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function reads the header of an entry and its name, which must hold
+-- FILENAME_MAX bytes. The body is left on the socket.
+*/
+static int readEntry(int socket, off_t *size, char *name)
+{
+    char header[ENTRY_HEADER];
+    unsigned short length = 0;
+
+    if (readAll(&socket, header, ENTRY_HEADER) == -1)
+    {
+        return -1;
+    }
+    memmove((void*)size, header, sizeof(off_t));
+    memmove((void*)&length, header + sizeof(off_t), sizeof(short));
+    if (length > MAX_ENTRY_NAME ||
+        (length > 0 && readAll(&socket, name, length) == -1))
+    {
+        return -1;
+    }
+
+    name[length] = '\0';
+    return 0;
+}
+
+/*
+-- FUNCTION: openEntry
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int openEntry(const char *base, const char *name);
+--
+-- RETURNS: the file or -1 on failure
+--
+-- NOTES:
+-- This function creates the file of an entry under base, readable and
+-- writable by the owner only like every received file, and the directories
+-- on the way to it. A name that does not stay under base is refused.
+*/
+static int openEntry(const char *base, const char *name)
+{
+    char path[FILENAME_MAX];
+    char *slash = NULL;
+
+    if (checkName(name) == -1 ||
+        snprintf(path, FILENAME_MAX, "%s%s", base, name) >= FILENAME_MAX)
+    {
+        return -1;
+    }
+
+    for (slash = strchr(path + strlen(base), '/'); slash != NULL;
+        slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        if (mkdir(path, 00700) == -1 && errno != EEXIST)
+        {
+            return -1;
+        }
+        *slash = '/';
+    }
+
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC, 00400 | 00200 | 00100);
+}
+
+/*
+-- FUNCTION: skipBody
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int skipBody(int socket, char *buffer, int size,
+--                                off_t length);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function reads the body of an entry that is not kept and drops it,
+-- through the buffer of size bytes.
+*/
+static int skipBody(int socket, char *buffer, int size, off_t length)
+{
+    int bytesRead = 0;
+
+    for (; length > 0; length -= bytesRead)
+    {
+        if ((bytesRead = read(socket, buffer, length < size ? length :
+            size)) <= 0)
+        {
+            if (bytesRead == -1 && errno == EINTR)
+            {
+                bytesRead = 0;
+                continue;
+            }
+            return -1;
+        }
+    }
+
+    return 0;
+}
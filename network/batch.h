@@ -0,0 +1,53 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+// Entry header: the size of the file (8) and the length of its name (2)
+#define ENTRY_HEADER	10
+
+// Size of the entry of a file the sender could not open, it has no body
+#define ENTRY_MISSING	-1
+
+// Longest name of an entry, the same as a path
+#define MAX_ENTRY_NAME	(FILENAME_MAX - 1)
+
+// The names of the files of a batch, relative to the directory of the sender
+struct batchList
+{
+    char **names;
+    int count;
+    int capacity;
+};
+
+// What a batch moved, filled in by sendEntries and receiveEntries
+struct batchStats
+{
+    int files;
+    int failures;
+    off_t bytes;
+};
+
+// Called for every entry once it is sent or received
+typedef void (*entryFinished)(const char *name, off_t size, int success);
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int addPaths(struct batchList *list, const char *base, const char *pattern);
+int addName(struct batchList *list, const char *name);
+void freeNames(struct batchList *list);
+int checkName(const char *name);
+int sendNames(int socket, const struct batchList *list);
+int readNames(int socket, struct batchList *list);
+int sendEntries(int socket, const char *base, const struct batchList *list,
+                struct batchStats *stats, entryFinished finished);
+int receiveEntries(int socket, const char *base, int *pipe, char *buffer,
+                   int size, struct batchStats *stats,
+                   entryFinished finished);
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,220 @@
+/*
+-- SOURCE FILE: buffer.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- long long parseSize(const char *text);
+-- int parseChunkSize(const char *text);
+-- void initializeBufferPool(struct bufferPool *pool, int size);
+-- void destroyBufferPool(struct bufferPool *pool);
+-- char *takeBuffer(struct bufferPool *pool);
+-- void returnBuffer(struct bufferPool *pool, char *buffer);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Sizes are read by parseSize.
+--
+-- NOTES:
+-- This file contains the pool of transfer buffers. The size of the chunks file
+-- data is moved in no longer has anything to do with BUFFER_LENGTH, the size
+-- of a control message. It is chosen on the command line and every buffer of
+-- a pool is one chunk long and aligned to a page, so the kernel can copy into
+-- it a page at a time.
+--
+-- Buffers that are handed back are kept for the next transfer instead of being
+-- freed, so a process or reactor thread only allocates as many buffers as it
+-- uses at the same time. Like the port pool, a buffer pool belongs to a single
+-- process or thread and is not locked.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "buffer.h"
+
+/*
+-- FUNCTION: parseSize
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Takes gigabytes.
+--
+-- INTERFACE: long long parseSize(const char *text);
+--
+-- RETURNS: the size in bytes or -1 if it is not valid
+--
+-- NOTES:
+-- This function reads a size from the command line. The number may end in k,
+-- m or g for kilobytes, megabytes or gigabytes and must not be negative.
+*/
+long long parseSize(const char *text)
+{
+    char *end = NULL;
+    long long size = strtoll(text, &end, 10);
+
+    if (end == text || size < 0)
+    {
+        return -1;
+    }
+    if (*end == 'k' || *end == 'K')
+    {
+        size *= 1024;
+        end++;
+    }
+    else if (*end == 'm' || *end == 'M')
+    {
+        size *= 1024 * 1024;
+        end++;
+    }
+    else if (*end == 'g' || *end == 'G')
+    {
+        size *= 1024 * 1024 * 1024;
+        end++;
+    }
+
+    return *end == '\0' ? size : -1;
+}
+
+/*
+-- FUNCTION: parseChunkSize
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Reads the number with parseSize.
+--
+-- INTERFACE: int parseChunkSize(const char *text);
+--
+-- RETURNS: the chunk size in bytes or -1 if it is not valid
+--
+-- NOTES:
+-- This function reads a chunk size from the command line, see parseSize. It
+-- must lie between MIN_CHUNK_SIZE and MAX_CHUNK_SIZE.
+*/
+int parseChunkSize(const char *text)
+{
+    long long size = parseSize(text);
+
+    if (size < MIN_CHUNK_SIZE || size > MAX_CHUNK_SIZE)
+    {
+        return -1;
+    }
+
+    return (int)size;
+}
+
+/*
+-- FUNCTION: initializeBufferPool
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void initializeBufferPool(struct bufferPool *pool, int size);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function creates an empty pool of buffers that are size bytes long,
+-- rounded up to a whole number of pages.
+*/
+void initializeBufferPool(struct bufferPool *pool, int size)
+{
+    int page = (int)sysconf(_SC_PAGESIZE);
+
+    if (page <= 0)
+    {
+        page = MIN_CHUNK_SIZE;
+    }
+
+    pool->size = (size + page - 1) / page * page;
+    pool->count = 0;
+}
+
+/*
+-- FUNCTION: destroyBufferPool
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void destroyBufferPool(struct bufferPool *pool);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function frees every buffer held by the pool. Buffers still taken are
+-- not affected and may be freed with free.
+*/
+void destroyBufferPool(struct bufferPool *pool)
+{
+    while (pool->count > 0)
+    {
+        free(pool->buffers[--pool->count]);
+    }
+}
+
+/*
+-- FUNCTION: takeBuffer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: char *takeBuffer(struct bufferPool *pool);
+--
+-- RETURNS: a buffer of pool->size bytes or NULL if none could be allocated
+--
+-- NOTES:
+-- This function hands out the buffer that was returned last, which is the one
+-- most likely to still be in the cache, or allocates a new one.
+*/
+char *takeBuffer(struct bufferPool *pool)
+{
+    void *buffer = NULL;
+    int page = (int)sysconf(_SC_PAGESIZE);
+
+    if (pool->count > 0)
+    {
+        return pool->buffers[--pool->count];
+    }
+
+    if (posix_memalign(&buffer, page > 0 ? page : MIN_CHUNK_SIZE,
+        pool->size) != 0)
+    {
+        return NULL;
+    }
+
+    return (char*)buffer;
+}
+
+/*
+-- FUNCTION: returnBuffer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void returnBuffer(struct bufferPool *pool, char *buffer);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function gives a buffer back to the pool. Once the pool holds
+-- MAX_POOLED_BUFFERS free buffers any further ones are freed.
+*/
+void returnBuffer(struct bufferPool *pool, char *buffer)
+{
+    if (buffer == NULL)
+    {
+        return;
+    }
+
+    if (pool->count == MAX_POOLED_BUFFERS)
+    {
+        free(buffer);
+        return;
+    }
+
+    pool->buffers[pool->count++] = buffer;
+}
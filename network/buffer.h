@@ -0,0 +1,34 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+// Size of the chunks file data is moved in, apart from the control messages
+#define DEF_CHUNK_SIZE	262144
+#define MIN_CHUNK_SIZE	4096
+#define MAX_CHUNK_SIZE	8388608
+
+// Most free buffers a pool keeps around
+#define MAX_POOLED_BUFFERS	16
+
+// A free list of page aligned buffers of one size, not locked
+struct bufferPool
+{
+    int size;
+    int count;
+    char *buffers[MAX_POOLED_BUFFERS];
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+long long parseSize(const char *text);
+int parseChunkSize(const char *text);
+void initializeBufferPool(struct bufferPool *pool, int size);
+void destroyBufferPool(struct bufferPool *pool);
+char *takeBuffer(struct bufferPool *pool);
+void returnBuffer(struct bufferPool *pool, char *buffer);
+#ifdef __cplusplus
+}
+#endif
+#endif
+
@@ -0,0 +1,473 @@
+/*
+-- SOURCE FILE: checksum.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- unsigned int crc32c(unsigned int crc, const void *data, size_t length);
+-- int checksumFile(int file, off_t offset, off_t length, char *buffer,
+--                  int size, unsigned int *checksum);
+-- void blockSums(const void *data, int length, unsigned int *a,
+--                unsigned int *b);
+-- void hash128(const void *data, size_t length, unsigned char *hash);
+-- static unsigned int crcTableBytes(unsigned int crc,
+--                                   const unsigned char *bytes,
+--                                   size_t length);
+-- static unsigned int crcHardware(unsigned int crc,
+--                                 const unsigned char *bytes, size_t length);
+-- static unsigned long long mixBlock(unsigned long long k,
+--                                    unsigned long long c1,
+--                                    unsigned long long c2, int rotate);
+-- static unsigned long long finalMix(unsigned long long k);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The rolling checksum and the strong hash of
+-- the delta transfers.
+-- October 17, 2026 - CRC32C uses the crc32 instruction of SSE4.2 when the
+-- processor has it.
+--
+-- NOTES:
+-- This file contains the checksum used to check file data, CRC32C, the CRC
+-- with the Castagnoli polynomial. It is the polynomial of the crc32
+-- instruction of SSE4.2, which works out the CRC of 8 bytes at a time. The
+-- instruction is used when the processor has it, found out the first time a
+-- CRC is computed, so the program still runs on processors without it.
+-- Otherwise the CRC is computed a byte at a time from a table of the CRC of
+-- every byte value.
+--
+-- It also holds the two checksums of a block used by delta transfers, see
+-- delta.c. The weak one is the rolling checksum of rsync, two sums of the
+-- bytes that can be slid along a file a byte at a time. The sums of a whole
+-- block are computed 16 bytes at a time with SSE2 where it is available. The
+-- strong one is the 128 bit MurmurHash3, which tells blocks with the same
+-- weak checksum apart.
+*/
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define HAVE_CRC_INSTRUCTION
+#endif
+
+#include "checksum.h"
+
+static unsigned int crcTableBytes(unsigned int crc,
+                                  const unsigned char *bytes, size_t length);
+#ifdef HAVE_CRC_INSTRUCTION
+static unsigned int crcHardware(unsigned int crc,
+                                const unsigned char *bytes, size_t length)
+                                __attribute__((target("sse4.2")));
+#endif
+static unsigned long long mixBlock(unsigned long long k,
+                                   unsigned long long c1,
+                                   unsigned long long c2, int rotate);
+static unsigned long long finalMix(unsigned long long k);
+
+// CRC32C of every byte value, reflected polynomial 0x82f63b78
+static const unsigned int crcTable[256] =
+{
+    0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4,
+    0xc79a971f, 0x35f1141c, 0x26a1e7e8, 0xd4ca64eb,
+    0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b,
+    0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24,
+    0x105ec76f, 0xe235446c, 0xf165b798, 0x030e349b,
+    0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+    0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54,
+    0x5d1d08bf, 0xaf768bbc, 0xbc267848, 0x4e4dfb4b,
+    0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a,
+    0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35,
+    0xaa64d611, 0x580f5512, 0x4b5fa6e6, 0xb93425e5,
+    0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+    0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45,
+    0xf779deae, 0x05125dad, 0x1642ae59, 0xe4292d5a,
+    0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a,
+    0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595,
+    0x417b1dbc, 0xb3109ebf, 0xa0406d4b, 0x522bee48,
+    0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+    0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687,
+    0x0c38d26c, 0xfe53516f, 0xed03a29b, 0x1f682198,
+    0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927,
+    0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38,
+    0xdbfc821c, 0x2997011f, 0x3ac7f2eb, 0xc8ac71e8,
+    0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+    0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096,
+    0xa65c047d, 0x5437877e, 0x4767748a, 0xb50cf789,
+    0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859,
+    0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46,
+    0x7198540d, 0x83f3d70e, 0x90a324fa, 0x62c8a7f9,
+    0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+    0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36,
+    0x3cdb9bdd, 0xceb018de, 0xdde0eb2a, 0x2f8b6829,
+    0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c,
+    0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93,
+    0x082f63b7, 0xfa44e0b4, 0xe9141340, 0x1b7f9043,
+    0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+    0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3,
+    0x55326b08, 0xa759e80b, 0xb4091bff, 0x466298fc,
+    0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c,
+    0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033,
+    0xa24bb5a6, 0x502036a5, 0x4370c551, 0xb11b4652,
+    0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+    0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d,
+    0xef087a76, 0x1d63f975, 0x0e330a81, 0xfc588982,
+    0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d,
+    0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622,
+    0x38cc2a06, 0xcaa7a905, 0xd9f75af1, 0x2b9cd9f2,
+    0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+    0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530,
+    0x0417b1db, 0xf67c32d8, 0xe52cc12c, 0x1747422f,
+    0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff,
+    0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0,
+    0xd3d3e1ab, 0x21b862a8, 0x32e8915c, 0xc083125f,
+    0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+    0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90,
+    0x9e902e7b, 0x6cfbad78, 0x7fab5e8c, 0x8dc0dd8f,
+    0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee,
+    0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1,
+    0x69e9f0d5, 0x9b8273d6, 0x88d28022, 0x7ab90321,
+    0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+    0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81,
+    0x34f4f86a, 0xc69f7b69, 0xd5cf889d, 0x27a40b9e,
+    0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e,
+    0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351
+};
+
+/*
+-- FUNCTION: crc32c
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: unsigned int crc32c(unsigned int crc, const void *data,
+--                                size_t length);
+--
+-- RETURNS: the checksum of the data
+--
+-- NOTES:
+-- This function adds length bytes of data to the checksum crc. Start with a
+-- crc of 0. The checksum of data that arrives in pieces is the result of
+-- passing each piece in turn with the checksum of the pieces before it.
+--
+-- Whether the processor has the crc32 instruction is only asked once. Every
+-- thread gets the same answer, so it does not matter which one asks first.
+*/
+unsigned int crc32c(unsigned int crc, const void *data, size_t length)
+{
+    const unsigned char *bytes = (const unsigned char*)data;
+#ifdef HAVE_CRC_INSTRUCTION
+    static int hardware = -1;
+
+    if (hardware == -1)
+    {
+        hardware = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+    }
+    if (hardware)
+    {
+        return ~crcHardware(~crc, bytes, length);
+    }
+#endif
+
+    return ~crcTableBytes(~crc, bytes, length);
+}
+
+/*
+-- FUNCTION: checksumFile
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int checksumFile(int file, off_t offset, off_t length,
+--                             char *buffer, int size,
+--                             unsigned int *checksum);
+--
+-- RETURNS: 0 on success or -1 if the range could not be read
+--
+-- NOTES:
+-- This function computes the checksum of length bytes of the file starting at
+-- offset. The file is read with pread through the buffer of size bytes, so
+-- the file position is left alone. A file that ends before the range does is
+-- a failure.
+*/
+int checksumFile(int file, off_t offset, off_t length, char *buffer,
+                 int size, unsigned int *checksum)
+{
+    ssize_t bytesRead = 0;
+
+    *checksum = 0;
+    while (length > 0)
+    {
+        bytesRead = pread(file, buffer, length < size ? length : size,
+            offset);
+        if (bytesRead <= 0)
+        {
+            if (bytesRead == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        *checksum = crc32c(*checksum, buffer, bytesRead);
+        offset += bytesRead;
+        length -= bytesRead;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: crcTableBytes
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static unsigned int crcTableBytes(unsigned int crc,
+--                                              const unsigned char *bytes,
+--                                              size_t length);
+--
+-- RETURNS: the updated register
+--
+-- NOTES:
+-- This function adds the bytes to the CRC register a byte at a time with the
+-- table. The register is the inverted checksum, crc32c does the inverting.
+*/
+static unsigned int crcTableBytes(unsigned int crc,
+                                  const unsigned char *bytes, size_t length)
+{
+    while (length-- > 0)
+    {
+        crc = crcTable[(crc ^ *bytes++) & 0xff] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+#ifdef HAVE_CRC_INSTRUCTION
+/*
+-- FUNCTION: crcHardware
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static unsigned int crcHardware(unsigned int crc,
+--                                            const unsigned char *bytes,
+--                                            size_t length);
+--
+-- RETURNS: the updated register
+--
+-- NOTES:
+-- This function adds the bytes to the CRC register with the crc32
+-- instruction, 8 bytes at a time and the bytes past the last 8 one by one. It
+-- is compiled for SSE4.2 on its own, the rest of the program is not, and must
+-- only be called when the processor has it.
+*/
+static unsigned int crcHardware(unsigned int crc,
+                                const unsigned char *bytes, size_t length)
+{
+    unsigned long long register64 = crc;
+    unsigned long long word = 0;
+
+    for (; length >= 8; length -= 8, bytes += 8)
+    {
+        memcpy(&word, bytes, 8);
+        register64 = _mm_crc32_u64(register64, word);
+    }
+
+    crc = (unsigned int)register64;
+    for (; length > 0; length--)
+    {
+        crc = _mm_crc32_u8(crc, *bytes++);
+    }
+
+    return crc;
+}
+#endif
+
+/*
+-- FUNCTION: blockSums
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void blockSums(const void *data, int length, unsigned int *a,
+--                           unsigned int *b);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function computes the two sums of the rolling checksum of a block, a
+-- the sum of its bytes and b the sum of every byte weighted by its distance
+-- from the end of the block, the same as adding a to b after every byte. Only
+-- the low 16 bits of each sum are used, so both are left to wrap.
+--
+-- With SSE2, 16 bytes are added at a time. The byte sums come from psadbw,
+-- and b of the 16 bytes is 16 times a before them plus the bytes weighted 16
+-- down to 1, which pmaddwd works out four pairs at a time. The bytes past the
+-- last 16 are added one by one.
+*/
+void blockSums(const void *data, int length, unsigned int *a,
+               unsigned int *b)
+{
+    const unsigned char *bytes = (const unsigned char*)data;
+    unsigned int sumA = 0;
+    unsigned int sumB = 0;
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowWeights = _mm_set_epi16(9, 10, 11, 12, 13, 14, 15, 16);
+    const __m128i highWeights = _mm_set_epi16(1, 2, 3, 4, 5, 6, 7, 8);
+    __m128i vectorA = zero;
+    __m128i vectorBefore = zero;
+    __m128i vectorWeighted = zero;
+    __m128i chunk;
+    unsigned int lanes[4];
+
+    for (; i + 16 <= length; i += 16)
+    {
+        chunk = _mm_loadu_si128((const __m128i*)(bytes + i));
+        vectorBefore = _mm_add_epi32(vectorBefore, vectorA);
+        vectorA = _mm_add_epi32(vectorA, _mm_sad_epu8(chunk, zero));
+        vectorWeighted = _mm_add_epi32(vectorWeighted,
+            _mm_madd_epi16(_mm_unpacklo_epi8(chunk, zero), lowWeights));
+        vectorWeighted = _mm_add_epi32(vectorWeighted,
+            _mm_madd_epi16(_mm_unpackhi_epi8(chunk, zero), highWeights));
+    }
+
+    _mm_storeu_si128((__m128i*)lanes, vectorA);
+    sumA = lanes[0] + lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, vectorBefore);
+    sumB = (lanes[0] + lanes[2]) * 16;
+    _mm_storeu_si128((__m128i*)lanes, vectorWeighted);
+    sumB += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    for (; i < length; i++)
+    {
+        sumA += bytes[i];
+        sumB += sumA;
+    }
+
+    *a = sumA;
+    *b = sumB;
+}
+
+/*
+-- FUNCTION: hash128
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void hash128(const void *data, size_t length,
+--                         unsigned char *hash);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function computes the 128 bit MurmurHash3 (x64 variant, seed 0) of the
+-- data and stores its 16 bytes in hash. The data is read 16 bytes at a time,
+-- the last partial block is zero padded.
+*/
+void hash128(const void *data, size_t length, unsigned char *hash)
+{
+    const unsigned long long c1 = 0x87c37b91114253d5ULL;
+    const unsigned long long c2 = 0x4cf5ad432745937fULL;
+    const unsigned char *bytes = (const unsigned char*)data;
+    unsigned long long h1 = 0;
+    unsigned long long h2 = 0;
+    unsigned long long k[2];
+    size_t i = 0;
+
+    for (i = 0; i + 16 <= length; i += 16)
+    {
+        memcpy(k, bytes + i, 16);
+        h1 ^= mixBlock(k[0], c1, c2, 31);
+        h1 = ((h1 << 27) | (h1 >> 37)) + h2;
+        h1 = h1 * 5 + 0x52dce729;
+        h2 ^= mixBlock(k[1], c2, c1, 33);
+        h2 = ((h2 << 31) | (h2 >> 33)) + h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    // The tail is mixed in without the rounds, a zero word changes nothing
+    k[0] = 0;
+    k[1] = 0;
+    memcpy(k, bytes + i, length - i);
+    h1 ^= mixBlock(k[0], c1, c2, 31);
+    h2 ^= mixBlock(k[1], c2, c1, 33);
+
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = finalMix(h1);
+    h2 = finalMix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    memcpy(hash, &h1, 8);
+    memcpy(hash + 8, &h2, 8);
+}
+
+/*
+-- FUNCTION: mixBlock
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static unsigned long long mixBlock(unsigned long long k,
+--                                               unsigned long long c1,
+--                                               unsigned long long c2,
+--                                               int rotate);
+--
+-- RETURNS: the mixed word
+--
+-- NOTES:
+-- This function scrambles a word of input before it is added to one half of
+-- the hash.
+*/
+static unsigned long long mixBlock(unsigned long long k,
+                                   unsigned long long c1,
+                                   unsigned long long c2, int rotate)
+{
+    k *= c1;
+    k = (k << rotate) | (k >> (64 - rotate));
+    return k * c2;
+}
+
+/*
+-- FUNCTION: finalMix
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static unsigned long long finalMix(unsigned long long k);
+--
+-- RETURNS: the mixed word
+--
+-- NOTES:
+-- This function makes every bit of a half of the hash depend on every other
+-- bit before it is output.
+*/
+static unsigned long long finalMix(unsigned long long k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
@@ -0,0 +1,20 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <sys/types.h>
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+unsigned int crc32c(unsigned int crc, const void *data, size_t length);
+int checksumFile(int file, off_t offset, off_t length, char *buffer,
+                 int size, unsigned int *checksum);
+void blockSums(const void *data, int length, unsigned int *a,
+               unsigned int *b);
+void hash128(const void *data, size_t length, unsigned char *hash);
+#ifdef __cplusplus
+}
+#endif
+#endif
+
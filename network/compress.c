@@ -0,0 +1,544 @@
+/*
+-- SOURCE FILE: compress.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int worthCompressing(int file, off_t offset, off_t length);
+-- int sendCompressed(int socket, int file, off_t offset, off_t length,
+--                    struct compressStats *stats,
+--                    struct verifier *verifier);
+-- int openDecoder(struct frameDecoder *decoder);
+-- void closeDecoder(struct frameDecoder *decoder);
+-- int receiveFrame(int socket, int file, int *pipe,
+--                  struct frameDecoder *decoder, int length, off_t *offset);
+-- static void *compressBlocks(void *argument);
+-- static int encodeBlock(struct compressPipeline *pipeline,
+--                        struct frameSlot *slot, off_t offset, int length);
+-- static int readBlock(int file, char *buffer, off_t offset, int length);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The checksums of verified transfers are sent
+-- between frames.
+--
+-- NOTES:
+-- This file contains compressed transfers. A client asks for them with
+-- FLAG_COMPRESS and the sender of the file decides. It compresses a few
+-- blocks spread over the file first, see worthCompressing, and only when
+-- they shrink does it set BODY_COMPRESSED in the size control message.
+-- Otherwise the body is sent with sendfile as always, so data that does not
+-- compress costs nothing but the sample.
+--
+-- A compressed body is a run of frames, one for every COMPRESS_BLOCK bytes of
+-- the file. A frame is its raw length and its coded length followed by the
+-- coded bytes, see lz.c. A block that did not shrink is stored, its coded
+-- length is its raw length and its bytes follow as they are, sent with
+-- sendfile and spliced to disk at the other end.
+--
+-- The sender compresses on a thread of its own while the caller sends, so
+-- compressing one block overlaps with sending the ones before it. The thread
+-- hands frames over in a ring of COMPRESS_SLOTS slots. After a block that
+-- does not compress the thread stores the next ones without trying, twice
+-- as many after every miss in a row, so a stretch of compressed data in a
+-- file costs little more than sending it raw.
+*/
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "network.h"
+#include "compress.h"
+#include "transfer.h"
+#include "verify.h"
+#include "lz.h"
+
+// A block has to lose at least this share of its size to be sent coded
+#define MIN_SAVING	16
+
+// Most blocks stored without trying after misses in a row
+#define MAX_SKIP	64
+
+// A frame waiting to be sent, stored frames are sent from the file
+struct frameSlot
+{
+    char *data;
+    int length;
+    off_t rawOffset;
+    int rawLength;
+};
+
+// The compressor thread and the sender, the ring is guarded by the lock
+struct compressPipeline
+{
+    int file;
+    off_t offset;
+    off_t end;
+    char *block;
+    struct frameSlot slots[COMPRESS_SLOTS];
+    int head;
+    int filled;
+    int stop;
+    int skip;
+    int misses;
+    struct compressStats *stats;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_cond_t freed;
+};
+
+static void *compressBlocks(void *argument);
+static int encodeBlock(struct compressPipeline *pipeline,
+                       struct frameSlot *slot, off_t offset, int length);
+static int readBlock(int file, char *buffer, off_t offset, int length);
+
+/*
+-- FUNCTION: worthCompressing
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int worthCompressing(int file, off_t offset, off_t length);
+--
+-- RETURNS: 1 if the range should be sent compressed, 0 otherwise
+--
+-- NOTES:
+-- This function compresses COMPRESS_SAMPLES blocks spread evenly over the
+-- range of the file and says whether together they lost an eighth of their
+-- size. Anything that goes wrong is an answer of no.
+*/
+int worthCompressing(int file, off_t offset, off_t length)
+{
+    char *block = (char*)malloc(COMPRESS_BLOCK);
+    char *coded = (char*)malloc(COMPRESS_BLOCK);
+    off_t step = length / COMPRESS_SAMPLES;
+    off_t raw = 0;
+    off_t total = 0;
+    int sample = 0;
+    int size = 0;
+    int i = 0;
+
+    for (i = 0; i < COMPRESS_SAMPLES && block != NULL && coded != NULL &&
+        length > 0; i++)
+    {
+        size = length - i * step < COMPRESS_BLOCK ?
+            (int)(length - i * step) : COMPRESS_BLOCK;
+        if (readBlock(file, block, offset + i * step, size) == -1)
+        {
+            total = raw;
+            break;
+        }
+        sample = lzCompress(block, size, coded, size);
+        raw += size;
+        total += sample == 0 ? size : sample;
+
+        // A range shorter than a block is one sample
+        if (step == 0)
+        {
+            break;
+        }
+    }
+
+    free(block);
+    free(coded);
+    return raw > 0 && total < raw - raw / 8;
+}
+
+/*
+-- FUNCTION: sendCompressed
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Sends the checksums of a verified transfer.
+--
+-- INTERFACE: int sendCompressed(int socket, int file, off_t offset,
+--                               off_t length,
+--                               struct compressStats *stats,
+--                               struct verifier *verifier);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function sends length bytes of the file starting at offset as frames.
+-- The compressor thread is started on the range and the frames are sent as
+-- it fills them. On a failure the thread is told to stop and is waited for
+-- before returning. The bytes of the file and the bytes that were sent are
+-- counted in stats, along with the blocks that were stored.
+--
+-- A verified transfer passes its verifier, and the checksum of every chunk
+-- is sent after the frame that ends it, see verify.c. Otherwise it is NULL.
+*/
+int sendCompressed(int socket, int file, off_t offset, off_t length,
+                   struct compressStats *stats, struct verifier *verifier)
+{
+    struct compressPipeline pipeline;
+    struct frameSlot *slot = NULL;
+    pthread_t thread;
+    off_t blocks = (length + COMPRESS_BLOCK - 1) / COMPRESS_BLOCK;
+    int started = 0;
+    int rawLength = 0;
+    int result = 0;
+    int i = 0;
+
+    stats->raw = 0;
+    stats->sent = 0;
+    stats->skipped = 0;
+    bzero(&pipeline, sizeof(pipeline));
+    pipeline.file = file;
+    pipeline.offset = offset;
+    pipeline.end = offset + length;
+    pipeline.stats = stats;
+
+    pipeline.block = (char*)malloc(COMPRESS_BLOCK);
+    for (i = 0; i < COMPRESS_SLOTS; i++)
+    {
+        pipeline.slots[i].data = (char*)malloc(FRAME_HEADER + COMPRESS_BLOCK);
+        result = pipeline.slots[i].data == NULL ? -1 : result;
+    }
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.ready, NULL);
+    pthread_cond_init(&pipeline.freed, NULL);
+    if (pipeline.block != NULL && result == 0 &&
+        pthread_create(&thread, NULL, compressBlocks, &pipeline) == 0)
+    {
+        started = 1;
+    }
+    result = started ? 0 : -1;
+
+    for (; blocks > 0 && result == 0; blocks--)
+    {
+        pthread_mutex_lock(&pipeline.lock);
+        while (pipeline.filled == 0)
+        {
+            pthread_cond_wait(&pipeline.ready, &pipeline.lock);
+        }
+        pthread_mutex_unlock(&pipeline.lock);
+
+        // Stored frames follow their header straight from the file
+        slot = &pipeline.slots[pipeline.head];
+        if (slot->length == -1 ||
+            sendAll(&socket, slot->data, slot->length) == -1 ||
+            (slot->rawLength > 0 && sendRange(socket, file, slot->rawOffset,
+            slot->rawLength) == -1))
+        {
+            result = -1;
+            break;
+        }
+        memmove((void*)&rawLength, slot->data, sizeof(int));
+        stats->sent += slot->length + slot->rawLength;
+        stats->raw += rawLength;
+        if (sendChecksums(socket, verifier, stats->raw) == -1)
+        {
+            result = -1;
+            break;
+        }
+
+        pthread_mutex_lock(&pipeline.lock);
+        pipeline.head = (pipeline.head + 1) % COMPRESS_SLOTS;
+        pipeline.filled--;
+        pthread_cond_signal(&pipeline.freed);
+        pthread_mutex_unlock(&pipeline.lock);
+    }
+
+    if (started)
+    {
+        pthread_mutex_lock(&pipeline.lock);
+        pipeline.stop = 1;
+        pthread_cond_signal(&pipeline.freed);
+        pthread_mutex_unlock(&pipeline.lock);
+        pthread_join(thread, NULL);
+    }
+
+    pthread_cond_destroy(&pipeline.freed);
+    pthread_cond_destroy(&pipeline.ready);
+    pthread_mutex_destroy(&pipeline.lock);
+    for (i = 0; i < COMPRESS_SLOTS; i++)
+    {
+        free(pipeline.slots[i].data);
+    }
+    free(pipeline.block);
+    return result;
+}
+
+/*
+-- FUNCTION: openDecoder
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int openDecoder(struct frameDecoder *decoder);
+--
+-- RETURNS: 0 on success or -1 if the buffers could not be allocated
+--
+-- NOTES:
+-- This function allocates the buffers a receiver decodes frames in, one for
+-- the coded bytes and one for the block they decode to.
+*/
+int openDecoder(struct frameDecoder *decoder)
+{
+    decoder->coded = (char*)malloc(COMPRESS_BLOCK);
+    decoder->raw = (char*)malloc(COMPRESS_BLOCK);
+    if (decoder->coded == NULL || decoder->raw == NULL)
+    {
+        closeDecoder(decoder);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: closeDecoder
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void closeDecoder(struct frameDecoder *decoder);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function frees the buffers of the decoder.
+*/
+void closeDecoder(struct frameDecoder *decoder)
+{
+    free(decoder->coded);
+    free(decoder->raw);
+    decoder->coded = NULL;
+    decoder->raw = NULL;
+}
+
+/*
+-- FUNCTION: receiveFrame
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int receiveFrame(int socket, int file, int *pipe,
+--                             struct frameDecoder *decoder, int length,
+--                             off_t *offset);
+--
+-- RETURNS: the number of bytes written to the file or -1 on failure
+--
+-- NOTES:
+-- This function receives a frame and writes the block it holds to the file
+-- at offset, moving the offset past it. A stored frame is moved to the file
+-- with receiveChunk, through the pipe like a plain body. The lengths in the
+-- header are checked before anything is received into the buffers, and a
+-- block longer than the length still expected is a failure.
+*/
+int receiveFrame(int socket, int file, int *pipe,
+                 struct frameDecoder *decoder, int length, off_t *offset)
+{
+    char header[FRAME_HEADER];
+    int rawLength = 0;
+    int codedLength = 0;
+    int count = 0;
+    int bytesRead = 0;
+
+    if (readAll(&socket, header, FRAME_HEADER) == -1)
+    {
+        return -1;
+    }
+    memmove((void*)&rawLength, header, sizeof(int));
+    memmove((void*)&codedLength, header + sizeof(int), sizeof(int));
+    if (rawLength <= 0 || rawLength > COMPRESS_BLOCK || rawLength > length ||
+        codedLength <= 0 || codedLength > rawLength)
+    {
+        return -1;
+    }
+
+    if (codedLength == rawLength)
+    {
+        while (count < rawLength)
+        {
+            if ((bytesRead = receiveChunk(socket, file, pipe, decoder->raw,
+                rawLength - count, offset)) <= 0)
+            {
+                return -1;
+            }
+            count += bytesRead;
+        }
+        return rawLength;
+    }
+
+    if (readAll(&socket, decoder->coded, codedLength) == -1 ||
+        lzDecompress(decoder->coded, codedLength, decoder->raw,
+        COMPRESS_BLOCK) != rawLength ||
+        writeAll(file, decoder->raw, rawLength, offset) == -1)
+    {
+        return -1;
+    }
+
+    return rawLength;
+}
+
+/*
+-- FUNCTION: compressBlocks
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void *compressBlocks(void *argument);
+--
+-- RETURNS: NULL
+--
+-- NOTES:
+-- This is the compressor thread. It fills the slots of the ring in order
+-- with the frames of the range, waiting whenever every slot is full, until
+-- the range ends or the sender tells it to stop. A block that could not be
+-- read is handed over as a slot with a length of -1.
+*/
+static void *compressBlocks(void *argument)
+{
+    struct compressPipeline *pipeline = (struct compressPipeline*)argument;
+    off_t offset = pipeline->offset;
+    int tail = 0;
+    int length = 0;
+
+    for (; offset < pipeline->end; offset += length)
+    {
+        length = pipeline->end - offset < COMPRESS_BLOCK ?
+            (int)(pipeline->end - offset) : COMPRESS_BLOCK;
+
+        pthread_mutex_lock(&pipeline->lock);
+        while (pipeline->filled == COMPRESS_SLOTS && !pipeline->stop)
+        {
+            pthread_cond_wait(&pipeline->freed, &pipeline->lock);
+        }
+        if (pipeline->stop)
+        {
+            pthread_mutex_unlock(&pipeline->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+
+        if (encodeBlock(pipeline, &pipeline->slots[tail], offset,
+            length) == -1)
+        {
+            pipeline->slots[tail].length = -1;
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->filled++;
+        pthread_cond_signal(&pipeline->ready);
+        pthread_mutex_unlock(&pipeline->lock);
+        tail = (tail + 1) % COMPRESS_SLOTS;
+    }
+
+    return NULL;
+}
+
+/*
+-- FUNCTION: encodeBlock
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int encodeBlock(struct compressPipeline *pipeline,
+--                                   struct frameSlot *slot, off_t offset,
+--                                   int length);
+--
+-- RETURNS: 0 on success or -1 if the block could not be read
+--
+-- NOTES:
+-- This function fills the slot with the frame of length bytes of the file
+-- at offset. The block is coded unless the thread is still skipping blocks
+-- after a miss, and stored when coding it did not save MIN_SAVING of it.
+*/
+static int encodeBlock(struct compressPipeline *pipeline,
+                       struct frameSlot *slot, off_t offset, int length)
+{
+    int coded = 0;
+
+    if (pipeline->skip > 0)
+    {
+        pipeline->skip--;
+    }
+    else if (readBlock(pipeline->file, pipeline->block, offset,
+        length) == -1)
+    {
+        return -1;
+    }
+    else
+    {
+        coded = lzCompress(pipeline->block, length,
+            slot->data + FRAME_HEADER, length - length / MIN_SAVING);
+        if (coded == 0)
+        {
+            pipeline->misses++;
+            pipeline->skip = (1 << pipeline->misses) - 1;
+            pipeline->skip = pipeline->skip < MAX_SKIP ?
+                pipeline->skip : MAX_SKIP;
+        }
+        else
+        {
+            pipeline->misses = 0;
+        }
+    }
+
+    memmove(slot->data, (void*)&length, sizeof(int));
+    if (coded > 0)
+    {
+        memmove(slot->data + sizeof(int), (void*)&coded, sizeof(int));
+        slot->length = FRAME_HEADER + coded;
+        slot->rawLength = 0;
+        return 0;
+    }
+
+    memmove(slot->data + sizeof(int), (void*)&length, sizeof(int));
+    slot->length = FRAME_HEADER;
+    slot->rawOffset = offset;
+    slot->rawLength = length;
+    pipeline->stats->skipped++;
+    return 0;
+}
+
+/*
+-- FUNCTION: readBlock
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int readBlock(int file, char *buffer, off_t offset,
+--                                 int length);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function reads length bytes of the file at offset without touching
+-- the file position. A file that ends first is a failure.
+*/
+static int readBlock(int file, char *buffer, off_t offset, int length)
+{
+    ssize_t bytesRead = 0;
+
+    while (length > 0)
+    {
+        bytesRead = pread(file, buffer, length, offset);
+        if (bytesRead == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesRead <= 0)
+        {
+            return -1;
+        }
+        buffer += bytesRead;
+        offset += bytesRead;
+        length -= bytesRead;
+    }
+
+    return 0;
+}
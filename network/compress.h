@@ -0,0 +1,47 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <sys/types.h>
+
+struct verifier;
+
+// Bytes of the file in a frame, and the frame header of raw and coded lengths
+#define COMPRESS_BLOCK	65536
+#define FRAME_HEADER	8
+
+// Frames the compressor thread can get ahead of the socket
+#define COMPRESS_SLOTS	4
+
+// Blocks spread over a file that are compressed to see if it is worth it
+#define COMPRESS_SAMPLES	4
+
+// The frames of a compressed body as the receiver decodes them
+struct frameDecoder
+{
+    char *coded;
+    char *raw;
+};
+
+// What a compressed transfer cost, filled in by sendCompressed
+struct compressStats
+{
+    off_t raw;
+    off_t sent;
+    int skipped;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int worthCompressing(int file, off_t offset, off_t length);
+int sendCompressed(int socket, int file, off_t offset, off_t length,
+                   struct compressStats *stats, struct verifier *verifier);
+int openDecoder(struct frameDecoder *decoder);
+void closeDecoder(struct frameDecoder *decoder);
+int receiveFrame(int socket, int file, int *pipe,
+                 struct frameDecoder *decoder, int length, off_t *offset);
+#ifdef __cplusplus
+}
+#endif
+#endif
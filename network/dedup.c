@@ -0,0 +1,380 @@
+/*
+-- SOURCE FILE: dedup.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int findBoundary(const unsigned char *data, off_t length);
+-- int sendChunked(int socket, int file, char *buffer, int size,
+--                 struct dedupStats *stats);
+-- static void buildGear(void);
+-- static unsigned char *cutFile(const unsigned char *data, off_t length,
+--                               int *count);
+-- static int sendMissing(int socket, const unsigned char *data,
+--                        const unsigned char *entries, int count,
+--                        const unsigned char *missing,
+--                        struct dedupStats *stats);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- NOTES:
+-- This file contains the client side of a deduplicated upload. The server
+-- keeps the data of these uploads in a store of chunks named by their hash,
+-- see store.c, so data it already has under any name is neither sent nor
+-- stored again.
+--
+-- The file is cut into chunks where the content says so, FastCDC, so an
+-- insert near the start of a file only changes the chunks around it rather
+-- than shifting every boundary after it. A gear hash is rolled over the bytes
+-- and a boundary is cut where its masked bits are all zero. Nothing is cut
+-- before CDC_MIN_CHUNK bytes, a mask with more bits is used until
+-- CDC_AVG_CHUNK bytes and one with fewer after it, so the chunk sizes bunch
+-- up around the average, and a chunk is always cut at CDC_MAX_CHUNK bytes.
+--
+-- The transfer runs on the data connection:
+--
+--   client: manifest header (BUFFER_LENGTH bytes), file size at the start
+--           and chunk count at MANIFEST_COUNT, followed by CHUNK_ENTRY_SIZE
+--           bytes for every chunk, its 128 bit hash and its length
+--   server: missing header (BUFFER_LENGTH bytes), the number of missing
+--           chunks at the start, followed by a bitmap with a bit set for
+--           every chunk of the manifest the server does not have
+--   client: the bytes of every missing chunk, in manifest order
+--   server: result message (BUFFER_LENGTH bytes), 0 or -1 at the start
+*/
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "network.h"
+#include "dedup.h"
+#include "transfer.h"
+#include "checksum.h"
+
+// Boundary masks, 15 bits before the average chunk size and 11 bits after it
+#define MASK_SMALL	0x0003590703530000ULL
+#define MASK_LARGE	0x0000d90003530000ULL
+
+// Largest piece of the manifest handed to sendAll at a time
+#define MANIFEST_BATCH 1048576
+
+// Random value of every byte rolled into the gear hash, built on first use
+static unsigned long long gear[256];
+static int gearBuilt = 0;
+
+static void buildGear(void);
+static unsigned char *cutFile(const unsigned char *data, off_t length,
+                              int *count);
+static int sendMissing(int socket, const unsigned char *data,
+                       const unsigned char *entries, int count,
+                       const unsigned char *missing,
+                       struct dedupStats *stats);
+
+/*
+-- FUNCTION: findBoundary
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int findBoundary(const unsigned char *data, off_t length);
+--
+-- RETURNS: the length of the chunk at the start of data
+--
+-- NOTES:
+-- This function finds where the chunk starting at data ends, length being
+-- the bytes left in the file. The first CDC_MIN_CHUNK bytes of a chunk are
+-- never looked at, they can not hold a boundary.
+*/
+int findBoundary(const unsigned char *data, off_t length)
+{
+    unsigned long long fingerprint = 0;
+    int normal = CDC_AVG_CHUNK;
+    int end = CDC_MAX_CHUNK;
+    int i = CDC_MIN_CHUNK;
+
+    if (length <= CDC_MIN_CHUNK)
+    {
+        return (int)length;
+    }
+    if (length < end)
+    {
+        end = (int)length;
+    }
+    if (end < normal)
+    {
+        normal = end;
+    }
+    if (!gearBuilt)
+    {
+        buildGear();
+    }
+
+    for (; i < normal; i++)
+    {
+        fingerprint = (fingerprint << 1) + gear[data[i]];
+        if ((fingerprint & MASK_SMALL) == 0)
+        {
+            return i + 1;
+        }
+    }
+    for (; i < end; i++)
+    {
+        fingerprint = (fingerprint << 1) + gear[data[i]];
+        if ((fingerprint & MASK_LARGE) == 0)
+        {
+            return i + 1;
+        }
+    }
+
+    return end;
+}
+
+/*
+-- FUNCTION: sendChunked
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendChunked(int socket, int file, char *buffer, int size,
+--                            struct dedupStats *stats);
+--
+-- RETURNS: 0 if the server stored the file or -1 on failure
+--
+-- NOTES:
+-- This function cuts the file into chunks, sends the manifest of them, sends
+-- the chunks the server asks for and waits for the result. The file is mapped
+-- so the chunks are hashed and sent without copying. The buffer of size bytes
+-- holds the headers. The chunks, the missing ones and the bytes that were
+-- sent are counted in stats.
+*/
+int sendChunked(int socket, int file, char *buffer, int size,
+                struct dedupStats *stats)
+{
+    struct stat statBuffer;
+    const unsigned char *data = NULL;
+    unsigned char *entries = NULL;
+    unsigned char *missing = NULL;
+    int count = 0;
+    int sent = 0;
+    int batch = 0;
+    int result = -1;
+
+    stats->chunks = 0;
+    stats->missing = 0;
+    stats->sent = 0;
+
+    if (fstat(file, &statBuffer) == -1 || size < BUFFER_LENGTH)
+    {
+        return -1;
+    }
+    if (statBuffer.st_size > 0)
+    {
+        data = (const unsigned char*)mmap(NULL, statBuffer.st_size,
+            PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED)
+        {
+            return -1;
+        }
+        madvise((void*)data, statBuffer.st_size, MADV_SEQUENTIAL);
+    }
+
+    if ((entries = cutFile(data, statBuffer.st_size, &count)) != NULL)
+    {
+        stats->chunks = count;
+        bzero(buffer, BUFFER_LENGTH);
+        memmove(buffer, (void*)&statBuffer.st_size, sizeof(off_t));
+        memmove(buffer + MANIFEST_COUNT, (void*)&count, sizeof(int));
+        result = sendAll(&socket, buffer, BUFFER_LENGTH);
+        stats->sent += BUFFER_LENGTH;
+
+        // The manifest can be long, it is sent in pieces
+        while (result == 0 && sent < count * CHUNK_ENTRY_SIZE)
+        {
+            batch = count * CHUNK_ENTRY_SIZE - sent;
+            batch = batch < MANIFEST_BATCH ? batch : MANIFEST_BATCH;
+            result = sendAll(&socket, (char*)entries + sent, batch);
+            sent += batch;
+        }
+        stats->sent += sent;
+
+        // The server answers with the chunks it does not have
+        if (result == 0 &&
+            (missing = (unsigned char*)malloc(count / 8 + 1)) != NULL &&
+            readAll(&socket, buffer, BUFFER_LENGTH) == 0 &&
+            readAll(&socket, (char*)missing, count / 8 + 1) == 0)
+        {
+            memmove((void*)&stats->missing, buffer, sizeof(int));
+            if (sendMissing(socket, data, entries, count, missing,
+                stats) == 0)
+            {
+                result = readResult(socket);
+            }
+            else
+            {
+                result = -1;
+            }
+        }
+        else
+        {
+            result = -1;
+        }
+        free(missing);
+        free(entries);
+    }
+
+    if (data != NULL)
+    {
+        munmap((void*)data, statBuffer.st_size);
+    }
+    return result == 0 ? 0 : -1;
+}
+
+/*
+-- FUNCTION: buildGear
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void buildGear(void);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function fills the gear table from a fixed seed with splitmix64, so
+-- every client cuts the same data at the same boundaries.
+*/
+static void buildGear(void)
+{
+    unsigned long long state = 0x5346544348554e4bULL;
+    unsigned long long value = 0;
+    int i = 0;
+
+    for (i = 0; i < 256; i++)
+    {
+        state += 0x9e3779b97f4a7c15ULL;
+        value = state;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        gear[i] = value ^ (value >> 31);
+    }
+
+    gearBuilt = 1;
+}
+
+/*
+-- FUNCTION: cutFile
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static unsigned char *cutFile(const unsigned char *data,
+--                                          off_t length, int *count);
+--
+-- RETURNS: the manifest entries, to be freed, or NULL on failure
+--
+-- NOTES:
+-- This function cuts the length bytes of data into chunks and builds the
+-- manifest entry of every chunk. The number of chunks is stored in count.
+*/
+static unsigned char *cutFile(const unsigned char *data, off_t length,
+                              int *count)
+{
+    unsigned char *entries = NULL;
+    off_t offset = 0;
+    int chunk = 0;
+
+    // Every chunk but the last one is at least CDC_MIN_CHUNK bytes
+    if (length / CDC_MIN_CHUNK + 1 > MAX_MANIFEST_ENTRIES)
+    {
+        return NULL;
+    }
+    entries = (unsigned char*)malloc(
+        (length / CDC_MIN_CHUNK + 1) * CHUNK_ENTRY_SIZE);
+    if (entries == NULL)
+    {
+        return NULL;
+    }
+
+    *count = 0;
+    while (offset < length)
+    {
+        chunk = findBoundary(data + offset, length - offset);
+        hash128(data + offset, chunk, entries + *count * CHUNK_ENTRY_SIZE);
+        memmove(entries + *count * CHUNK_ENTRY_SIZE + CHUNK_HASH_SIZE,
+            (void*)&chunk, sizeof(int));
+        offset += chunk;
+        (*count)++;
+    }
+
+    return entries;
+}
+
+/*
+-- FUNCTION: sendMissing
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int sendMissing(int socket, const unsigned char *data,
+--                                   const unsigned char *entries, int count,
+--                                   const unsigned char *missing,
+--                                   struct dedupStats *stats);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function sends the chunks that have their bit set in missing. Runs of
+-- missing chunks are next to each other in the file and are sent as one.
+*/
+static int sendMissing(int socket, const unsigned char *data,
+                       const unsigned char *entries, int count,
+                       const unsigned char *missing,
+                       struct dedupStats *stats)
+{
+    off_t offset = 0;
+    off_t start = 0;
+    int run = 0;
+    int chunk = 0;
+    int i = 0;
+
+    for (i = 0; i <= count; i++)
+    {
+        // A run ends at a chunk the server has, a long one, or the last one
+        if (run > 0 && (i == count || !(missing[i / 8] & (1 << (i % 8))) ||
+            run >= MANIFEST_BATCH))
+        {
+            if (sendAll(&socket, (const char*)data + start, run) == -1)
+            {
+                return -1;
+            }
+            stats->sent += run;
+            run = 0;
+        }
+        if (i == count)
+        {
+            break;
+        }
+
+        memmove((void*)&chunk, entries + i * CHUNK_ENTRY_SIZE +
+            CHUNK_HASH_SIZE, sizeof(int));
+        if (missing[i / 8] & (1 << (i % 8)))
+        {
+            start = run == 0 ? offset : start;
+            run += chunk;
+        }
+        offset += chunk;
+    }
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <sys/types.h>
+
+// Sizes of the chunks a file is cut into, the boundaries depend on the data
+#define CDC_MIN_CHUNK	2048
+#define CDC_AVG_CHUNK	8192
+#define CDC_MAX_CHUNK	65536
+
+// Manifest header layout, the size of the file is at the start
+#define MANIFEST_COUNT	8
+
+// Bytes of a manifest entry, the strong hash of a chunk and its length
+#define CHUNK_HASH_SIZE	16
+#define CHUNK_ENTRY_SIZE	20
+
+// Most chunks in a manifest, enough for files of at least 32 GB
+#define MAX_MANIFEST_ENTRIES	16777216
+
+// What a deduplicated upload cost, filled in by sendChunked
+struct dedupStats
+{
+    int chunks;
+    int missing;
+    off_t sent;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int findBoundary(const unsigned char *data, off_t length);
+int sendChunked(int socket, int file, char *buffer, int size,
+                struct dedupStats *stats);
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,925 @@
+/*
+-- SOURCE FILE: delta.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int sendSignature(int socket, int basis, char *buffer, int size,
+--                   struct deltaBasis *signature);
+-- int sendDelta(int socket, int file, char *buffer, int size,
+--               struct deltaStats *stats);
+-- int receiveDelta(int socket, int basis, int file,
+--                  const struct deltaBasis *signature, char *buffer,
+--                  int size);
+-- static int chooseBlockSize(off_t fileSize, int size);
+-- static int readSignature(int socket, struct blockTable *table,
+--                          char *buffer, int size);
+-- static int scanFile(struct deltaOutput *output,
+--                     const struct blockTable *table,
+--                     const unsigned char *data, off_t length);
+-- static int findBlock(const struct blockTable *table, unsigned int weak,
+--                      const unsigned char *data, int preferred);
+-- static void freeTable(struct blockTable *table);
+-- static int putLiteral(struct deltaOutput *output,
+--                       const unsigned char *data, off_t length);
+-- static int putCopy(struct deltaOutput *output, int first, int count);
+-- static int putBytes(struct deltaOutput *output, const void *data,
+--                     int length);
+-- static int flushOutput(struct deltaOutput *output);
+-- static int takeBytes(struct deltaInput *input, void *data, int length);
+-- static int fillInput(struct deltaInput *input);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Uses readAll and sendAll of network.c and
+-- the result message and writeAll of transfer.c.
+--
+-- NOTES:
+-- This file contains the delta upload, the rsync algorithm for sending a file
+-- the server already has an older copy of. Only the parts of the file that
+-- changed cross the network.
+--
+-- The server cuts its copy, the basis, into blocks and sends the client the
+-- signature of every block, its rolling checksum and its strong hash, see
+-- checksum.c. The client slides a window of one block along its file a byte
+-- at a time, updating the rolling checksum as it goes, and looks the checksum
+-- up in the signatures. When the strong hash of the window matches too, the
+-- client sends a copy instruction naming the block and jumps past it. The
+-- bytes it slid over in between are sent as a literal. The server rebuilds
+-- the file from the blocks of the basis and the literals.
+--
+-- Only whole blocks of the basis are in the signature, a short block at the
+-- end of it is always sent as a literal. Runs of consecutive blocks are sent
+-- as a single copy instruction.
+--
+-- The transfer runs on the data connection:
+--
+--   server: signature header (BUFFER_LENGTH bytes), block size at
+--           SIGNATURE_BLOCK and block count at SIGNATURE_COUNT, followed by
+--           SIGNATURE_SIZE bytes for every block
+--   client: DELTA_LITERAL [length] [bytes] and DELTA_COPY [block] [count]
+--           instructions, then DELTA_END [file size] [CRC32C of the file]
+--   server: result message (BUFFER_LENGTH bytes), 0 or -1 at the start
+--
+-- The server checks the size and the CRC32C of the file it rebuilt, so a
+-- false match of both checksums of a block fails the upload rather than
+-- corrupting the file.
+*/
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include "network.h"
+#include "delta.h"
+#include "transfer.h"
+#include "checksum.h"
+
+// Largest literal sent as a single instruction
+#define MAX_LITERAL 1073741824
+
+// Signatures sent at a time by sendSignature
+#define SIGNATURE_BATCH 256
+
+// The signature of the basis as the client looks it up
+struct blockTable
+{
+    int blockSize;
+    int blockCount;
+    unsigned int *weak;
+    unsigned long long *strong;
+    int *heads;
+    int *next;
+    int bits;
+};
+
+// Instructions waiting to be sent by the client
+struct deltaOutput
+{
+    int socket;
+    char *buffer;
+    int size;
+    int count;
+    struct deltaStats *stats;
+};
+
+// Instructions received by the server and not handled yet
+struct deltaInput
+{
+    int socket;
+    char *buffer;
+    int size;
+    int start;
+    int end;
+};
+
+static int chooseBlockSize(off_t fileSize, int size);
+static int readSignature(int socket, struct blockTable *table,
+                         char *buffer, int size);
+static int scanFile(struct deltaOutput *output,
+                    const struct blockTable *table,
+                    const unsigned char *data, off_t length);
+static int findBlock(const struct blockTable *table, unsigned int weak,
+                     const unsigned char *data, int preferred);
+static void freeTable(struct blockTable *table);
+static int putLiteral(struct deltaOutput *output,
+                      const unsigned char *data, off_t length);
+static int putCopy(struct deltaOutput *output, int first, int count);
+static int putBytes(struct deltaOutput *output, const void *data,
+                    int length);
+static int flushOutput(struct deltaOutput *output);
+static int takeBytes(struct deltaInput *input, void *data, int length);
+static int fillInput(struct deltaInput *input);
+
+/*
+-- FUNCTION: sendSignature
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendSignature(int socket, int basis, char *buffer,
+--                              int size, struct deltaBasis *signature);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function sends the signature of the basis, -1 when the server has no
+-- copy of the file, and stores what it sent in signature for receiveDelta.
+-- The basis is read with pread through the buffer of size bytes.
+*/
+int sendSignature(int socket, int basis, char *buffer, int size,
+                  struct deltaBasis *signature)
+{
+    char entries[SIGNATURE_BATCH * SIGNATURE_SIZE];
+    unsigned char hash[16];
+    struct stat statBuffer;
+    unsigned int weak = 0;
+    unsigned int a = 0;
+    unsigned int b = 0;
+    off_t offset = 0;
+    ssize_t bytesRead = 0;
+    int batch = 0;
+    int block = 0;
+    int i = 0;
+
+    signature->size = 0;
+    if (basis != -1 && fstat(basis, &statBuffer) == 0)
+    {
+        signature->size = statBuffer.st_size;
+    }
+    signature->blockSize = chooseBlockSize(signature->size, size);
+    signature->blockCount = signature->size / signature->blockSize;
+
+    bzero(buffer, BUFFER_LENGTH);
+    memmove(buffer, (void*)&signature->size, sizeof(off_t));
+    memmove(buffer + SIGNATURE_BLOCK, (void*)&signature->blockSize,
+        sizeof(int));
+    memmove(buffer + SIGNATURE_COUNT, (void*)&signature->blockCount,
+        sizeof(int));
+    if (sendAll(&socket, buffer, BUFFER_LENGTH) == -1)
+    {
+        return -1;
+    }
+
+    // Read as many whole blocks as fit in the buffer at a time
+    while (block < signature->blockCount)
+    {
+        bytesRead = pread(basis, buffer, (size / signature->blockSize) *
+            signature->blockSize, offset);
+        if (bytesRead == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesRead < signature->blockSize)
+        {
+            return -1;
+        }
+
+        for (i = 0; i + signature->blockSize <= bytesRead &&
+            block < signature->blockCount; i += signature->blockSize)
+        {
+            blockSums(buffer + i, signature->blockSize, &a, &b);
+            weak = (a & 0xffff) | (b << 16);
+            hash128(buffer + i, signature->blockSize, hash);
+            memcpy(entries + batch * SIGNATURE_SIZE, &weak, 4);
+            memcpy(entries + batch * SIGNATURE_SIZE + 4, hash, 8);
+            block++;
+            if (++batch == SIGNATURE_BATCH)
+            {
+                if (sendAll(&socket, entries, batch * SIGNATURE_SIZE) == -1)
+                {
+                    return -1;
+                }
+                batch = 0;
+            }
+        }
+        offset += i;
+    }
+
+    return sendAll(&socket, entries, batch * SIGNATURE_SIZE);
+}
+
+/*
+-- FUNCTION: sendDelta
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendDelta(int socket, int file, char *buffer, int size,
+--                          struct deltaStats *stats);
+--
+-- RETURNS: 0 if the server rebuilt the file or -1 on failure
+--
+-- NOTES:
+-- This function reads the signature of the server's copy, sends the file as
+-- copy and literal instructions against it, see scanFile, and waits for the
+-- result. The file is mapped so the window can slide along it without
+-- copying. The buffer of size bytes collects the instructions. The literal
+-- and matched bytes and everything that was sent are counted in stats.
+*/
+int sendDelta(int socket, int file, char *buffer, int size,
+              struct deltaStats *stats)
+{
+    struct blockTable table;
+    struct deltaOutput output;
+    struct stat statBuffer;
+    const unsigned char *data = NULL;
+    unsigned int checksum = 0;
+    int result = -1;
+    char end = DELTA_END;
+
+    stats->literal = 0;
+    stats->matched = 0;
+    stats->sent = 0;
+    output.socket = socket;
+    output.buffer = buffer;
+    output.size = size;
+    output.count = 0;
+    output.stats = stats;
+
+    if (fstat(file, &statBuffer) == -1)
+    {
+        return -1;
+    }
+    if (statBuffer.st_size > 0)
+    {
+        data = (const unsigned char*)mmap(NULL, statBuffer.st_size,
+            PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED)
+        {
+            return -1;
+        }
+        madvise((void*)data, statBuffer.st_size, MADV_SEQUENTIAL);
+    }
+
+    if (readSignature(socket, &table, buffer, size) == 0)
+    {
+        // The server checks the file it rebuilt against the checksum
+        checksum = crc32c(0, data, statBuffer.st_size);
+        if (scanFile(&output, &table, data, statBuffer.st_size) == 0 &&
+            putBytes(&output, &end, 1) == 0 &&
+            putBytes(&output, &statBuffer.st_size, sizeof(off_t)) == 0 &&
+            putBytes(&output, &checksum, sizeof(int)) == 0 &&
+            flushOutput(&output) == 0)
+        {
+            result = readResult(socket);
+        }
+        freeTable(&table);
+    }
+
+    if (data != NULL)
+    {
+        munmap((void*)data, statBuffer.st_size);
+    }
+    return result == 0 ? 0 : -1;
+}
+
+/*
+-- FUNCTION: receiveDelta
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int receiveDelta(int socket, int basis, int file,
+--                             const struct deltaBasis *signature,
+--                             char *buffer, int size);
+--
+-- RETURNS: 0 if the file was rebuilt and checks out, -1 otherwise
+--
+-- NOTES:
+-- This function carries out the instructions of the client, writing the
+-- literals and the blocks of the basis it names to file in order. The first
+-- half of the buffer holds instructions as they arrive, the second half the
+-- blocks read from the basis. Every instruction is checked against the
+-- signature that was sent, so a client can not make the server read outside
+-- of the basis.
+*/
+int receiveDelta(int socket, int basis, int file,
+                 const struct deltaBasis *signature, char *buffer, int size)
+{
+    struct deltaInput input;
+    char *blocks = buffer + size / 2;
+    unsigned int checksum = 0;
+    unsigned int expected = 0;
+    off_t written = 0;
+    off_t fileSize = 0;
+    off_t offset = 0;
+    off_t length = 0;
+    ssize_t bytesRead = 0;
+    int literal = 0;
+    int first = 0;
+    int count = 0;
+    int chunk = 0;
+    char type = 0;
+
+    input.socket = socket;
+    input.buffer = buffer;
+    input.size = size / 2;
+    input.start = 0;
+    input.end = 0;
+
+    while (takeBytes(&input, &type, 1) == 0)
+    {
+        switch (type)
+        {
+        case DELTA_LITERAL:
+            if (takeBytes(&input, &literal, sizeof(int)) == -1 ||
+                literal <= 0)
+            {
+                return -1;
+            }
+            while (literal > 0)
+            {
+                if (input.start == input.end && fillInput(&input) == -1)
+                {
+                    return -1;
+                }
+                chunk = input.end - input.start;
+                chunk = chunk < literal ? chunk : literal;
+                if (writeAll(file, input.buffer + input.start, chunk,
+                    NULL) == -1)
+                {
+                    return -1;
+                }
+                checksum = crc32c(checksum, input.buffer + input.start,
+                    chunk);
+                input.start += chunk;
+                literal -= chunk;
+                written += chunk;
+            }
+            break;
+        case DELTA_COPY:
+            if (takeBytes(&input, &first, sizeof(int)) == -1 ||
+                takeBytes(&input, &count, sizeof(int)) == -1 || first < 0 ||
+                count <= 0 || count > signature->blockCount - first)
+            {
+                return -1;
+            }
+            offset = (off_t)first * signature->blockSize;
+            length = (off_t)count * signature->blockSize;
+            while (length > 0)
+            {
+                bytesRead = pread(basis, blocks, length < size - size / 2 ?
+                    length : size - size / 2, offset);
+                if (bytesRead <= 0)
+                {
+                    if (bytesRead == -1 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return -1;
+                }
+                if (writeAll(file, blocks, bytesRead, NULL) == -1)
+                {
+                    return -1;
+                }
+                checksum = crc32c(checksum, blocks, bytesRead);
+                offset += bytesRead;
+                length -= bytesRead;
+                written += bytesRead;
+            }
+            break;
+        case DELTA_END:
+            if (takeBytes(&input, &fileSize, sizeof(off_t)) == -1 ||
+                takeBytes(&input, &expected, sizeof(int)) == -1)
+            {
+                return -1;
+            }
+            return fileSize == written && expected == checksum ? 0 : -1;
+        default:
+            return -1;
+        }
+    }
+
+    return -1;
+}
+
+/*
+-- FUNCTION: chooseBlockSize
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int chooseBlockSize(off_t fileSize, int size);
+--
+-- RETURNS: the block size of the signature
+--
+-- NOTES:
+-- This function picks the smallest power of two at least the square root of
+-- the size of the file, which keeps both the signature and the bytes resent
+-- around a change small. A block always fits in the buffer of size bytes.
+*/
+static int chooseBlockSize(off_t fileSize, int size)
+{
+    int blockSize = DELTA_MIN_BLOCK;
+
+    while (blockSize < DELTA_MAX_BLOCK &&
+        (off_t)blockSize * blockSize < fileSize)
+    {
+        blockSize *= 2;
+    }
+    while (blockSize > size)
+    {
+        blockSize /= 2;
+    }
+
+    return blockSize;
+}
+
+/*
+-- FUNCTION: readSignature
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int readSignature(int socket, struct blockTable *table,
+--                                     char *buffer, int size);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function reads the signature sent by the server into a hash table
+-- keyed on the rolling checksum, the blocks with the same bucket chained
+-- through next. The signatures are received through the buffer of size
+-- bytes, as many at a time as fit.
+*/
+static int readSignature(int socket, struct blockTable *table, char *buffer,
+                         int size)
+{
+    unsigned int bucket = 0;
+    int batch = 0;
+    int i = 0;
+    int j = 0;
+
+    bzero(table, sizeof(struct blockTable));
+    if (readAll(&socket, buffer, BUFFER_LENGTH) == -1)
+    {
+        return -1;
+    }
+    memmove((void*)&table->blockSize, buffer + SIGNATURE_BLOCK, sizeof(int));
+    memmove((void*)&table->blockCount, buffer + SIGNATURE_COUNT,
+        sizeof(int));
+    if (table->blockSize < 1 || table->blockSize > DELTA_MAX_BLOCK ||
+        table->blockCount < 0)
+    {
+        return -1;
+    }
+
+    // Twice as many buckets as blocks keeps the chains short
+    table->bits = 1;
+    while (table->bits < 30 && (1 << table->bits) < table->blockCount * 2)
+    {
+        table->bits++;
+    }
+    table->weak = (unsigned int*)malloc(sizeof(unsigned int) *
+        (table->blockCount + 1));
+    table->strong = (unsigned long long*)malloc(sizeof(unsigned long long) *
+        (table->blockCount + 1));
+    table->next = (int*)malloc(sizeof(int) * (table->blockCount + 1));
+    table->heads = (int*)malloc(sizeof(int) << table->bits);
+    if (table->weak == NULL || table->strong == NULL || table->next == NULL ||
+        table->heads == NULL)
+    {
+        freeTable(table);
+        return -1;
+    }
+    memset(table->heads, 0xff, sizeof(int) << table->bits);
+
+    for (i = 0; i < table->blockCount; i += batch)
+    {
+        batch = size / SIGNATURE_SIZE;
+        batch = batch < table->blockCount - i ? batch : table->blockCount - i;
+        if (readAll(&socket, buffer, batch * SIGNATURE_SIZE) == -1)
+        {
+            freeTable(table);
+            return -1;
+        }
+        for (j = 0; j < batch; j++)
+        {
+            memcpy(&table->weak[i + j], buffer + j * SIGNATURE_SIZE, 4);
+            memcpy(&table->strong[i + j], buffer + j * SIGNATURE_SIZE + 4, 8);
+        }
+    }
+
+    // Chain the blocks from the last so each chain is in file order
+    for (i = table->blockCount - 1; i >= 0; i--)
+    {
+        bucket = (table->weak[i] * 0x9e3779b1U) >> (32 - table->bits);
+        table->next[i] = table->heads[bucket];
+        table->heads[bucket] = i;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: scanFile
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int scanFile(struct deltaOutput *output,
+--                                const struct blockTable *table,
+--                                const unsigned char *data, off_t length);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function slides a window of one block along the length bytes of data
+-- and queues the instructions that rebuild it from the basis. The rolling
+-- checksum of the window is updated a byte at a time and only worked out in
+-- full, with blockSums, after a match moves the window a whole block.
+--
+-- The window tries the block after the last one it matched first, so an
+-- unchanged run of the file becomes a single copy.
+*/
+static int scanFile(struct deltaOutput *output,
+                    const struct blockTable *table,
+                    const unsigned char *data, off_t length)
+{
+    unsigned int a = 0;
+    unsigned int b = 0;
+    off_t position = 0;
+    off_t literal = 0;
+    int blockSize = table->blockSize;
+    int copyFirst = 0;
+    int copyCount = 0;
+    int match = 0;
+
+    if (table->blockCount > 0 && length >= blockSize)
+    {
+        blockSums(data, blockSize, &a, &b);
+    }
+    while (table->blockCount > 0 && position + blockSize <= length)
+    {
+        match = findBlock(table, (a & 0xffff) | (b << 16), data + position,
+            copyCount > 0 ? copyFirst + copyCount : -1);
+        if (match == -1)
+        {
+            // Slide the window a byte, see blockSums for the two sums
+            if (position + blockSize < length)
+            {
+                a += data[position + blockSize] - data[position];
+                b += a - blockSize * data[position];
+            }
+            position++;
+            continue;
+        }
+
+        // Send what the window slid over before the block it found
+        if (literal < position)
+        {
+            if ((copyCount > 0 && putCopy(output, copyFirst,
+                copyCount) == -1) || putLiteral(output, data + literal,
+                position - literal) == -1)
+            {
+                return -1;
+            }
+            copyCount = 0;
+        }
+        if (copyCount > 0 && match == copyFirst + copyCount)
+        {
+            copyCount++;
+        }
+        else
+        {
+            if (copyCount > 0 && putCopy(output, copyFirst, copyCount) == -1)
+            {
+                return -1;
+            }
+            copyFirst = match;
+            copyCount = 1;
+        }
+
+        output->stats->matched += blockSize;
+        position += blockSize;
+        literal = position;
+        if (position + blockSize <= length)
+        {
+            blockSums(data + position, blockSize, &a, &b);
+        }
+    }
+
+    if (copyCount > 0 && putCopy(output, copyFirst, copyCount) == -1)
+    {
+        return -1;
+    }
+    return putLiteral(output, data + literal, length - literal);
+}
+
+/*
+-- FUNCTION: findBlock
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int findBlock(const struct blockTable *table,
+--                                 unsigned int weak,
+--                                 const unsigned char *data,
+--                                 int preferred);
+--
+-- RETURNS: the block that matches the window at data, or -1
+--
+-- NOTES:
+-- This function looks for a block of the basis with the rolling checksum
+-- weak and the same strong hash as the window. The strong hash is only
+-- computed once a rolling checksum matches. If the preferred block matches it
+-- is chosen over the others.
+*/
+static int findBlock(const struct blockTable *table, unsigned int weak,
+                     const unsigned char *data, int preferred)
+{
+    unsigned long long strong = 0;
+    unsigned char hash[16];
+    int found = -1;
+    int hashed = 0;
+    int i = 0;
+
+    for (i = table->heads[(weak * 0x9e3779b1U) >> (32 - table->bits)];
+        i != -1; i = table->next[i])
+    {
+        if (table->weak[i] != weak)
+        {
+            continue;
+        }
+        if (!hashed)
+        {
+            hash128(data, table->blockSize, hash);
+            memcpy(&strong, hash, 8);
+            hashed = 1;
+        }
+        if (table->strong[i] == strong)
+        {
+            if (i == preferred)
+            {
+                return i;
+            }
+            if (found == -1)
+            {
+                found = i;
+            }
+        }
+    }
+
+    return found;
+}
+
+/*
+-- FUNCTION: freeTable
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void freeTable(struct blockTable *table);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function frees the arrays of a signature read by readSignature.
+*/
+static void freeTable(struct blockTable *table)
+{
+    free(table->weak);
+    free(table->strong);
+    free(table->heads);
+    free(table->next);
+    table->weak = NULL;
+    table->strong = NULL;
+    table->heads = NULL;
+    table->next = NULL;
+}
+
+/*
+-- FUNCTION: putLiteral
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int putLiteral(struct deltaOutput *output,
+--                                  const unsigned char *data,
+--                                  off_t length);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function queues length bytes of the file as literal instructions of
+-- at most MAX_LITERAL bytes each. Nothing is queued for no bytes.
+*/
+static int putLiteral(struct deltaOutput *output,
+                      const unsigned char *data, off_t length)
+{
+    char type = DELTA_LITERAL;
+    int chunk = 0;
+
+    while (length > 0)
+    {
+        chunk = length < MAX_LITERAL ? length : MAX_LITERAL;
+        if (putBytes(output, &type, 1) == -1 ||
+            putBytes(output, &chunk, sizeof(int)) == -1 ||
+            putBytes(output, data, chunk) == -1)
+        {
+            return -1;
+        }
+        output->stats->literal += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: putCopy
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int putCopy(struct deltaOutput *output, int first,
+--                               int count);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function queues a copy of count blocks of the basis, starting with the
+-- block first.
+*/
+static int putCopy(struct deltaOutput *output, int first, int count)
+{
+    char type = DELTA_COPY;
+
+    if (putBytes(output, &type, 1) == -1 ||
+        putBytes(output, &first, sizeof(int)) == -1 ||
+        putBytes(output, &count, sizeof(int)) == -1)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: putBytes
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int putBytes(struct deltaOutput *output,
+--                                const void *data, int length);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function adds bytes to the instructions waiting to be sent and sends
+-- them once the buffer is full. Data at least as large as the buffer is sent
+-- straight from where it is instead of being copied.
+*/
+static int putBytes(struct deltaOutput *output, const void *data,
+                    int length)
+{
+    if (output->count + length > output->size && flushOutput(output) == -1)
+    {
+        return -1;
+    }
+    if (length >= output->size)
+    {
+        output->stats->sent += length;
+        return sendAll(&output->socket, (const char*)data, length);
+    }
+
+    memcpy(output->buffer + output->count, data, length);
+    output->count += length;
+    return 0;
+}
+
+/*
+-- FUNCTION: flushOutput
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int flushOutput(struct deltaOutput *output);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function sends the instructions waiting in the buffer.
+*/
+static int flushOutput(struct deltaOutput *output)
+{
+    output->stats->sent += output->count;
+    if (sendAll(&output->socket, output->buffer, output->count) == -1)
+    {
+        return -1;
+    }
+
+    output->count = 0;
+    return 0;
+}
+
+/*
+-- FUNCTION: takeBytes
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int takeBytes(struct deltaInput *input, void *data,
+--                                 int length);
+--
+-- RETURNS: 0 on success or -1 if the connection ended first
+--
+-- NOTES:
+-- This function copies the next length bytes of the instructions to data,
+-- receiving more as needed.
+*/
+static int takeBytes(struct deltaInput *input, void *data, int length)
+{
+    char *bytes = (char*)data;
+    int chunk = 0;
+
+    while (length > 0)
+    {
+        if (input->start == input->end && fillInput(input) == -1)
+        {
+            return -1;
+        }
+        chunk = input->end - input->start;
+        chunk = chunk < length ? chunk : length;
+        memcpy(bytes, input->buffer + input->start, chunk);
+        input->start += chunk;
+        bytes += chunk;
+        length -= chunk;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: fillInput
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int fillInput(struct deltaInput *input);
+--
+-- RETURNS: 0 on success or -1 if the connection ended or failed
+--
+-- NOTES:
+-- This function receives as many instructions as fit in the input buffer. It
+-- is only called once everything in the buffer has been taken.
+*/
+static int fillInput(struct deltaInput *input)
+{
+    ssize_t bytesRead = 0;
+
+    do
+    {
+        bytesRead = recv(input->socket, input->buffer, input->size, 0);
+    } while (bytesRead == -1 && errno == EINTR);
+    if (bytesRead <= 0)
+    {
+        return -1;
+    }
+
+    input->start = 0;
+    input->end = bytesRead;
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <sys/types.h>
+
+// Delta instructions, each starts with one of these bytes
+#define DELTA_END		0
+#define DELTA_LITERAL	1
+#define DELTA_COPY		2
+
+// Block sizes of a signature, the block size grows with the square root
+// of the size of the file
+#define DELTA_MIN_BLOCK	1024
+#define DELTA_MAX_BLOCK	131072
+
+// Signature header layout, the size of the file is at the start
+#define SIGNATURE_BLOCK	8
+#define SIGNATURE_COUNT	12
+
+// Bytes of a block signature, the weak checksum and 64 bits of the strong one
+#define SIGNATURE_SIZE	12
+
+// The blocks the server has of a file, sent to the client as its signature
+struct deltaBasis
+{
+    off_t size;
+    int blockSize;
+    int blockCount;
+};
+
+// What a delta upload cost, filled in by sendDelta
+struct deltaStats
+{
+    off_t literal;
+    off_t matched;
+    off_t sent;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int sendSignature(int socket, int basis, char *buffer, int size,
+                  struct deltaBasis *signature);
+int sendDelta(int socket, int file, char *buffer, int size,
+              struct deltaStats *stats);
+int receiveDelta(int socket, int basis, int file,
+                 const struct deltaBasis *signature, char *buffer, int size);
+#ifdef __cplusplus
+}
+#endif
+#endif
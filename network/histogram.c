@@ -0,0 +1,199 @@
+/*
+-- SOURCE FILE: histogram.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int bucketOf(long long value);
+-- long long bucketLimit(int bucket);
+-- void recordValue(struct histogram *histogram, long long value);
+-- long long valueAt(const struct histogram *histogram, double fraction);
+-- long long countUpTo(const struct histogram *histogram, long long value);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- NOTES:
+-- This file contains the latency histograms, which used to live in the load
+-- generator and are now shared with the metrics of the server. A histogram
+-- is a fixed array of counts, so recording a value is a few instructions and
+-- never allocates, and two histograms of the same values can be added bucket
+-- by bucket. Values below HISTOGRAM_SUB have a bucket each, every power of
+-- two above that is split into HISTOGRAM_SUB buckets, so the buckets get
+-- wider as the values grow but always stay a small part of the value.
+--
+-- A histogram is not locked. The server keeps one per thread and adds them
+-- up when it reports, see metrics.c.
+*/
+
+#include "histogram.h"
+
+/*
+-- FUNCTION: bucketOf
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int bucketOf(long long value);
+--
+-- RETURNS: the bucket the value is counted in
+--
+-- NOTES:
+-- This function finds the bucket of a value, negative values are counted as
+-- 0.
+*/
+int bucketOf(long long value)
+{
+    int top = 0;
+    int shift = 0;
+
+    if (value < HISTOGRAM_SUB)
+    {
+        return value < 0 ? 0 : (int)value;
+    }
+    top = 63 - __builtin_clzll((unsigned long long)value);
+    shift = top - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB +
+        (int)((value >> shift) - HISTOGRAM_SUB);
+}
+
+/*
+-- FUNCTION: bucketLimit
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: long long bucketLimit(int bucket);
+--
+-- RETURNS: the largest value counted in the bucket
+--
+-- NOTES:
+-- This function is the opposite of bucketOf.
+*/
+long long bucketLimit(int bucket)
+{
+    int shift = 0;
+
+    if (bucket < HISTOGRAM_SUB)
+    {
+        return bucket;
+    }
+    shift = bucket / HISTOGRAM_SUB - 1;
+    return ((long long)(HISTOGRAM_SUB + bucket % HISTOGRAM_SUB + 1) << shift)
+        - 1;
+}
+
+/*
+-- FUNCTION: recordValue
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moved here from load.c, also adds up the
+-- values.
+--
+-- INTERFACE: void recordValue(struct histogram *histogram, long long value);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function counts a value in a histogram.
+*/
+void recordValue(struct histogram *histogram, long long value)
+{
+    if (value < 0)
+    {
+        value = 0;
+    }
+
+    histogram->counts[bucketOf(value)]++;
+    histogram->total++;
+    histogram->sum += value;
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+/*
+-- FUNCTION: valueAt
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moved here from load.c.
+--
+-- INTERFACE: long long valueAt(const struct histogram *histogram,
+--                              double fraction);
+--
+-- RETURNS: the value the fraction of the counted values are at or below, 0
+-- for an empty histogram
+--
+-- NOTES:
+-- This function finds a percentile of a histogram, as the middle of the
+-- bucket it falls in, but never more than the largest value counted.
+*/
+long long valueAt(const struct histogram *histogram, double fraction)
+{
+    long long wanted = (long long)(fraction * histogram->total + 0.999999);
+    long long seen = 0;
+    long long value = 0;
+    int shift = 0;
+    int bucket = 0;
+
+    if (histogram->total == 0)
+    {
+        return 0;
+    }
+    if (wanted < 1)
+    {
+        wanted = 1;
+    }
+    for (bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+    {
+        if ((seen += histogram->counts[bucket]) >= wanted)
+        {
+            break;
+        }
+    }
+
+    if (bucket < HISTOGRAM_SUB)
+    {
+        return bucket;
+    }
+    shift = bucket / HISTOGRAM_SUB - 1;
+    value = ((long long)(HISTOGRAM_SUB + bucket % HISTOGRAM_SUB) << shift) +
+        ((1LL << shift) >> 1);
+    return value < histogram->max ? value : histogram->max;
+}
+
+/*
+-- FUNCTION: countUpTo
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: long long countUpTo(const struct histogram *histogram,
+--                                long long value);
+--
+-- RETURNS: how many of the counted values are at or below the value
+--
+-- NOTES:
+-- This function counts the buckets that lie wholly at or below the value.
+-- Values in the bucket the value falls in are left out unless it ends at the
+-- value, so the count can be up to about 3% low but is never high.
+*/
+long long countUpTo(const struct histogram *histogram, long long value)
+{
+    long long count = 0;
+    int bucket = 0;
+
+    for (bucket = 0; bucket < HISTOGRAM_BUCKETS &&
+        bucketLimit(bucket) <= value; bucket++)
+    {
+        count += histogram->counts[bucket];
+    }
+    return count;
+}
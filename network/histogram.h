@@ -0,0 +1,30 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+// A histogram has this many sub-buckets for every power of two, which keeps
+// every value within about 3%
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS (64 * HISTOGRAM_SUB)
+
+struct histogram
+{
+    long long counts[HISTOGRAM_BUCKETS];
+    long long total;
+    long long sum;
+    long long max;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int bucketOf(long long value);
+long long bucketLimit(int bucket);
+void recordValue(struct histogram *histogram, long long value);
+long long valueAt(const struct histogram *histogram, double fraction);
+long long countUpTo(const struct histogram *histogram, long long value);
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,230 @@
+/*
+-- SOURCE FILE: list.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int sendListRequest(int socket, const char *after, int limit, int flags);
+-- int readListRequest(int socket, char *after, int *limit, int *flags);
+-- int packListed(char *buffer, const char *previous, const char *name,
+--                off_t size, long long modified, const unsigned int *hash);
+-- int readListPage(int socket, struct listEntry *entry, entryListed listed,
+--                  unsigned int *matches, int *more);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- NOTES:
+-- This file contains the messages of a listing of the files the server
+-- shares. The control packet of a listing holds the prefix the names must
+-- start with. On the data connection the client asks for a page at a time,
+-- giving the most entries it wants and the name the page starts after, the
+-- last name of the page before. The server answers with the page header and
+-- the entries, in the order of their names. The client asks for the next page
+-- on the same connection or closes it.
+--
+-- Names sorted next to each other mostly start the same, so every entry only
+-- holds the part of its name that differs from the entry before it. The
+-- first entry of a page holds its whole name.
+*/
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <string.h>
+
+#include "network.h"
+#include "list.h"
+
+/*
+-- FUNCTION: sendListRequest
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendListRequest(int socket, const char *after, int limit,
+--                                int flags);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function asks for the next page of at most limit entries whose names
+-- come after the name after, an empty name for the first page.
+*/
+int sendListRequest(int socket, const char *after, int limit, int flags)
+{
+    char request[LIST_REQUEST + FILENAME_MAX];
+    unsigned short length = (unsigned short)strlen(after);
+
+    if (length >= FILENAME_MAX)
+    {
+        return -1;
+    }
+    memmove(request, (void*)&limit, sizeof(int));
+    memmove(request + sizeof(int), (void*)&flags, sizeof(int));
+    memmove(request + 2 * sizeof(int), (void*)&length, sizeof(short));
+    memmove(request + LIST_REQUEST, after, length);
+    return sendAll(&socket, request, LIST_REQUEST + length);
+}
+
+/*
+-- FUNCTION: readListRequest
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int readListRequest(int socket, char *after, int *limit,
+--                                int *flags);
+--
+-- RETURNS: 0 on success or -1 on failure or once the client is done
+--
+-- NOTES:
+-- This function reads the request for a page. The name the page starts after
+-- is read into after, which must hold FILENAME_MAX bytes, and the limit is
+-- kept between 1 and MAX_PAGE_ENTRIES.
+*/
+int readListRequest(int socket, char *after, int *limit, int *flags)
+{
+    char request[LIST_REQUEST];
+    unsigned short length = 0;
+
+    if (readAll(&socket, request, LIST_REQUEST) == -1)
+    {
+        return -1;
+    }
+    memmove((void*)limit, request, sizeof(int));
+    memmove((void*)flags, request + sizeof(int), sizeof(int));
+    memmove((void*)&length, request + 2 * sizeof(int), sizeof(short));
+    if (length >= FILENAME_MAX ||
+        (length > 0 && readAll(&socket, after, length) == -1))
+    {
+        return -1;
+    }
+
+    after[length] = '\0';
+    if (*limit < 1 || *limit > MAX_PAGE_ENTRIES)
+    {
+        *limit = MAX_PAGE_ENTRIES;
+    }
+    return 0;
+}
+
+/*
+-- FUNCTION: packListed
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int packListed(char *buffer, const char *previous,
+--                           const char *name, off_t size,
+--                           long long modified, const unsigned int *hash);
+--
+-- RETURNS: the bytes of the entry
+--
+-- NOTES:
+-- This function writes the entry of a file to buffer, which must hold
+-- LISTED_ENTRY + LISTED_HASH + FILENAME_MAX bytes. Only the part of the name
+-- after what it shares with previous, the name of the entry before it or
+-- NULL for the first entry of a page, is written. The checksum is left out
+-- when hash is NULL.
+*/
+int packListed(char *buffer, const char *previous, const char *name,
+               off_t size, long long modified, const unsigned int *hash)
+{
+    unsigned short shared = 0;
+    unsigned short rest = 0;
+    int length = LISTED_ENTRY;
+
+    while (previous != NULL && previous[shared] != '\0' &&
+        previous[shared] == name[shared])
+    {
+        shared++;
+    }
+    rest = (unsigned short)strlen(name + shared);
+
+    buffer[0] = hash != NULL ? ENTRY_HASHED : 0;
+    memmove(buffer + 1, (void*)&shared, sizeof(short));
+    memmove(buffer + 3, (void*)&rest, sizeof(short));
+    memmove(buffer + 5, (void*)&size, sizeof(off_t));
+    memmove(buffer + 13, (void*)&modified, sizeof(long long));
+    if (hash != NULL)
+    {
+        memmove(buffer + length, (void*)hash, sizeof(int));
+        length += LISTED_HASH;
+    }
+    memmove(buffer + length, name + shared, rest);
+
+    return length + rest;
+}
+
+/*
+-- FUNCTION: readListPage
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int readListPage(int socket, struct listEntry *entry,
+--                             entryListed listed, unsigned int *matches,
+--                             int *more);
+--
+-- RETURNS: the entries of the page or -1 on failure
+--
+-- NOTES:
+-- This function reads a page and passes every entry of it to listed. The
+-- entry is filled in with one file after the other, so once the page is read
+-- it holds the last one, the name to ask for the next page after. The files
+-- that match the prefix and whether more pages follow are read into matches
+-- and more.
+*/
+int readListPage(int socket, struct listEntry *entry, entryListed listed,
+                 unsigned int *matches, int *more)
+{
+    char header[LISTED_ENTRY + LISTED_HASH];
+    unsigned short shared = 0;
+    unsigned short rest = 0;
+    unsigned int count = 0;
+    unsigned int i = 0;
+
+    if (readAll(&socket, header, PAGE_HEADER) == -1)
+    {
+        return -1;
+    }
+    memmove((void*)matches, header, sizeof(int));
+    memmove((void*)&count, header + sizeof(int), sizeof(int));
+    *more = header[2 * sizeof(int)];
+    if (count > MAX_PAGE_ENTRIES)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (readAll(&socket, header, LISTED_ENTRY) == -1)
+        {
+            return -1;
+        }
+        memmove((void*)&shared, header + 1, sizeof(short));
+        memmove((void*)&rest, header + 3, sizeof(short));
+        memmove((void*)&entry->size, header + 5, sizeof(off_t));
+        memmove((void*)&entry->modified, header + 13, sizeof(long long));
+        entry->hashed = header[0] & ENTRY_HASHED;
+
+        // The first entry of a page shares nothing with the page before
+        if ((i == 0 && shared > 0) || shared > strlen(entry->name) ||
+            shared + rest >= FILENAME_MAX ||
+            (entry->hashed && readAll(&socket, (char*)&entry->hash,
+            LISTED_HASH) == -1) ||
+            (rest > 0 && readAll(&socket, entry->name + shared, rest) == -1))
+        {
+            return -1;
+        }
+        entry->name[shared + rest] = '\0';
+        listed(entry);
+    }
+
+    return (int)count;
+}
@@ -0,0 +1,56 @@
+#ifndef LIST_H
+#define LIST_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+// Page request: the most entries to send (4), the list flags (4) and the
+// length of the name the page starts after (2)
+#define LIST_REQUEST	10
+
+// Page header: the files that match the prefix (4), the entries in the page
+// (4) and whether more follow the page (1)
+#define PAGE_HEADER		9
+
+// Listed entry: its flags (1), the bytes of the name it shares with the entry
+// before it (2), the length of the rest of the name (2), the size (8) and the
+// time it was last modified (8), followed by the checksum if it has one
+#define LISTED_ENTRY	21
+#define LISTED_HASH		4
+
+// Most entries a page holds
+#define MAX_PAGE_ENTRIES	10000
+
+// Page request flags
+#define LIST_HASH		0x01
+
+// Listed entry flags
+#define ENTRY_HASHED	0x01
+
+// A file of a listing, the name of the entry before it until it is read
+struct listEntry
+{
+    char name[FILENAME_MAX];
+    off_t size;
+    long long modified;
+    unsigned int hash;
+    int hashed;
+};
+
+// Called for every entry of a page as it is read
+typedef void (*entryListed)(const struct listEntry *entry);
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int sendListRequest(int socket, const char *after, int limit, int flags);
+int readListRequest(int socket, char *after, int *limit, int *flags);
+int packListed(char *buffer, const char *previous, const char *name,
+               off_t size, long long modified, const unsigned int *hash);
+int readListPage(int socket, struct listEntry *entry, entryListed listed,
+                 unsigned int *matches, int *more);
+#ifdef __cplusplus
+}
+#endif
+#endif
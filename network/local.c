@@ -0,0 +1,733 @@
+/*
+-- SOURCE FILE: local.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- static int unixOpen();
+-- static void unixAddress(const char *format, int port,
+--                         struct sockaddr_un *address, socklen_t *length);
+-- static int bindName(const char *format, int *port, int *socket);
+-- static int unixBind(int *port, int *socket);
+-- static int unixAccept(int *listenSocket, char *ip, unsigned short *port);
+-- static int unixConnect(int *port, int *socket, const char *host,
+--                        int lookup);
+-- static int unixNamePort(int *socket, int peer);
+-- static int unixLocalPort(int *socket);
+-- static int unixListen(int *socket);
+-- static int localPeerIp(int *socket, char *ip);
+-- static struct memoryListener *findListener(int port, int socket);
+-- static int memoryBind(int *port, int *socket);
+-- static int memoryAccept(int *listenSocket, char *ip, unsigned short *port);
+-- static int memoryConnect(int *port, int *socket, const char *host,
+--                          int lookup);
+-- static int memoryLocalPort(int *socket);
+-- static int memoryListen(int *socket);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The load generator runs the server over the
+-- memory transport.
+-- October 17, 2026 - Says what the memory transport is made of.
+--
+-- NOTES:
+-- This file contains the transports that never leave the machine, see
+-- network.c. They keep the ports of the protocol, so the control packet and
+-- the data ports work as they do over TCP, and the peer of every connection
+-- is 127.0.0.1.
+--
+-- The unix transport binds port N to the name sft-N in the abstract Unix
+-- domain namespace, or sftc-N for the port of a connected socket, so nothing
+-- is left in the file system and the name is gone once the last socket bound
+-- to it is closed. The data goes through the kernel without the TCP/IP
+-- stack.
+--
+-- The memory transport connects the two ends of a socket pair made in the
+-- process, so its connections can only be made between threads of one
+-- process, or between a process and a child forked after the port it
+-- connects to was bound. Its connections have no port of their own, so the
+-- server can not connect back and transfers must be passive. The load
+-- generator runs the server in its own process over it, see loopback.c. A
+-- listening socket is one end of a datagram socket pair, a connect passes
+-- one end of a new stream socket pair through the other end and accept
+-- receives it. The listening socket is readable while connections wait, so
+-- it works with poll and epoll. io_uring accepts need a real listening
+-- socket, the uring mode only runs over TCP.
+--
+-- Despite its name the memory transport is not a pipe in user space. It is
+-- a variant of the unix transport: every connection is a pair of Unix
+-- domain stream sockets of the kernel, so every read, write, sendfile and
+-- splice is still a system call and the timing is not deterministic. What
+-- it saves over the unix transport is the names and the connect through the
+-- kernel, and over TCP the TCP/IP stack. The server moves its data with
+-- sendfile, splice and epoll on descriptors, which a pipe in user space
+-- could not take part in.
+*/
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "network.h"
+
+#define MAX_QUEUE SOMAXCONN
+
+// The ports handed out when port 0 is bound, as TCP does
+#define LOCAL_PORT_LOW		49152
+#define LOCAL_PORT_COUNT	16384
+#define PORT_SPREAD			2654435761u
+
+// The abstract names of the ports of listening and connected sockets
+#define LISTEN_NAME			"sft-%d"
+#define CONNECT_NAME		"sftc-%d"
+
+// The address of the peer of every local connection
+#define LOCAL_IP			"127.0.0.1"
+
+// Most ports of the memory transport listening at once
+#define MEMORY_LISTENERS	256
+
+// A listening port of the memory transport. The socket is the end accept
+// reads from, known by its inode since the descriptor may be closed and its
+// number reused, and the writer the end connect passes sockets through.
+struct memoryListener
+{
+    int port;
+    int socket;
+    ino_t inode;
+    int writer;
+};
+
+static int unixOpen();
+static void unixAddress(const char *format, int port,
+                        struct sockaddr_un *address, socklen_t *length);
+static int bindName(const char *format, int *port, int *socket);
+static int unixBind(int *port, int *socket);
+static int unixAccept(int *listenSocket, char *ip, unsigned short *port);
+static int unixConnect(int *port, int *socket, const char *host, int lookup);
+static int unixNamePort(int *socket, int peer);
+static int unixLocalPort(int *socket);
+static int unixListen(int *socket);
+static int localPeerIp(int *socket, char *ip);
+static struct memoryListener *findListener(int port, int socket);
+static int memoryBind(int *port, int *socket);
+static int memoryAccept(int *listenSocket, char *ip, unsigned short *port);
+static int memoryConnect(int *port, int *socket, const char *host,
+                         int lookup);
+static int memoryLocalPort(int *socket);
+static int memoryListen(int *socket);
+
+const struct transport unixTransport = {
+    "unix", 0, unixOpen, unixBind, unixListen, unixAccept, unixConnect,
+    unixLocalPort, localPeerIp
+};
+
+const struct transport memoryTransport = {
+    "memory", 0, unixOpen, memoryBind, memoryListen, memoryAccept,
+    memoryConnect, memoryLocalPort, localPeerIp
+};
+
+static struct memoryListener listeners[MEMORY_LISTENERS];
+static pthread_mutex_t listenerLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Where the search for a free port starts, so binds of port 0 in a row do
+// not try the same ports again
+static int nextPort = 0;
+
+/*
+-- FUNCTION: unixOpen
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int unixOpen();
+--
+-- RETURNS: a new Unix domain stream socket or -1 on failure
+--
+-- NOTES:
+-- This function makes the sockets of both local transports. The memory
+-- transport replaces the socket with an end of a socket pair when it is
+-- bound or connected, keeping its descriptor and flags.
+*/
+static int unixOpen()
+{
+    return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+/*
+-- FUNCTION: unixAddress
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void unixAddress(const char *format, int port,
+--                                    struct sockaddr_un *address,
+--                                    socklen_t *length);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function fills in the abstract address of a port, named with format.
+-- The name starts with a zero byte and is not terminated, so its length is
+-- part of it.
+*/
+static void unixAddress(const char *format, int port,
+                        struct sockaddr_un *address, socklen_t *length)
+{
+    int nameLength = 0;
+
+    bzero((char *)address, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    nameLength = snprintf(address->sun_path + 1, sizeof(address->sun_path) - 1,
+        format, port);
+    *length = offsetof(struct sockaddr_un, sun_path) + 1 + nameLength;
+}
+
+/*
+-- FUNCTION: bindName
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int bindName(const char *format, int *port,
+--                                int *socket);
+--
+-- RETURNS: the result of the bind function
+--
+-- NOTES:
+-- This function binds a socket to the name of a port, made with format.
+-- Port 0 takes the first free one of the local ports, which unixLocalPort
+-- finds again.
+*/
+static int bindName(const char *format, int *port, int *socket)
+{
+    struct sockaddr_un address;
+    socklen_t length = 0;
+    int tries = 0;
+
+    if (*port != 0)
+    {
+        unixAddress(format, *port, &address, &length);
+        return bind(*socket, (struct sockaddr *)&address, length);
+    }
+
+    // Other processes take local ports too, each starts somewhere else and
+    // processes started one after the other far apart
+    for (tries = 0; tries < LOCAL_PORT_COUNT; tries++)
+    {
+        unixAddress(format, LOCAL_PORT_LOW + (nextPort++ +
+            (unsigned int)getpid() * PORT_SPREAD) % LOCAL_PORT_COUNT,
+            &address, &length);
+        if (bind(*socket, (struct sockaddr *)&address, length) == 0)
+        {
+            return 0;
+        }
+        if (errno != EADDRINUSE)
+        {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/*
+-- FUNCTION: unixBind
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int unixBind(int *port, int *socket);
+--
+-- RETURNS: the result of the bind function
+--
+-- NOTES:
+-- This function binds a socket of the unix transport to a port to listen on.
+*/
+static int unixBind(int *port, int *socket)
+{
+    return bindName(LISTEN_NAME, port, socket);
+}
+
+/*
+-- FUNCTION: unixAccept
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int unixAccept(int *listenSocket, char *ip,
+--                                  unsigned short *port);
+--
+-- RETURNS: the new socket created for the connection
+--
+-- NOTES:
+-- This function accepts a connection of the unix transport. The port of the
+-- client is the one its socket was bound to when it connected.
+*/
+static int unixAccept(int *listenSocket, char *ip, unsigned short *port)
+{
+    int sock = accept(*listenSocket, NULL, NULL);
+
+    if (sock != -1 && ip != NULL)
+    {
+        strcpy(ip, LOCAL_IP);
+    }
+    if (sock != -1 && port != NULL)
+    {
+        *port = (unsigned short)unixNamePort(&sock, 1);
+    }
+    return sock;
+}
+
+/*
+-- FUNCTION: unixConnect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int unixConnect(int *port, int *socket,
+--                                  const char *host, int lookup);
+--
+-- RETURNS: the result of the connect function
+--
+-- NOTES:
+-- This function connects a socket to the name of a port. The host does not
+-- matter, every local port is on this machine. The socket is first bound to
+-- a free port, as TCP does, since the server connects back to the port of
+-- the control connection. Connected sockets are named apart from listening
+-- ones, so the client can listen on the port while the control connection
+-- is still open in a process it forked.
+*/
+static int unixConnect(int *port, int *socket, const char *host, int lookup)
+{
+    struct sockaddr_un address;
+    socklen_t length = 0;
+    int localPort = 0;
+
+    (void)host;
+    (void)lookup;
+    if (unixNamePort(socket, 0) == -1 &&
+        bindName(CONNECT_NAME, &localPort, socket) == -1)
+    {
+        return -1;
+    }
+    unixAddress(LISTEN_NAME, *port, &address, &length);
+    return connect(*socket, (struct sockaddr *)&address, length);
+}
+
+/*
+-- FUNCTION: unixNamePort
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int unixNamePort(int *socket, int peer);
+--
+-- RETURNS: the port or -1 if the socket has no name of a port
+--
+-- NOTES:
+-- This function reads the port back out of the name a socket is bound to, or
+-- the name of the socket at the other end when peer is set.
+*/
+static int unixNamePort(int *socket, int peer)
+{
+    struct sockaddr_un address;
+    socklen_t length = sizeof(address);
+    char name[sizeof(address.sun_path)];
+    int port = 0;
+
+    bzero((char *)&address, sizeof(address));
+    if ((peer ? getpeername(*socket, (struct sockaddr *)&address, &length) :
+        getsockname(*socket, (struct sockaddr *)&address, &length)) == -1 ||
+        length <= offsetof(struct sockaddr_un, sun_path) + 1)
+    {
+        return -1;
+    }
+    length -= offsetof(struct sockaddr_un, sun_path) + 1;
+    memmove(name, address.sun_path + 1, length);
+    name[length] = '\0';
+    return sscanf(name, LISTEN_NAME, &port) == 1 ||
+        sscanf(name, CONNECT_NAME, &port) == 1 ? port : -1;
+}
+
+/*
+-- FUNCTION: unixLocalPort
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int unixLocalPort(int *socket);
+--
+-- RETURNS: the port the socket is bound to or -1 on failure
+--
+-- NOTES:
+-- This function finds the port of a socket of the unix transport.
+*/
+static int unixLocalPort(int *socket)
+{
+    return unixNamePort(socket, 0);
+}
+
+/*
+-- FUNCTION: unixListen
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Queues as many connections as the system
+-- allows.
+--
+-- INTERFACE: static int unixListen(int *socket);
+--
+-- RETURNS: the result of the listen function
+--
+-- NOTES:
+-- This function sets a socket of the unix transport to listen.
+*/
+static int unixListen(int *socket)
+{
+    return listen(*socket, MAX_QUEUE);
+}
+
+/*
+-- FUNCTION: localPeerIp
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int localPeerIp(int *socket, char *ip);
+--
+-- RETURNS: 0
+--
+-- NOTES:
+-- This function gives the address of the other end of a local connection,
+-- always this machine. The address is only used to connect back to it.
+*/
+static int localPeerIp(int *socket, char *ip)
+{
+    (void)socket;
+    strcpy(ip, LOCAL_IP);
+    return 0;
+}
+
+/*
+-- FUNCTION: findListener
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static struct memoryListener *findListener(int port,
+--                                                       int socket);
+--
+-- RETURNS: the listener or NULL if there is none
+--
+-- NOTES:
+-- This function finds the listener of a port, or of a listening socket when
+-- port is 0. A listener whose socket was closed is forgotten on the way, so
+-- its port is free again. The listener lock must be held.
+*/
+static struct memoryListener *findListener(int port, int socket)
+{
+    struct stat statBuffer;
+    int i = 0;
+
+    for (i = 0; i < MEMORY_LISTENERS; i++)
+    {
+        if (listeners[i].port == 0)
+        {
+            continue;
+        }
+        if (fstat(listeners[i].socket, &statBuffer) == -1 ||
+            statBuffer.st_ino != listeners[i].inode)
+        {
+            close(listeners[i].writer);
+            listeners[i].port = 0;
+            continue;
+        }
+        if ((port != 0 && listeners[i].port == port) ||
+            (port == 0 && listeners[i].socket == socket))
+        {
+            return &listeners[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+-- FUNCTION: memoryBind
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int memoryBind(int *port, int *socket);
+--
+-- RETURNS: 0 on success or -1 on failure with errno set
+--
+-- NOTES:
+-- This function makes the socket a listening socket of the memory transport.
+-- It is replaced by the reading end of a datagram socket pair and the port
+-- is given to it, the first free local port for port 0. A port that is taken
+-- fails with EADDRINUSE.
+*/
+static int memoryBind(int *port, int *socket)
+{
+    struct memoryListener *listener = NULL;
+    struct stat statBuffer;
+    int pair[2];
+    int bound = *port;
+    int tries = 0;
+    int i = 0;
+
+    pthread_mutex_lock(&listenerLock);
+    if (bound != 0 && findListener(bound, 0) != NULL)
+    {
+        pthread_mutex_unlock(&listenerLock);
+        errno = EADDRINUSE;
+        return -1;
+    }
+    for (tries = 0; bound == 0 && tries < LOCAL_PORT_COUNT; tries++)
+    {
+        if (findListener(LOCAL_PORT_LOW + nextPort % LOCAL_PORT_COUNT, 0) ==
+            NULL)
+        {
+            bound = LOCAL_PORT_LOW + nextPort % LOCAL_PORT_COUNT;
+        }
+        nextPort++;
+    }
+    for (i = 0; i < MEMORY_LISTENERS && listeners[i].port != 0; i++);
+    if (bound == 0 || i == MEMORY_LISTENERS)
+    {
+        pthread_mutex_unlock(&listenerLock);
+        errno = EADDRINUSE;
+        return -1;
+    }
+    listener = &listeners[i];
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, pair) == -1)
+    {
+        pthread_mutex_unlock(&listenerLock);
+        return -1;
+    }
+    if (dup2(pair[0], *socket) == -1 || fstat(*socket, &statBuffer) == -1)
+    {
+        close(pair[0]);
+        close(pair[1]);
+        pthread_mutex_unlock(&listenerLock);
+        return -1;
+    }
+    close(pair[0]);
+    listener->port = bound;
+    listener->socket = *socket;
+    listener->inode = statBuffer.st_ino;
+    listener->writer = pair[1];
+    pthread_mutex_unlock(&listenerLock);
+
+    return 0;
+}
+
+/*
+-- FUNCTION: memoryAccept
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int memoryAccept(int *listenSocket, char *ip,
+--                                   unsigned short *port);
+--
+-- RETURNS: the new socket created for the connection
+--
+-- NOTES:
+-- This function receives the socket a connect passed to the listening
+-- socket. A non blocking listening socket fails with EAGAIN when no
+-- connection waits, as accept does.
+*/
+static int memoryAccept(int *listenSocket, char *ip, unsigned short *port)
+{
+    struct msghdr message;
+    struct cmsghdr *control = NULL;
+    char controlBuffer[CMSG_SPACE(sizeof(int))];
+    char byte = 0;
+    struct iovec vector;
+    int sock = -1;
+
+    bzero((char *)&message, sizeof(message));
+    vector.iov_base = &byte;
+    vector.iov_len = 1;
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = controlBuffer;
+    message.msg_controllen = sizeof(controlBuffer);
+
+    if (recvmsg(*listenSocket, &message, 0) <= 0 ||
+        (control = CMSG_FIRSTHDR(&message)) == NULL ||
+        control->cmsg_type != SCM_RIGHTS)
+    {
+        return -1;
+    }
+    memmove((void*)&sock, CMSG_DATA(control), sizeof(int));
+
+    if (ip != NULL)
+    {
+        strcpy(ip, LOCAL_IP);
+    }
+    if (port != NULL)
+    {
+        *port = 0;
+    }
+    return sock;
+}
+
+/*
+-- FUNCTION: memoryConnect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Closes its end of the passed socket before
+-- the listener can accept it.
+--
+-- INTERFACE: static int memoryConnect(int *port, int *socket,
+--                                    const char *host, int lookup);
+--
+-- RETURNS: 0 on success or -1 on failure with errno set
+--
+-- NOTES:
+-- This function connects the socket to a listening port of the memory
+-- transport. A stream socket pair is made, one end is passed to the listener
+-- and the socket is replaced by the other with the flags it had, so a non
+-- blocking connect stays non blocking and is done at once. A port nobody
+-- listens on fails with ECONNREFUSED, as TCP does.
+--
+-- The server may run in this process, see loopback.c, and accept, serve and
+-- close the passed end at any time once it is sent. Its copy here is closed
+-- at once, so the socket never outlives the descriptor of the server.
+*/
+static int memoryConnect(int *port, int *socket, const char *host, int lookup)
+{
+    struct memoryListener *listener = NULL;
+    struct msghdr message;
+    struct cmsghdr *control = NULL;
+    char controlBuffer[CMSG_SPACE(sizeof(int))];
+    char byte = 0;
+    struct iovec vector;
+    int pair[2];
+    int flags = 0;
+    int result = 0;
+    int error = 0;
+
+    (void)host;
+    (void)lookup;
+    if ((flags = fcntl(*socket, F_GETFL, 0)) == -1 ||
+        socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == -1)
+    {
+        return -1;
+    }
+
+    bzero((char *)&message, sizeof(message));
+    vector.iov_base = &byte;
+    vector.iov_len = 1;
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = controlBuffer;
+    message.msg_controllen = sizeof(controlBuffer);
+    control = CMSG_FIRSTHDR(&message);
+    control->cmsg_level = SOL_SOCKET;
+    control->cmsg_type = SCM_RIGHTS;
+    control->cmsg_len = CMSG_LEN(sizeof(int));
+    memmove(CMSG_DATA(control), (void*)&pair[1], sizeof(int));
+
+    pthread_mutex_lock(&listenerLock);
+    if ((listener = findListener(*port, 0)) == NULL)
+    {
+        errno = ECONNREFUSED;
+        result = -1;
+    }
+    else if (sendmsg(listener->writer, &message, MSG_DONTWAIT | MSG_NOSIGNAL)
+        == -1)
+    {
+        // A full queue is a full backlog, the caller tries again
+        errno = errno == EAGAIN ? ECONNREFUSED : errno;
+        result = -1;
+    }
+    error = errno;
+    close(pair[1]);
+    pthread_mutex_unlock(&listenerLock);
+
+    errno = error;
+    if (result == -1 || dup2(pair[0], *socket) == -1 ||
+        fcntl(*socket, F_SETFL, flags) == -1)
+    {
+        close(pair[0]);
+        return -1;
+    }
+    close(pair[0]);
+    return 0;
+}
+
+/*
+-- FUNCTION: memoryLocalPort
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int memoryLocalPort(int *socket);
+--
+-- RETURNS: the port the socket listens on or -1 if it does not
+--
+-- NOTES:
+-- This function finds the port of a listening socket of the memory
+-- transport.
+*/
+static int memoryLocalPort(int *socket)
+{
+    struct memoryListener *listener = NULL;
+    int port = -1;
+
+    pthread_mutex_lock(&listenerLock);
+    if ((listener = findListener(0, *socket)) != NULL)
+    {
+        port = listener->port;
+    }
+    pthread_mutex_unlock(&listenerLock);
+    return port;
+}
+
+/*
+-- FUNCTION: memoryListen
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int memoryListen(int *socket);
+--
+-- RETURNS: 0
+--
+-- NOTES:
+-- This function does nothing, a socket of the memory transport takes
+-- connections as soon as it is bound.
+*/
+static int memoryListen(int *socket)
+{
+    (void)socket;
+    return 0;
+}
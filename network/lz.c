@@ -0,0 +1,330 @@
+/*
+-- SOURCE FILE: lz.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int lzCompress(const char *source, int length, char *destination,
+--                int capacity);
+-- int lzDecompress(const char *source, int length, char *destination,
+--                  int capacity);
+-- static int putSequence(unsigned char *output, int count, int capacity,
+--                        const unsigned char *literals, int literalLength,
+--                        int offset, int matchLength);
+-- static int putLength(unsigned char *output, int count, int length);
+-- static int takeLength(const unsigned char *input, int *count, int length,
+--                       int *value);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- NOTES:
+-- This file contains the codec of compressed transfers, see compress.c. It
+-- is a byte oriented LZ77 codec that writes the LZ4 block format, chosen
+-- because it decodes with nothing but copies and compresses in a single
+-- greedy pass with a small hash table, fast enough to keep up with a socket.
+--
+-- A block is a run of sequences. A sequence starts with a token byte, the
+-- literal length in the high four bits and the match length less
+-- LZ_MIN_MATCH in the low four. A field of 15 goes on in extra bytes, each
+-- added to it, until one is not 255. The literals follow, then the offset of
+-- the match, two bytes little endian. The last sequence only has literals.
+--
+-- Positions of four byte sequences are kept in a hash table. When the four
+-- bytes at the table's position for the current ones match, the match is
+-- extended both ways and a sequence is written. Otherwise the compressor
+-- moves on, taking bigger steps the longer it goes without a match, so data
+-- that does not compress costs little time.
+*/
+
+#include <string.h>
+
+#include "lz.h"
+
+// Bits of the hash of four bytes, the table has an entry for every value
+#define HASH_BITS	12
+
+// Misses before the compressor starts stepping over more than a byte
+#define SKIP_SHIFT	6
+
+static int putSequence(unsigned char *output, int count, int capacity,
+                       const unsigned char *literals, int literalLength,
+                       int offset, int matchLength);
+static int putLength(unsigned char *output, int count, int length);
+static int takeLength(const unsigned char *input, int *count, int length,
+                      int *value);
+
+/*
+-- FUNCTION: lzCompress
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int lzCompress(const char *source, int length,
+--                           char *destination, int capacity);
+--
+-- RETURNS: the length of the compressed block, 0 if it did not fit
+--
+-- NOTES:
+-- This function compresses length bytes of source into destination, which
+-- holds capacity bytes. A block is at most LZ_MAX_OFFSET + 1 bytes, so every
+-- position in it fits in the 16 bits of a table entry. Callers pass a
+-- capacity below length to be told data does not compress.
+*/
+int lzCompress(const char *source, int length, char *destination,
+               int capacity)
+{
+    const unsigned char *input = (const unsigned char*)source;
+    unsigned char *output = (unsigned char*)destination;
+    unsigned short table[1 << HASH_BITS];
+    unsigned int sequence = 0;
+    unsigned int hash = 0;
+    int candidate = 0;
+    int position = 0;
+    int anchor = 0;
+    int matchEnd = 0;
+    int count = 0;
+    int limit = length - LZ_MATCH_LIMIT;
+
+    if (length > LZ_MAX_OFFSET + 1)
+    {
+        return 0;
+    }
+    memset(table, 0, sizeof(table));
+
+    while (position < limit)
+    {
+        memcpy(&sequence, input + position, sizeof(int));
+        hash = (sequence * 2654435761U) >> (32 - HASH_BITS);
+        candidate = table[hash];
+        table[hash] = (unsigned short)position;
+        if (candidate >= position ||
+            memcmp(input + candidate, &sequence, sizeof(int)) != 0)
+        {
+            position += 1 + ((position - anchor) >> SKIP_SHIFT);
+            continue;
+        }
+
+        // Extend the match forwards, then backwards over the literals
+        matchEnd = position + LZ_MIN_MATCH;
+        while (matchEnd < length - LZ_LAST_LITERALS &&
+            input[matchEnd] == input[candidate + matchEnd - position])
+        {
+            matchEnd++;
+        }
+        while (position > anchor && candidate > 0 &&
+            input[position - 1] == input[candidate - 1])
+        {
+            position--;
+            candidate--;
+        }
+
+        count = putSequence(output, count, capacity, input + anchor,
+            position - anchor, position - candidate, matchEnd - position);
+        if (count == -1)
+        {
+            return 0;
+        }
+        position = matchEnd;
+        anchor = matchEnd;
+    }
+
+    // The rest of the block is literals
+    count = putSequence(output, count, capacity, input + anchor,
+        length - anchor, 0, 0);
+    return count == -1 ? 0 : count;
+}
+
+/*
+-- FUNCTION: lzDecompress
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int lzDecompress(const char *source, int length,
+--                             char *destination, int capacity);
+--
+-- RETURNS: the length of the decompressed block or -1 if it is not valid
+--
+-- NOTES:
+-- This function decompresses the block of length bytes in source into
+-- destination, which holds capacity bytes. The block comes off the network,
+-- so every length and offset is checked before it is used. A match may
+-- overlap the bytes it produces, a run of one byte is an offset of one, so it
+-- is copied a byte at a time.
+*/
+int lzDecompress(const char *source, int length, char *destination,
+                 int capacity)
+{
+    const unsigned char *input = (const unsigned char*)source;
+    unsigned char *output = (unsigned char*)destination;
+    int count = 0;
+    int written = 0;
+    int token = 0;
+    int literalLength = 0;
+    int matchLength = 0;
+    int offset = 0;
+
+    while (count < length)
+    {
+        token = input[count++];
+        literalLength = token >> 4;
+        if (takeLength(input, &count, length, &literalLength) == -1 ||
+            literalLength > length - count ||
+            literalLength > capacity - written)
+        {
+            return -1;
+        }
+        memcpy(output + written, input + count, literalLength);
+        count += literalLength;
+        written += literalLength;
+
+        // Only the last sequence ends after its literals
+        if (count == length)
+        {
+            break;
+        }
+        if (length - count < 2)
+        {
+            return -1;
+        }
+        offset = input[count] | (input[count + 1] << 8);
+        count += 2;
+        matchLength = token & 0x0f;
+        if (offset == 0 || offset > written ||
+            takeLength(input, &count, length, &matchLength) == -1 ||
+            matchLength + LZ_MIN_MATCH > capacity - written)
+        {
+            return -1;
+        }
+        for (matchLength += LZ_MIN_MATCH; matchLength > 0; matchLength--)
+        {
+            output[written] = output[written - offset];
+            written++;
+        }
+    }
+
+    return written;
+}
+
+/*
+-- FUNCTION: putSequence
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int putSequence(unsigned char *output, int count,
+--                                   int capacity,
+--                                   const unsigned char *literals,
+--                                   int literalLength, int offset,
+--                                   int matchLength);
+--
+-- RETURNS: the bytes in output after the sequence or -1 if it did not fit
+--
+-- NOTES:
+-- This function writes a sequence after the count bytes already in output.
+-- A match length of 0 writes the last sequence, which has no match.
+*/
+static int putSequence(unsigned char *output, int count, int capacity,
+                       const unsigned char *literals, int literalLength,
+                       int offset, int matchLength)
+{
+    int token = count;
+
+    // The worst case of the token, both lengths, the literals and the offset
+    if (count + literalLength + literalLength / 255 + matchLength / 255 + 5 >
+        capacity)
+    {
+        return -1;
+    }
+
+    output[token] = (literalLength < 15 ? literalLength : 15) << 4;
+    count = putLength(output, count + 1, literalLength);
+    memcpy(output + count, literals, literalLength);
+    count += literalLength;
+    if (matchLength == 0)
+    {
+        return count;
+    }
+
+    output[count++] = offset & 0xff;
+    output[count++] = offset >> 8;
+    matchLength -= LZ_MIN_MATCH;
+    output[token] |= matchLength < 15 ? matchLength : 15;
+    return putLength(output, count, matchLength);
+}
+
+/*
+-- FUNCTION: putLength
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int putLength(unsigned char *output, int count,
+--                                 int length);
+--
+-- RETURNS: the bytes in output after the extra bytes
+--
+-- NOTES:
+-- This function writes the extra bytes of a length that did not fit in its
+-- four bits of the token. Nothing is written for a length below 15.
+*/
+static int putLength(unsigned char *output, int count, int length)
+{
+    if (length < 15)
+    {
+        return count;
+    }
+
+    for (length -= 15; length >= 255; length -= 255)
+    {
+        output[count++] = 255;
+    }
+    output[count++] = (unsigned char)length;
+    return count;
+}
+
+/*
+-- FUNCTION: takeLength
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int takeLength(const unsigned char *input, int *count,
+--                                  int length, int *value);
+--
+-- RETURNS: 0 on success or -1 if the block ended first
+--
+-- NOTES:
+-- This function adds the extra bytes of a length to value, the four bits of
+-- it from the token, when they are 15. The block is length bytes and count
+-- is moved past the extra bytes.
+*/
+static int takeLength(const unsigned char *input, int *count, int length,
+                      int *value)
+{
+    int extra = 255;
+
+    if (*value < 15)
+    {
+        return 0;
+    }
+
+    while (extra == 255)
+    {
+        if (*count >= length || *value > LZ_MAX_OFFSET + 1)
+        {
+            return -1;
+        }
+        extra = input[(*count)++];
+        *value += extra;
+    }
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef LZ_H
+#define LZ_H
+
+// Shortest match worth a sequence, and bytes at the end that are never matched
+#define LZ_MIN_MATCH		4
+#define LZ_LAST_LITERALS	5
+#define LZ_MATCH_LIMIT		12
+
+// Farthest back a match can be
+#define LZ_MAX_OFFSET		65535
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int lzCompress(const char *source, int length, char *destination,
+               int capacity);
+int lzDecompress(const char *source, int length, char *destination,
+                 int capacity);
+#ifdef __cplusplus
+}
+#endif
+#endif
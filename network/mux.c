@@ -0,0 +1,1290 @@
+/*
+-- SOURCE FILE: mux.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- struct muxSession *muxCreate(int socket, int server, const char *directory,
+--     void (*finished)(struct muxStream *stream, int success));
+-- void muxDestroy(struct muxSession *session);
+-- int muxGet(struct muxSession *session, const char *fileName);
+-- int muxPut(struct muxSession *session, const char *fileName);
+-- int muxRead(struct muxSession *session);
+-- int muxWrite(struct muxSession *session);
+-- int muxWantsWrite(struct muxSession *session);
+-- int muxCheck(struct muxSession *session);
+-- void encodeFrameHeader(char *buffer, unsigned int stream, int type,
+--     unsigned int length);
+-- void decodeFrameHeader(const char *buffer, unsigned int *stream, int *type,
+--     unsigned int *length);
+-- void encodeSize(char *buffer, off_t size);
+-- off_t decodeSize(const char *buffer);
+-- static int handleFrame(struct muxSession *session, unsigned int id,
+--     int type, const char *payload, unsigned int length);
+-- static int receiveData(struct muxSession *session, struct muxStream *stream,
+--     const char *payload, unsigned int length);
+-- static int nextDataFrame(struct muxSession *session);
+-- static struct muxStream *openSending(struct muxSession *session,
+--     unsigned int id, const char *fileName);
+-- static struct muxStream *openReceiving(struct muxSession *session,
+--     unsigned int id, const char *fileName, off_t size);
+-- static struct muxStream *addStream(struct muxSession *session,
+--     unsigned int id, const char *fileName);
+-- static struct muxStream *findStream(struct muxSession *session,
+--     unsigned int id);
+-- static void finishStream(struct muxSession *session,
+--     struct muxStream *stream, int success);
+-- static void removeStream(struct muxSession *session,
+--     struct muxStream *stream);
+-- static int queueFrame(struct muxSession *session, unsigned int stream,
+--     int type, const char *payload, unsigned int length);
+-- static int queueError(struct muxSession *session, unsigned int stream,
+--     const char *message);
+-- static void refuseStream(struct muxSession *session, unsigned int id,
+--     const char *fileName, int sending);
+-- static long long muxClock();
+-- static long long streamClock();
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Times the streams and reports them opening.
+--
+-- NOTES:
+-- This file contains the multiplexed transfer protocol. Instead of a control
+-- connection plus a data connection per file, every command, size and chunk of
+-- file data travels over the one control socket as a frame:
+--
+-- | stream id (4) | type (1) | padding (3) | payload length (4) | payload |
+--
+-- All numbers are in network byte order. The client opens streams with GET
+-- (payload: file name) and PUT (payload: 8 byte size and file name) frames.
+-- The server answers a GET with a SIZE frame. The sending side then sends DATA
+-- frames followed by an END frame, and the receiving side acknowledges with an
+-- END frame once the file is on disk. ERROR frames abort a single stream.
+--
+-- Each stream has its own window of MUX_WINDOW bytes. The sender never has
+-- more than the window in flight and the receiver hands the window back with
+-- WINDOW frames as it writes the data to disk. Streams that may send take
+-- turns one DATA frame at a time, so many transfers progress side by side.
+--
+-- A session lasts for as many transfers as the client wants. Either side
+-- sends a PING frame, answered with a PONG, once it has heard nothing for
+-- MUX_KEEPALIVE, and gives the other side up after MUX_DEAD_TIME of silence.
+-- A session with no streams open for its idle timeout is closed. The owner of
+-- the session calls muxCheck at least every MUX_CHECK_INTERVAL for both.
+--
+-- The owner may set an opened function on the session, which is called when
+-- a stream that was asked for opens, as the finished function is when it
+-- ends. A GET or PUT the server can not open is reported as a stream that
+-- opened and failed at once, so every stream asked for is reported.
+--
+-- Both the client and the server use this file. The socket must be non
+-- blocking; muxRead and muxWrite are called whenever it is readable or
+-- writable, from a poll loop or from the epoll reactor.
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "mux.h"
+#include "network.h"
+
+#define MUX_QUEUE_SIZE 4096
+
+static int handleFrame(struct muxSession *session, unsigned int id,
+    int type, const char *payload, unsigned int length);
+static int receiveData(struct muxSession *session, struct muxStream *stream,
+    const char *payload, unsigned int length);
+static int nextDataFrame(struct muxSession *session);
+static struct muxStream *openSending(struct muxSession *session,
+    unsigned int id, const char *fileName);
+static struct muxStream *openReceiving(struct muxSession *session,
+    unsigned int id, const char *fileName, off_t size);
+static struct muxStream *addStream(struct muxSession *session,
+    unsigned int id, const char *fileName);
+static struct muxStream *findStream(struct muxSession *session,
+    unsigned int id);
+static void finishStream(struct muxSession *session,
+    struct muxStream *stream, int success);
+static void removeStream(struct muxSession *session,
+    struct muxStream *stream);
+static int queueFrame(struct muxSession *session, unsigned int stream,
+    int type, const char *payload, unsigned int length);
+static int queueError(struct muxSession *session, unsigned int stream,
+    const char *message);
+static void refuseStream(struct muxSession *session, unsigned int id,
+    const char *fileName, int sending);
+static long long muxClock();
+static long long streamClock();
+
+/*
+-- FUNCTION: muxCreate
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Sets the idle timeout, starts the clocks and
+-- turns off Nagle's algorithm.
+--
+-- INTERFACE: struct muxSession *muxCreate(int socket, int server,
+--                const char *directory,
+--                void (*finished)(struct muxStream *stream, int success));
+--
+-- RETURNS: the new session or NULL if it could not be allocated
+--
+-- NOTES:
+-- This function creates a session on a connected non blocking socket. The
+-- server accepts GET and PUT frames, the client opens streams with muxGet and
+-- muxPut. Received files are stored in directory. The finished function, if
+-- any, is called whenever a stream completes or fails.
+*/
+struct muxSession *muxCreate(int socket, int server, const char *directory,
+    void (*finished)(struct muxStream *stream, int success))
+{
+    struct muxSession *session = NULL;
+
+    if ((session = (struct muxSession*)calloc(1,
+        sizeof(struct muxSession))) == NULL)
+    {
+        return NULL;
+    }
+
+    session->socket = socket;
+    session->server = server;
+    session->directory = directory;
+    session->finished = finished;
+    session->nextStream = 1;
+    session->lastHeard = session->lastActive = muxClock();
+    session->idleTimeout = MUX_IDLE_TIMEOUT;
+
+    // Frames are small and each one waits on the one before, do not hold
+    // them back
+    setNoDelay(&session->socket);
+    session->currentSize = MUX_QUEUE_SIZE;
+    session->controlSize = MUX_QUEUE_SIZE;
+    session->in = (char*)malloc(FRAME_HEADER_LENGTH + MUX_MAX_PAYLOAD);
+    session->current = (char*)malloc(session->currentSize);
+    session->control = (char*)malloc(session->controlSize);
+
+    if (session->in == NULL || session->current == NULL ||
+        session->control == NULL)
+    {
+        muxDestroy(session);
+        return NULL;
+    }
+
+    return session;
+}
+
+/*
+-- FUNCTION: muxDestroy
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Removes streams that already finished instead
+-- of looping on them.
+--
+-- INTERFACE: void muxDestroy(struct muxSession *session);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function fails every stream that is still open and frees the session.
+-- The socket belongs to the caller and is left open.
+*/
+void muxDestroy(struct muxSession *session)
+{
+    session->pending = NULL;
+    while (session->streams != NULL)
+    {
+        // A stream that already finished was only waiting on its frame
+        if (session->streams->closed)
+        {
+            removeStream(session, session->streams);
+        }
+        else
+        {
+            finishStream(session, session->streams, 0);
+        }
+    }
+
+    free(session->in);
+    free(session->current);
+    free(session->control);
+    free(session);
+}
+
+/*
+-- FUNCTION: muxGet
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int muxGet(struct muxSession *session, const char *fileName);
+--
+-- RETURNS: the id of the new stream or -1 on failure
+--
+-- NOTES:
+-- This function opens a stream that retrieves a file from the server. The
+-- size of the file is filled in when the SIZE frame arrives.
+*/
+int muxGet(struct muxSession *session, const char *fileName)
+{
+    struct muxStream *stream = NULL;
+    unsigned int id = session->nextStream++;
+
+    if (strlen(fileName) > MAX_NAME_LENGTH ||
+        (stream = openReceiving(session, id, fileName, -1)) == NULL)
+    {
+        return -1;
+    }
+
+    if (queueFrame(session, id, FRAME_GET, fileName, strlen(fileName)) == -1)
+    {
+        finishStream(session, stream, 0);
+        return -1;
+    }
+
+    return (int)id;
+}
+
+/*
+-- FUNCTION: muxPut
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int muxPut(struct muxSession *session, const char *fileName);
+--
+-- RETURNS: the id of the new stream or -1 on failure
+--
+-- NOTES:
+-- This function opens a stream that sends a file to the server. The data
+-- frames follow the PUT frame right away, there is no round trip.
+*/
+int muxPut(struct muxSession *session, const char *fileName)
+{
+    struct muxStream *stream = NULL;
+    unsigned int id = session->nextStream++;
+    char payload[sizeof(off_t) + MAX_NAME_LENGTH];
+    int length = strlen(fileName);
+
+    if (length > MAX_NAME_LENGTH ||
+        (stream = openSending(session, id, fileName)) == NULL)
+    {
+        return -1;
+    }
+
+    encodeSize(payload, stream->size);
+    memcpy(payload + sizeof(off_t), fileName, length);
+    if (queueFrame(session, id, FRAME_PUT, payload,
+        sizeof(off_t) + length) == -1)
+    {
+        finishStream(session, stream, 0);
+        return -1;
+    }
+
+    return (int)id;
+}
+
+/*
+-- FUNCTION: muxRead
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Notes when the other side was last heard.
+--
+-- INTERFACE: int muxRead(struct muxSession *session);
+--
+-- RETURNS: 0 on success, -1 if the connection was closed or is broken
+--
+-- NOTES:
+-- This function reads what is available on the socket and handles every
+-- complete frame. A partial frame stays in the input buffer until the rest of
+-- it arrives.
+*/
+int muxRead(struct muxSession *session)
+{
+    int bytesRead = 0;
+    int used = 0;
+    unsigned int id = 0;
+    unsigned int length = 0;
+    int type = 0;
+
+    bytesRead = readData(&session->socket, session->in + session->inCount,
+        FRAME_HEADER_LENGTH + MUX_MAX_PAYLOAD - session->inCount);
+    if (bytesRead == 0)
+    {
+        return -1;
+    }
+    if (bytesRead == -1)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    session->inCount += bytesRead;
+    session->lastHeard = muxClock();
+    session->pinged = 0;
+
+    while (session->inCount - used >= FRAME_HEADER_LENGTH)
+    {
+        decodeFrameHeader(session->in + used, &id, &type, &length);
+        if (length > MUX_MAX_PAYLOAD)
+        {
+            return -1;
+        }
+        if (session->inCount - used < (int)(FRAME_HEADER_LENGTH + length))
+        {
+            break;
+        }
+
+        if (handleFrame(session, id, type,
+            session->in + used + FRAME_HEADER_LENGTH, length) == -1)
+        {
+            return -1;
+        }
+        used += FRAME_HEADER_LENGTH + length;
+    }
+
+    // Keep the partial frame at the start of the buffer
+    memmove(session->in, session->in + used, session->inCount - used);
+    session->inCount -= used;
+
+    return 0;
+}
+
+/*
+-- FUNCTION: muxWrite
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Sends a DATA frame header with its payload.
+--
+-- INTERFACE: int muxWrite(struct muxSession *session);
+--
+-- RETURNS: 0 on success, -1 if the connection is broken
+--
+-- NOTES:
+-- This function sends until the socket is full, there is nothing left to
+-- send, or MUX_WRITE_BUDGET bytes were sent. The frame in flight is finished
+-- first, its payload going out with sendfile straight from the file. Queued
+-- control frames go next, and only then is the next DATA frame started.
+*/
+int muxWrite(struct muxSession *session)
+{
+    long budget = MUX_WRITE_BUDGET;
+    ssize_t bytesSent = 0;
+    char *swap = NULL;
+    int swapSize = 0;
+
+    while (budget > 0)
+    {
+        if (session->currentSent < session->currentCount)
+        {
+            // A DATA frame header goes out in the same packet as its payload
+            bytesSent = session->pendingBytes > 0 ?
+                sendMore(&session->socket,
+                session->current + session->currentSent,
+                session->currentCount - session->currentSent) :
+                sendData(&session->socket,
+                session->current + session->currentSent,
+                session->currentCount - session->currentSent);
+            if (bytesSent == -1)
+            {
+                return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+            }
+            session->currentSent += bytesSent;
+            budget -= bytesSent;
+            continue;
+        }
+
+        if (session->pendingBytes > 0)
+        {
+            bytesSent = sendfile(session->socket, session->pending->file,
+                &session->pending->offset, session->pendingBytes);
+            if (bytesSent == -1)
+            {
+                return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+            }
+            if (bytesSent == 0)
+            {
+                // The file shrunk under a frame we already announced
+                return -1;
+            }
+            session->pendingBytes -= bytesSent;
+            budget -= bytesSent;
+            continue;
+        }
+
+        // The frame in flight is done
+        if (session->pending != NULL && session->pending->closed)
+        {
+            removeStream(session, session->pending);
+        }
+        session->pending = NULL;
+        session->currentCount = 0;
+        session->currentSent = 0;
+
+        if (session->controlCount > 0)
+        {
+            swap = session->current;
+            swapSize = session->currentSize;
+            session->current = session->control;
+            session->currentSize = session->controlSize;
+            session->currentCount = session->controlCount;
+            session->control = swap;
+            session->controlSize = swapSize;
+            session->controlCount = 0;
+            continue;
+        }
+
+        if (nextDataFrame(session) == 0)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: muxWantsWrite
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int muxWantsWrite(struct muxSession *session);
+--
+-- RETURNS: 1 if the session has something to send, 0 otherwise
+--
+-- NOTES:
+-- This function is used to decide whether to wait for the socket to become
+-- writable. A stream that has used up its window does not count.
+*/
+int muxWantsWrite(struct muxSession *session)
+{
+    struct muxStream *stream = NULL;
+
+    if (session->currentSent < session->currentCount ||
+        session->pendingBytes > 0 || session->controlCount > 0)
+    {
+        return 1;
+    }
+
+    for (stream = session->streams; stream != NULL; stream = stream->next)
+    {
+        if (stream->sending && !stream->ended && !stream->closed &&
+            (stream->offset == stream->size || stream->window > 0))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: muxCheck
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int muxCheck(struct muxSession *session);
+--
+-- RETURNS: MUX_ALIVE while the session goes on, MUX_IDLE if it had no streams
+--          for its idle timeout and MUX_DEAD if the other side is gone
+--
+-- NOTES:
+-- This function runs the keep alive and the idle timeout. It queues a PING
+-- frame once the other side has been silent for MUX_KEEPALIVE, so the caller
+-- must check muxWantsWrite again afterwards. An idle timeout of 0 keeps an
+-- idle session open for good.
+*/
+int muxCheck(struct muxSession *session)
+{
+    long long now = muxClock();
+
+    if (now - session->lastHeard >= MUX_DEAD_TIME)
+    {
+        return MUX_DEAD;
+    }
+    if (session->active == 0 && session->idleTimeout > 0 &&
+        now - session->lastActive >= session->idleTimeout)
+    {
+        return MUX_IDLE;
+    }
+    if (now - session->lastHeard >= MUX_KEEPALIVE && !session->pinged)
+    {
+        session->pinged = 1;
+        if (queueFrame(session, 0, FRAME_PING, NULL, 0) == -1)
+        {
+            return MUX_DEAD;
+        }
+    }
+
+    return MUX_ALIVE;
+}
+
+/*
+-- FUNCTION: encodeFrameHeader
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void encodeFrameHeader(char *buffer, unsigned int stream,
+--                                   int type, unsigned int length);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function writes a frame header into the first FRAME_HEADER_LENGTH
+-- bytes of the buffer.
+*/
+void encodeFrameHeader(char *buffer, unsigned int stream, int type,
+    unsigned int length)
+{
+    unsigned int value = 0;
+
+    value = htonl(stream);
+    memcpy(buffer, &value, 4);
+    buffer[4] = (char)type;
+    buffer[5] = buffer[6] = buffer[7] = 0;
+    value = htonl(length);
+    memcpy(buffer + 8, &value, 4);
+}
+
+/*
+-- FUNCTION: decodeFrameHeader
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void decodeFrameHeader(const char *buffer, unsigned int *stream,
+--                                   int *type, unsigned int *length);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function reads a frame header from the buffer.
+*/
+void decodeFrameHeader(const char *buffer, unsigned int *stream, int *type,
+    unsigned int *length)
+{
+    unsigned int value = 0;
+
+    memcpy(&value, buffer, 4);
+    *stream = ntohl(value);
+    *type = (int)(unsigned char)buffer[4];
+    memcpy(&value, buffer + 8, 4);
+    *length = ntohl(value);
+}
+
+/*
+-- FUNCTION: encodeSize
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void encodeSize(char *buffer, off_t size);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function writes a file size as 8 bytes in network byte order.
+*/
+void encodeSize(char *buffer, off_t size)
+{
+    unsigned int value = 0;
+
+    value = htonl((unsigned int)((unsigned long long)size >> 32));
+    memcpy(buffer, &value, 4);
+    value = htonl((unsigned int)(size & 0xFFFFFFFF));
+    memcpy(buffer + 4, &value, 4);
+}
+
+/*
+-- FUNCTION: decodeSize
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: off_t decodeSize(const char *buffer);
+--
+-- RETURNS: the file size
+--
+-- NOTES:
+-- This function reads a file size written by encodeSize.
+*/
+off_t decodeSize(const char *buffer)
+{
+    unsigned int high = 0;
+    unsigned int low = 0;
+
+    memcpy(&high, buffer, 4);
+    memcpy(&low, buffer + 4, 4);
+
+    return (off_t)(((unsigned long long)ntohl(high) << 32) | ntohl(low));
+}
+
+/*
+-- FUNCTION: handleFrame
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Answers PING frames.
+-- October 17, 2026 - Reports the streams it can not open.
+--
+-- INTERFACE: static int handleFrame(struct muxSession *session,
+--                unsigned int id, int type, const char *payload,
+--                unsigned int length);
+--
+-- RETURNS: 0 on success, -1 on a protocol error that ends the session
+--
+-- NOTES:
+-- This function handles one complete frame. Frames for streams that no longer
+-- exist are dropped, since the other side may still have had them in flight
+-- when the stream failed.
+*/
+static int handleFrame(struct muxSession *session, unsigned int id,
+    int type, const char *payload, unsigned int length)
+{
+    struct muxStream *stream = findStream(session, id);
+    char fileName[MAX_NAME_LENGTH + 1];
+    unsigned int window = 0;
+
+    switch (type)
+    {
+    case FRAME_GET:
+        if (!session->server || stream != NULL || length > MAX_NAME_LENGTH)
+        {
+            return -1;
+        }
+        memcpy(fileName, payload, length);
+        fileName[length] = '\0';
+        if ((stream = openSending(session, id, fileName)) == NULL)
+        {
+            refuseStream(session, id, fileName, 1);
+            return queueError(session, id, strerror(errno));
+        }
+        encodeSize(fileName, stream->size);
+        return queueFrame(session, id, FRAME_SIZE, fileName, sizeof(off_t));
+    case FRAME_PUT:
+        if (!session->server || stream != NULL || length < sizeof(off_t) ||
+            length - sizeof(off_t) > MAX_NAME_LENGTH)
+        {
+            return -1;
+        }
+        memcpy(fileName, payload + sizeof(off_t), length - sizeof(off_t));
+        fileName[length - sizeof(off_t)] = '\0';
+        if (openReceiving(session, id, fileName, decodeSize(payload)) == NULL)
+        {
+            refuseStream(session, id, fileName, 0);
+            return queueError(session, id, strerror(errno));
+        }
+        return 0;
+    case FRAME_SIZE:
+        if (stream != NULL && !stream->sending && length == sizeof(off_t))
+        {
+            stream->size = decodeSize(payload);
+        }
+        return 0;
+    case FRAME_DATA:
+        if (stream != NULL && !stream->sending && !stream->closed)
+        {
+            return receiveData(session, stream, payload, length);
+        }
+        return 0;
+    case FRAME_END:
+        if (stream == NULL || stream->closed)
+        {
+            return 0;
+        }
+        if (stream->sending)
+        {
+            // The receiver has the whole file
+            finishStream(session, stream, 1);
+            return 0;
+        }
+        if (stream->offset != stream->size)
+        {
+            finishStream(session, stream, 0);
+            return queueError(session, id, "Short transfer");
+        }
+        finishStream(session, stream, 1);
+        return queueFrame(session, id, FRAME_END, NULL, 0);
+    case FRAME_WINDOW:
+        if (stream != NULL && stream->sending && length == 4)
+        {
+            memcpy(&window, payload, 4);
+            stream->window += ntohl(window);
+        }
+        return 0;
+    case FRAME_ERROR:
+        if (stream != NULL && !stream->closed)
+        {
+            fprintf(stderr, "%s: %.*s\n", stream->name, (int)length, payload);
+            finishStream(session, stream, 0);
+        }
+        return 0;
+    case FRAME_PING:
+        return queueFrame(session, id, FRAME_PONG, NULL, 0);
+    case FRAME_PONG:
+        return 0;
+    }
+
+    return -1;
+}
+
+/*
+-- FUNCTION: receiveData
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Notes when the first data arrives.
+--
+-- INTERFACE: static int receiveData(struct muxSession *session,
+--                struct muxStream *stream, const char *payload,
+--                unsigned int length);
+--
+-- RETURNS: 0 on success, -1 if a frame could not be queued
+--
+-- NOTES:
+-- This function writes the payload of a DATA frame to the file of the stream.
+-- Once half of the window has been written it is handed back to the sender.
+*/
+static int receiveData(struct muxSession *session, struct muxStream *stream,
+    const char *payload, unsigned int length)
+{
+    unsigned int window = 0;
+
+    if (stream->size < 0 || stream->offset + length > stream->size)
+    {
+        finishStream(session, stream, 0);
+        return queueError(session, stream->id, "Too much data");
+    }
+
+    if (write(stream->file, payload, length) != (ssize_t)length)
+    {
+        finishStream(session, stream, 0);
+        return queueError(session, stream->id, "Unable To Write File");
+    }
+    if (stream->firstByte == 0)
+    {
+        stream->firstByte = streamClock();
+    }
+    stream->offset += length;
+    stream->consumed += length;
+
+    if (stream->consumed >= MUX_WINDOW / 2)
+    {
+        window = htonl((unsigned int)stream->consumed);
+        stream->consumed = 0;
+        return queueFrame(session, stream->id, FRAME_WINDOW,
+            (const char*)&window, 4);
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: nextDataFrame
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Notes when the first data goes out.
+--
+-- INTERFACE: static int nextDataFrame(struct muxSession *session);
+--
+-- RETURNS: 1 if a frame was started, 0 if there is nothing to send
+--
+-- NOTES:
+-- This function picks the next sending stream in round robin order. A stream
+-- with data and window left gets a DATA frame header in the current buffer and
+-- becomes the pending stream whose payload muxWrite sends with sendfile. A
+-- stream with all of its data sent gets its END frame queued instead.
+*/
+static int nextDataFrame(struct muxSession *session)
+{
+    struct muxStream *stream = NULL;
+    off_t length = 0;
+    int checked = 0;
+
+    if (session->cursor == NULL)
+    {
+        session->cursor = session->streams;
+    }
+
+    for (stream = session->cursor; checked < session->active;
+        stream = stream->next == NULL ? session->streams : stream->next)
+    {
+        checked++;
+        if (!stream->sending || stream->ended || stream->closed)
+        {
+            continue;
+        }
+        if (stream->firstByte == 0)
+        {
+            stream->firstByte = streamClock();
+        }
+
+        if (stream->offset == stream->size)
+        {
+            stream->ended = 1;
+            session->cursor = stream->next;
+            return queueFrame(session, stream->id, FRAME_END, NULL, 0) == 0;
+        }
+        if (stream->window <= 0)
+        {
+            continue;
+        }
+
+        length = stream->size - stream->offset;
+        if (length > MUX_MAX_PAYLOAD)
+        {
+            length = MUX_MAX_PAYLOAD;
+        }
+        if (length > stream->window)
+        {
+            length = stream->window;
+        }
+        stream->window -= length;
+
+        encodeFrameHeader(session->current, stream->id, FRAME_DATA,
+            (unsigned int)length);
+        session->currentCount = FRAME_HEADER_LENGTH;
+        session->currentSent = 0;
+        session->pending = stream;
+        session->pendingBytes = length;
+        session->cursor = stream->next;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: openSending
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Reports the stream opening.
+--
+-- INTERFACE: static struct muxStream *openSending(struct muxSession *session,
+--                unsigned int id, const char *fileName);
+--
+-- RETURNS: the new stream or NULL on failure with errno set
+--
+-- NOTES:
+-- This function opens a file for reading and adds a stream that sends it.
+*/
+static struct muxStream *openSending(struct muxSession *session,
+    unsigned int id, const char *fileName)
+{
+    struct muxStream *stream = NULL;
+    struct stat statBuffer;
+    int file = 0;
+
+    if ((file = open(fileName, O_RDONLY)) == -1)
+    {
+        return NULL;
+    }
+    if (fstat(file, &statBuffer) == -1 ||
+        (stream = addStream(session, id, fileName)) == NULL)
+    {
+        close(file);
+        return NULL;
+    }
+
+    stream->sending = 1;
+    stream->file = file;
+    stream->size = statBuffer.st_size;
+    stream->window = MUX_WINDOW;
+    if (session->opened != NULL)
+    {
+        session->opened(stream);
+    }
+
+    return stream;
+}
+
+/*
+-- FUNCTION: openReceiving
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Reports the stream opening.
+--
+-- INTERFACE: static struct muxStream *openReceiving(
+--                struct muxSession *session, unsigned int id,
+--                const char *fileName, off_t size);
+--
+-- RETURNS: the new stream or NULL on failure with errno set
+--
+-- NOTES:
+-- This function creates the file in the directory of the session and adds a
+-- stream that receives it. A size of -1 means it is not known yet.
+*/
+static struct muxStream *openReceiving(struct muxSession *session,
+    unsigned int id, const char *fileName, off_t size)
+{
+    struct muxStream *stream = NULL;
+    char fileNamePath[FILENAME_MAX];
+    int file = 0;
+
+    sprintf(fileNamePath, "%s%s", session->directory, fileName);
+    if ((file = open(fileNamePath, O_WRONLY | O_CREAT | O_TRUNC,
+        00400 | 00200 | 00100)) == -1)
+    {
+        return NULL;
+    }
+    if ((stream = addStream(session, id, fileName)) == NULL)
+    {
+        close(file);
+        return NULL;
+    }
+
+    stream->file = file;
+    stream->size = size;
+    if (session->opened != NULL)
+    {
+        session->opened(stream);
+    }
+
+    return stream;
+}
+
+/*
+-- FUNCTION: addStream
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Notes the time for the idle timeout.
+-- October 17, 2026 - Notes when the stream opened.
+--
+-- INTERFACE: static struct muxStream *addStream(struct muxSession *session,
+--                unsigned int id, const char *fileName);
+--
+-- RETURNS: the new stream or NULL on failure with errno set
+--
+-- NOTES:
+-- This function allocates a stream and adds it to the session. A session can
+-- have at most MUX_MAX_STREAMS streams open.
+*/
+static struct muxStream *addStream(struct muxSession *session,
+    unsigned int id, const char *fileName)
+{
+    struct muxStream *stream = NULL;
+
+    if (session->active >= MUX_MAX_STREAMS)
+    {
+        errno = EMFILE;
+        return NULL;
+    }
+    if ((stream = (struct muxStream*)calloc(1,
+        sizeof(struct muxStream))) == NULL)
+    {
+        return NULL;
+    }
+
+    stream->id = id;
+    stream->file = -1;
+    stream->opened = streamClock();
+    strcpy(stream->name, fileName);
+    stream->next = session->streams;
+    session->streams = stream;
+    session->active++;
+    session->lastActive = muxClock();
+
+    return stream;
+}
+
+/*
+-- FUNCTION: findStream
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static struct muxStream *findStream(struct muxSession *session,
+--                unsigned int id);
+--
+-- RETURNS: the stream with the id or NULL if there is none
+--
+-- NOTES:
+-- This function looks up an open stream.
+*/
+static struct muxStream *findStream(struct muxSession *session,
+    unsigned int id)
+{
+    struct muxStream *stream = NULL;
+
+    for (stream = session->streams; stream != NULL; stream = stream->next)
+    {
+        if (stream->id == id && !stream->closed)
+        {
+            return stream;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+-- FUNCTION: finishStream
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void finishStream(struct muxSession *session,
+--                struct muxStream *stream, int success);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function closes the file of a stream, reports the result and removes
+-- the stream. A file that failed to arrive is deleted. A stream whose DATA
+-- frame is still in flight is only marked as closed and removed by muxWrite
+-- once the frame is sent.
+*/
+static void finishStream(struct muxSession *session,
+    struct muxStream *stream, int success)
+{
+    char fileNamePath[FILENAME_MAX];
+
+    if (stream->closed)
+    {
+        return;
+    }
+    stream->closed = 1;
+
+    if (!success)
+    {
+        session->failures++;
+        if (!stream->sending)
+        {
+            sprintf(fileNamePath, "%s%s", session->directory, stream->name);
+            unlink(fileNamePath);
+        }
+    }
+    if (session->finished != NULL)
+    {
+        session->finished(stream, success);
+    }
+
+    if (stream != session->pending)
+    {
+        removeStream(session, stream);
+    }
+}
+
+/*
+-- FUNCTION: removeStream
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Notes the time for the idle timeout.
+--
+-- INTERFACE: static void removeStream(struct muxSession *session,
+--                struct muxStream *stream);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function unlinks a stream from the session and frees it.
+*/
+static void removeStream(struct muxSession *session,
+    struct muxStream *stream)
+{
+    struct muxStream **link = &session->streams;
+
+    while (*link != NULL && *link != stream)
+    {
+        link = &(*link)->next;
+    }
+    if (*link == NULL)
+    {
+        return;
+    }
+
+    *link = stream->next;
+    if (session->cursor == stream)
+    {
+        session->cursor = stream->next;
+    }
+    if (stream->file != -1)
+    {
+        close(stream->file);
+    }
+    session->active--;
+    session->lastActive = muxClock();
+    free(stream);
+}
+
+/*
+-- FUNCTION: queueFrame
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int queueFrame(struct muxSession *session,
+--                unsigned int stream, int type, const char *payload,
+--                unsigned int length);
+--
+-- RETURNS: 0 on success, -1 if the queue could not grow
+--
+-- NOTES:
+-- This function appends a frame to the control queue. The queue grows as
+-- needed and is sent between DATA frames.
+*/
+static int queueFrame(struct muxSession *session, unsigned int stream,
+    int type, const char *payload, unsigned int length)
+{
+    char *control = NULL;
+    int size = session->controlSize;
+
+    while (session->controlCount + FRAME_HEADER_LENGTH + (int)length > size)
+    {
+        size *= 2;
+    }
+    if (size != session->controlSize)
+    {
+        if ((control = (char*)realloc(session->control, size)) == NULL)
+        {
+            return -1;
+        }
+        session->control = control;
+        session->controlSize = size;
+    }
+
+    encodeFrameHeader(session->control + session->controlCount, stream, type,
+        length);
+    if (length > 0)
+    {
+        memcpy(session->control + session->controlCount + FRAME_HEADER_LENGTH,
+            payload, length);
+    }
+    session->controlCount += FRAME_HEADER_LENGTH + length;
+
+    return 0;
+}
+
+/*
+-- FUNCTION: queueError
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int queueError(struct muxSession *session,
+--                unsigned int stream, const char *message);
+--
+-- RETURNS: 0 on success, -1 if the frame could not be queued
+--
+-- NOTES:
+-- This function queues an ERROR frame that aborts a stream on the other side.
+*/
+static int queueError(struct muxSession *session, unsigned int stream,
+    const char *message)
+{
+    return queueFrame(session, stream, FRAME_ERROR, message, strlen(message));
+}
+
+/*
+-- FUNCTION: refuseStream
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void refuseStream(struct muxSession *session,
+--                unsigned int id, const char *fileName, int sending);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function reports a stream the server could not open, as opened and
+-- then failed, without adding it to the session.
+*/
+static void refuseStream(struct muxSession *session, unsigned int id,
+    const char *fileName, int sending)
+{
+    struct muxStream stream;
+
+    memset(&stream, 0, sizeof(struct muxStream));
+    stream.id = id;
+    stream.sending = sending;
+    stream.file = -1;
+    stream.closed = 1;
+    stream.opened = streamClock();
+    strcpy(stream.name, fileName);
+
+    if (session->opened != NULL)
+    {
+        session->opened(&stream);
+    }
+    if (session->finished != NULL)
+    {
+        session->finished(&stream, 0);
+    }
+}
+
+/*
+-- FUNCTION: muxClock
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static long long muxClock();
+--
+-- RETURNS: the monotonic time in milliseconds
+--
+-- NOTES:
+-- This function is used to time the keep alive and the idle timeout.
+*/
+static long long muxClock()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/*
+-- FUNCTION: streamClock
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static long long streamClock();
+--
+-- RETURNS: the monotonic time in microseconds
+--
+-- NOTES:
+-- This function is used to time the streams, finer than muxClock so the
+-- owner can time small transfers.
+*/
+static long long streamClock()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
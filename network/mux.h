@@ -0,0 +1,109 @@
+#ifndef MUX_H
+#define MUX_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+// Frame layout: stream id (4), type (1), padding (3), payload length (4)
+#define FRAME_HEADER_LENGTH	12
+#define MUX_MAX_PAYLOAD		65536
+#define MUX_WINDOW			262144
+#define MUX_MAX_STREAMS		256
+#define MUX_WRITE_BUDGET	262144
+
+// Frame types
+#define FRAME_GET		1
+#define FRAME_PUT		2
+#define FRAME_SIZE		3
+#define FRAME_DATA		4
+#define FRAME_END		5
+#define FRAME_WINDOW	6
+#define FRAME_ERROR		7
+#define FRAME_PING		8
+#define FRAME_PONG		9
+
+// Milliseconds. A session that heard nothing from the other side for
+// MUX_KEEPALIVE pings it and gives it up after MUX_DEAD_TIME. A session with
+// no streams for its idle timeout is closed, MUX_IDLE_TIMEOUT by default.
+#define MUX_KEEPALIVE		15000
+#define MUX_DEAD_TIME		45000
+#define MUX_IDLE_TIMEOUT	300000
+#define MUX_CHECK_INTERVAL	1000
+
+// Results of muxCheck
+#define MUX_ALIVE	0
+#define MUX_IDLE	1
+#define MUX_DEAD	-1
+
+// The open and first byte times are microseconds of CLOCK_MONOTONIC, the
+// first byte time is 0 until data of the stream moves
+struct muxStream
+{
+    unsigned int id;
+    int sending;
+    int file;
+    int ended;
+    int closed;
+    off_t size;
+    off_t offset;
+    long window;
+    long consumed;
+    long long opened;
+    long long firstByte;
+    char name[FILENAME_MAX];
+    struct muxStream *next;
+};
+
+struct muxSession
+{
+    int socket;
+    int server;
+    const char *directory;
+    void (*opened)(struct muxStream *stream);
+    void (*finished)(struct muxStream *stream, int success);
+    char *in;
+    int inCount;
+    char *current;
+    int currentCount;
+    int currentSent;
+    int currentSize;
+    char *control;
+    int controlCount;
+    int controlSize;
+    struct muxStream *streams;
+    struct muxStream *cursor;
+    struct muxStream *pending;
+    off_t pendingBytes;
+    unsigned int nextStream;
+    int active;
+    int failures;
+    long long lastHeard;
+    long long lastActive;
+    long long idleTimeout;
+    int pinged;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+struct muxSession *muxCreate(int socket, int server, const char *directory,
+    void (*finished)(struct muxStream *stream, int success));
+void muxDestroy(struct muxSession *session);
+int muxGet(struct muxSession *session, const char *fileName);
+int muxPut(struct muxSession *session, const char *fileName);
+int muxRead(struct muxSession *session);
+int muxWrite(struct muxSession *session);
+int muxWantsWrite(struct muxSession *session);
+int muxCheck(struct muxSession *session);
+void encodeFrameHeader(char *buffer, unsigned int stream, int type,
+    unsigned int length);
+void decodeFrameHeader(const char *buffer, unsigned int *stream, int *type,
+    unsigned int *length);
+void encodeSize(char *buffer, off_t size);
+off_t decodeSize(const char *buffer);
+#ifdef __cplusplus
+}
+#endif
+#endif
+
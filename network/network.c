@@ -6,16 +6,39 @@
 -- FUNCTIONS:
 -- int tcpSocket();
 -- int setReuse(int* socket);
+-- int setReusePort(int *socket);
+-- int setNoDelay(int *socket);
 -- int bindAddress(int *port, int *socket);
 -- int setListen(int *socket);
 -- int acceptConnection(int *listenSocket);
 -- int readData(int *socket, char *buffer, int bytesToRead);
 -- int sendData(int *socket, char *buffer, int bytesToSend);
+-- int sendMore(int *socket, const char *buffer, int bytesToSend);
+-- int readAll(int *socket, char *buffer, int bytesToRead);
+-- int sendAll(int *socket, const char *buffer, int bytesToSend);
 -- int closeSocket(int *socket);
+-- int connectToServer(int *port, int *socket, const char *ip);
+-- int connectToIp(int *port, int *socket, const char *ip);
+-- int makeSocketNonBlocking(int *socket);
+-- int getSocketPort(int *socket);
+-- int getPeerIp(int *socket, char *ip);
+-- const struct transport *findTransport(const char *name);
+-- void setTransport(const struct transport *next);
+-- const struct transport *getTransport();
+-- static int tcpOpen();
+-- static int tcpBind(int *port, int *socket);
+-- static int tcpListen(int *socket);
+-- static int tcpAccept(int *listenSocket, char *ip, unsigned short *port);
+-- static int tcpConnect(int *port, int *socket, const char *host,
+--                       int lookup);
+-- static int tcpLocalPort(int *socket);
+-- static int tcpPeerIp(int *socket, char *ip);
 --
 -- DATE: March 12, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - readAll and sendAll.
+-- October 17, 2026 - The addressing goes through a transport.
+-- October 17, 2026 - setNoDelay and sendMore.
 --
 -- DESIGNER: Luke Queenan
 --
@@ -26,28 +49,56 @@
 -- programs.The file contains all network related header files, meaning that the
 -- user of this library does not need to include anything except the network.h
 -- header file.
+--
+-- Everything that deals with addresses, creating, binding, accepting and
+-- connecting sockets and finding their ports and peers, goes through the
+-- transport set with setTransport, TCP unless another is set. The transports
+-- of local.c move the same protocol over Unix domain sockets or a pipe
+-- inside the process. Every transport hands out stream socket descriptors,
+-- so reading and writing them, splice, sendfile, epoll and io_uring work on
+-- all of them alike.
 */
 
 // Includes
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <string.h>
 
 #include "network.h"
 
-#define MAX_QUEUE 10
+// Connections waiting to be accepted, a burst of clients beyond this loses
+// the commands of the ones that did not fit
+#define MAX_QUEUE SOMAXCONN
+
+static int tcpOpen();
+static int tcpBind(int *port, int *socket);
+static int tcpListen(int *socket);
+static int tcpAccept(int *listenSocket, char *ip, unsigned short *port);
+static int tcpConnect(int *port, int *socket, const char *host, int lookup);
+static int tcpLocalPort(int *socket);
+static int tcpPeerIp(int *socket, char *ip);
+
+const struct transport tcpTransport = {
+    "tcp", TRANSPORT_INET | TRANSPORT_REUSE_PORT, tcpOpen, tcpBind, tcpListen,
+    tcpAccept, tcpConnect, tcpLocalPort, tcpPeerIp
+};
+
+// The transport every socket of the process is made and addressed with
+static const struct transport *transport = &tcpTransport;
 
 /*
 -- FUNCTION: tcpSocket
 --
 -- DATE: March 12, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - Goes through the transport.
 --
 -- DESIGNER: Luke Queenan
 --
@@ -58,11 +109,12 @@
 -- RETURNS: a new tcp socket
 --
 -- NOTES:
--- This is the wrapper function for creating a new tcp socket.
+-- This is the wrapper function for creating a new tcp socket, or a stream
+-- socket of the transport that was set instead.
 */
 int tcpSocket()
 {
-    return socket(AF_INET, SOCK_STREAM, 0);
+    return transport->open();
 }
 
 /*
@@ -91,12 +143,60 @@ int setReuse(int *socket)
                         sizeof(optlen));
 }
 
+/*
+-- FUNCTION: setReusePort
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int setReusePort(int *socket);
+--
+-- RETURNS: the result of the setsockopt function
+--
+-- NOTES:
+-- This is the wrapper function for setting the reuse port option on a socket.
+-- Several sockets with this option can be bound to the same port and the
+-- kernel spreads the incoming connections between them. It must be set before
+-- the socket is bound.
+*/
+int setReusePort(int *socket)
+{
+    int optval = 1;
+    return setsockopt(*socket, SOL_SOCKET, SO_REUSEPORT, &optval,
+                        sizeof(optval));
+}
+
+/*
+-- FUNCTION: setNoDelay
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int setNoDelay(int *socket);
+--
+-- RETURNS: the result of the setsockopt function
+--
+-- NOTES:
+-- This is the wrapper function for turning off Nagle's algorithm on a TCP
+-- socket, so a small message is sent right away instead of waiting for the
+-- last one to be acknowledged. It fails on a Unix domain socket, which never
+-- holds messages back.
+*/
+int setNoDelay(int *socket)
+{
+    int optval = 1;
+    return setsockopt(*socket, IPPROTO_TCP, TCP_NODELAY, &optval,
+                        sizeof(optval));
+}
+
 /*
 -- FUNCTION: bindAddress
 --
 -- DATE: March 12, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - Goes through the transport.
 --
 -- DESIGNER: Luke Queenan
 --
@@ -111,14 +211,7 @@ int setReuse(int *socket)
 */
 int bindAddress(int *port, int *socket)
 {
-    struct sockaddr_in address;
-    
-    bzero((char *)&address, sizeof(struct sockaddr_in));
-    address.sin_family = AF_INET;
-    address.sin_port = htons(*port);
-    address.sin_addr.s_addr = htonl(INADDR_ANY);
-
-    return bind(*socket, (struct sockaddr *)&address, sizeof(address));
+    return transport->bind(port, socket);
 }
 
 /*
@@ -126,7 +219,7 @@ int bindAddress(int *port, int *socket)
 --
 -- DATE: March 12, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - Goes through the transport.
 --
 -- DESIGNER: Luke Queenan
 --
@@ -141,7 +234,7 @@ int bindAddress(int *port, int *socket)
 */
 int setListen(int *socket)
 {
-    return listen(*socket, MAX_QUEUE);
+    return transport->listen(socket);
 }
 
 /*
@@ -149,7 +242,7 @@ int setListen(int *socket)
 --
 -- DATE: March 12, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - Goes through the transport.
 --
 -- DESIGNER: Luke Queenan
 --
@@ -165,9 +258,7 @@ int setListen(int *socket)
 */
 int acceptConnection(int *listenSocket)
 {
-    struct sockaddr_in clientAddress;
-    socklen_t addrlen = sizeof(clientAddress);
-    return accept(*listenSocket, (struct sockaddr *) &clientAddress, &addrlen);
+    return transport->accept(listenSocket, NULL, NULL);
 }
 
 /*
@@ -175,7 +266,7 @@ int acceptConnection(int *listenSocket)
 --
 -- DATE: March 12, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - Goes through the transport.
 --
 -- DESIGNER: Luke Queenan
 --
@@ -192,12 +283,7 @@ int acceptConnection(int *listenSocket)
 */
 int acceptConnectionIp(int *listenSocket, char *ip)
 {
-    int sock = 0;
-    struct sockaddr_in clientAddress;
-    socklen_t addrlen = sizeof(clientAddress);
-    sock = accept(*listenSocket, (struct sockaddr *) &clientAddress, &addrlen);
-    strcpy(ip, inet_ntoa(clientAddress.sin_addr));
-    return sock;
+    return transport->accept(listenSocket, ip, NULL);
 }
 
 /*
@@ -205,7 +291,7 @@ int acceptConnectionIp(int *listenSocket, char *ip)
 --
 -- DATE: September 28, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - Goes through the transport.
 --
 -- DESIGNER: Luke Queenan
 --
@@ -224,13 +310,7 @@ int acceptConnectionIp(int *listenSocket, char *ip)
 */
 int acceptConnectionIpPort(int *listenSocket, char *ip, unsigned short *port)
 {
-    int sock = 0;
-    struct sockaddr_in clientAddress;
-    socklen_t addrlen = sizeof(clientAddress);
-    sock = accept(*listenSocket, (struct sockaddr *) &clientAddress, &addrlen);
-    strcpy(ip, inet_ntoa(clientAddress.sin_addr));
-    *port = htons(clientAddress.sin_port);
-    return sock;
+    return transport->accept(listenSocket, ip, port);
 }
 
 /*
@@ -283,6 +363,102 @@ int sendData(int *socket, const char *buffer, int bytesToSend)
     return send(*socket, buffer, bytesToSend, 0);
 }
 
+/*
+-- FUNCTION: sendMore
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendMore(int *socket, const char *buffer, int bytesToSend);
+--
+-- RETURNS: the bytes written to the specified socket
+--
+-- NOTES:
+-- This function sends like sendData but tells the kernel more data follows
+-- right away, so a header shares a packet with the body sent after it even
+-- with Nagle's algorithm turned off.
+*/
+int sendMore(int *socket, const char *buffer, int bytesToSend)
+{
+    return send(*socket, buffer, bytesToSend, MSG_MORE);
+}
+
+/*
+-- FUNCTION: readAll
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int readAll(int *socket, char *buffer, int bytesToRead);
+--
+-- RETURNS: 0 once all the bytes are read, -1 if the connection ended first
+--          or failed
+--
+-- NOTES:
+-- This function reads exactly bytesToRead bytes from a blocking socket,
+-- calling recv as many times as it takes.
+*/
+int readAll(int *socket, char *buffer, int bytesToRead)
+{
+    ssize_t bytesRead = 0;
+
+    while (bytesToRead > 0)
+    {
+        bytesRead = recv(*socket, buffer, bytesToRead, 0);
+        if (bytesRead <= 0)
+        {
+            if (bytesRead == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        buffer += bytesRead;
+        bytesToRead -= bytesRead;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: sendAll
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendAll(int *socket, const char *buffer, int bytesToSend);
+--
+-- RETURNS: 0 once all the bytes are sent, -1 on failure
+--
+-- NOTES:
+-- This function sends all bytesToSend bytes to a blocking socket, calling
+-- send as many times as it takes.
+*/
+int sendAll(int *socket, const char *buffer, int bytesToSend)
+{
+    ssize_t bytesSent = 0;
+
+    while (bytesToSend > 0)
+    {
+        bytesSent = send(*socket, buffer, bytesToSend, 0);
+        if (bytesSent == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        buffer += bytesSent;
+        bytesToSend -= bytesSent;
+    }
+
+    return 0;
+}
+
 /*
 -- FUNCTION: closeSocket
 --
@@ -311,7 +487,7 @@ int closeSocket(int *socket)
 --
 -- DATE: March 14, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - Goes through the transport.
 --
 -- DESIGNER: Luke Queenan
 --
@@ -326,19 +502,29 @@ int closeSocket(int *socket)
 */
 int connectToServer(int *port, int *socket, const char *ip)
 {
-    struct sockaddr_in address;
-    struct hostent *hp;
-
-    bzero((char *)&address, sizeof(struct sockaddr_in));
-    address.sin_family = AF_INET;
-    address.sin_port = htons(*port);
-    if ((hp = gethostbyname(&(*ip))) == NULL)
-    {
-        return -1;
-    }
-    bcopy(hp->h_addr, (char *)&address.sin_addr, hp->h_length);
+    return transport->connect(port, socket, ip, 1);
+}
 
-    return connect(*socket, (struct sockaddr *)&address, sizeof(address));
+/*
+-- FUNCTION: connectToIp
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Goes through the transport.
+--
+-- INTERFACE: int connectToIp(int *port, int *socket, const char *ip);
+--
+-- RETURNS: the result of the connect function or -1 if the address is invalid
+--
+-- NOTES:
+-- This is the wrapper function for connecting to a dotted decimal address.
+-- Unlike connectToServer it never performs a name lookup, so it is safe to use
+-- on a non blocking socket from an event loop. A non blocking socket will
+-- usually return -1 with errno set to EINPROGRESS.
+*/
+int connectToIp(int *port, int *socket, const char *ip)
+{
+    return transport->connect(port, socket, ip, 0);
 }
 
 /*
@@ -379,4 +565,305 @@ int makeSocketNonBlocking(int *socket)
     return fcntl(*socket, F_SETFL, flags);
 }
 
+/*
+-- FUNCTION: getSocketPort
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Goes through the transport.
+--
+-- INTERFACE: int getSocketPort(int *socket);
+--
+-- RETURNS: the local port of the socket or -1 on failure
+--
+-- NOTES:
+-- This is the wrapper function for finding the port a socket is bound to, for
+-- example after binding to port 0 and letting the kernel choose.
+*/
+int getSocketPort(int *socket)
+{
+    return transport->localPort(socket);
+}
 
+/*
+-- FUNCTION: getPeerIp
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Goes through the transport.
+--
+-- INTERFACE: int getPeerIp(int *socket, char *ip);
+--
+-- RETURNS: 0 on success, -1 on failure
+--
+-- NOTES:
+-- This is the wrapper function for finding the address of the other end of a
+-- connected socket. You must ensure that the ip array is at least 16 bytes.
+*/
+int getPeerIp(int *socket, char *ip)
+{
+    return transport->peerIp(socket, ip);
+}
+
+/*
+-- FUNCTION: findTransport
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: const struct transport *findTransport(const char *name);
+--
+-- RETURNS: the transport or NULL if there is none of that name
+--
+-- NOTES:
+-- This function finds a transport by the name given on the command line,
+-- tcp, unix or memory.
+*/
+const struct transport *findTransport(const char *name)
+{
+    const struct transport *transports[] = {
+        &tcpTransport, &unixTransport, &memoryTransport
+    };
+    unsigned int i = 0;
+
+    for (i = 0; i < sizeof(transports) / sizeof(transports[0]); i++)
+    {
+        if (strcmp(transports[i]->name, name) == 0)
+        {
+            return transports[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+-- FUNCTION: setTransport
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void setTransport(const struct transport *next);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function sets the transport the sockets of the process are made and
+-- addressed with from now on. It must be set before the first socket is
+-- made, sockets of different transports can not reach each other.
+*/
+void setTransport(const struct transport *next)
+{
+    transport = next;
+}
+
+/*
+-- FUNCTION: getTransport
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: const struct transport *getTransport();
+--
+-- RETURNS: the transport in use
+--
+-- NOTES:
+-- This function returns the transport set with setTransport, so a caller
+-- can check what it supports.
+*/
+const struct transport *getTransport()
+{
+    return transport;
+}
+
+/*
+-- FUNCTION: tcpOpen
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int tcpOpen();
+--
+-- RETURNS: a new tcp socket or -1 on failure
+--
+-- NOTES:
+-- This function makes the sockets of the TCP transport.
+*/
+static int tcpOpen()
+{
+    return socket(AF_INET, SOCK_STREAM, 0);
+}
+
+/*
+-- FUNCTION: tcpBind
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int tcpBind(int *port, int *socket);
+--
+-- RETURNS: the result of the bind function
+--
+-- NOTES:
+-- This function binds a TCP socket to the port on every address.
+*/
+static int tcpBind(int *port, int *socket)
+{
+    struct sockaddr_in address;
+    
+    bzero((char *)&address, sizeof(struct sockaddr_in));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(*port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    return bind(*socket, (struct sockaddr *)&address, sizeof(address));
+}
+
+/*
+-- FUNCTION: tcpListen
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Queues as many connections as the system
+-- allows.
+--
+-- INTERFACE: static int tcpListen(int *socket);
+--
+-- RETURNS: the result of the listen function
+--
+-- NOTES:
+-- This function sets a TCP socket to listen for connections.
+*/
+static int tcpListen(int *socket)
+{
+    return listen(*socket, MAX_QUEUE);
+}
+
+/*
+-- FUNCTION: tcpAccept
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int tcpAccept(int *listenSocket, char *ip,
+--                                unsigned short *port);
+--
+-- RETURNS: the new socket created for the connection
+--
+-- NOTES:
+-- This function accepts a TCP connection. The address and the port of the
+-- client are written to ip and port unless they are NULL.
+*/
+static int tcpAccept(int *listenSocket, char *ip, unsigned short *port)
+{
+    int sock = 0;
+    struct sockaddr_in clientAddress;
+    socklen_t addrlen = sizeof(clientAddress);
+    sock = accept(*listenSocket, (struct sockaddr *) &clientAddress, &addrlen);
+    if (sock != -1 && ip != NULL)
+    {
+        strcpy(ip, inet_ntoa(clientAddress.sin_addr));
+    }
+    if (sock != -1 && port != NULL)
+    {
+        *port = htons(clientAddress.sin_port);
+    }
+    return sock;
+}
+
+/*
+-- FUNCTION: tcpConnect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int tcpConnect(int *port, int *socket,
+--                                 const char *host, int lookup);
+--
+-- RETURNS: the result of the connect function or -1 if the host is not found
+--
+-- NOTES:
+-- This function connects a TCP socket. The host is looked up by name when
+-- lookup is set and must be a dotted decimal address otherwise.
+*/
+static int tcpConnect(int *port, int *socket, const char *host, int lookup)
+{
+    struct sockaddr_in address;
+    struct hostent *hp;
+
+    bzero((char *)&address, sizeof(struct sockaddr_in));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(*port);
+    if (lookup)
+    {
+        if ((hp = gethostbyname(host)) == NULL)
+        {
+            return -1;
+        }
+        bcopy(hp->h_addr, (char *)&address.sin_addr, hp->h_length);
+    }
+    else if (inet_pton(AF_INET, host, &address.sin_addr) != 1)
+    {
+        return -1;
+    }
+
+    return connect(*socket, (struct sockaddr *)&address, sizeof(address));
+}
+
+/*
+-- FUNCTION: tcpLocalPort
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int tcpLocalPort(int *socket);
+--
+-- RETURNS: the local port of the socket or -1 on failure
+--
+-- NOTES:
+-- This function finds the port a TCP socket is bound to.
+*/
+static int tcpLocalPort(int *socket)
+{
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    if (getsockname(*socket, (struct sockaddr *)&address, &length) == -1)
+    {
+        return -1;
+    }
+    return ntohs(address.sin_port);
+}
+
+/*
+-- FUNCTION: tcpPeerIp
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int tcpPeerIp(int *socket, char *ip);
+--
+-- RETURNS: 0 on success, -1 on failure
+--
+-- NOTES:
+-- This function finds the address of the other end of a TCP connection.
+*/
+static int tcpPeerIp(int *socket, char *ip)
+{
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    if (getpeername(*socket, (struct sockaddr *)&address, &length) == -1)
+    {
+        return -1;
+    }
+    return inet_ntop(AF_INET, &address.sin_addr, ip, 16) == NULL ? -1 : 0;
+}
@@ -5,12 +5,71 @@
 #define BUFFER_LENGTH 	275
 #define FILE_SIZE		3
 
+// Control commands
+#define GET_FILE		0
+#define SEND_FILE		1
+#define REQUEST_LIST	2
+#define MULTIPLEX		3
+#define BATCH_GET		4
+#define BATCH_SEND		5
+
+// Control packet layout, the option fields sit at the end of the packet
+#define CONTROL_FLAGS	(BUFFER_LENGTH - 64)
+#define MAX_NAME_LENGTH	(CONTROL_FLAGS - 2)
+#define CONTROL_STRIPE	(CONTROL_FLAGS + 4)
+#define CONTROL_STRIPES	(CONTROL_FLAGS + 8)
+#define CONTROL_RESUME	(CONTROL_FLAGS + 12)
+
+// Size control message layout, the size is followed by the starting offset
+// and the flags of the body
+#define HEADER_OFFSET	8
+#define HEADER_FLAGS	16
+
+// Size control message flags, only set when the control packet asked for them
+#define BODY_COMPRESSED	0x01
+
+// Most stripes a file can be split into
+#define MAX_STRIPES		64
+
+// Bytes at the end of a partial file that are checked before resuming it
+#define RESUME_OVERLAP	1048576
+
+// Control packet flags
+#define FLAG_PASSIVE	0x01
+#define FLAG_RESUME		0x02
+#define FLAG_DELTA		0x04
+#define FLAG_DEDUP		0x08
+#define FLAG_COMPRESS	0x10
+#define FLAG_VERIFY		0x20
+
+// Transport capabilities, whether its addresses are sockaddr_in and whether
+// several sockets can listen on one port
+#define TRANSPORT_INET			0x01
+#define TRANSPORT_REUSE_PORT	0x02
+
+// The functions a transport makes, binds, accepts, connects and addresses its
+// stream sockets with, see network.c
+struct transport
+{
+    const char *name;
+    int flags;
+    int (*open)();
+    int (*bind)(int *port, int *socket);
+    int (*listen)(int *socket);
+    int (*accept)(int *listenSocket, char *ip, unsigned short *port);
+    int (*connect)(int *port, int *socket, const char *host, int lookup);
+    int (*localPort)(int *socket);
+    int (*peerIp)(int *socket, char *ip);
+};
+
 // Function Prototypes
 #ifdef __cplusplus
 extern "C" {
 #endif
 int tcpSocket();
 int setReuse(int* socket);
+int setReusePort(int *socket);
+int setNoDelay(int *socket);
 int bindAddress(int *port, int *socket);
 int setListen(int *socket);
 int acceptConnection(int *listenSocket);
@@ -18,9 +77,22 @@ int acceptConnectionIp(int *listenSocket, char* ip);
 int acceptConnectionIpPort(int *listenSocket, char *ip, unsigned short *port);
 int readData(int *socket, char *buffer, int bytesToRead);
 int sendData(int *socket, const char *buffer, int bytesToSend);
+int sendMore(int *socket, const char *buffer, int bytesToSend);
+int readAll(int *socket, char *buffer, int bytesToRead);
+int sendAll(int *socket, const char *buffer, int bytesToSend);
 int closeSocket(int *socket);
 int connectToServer(int *port, int *socket, const char *ip);
+int connectToIp(int *port, int *socket, const char *ip);
 int makeSocketNonBlocking(int *socket);
+int getSocketPort(int *socket);
+int getPeerIp(int *socket, char *ip);
+const struct transport *findTransport(const char *name);
+void setTransport(const struct transport *next);
+const struct transport *getTransport();
+
+extern const struct transport tcpTransport;
+extern const struct transport unixTransport;
+extern const struct transport memoryTransport;
 #ifdef __cplusplus
 }
 #endif
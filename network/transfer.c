@@ -0,0 +1,1000 @@
+/*
+-- SOURCE FILE: transfer.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int openReceivePipe(int *pipe, int size);
+-- void closeReceivePipe(int *pipe);
+-- int receiveChunk(int socket, int file, int *pipe, char *buffer, int length,
+--                  off_t *offset);
+-- int sendRange(int socket, int file, off_t offset, off_t length);
+-- void readStripe(const char *control, int *stripe, int *stripes);
+-- void stripeRange(off_t size, int stripe, int stripes, off_t *offset,
+--                  off_t *length);
+-- int findResume(int file, struct resumePoint *resume, char *buffer,
+--                int size);
+-- off_t checkResume(int file, off_t fileSize,
+--                   const struct resumePoint *resume, char *buffer,
+--                   int size);
+-- void packResume(char *packet, const struct resumePoint *resume);
+-- void unpackResume(const char *packet, struct resumePoint *resume);
+-- int sendResult(int socket, int result);
+-- int readResult(int socket);
+-- int writeAll(int file, const char *buffer, int count, off_t *offset);
+-- void startReceive(struct writeBehind *behind, int file, off_t offset,
+--                   off_t length);
+-- void writeBehind(struct writeBehind *behind, off_t offset);
+-- void setDirectSize(off_t size);
+-- int receiveDirectly(off_t length);
+-- int receiveDirect(int socket, int file, char *buffer, int length,
+--                   off_t *offset);
+-- void setMappedReceive(int mapped);
+-- int openMapping(struct fileMapping *mapping, int file, off_t size);
+-- int receiveMapped(int socket, struct fileMapping *mapping, int length,
+--                   off_t *offset);
+-- void closeMapping(struct fileMapping *mapping);
+-- static int copyChunk(int socket, int file, char *buffer, int length,
+--                      off_t *offset);
+-- static int drainPipe(int *pipe, int file, char *buffer, int count,
+--                      off_t *offset);
+-- static int setDirect(int file, int direct);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The chunk size is set by the caller.
+-- October 17, 2026 - Data can be written at an offset, and the range and
+-- stripe helpers for striped transfers.
+-- October 17, 2026 - The resume point helpers for resumed transfers.
+-- October 17, 2026 - The result message of uploads that are checked, and
+-- writeAll is shared.
+-- October 17, 2026 - Preallocation, write behind and direct writes.
+-- October 17, 2026 - Mapped receives.
+--
+-- NOTES:
+-- This file contains the receive path shared by the client and the server.
+-- File data is moved from the socket into a pipe and from the pipe into the
+-- file with splice, so it never passes through a user space buffer. When the
+-- kernel or the file system can not splice, the pipe is closed and the data
+-- is copied through the caller's buffer with read and write instead.
+--
+-- The pipe is always empty between calls, so a single pipe can be reused for
+-- every transfer made by a process or a reactor thread.
+--
+-- A file can be moved as several stripes, each a byte range sent over its own
+-- connection. The stripe of a connection is carried in its control packet and
+-- both ends work out the range from the size of the file with stripeRange.
+-- Every stripe is written at its own offset, so they can arrive in any order.
+--
+-- A transfer that died part way can be resumed. The receiver tells the sender
+-- how much of the file it has and the checksum of the last RESUME_OVERLAP
+-- bytes of that. If the sender's file has the same bytes there it starts
+-- sending where the receiver left off, otherwise from the start. The size
+-- control message tells the receiver which one it is.
+--
+-- Uploads the server checks before keeping, delta and chunked uploads, end
+-- with a result message from the server telling the client how it went.
+--
+-- The size of a file is known before its body arrives, so the receiver
+-- allocates its blocks up front with startReceive and the file system can
+-- lay them out in one piece. As the body is written the receiver keeps the
+-- writeback of it going with writeBehind, WRITE_BEHIND bytes at a time, and
+-- once a stretch is on disk drops it from the page cache. A large upload
+-- then never holds more than two stretches of dirty pages, and does not push
+-- the files clients download out of the page cache.
+--
+-- Very large files can be received with direct writes instead, see
+-- receiveDirect, which skip the page cache altogether. They are only used
+-- for files of at least the size given to setDirectSize, none by default.
+--
+-- A receiver can also read the body from the socket straight into the file
+-- mapped into memory, see receiveMapped, after setMappedReceive. The file
+-- is mapped MAP_WINDOW bytes at a time and each window is unmapped once the
+-- data has moved past it, so a file larger than memory can be received.
+*/
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include "network.h"
+#include "transfer.h"
+#include "checksum.h"
+
+static int copyChunk(int socket, int file, char *buffer, int length,
+                     off_t *offset);
+static int drainPipe(int *pipe, int file, char *buffer, int count,
+                     off_t *offset);
+static int setDirect(int file, int direct);
+
+// Files at least this long are received with direct writes, 0 for none
+static off_t directSize = 0;
+
+// Whether bodies are received into a mapping of the file
+static int mappedReceive = 0;
+
+/*
+-- FUNCTION: openReceivePipe
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Takes the chunk size.
+--
+-- INTERFACE: int openReceivePipe(int *pipe, int size);
+--
+-- RETURNS: 0 if splice can be used, -1 if the copy path must be used
+--
+-- NOTES:
+-- This function creates the pipe used by receiveChunk and tries to make it
+-- large enough to hold a chunk of size bytes. If the pipe can not be created
+-- both ends are set to -1 and receiveChunk copies instead.
+*/
+int openReceivePipe(int *pipe, int size)
+{
+    if (pipe2(pipe, O_CLOEXEC) == -1)
+    {
+        pipe[0] = -1;
+        pipe[1] = -1;
+        return -1;
+    }
+
+    // A pipe smaller than a chunk, for example because the size is above
+    // /proc/sys/fs/pipe-max-size, only means smaller splices
+    fcntl(pipe[1], F_SETPIPE_SZ, size);
+    return 0;
+}
+
+/*
+-- FUNCTION: closeReceivePipe
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void closeReceivePipe(int *pipe);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function closes both ends of the pipe, if it is open.
+*/
+void closeReceivePipe(int *pipe)
+{
+    if (pipe[0] != -1)
+    {
+        close(pipe[0]);
+        close(pipe[1]);
+    }
+    pipe[0] = -1;
+    pipe[1] = -1;
+}
+
+/*
+-- FUNCTION: receiveChunk
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Takes the offset to write at.
+--
+-- INTERFACE: int receiveChunk(int socket, int file, int *pipe, char *buffer,
+--                             int length, off_t *offset);
+--
+-- RETURNS: the number of bytes written to the file, 0 if the peer closed the
+--          connection or -1 on failure with errno set
+--
+-- NOTES:
+-- This function moves up to length bytes from the socket to the end of the
+-- file. A single splice moves no more than the pipe holds. It blocks only if
+-- the socket is blocking, a non blocking socket without data fails with
+-- EAGAIN like readData does.
+--
+-- With an offset the data is written there and the offset is moved past it,
+-- without touching the file position, so several connections can write their
+-- parts of one file at once. Without an offset the data is written at the
+-- file position.
+--
+-- The buffer must hold length bytes. It is only used when the pipe is closed
+-- or splice turns out to be unsupported, in which case the pipe is closed so
+-- later calls go straight to the copy path.
+*/
+int receiveChunk(int socket, int file, int *pipe, char *buffer, int length,
+                 off_t *offset)
+{
+    int bytesRead = 0;
+    int bytesMoved = 0;
+    int result = 0;
+
+    if (pipe[0] == -1)
+    {
+        return copyChunk(socket, file, buffer, length, offset);
+    }
+
+    bytesRead = splice(socket, NULL, pipe[1], NULL, length, SPLICE_F_MOVE);
+    if (bytesRead == -1)
+    {
+        if (errno == EINVAL || errno == ENOSYS)
+        {
+            closeReceivePipe(pipe);
+            return copyChunk(socket, file, buffer, length, offset);
+        }
+        return -1;
+    }
+
+    while (bytesMoved < bytesRead)
+    {
+        result = splice(pipe[0], NULL, file, offset, bytesRead - bytesMoved,
+            SPLICE_F_MOVE);
+        if (result <= 0)
+        {
+            // The file can not be spliced to, or the disk failed. Either way
+            // the pipe must be emptied before the next chunk.
+            if (result == -1 && (errno == EINVAL || errno == ENOSYS))
+            {
+                result = drainPipe(pipe, file, buffer, bytesRead - bytesMoved,
+                    offset);
+                closeReceivePipe(pipe);
+                return result == -1 ? -1 : bytesRead;
+            }
+            closeReceivePipe(pipe);
+            openReceivePipe(pipe, length);
+            return -1;
+        }
+        bytesMoved += result;
+    }
+
+    return bytesRead;
+}
+
+/*
+-- FUNCTION: sendRange
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendRange(int socket, int file, off_t offset, off_t length);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function sends length bytes of the file starting at offset with
+-- sendfile on a blocking socket. A single sendfile may send less than asked,
+-- so it is called until the whole range is sent. A file that ends before the
+-- range does is a failure.
+*/
+int sendRange(int socket, int file, off_t offset, off_t length)
+{
+    ssize_t bytesSent = 0;
+    off_t end = offset + length;
+
+    while (offset < end)
+    {
+        if ((bytesSent = sendfile(socket, file, &offset, end - offset)) <= 0)
+        {
+            if (bytesSent == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: readStripe
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void readStripe(const char *control, int *stripe, int *stripes);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function reads the stripe fields of a control packet. Packets from
+-- clients that do not stripe have both fields zeroed, and those as well as
+-- fields that make no sense stand for the whole file, stripe 0 of 1.
+*/
+void readStripe(const char *control, int *stripe, int *stripes)
+{
+    memmove((void*)stripe, control + CONTROL_STRIPE, sizeof(int));
+    memmove((void*)stripes, control + CONTROL_STRIPES, sizeof(int));
+
+    if (*stripes < 1 || *stripes > MAX_STRIPES || *stripe < 0 ||
+        *stripe >= *stripes)
+    {
+        *stripe = 0;
+        *stripes = 1;
+    }
+}
+
+/*
+-- FUNCTION: stripeRange
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void stripeRange(off_t size, int stripe, int stripes,
+--                             off_t *offset, off_t *length);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function works out the byte range of a stripe of a file of size bytes.
+-- The file is cut into equal stripes and the last one takes what is left
+-- over. Stripe 0 of 1 is the whole file.
+*/
+void stripeRange(off_t size, int stripe, int stripes, off_t *offset,
+                 off_t *length)
+{
+    off_t stripeSize = size / stripes;
+
+    *offset = stripeSize * stripe;
+    *length = stripe == stripes - 1 ? size - *offset : stripeSize;
+}
+
+/*
+-- FUNCTION: findResume
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int findResume(int file, struct resumePoint *resume,
+--                           char *buffer, int size);
+--
+-- RETURNS: 0 on success or -1 if the file could not be read
+--
+-- NOTES:
+-- This function is used by the receiver to find the resume point of the part
+-- of a file it already has, its length and the checksum of its last
+-- RESUME_OVERLAP bytes. The file must be open for reading, it is read through
+-- the buffer of size bytes. If it can not be read the resume point is empty
+-- and the whole file is sent again.
+*/
+int findResume(int file, struct resumePoint *resume, char *buffer, int size)
+{
+    struct stat statBuffer;
+    off_t overlap = 0;
+
+    resume->length = 0;
+    resume->checksum = 0;
+    if (fstat(file, &statBuffer) == -1)
+    {
+        return -1;
+    }
+
+    overlap = statBuffer.st_size < RESUME_OVERLAP ? statBuffer.st_size :
+        RESUME_OVERLAP;
+    if (checksumFile(file, statBuffer.st_size - overlap, overlap, buffer,
+        size, &resume->checksum) == -1)
+    {
+        resume->checksum = 0;
+        return -1;
+    }
+    resume->length = statBuffer.st_size;
+
+    return 0;
+}
+
+/*
+-- FUNCTION: checkResume
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: off_t checkResume(int file, off_t fileSize,
+--                              const struct resumePoint *resume,
+--                              char *buffer, int size);
+--
+-- RETURNS: the offset to start sending from
+--
+-- NOTES:
+-- This function is used by the sender to check the resume point of the
+-- receiver against the file of fileSize bytes it is about to send. When the
+-- file is at least as long as what the receiver has and the checksums of the
+-- overlap match, the transfer resumes at the end of what the receiver has.
+-- Otherwise it starts over from the beginning.
+*/
+off_t checkResume(int file, off_t fileSize, const struct resumePoint *resume,
+                  char *buffer, int size)
+{
+    unsigned int checksum = 0;
+    off_t overlap = 0;
+
+    if (resume->length <= 0 || resume->length > fileSize)
+    {
+        return 0;
+    }
+
+    overlap = resume->length < RESUME_OVERLAP ? resume->length :
+        RESUME_OVERLAP;
+    if (checksumFile(file, resume->length - overlap, overlap, buffer, size,
+        &checksum) == -1 || checksum != resume->checksum)
+    {
+        return 0;
+    }
+
+    return resume->length;
+}
+
+/*
+-- FUNCTION: packResume
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void packResume(char *packet,
+--                            const struct resumePoint *resume);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function stores a resume point at the start of packet, the length
+-- followed by the checksum.
+*/
+void packResume(char *packet, const struct resumePoint *resume)
+{
+    memmove(packet, (void*)&resume->length, sizeof(off_t));
+    memmove(packet + sizeof(off_t), (void*)&resume->checksum,
+        sizeof(unsigned int));
+}
+
+/*
+-- FUNCTION: unpackResume
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void unpackResume(const char *packet,
+--                              struct resumePoint *resume);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function reads a resume point stored by packResume.
+*/
+void unpackResume(const char *packet, struct resumePoint *resume)
+{
+    memmove((void*)&resume->length, packet, sizeof(off_t));
+    memmove((void*)&resume->checksum, packet + sizeof(off_t),
+        sizeof(unsigned int));
+}
+
+/*
+-- FUNCTION: sendResult
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendResult(int socket, int result);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function sends the result message of an upload, 0 if the server kept
+-- the file and -1 if it did not.
+*/
+int sendResult(int socket, int result)
+{
+    char packet[BUFFER_LENGTH];
+
+    bzero(packet, BUFFER_LENGTH);
+    memmove(packet, (void*)&result, sizeof(int));
+    return sendAll(&socket, packet, BUFFER_LENGTH);
+}
+
+/*
+-- FUNCTION: readResult
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int readResult(int socket);
+--
+-- RETURNS: the result sent by the server, -1 if none arrived
+--
+-- NOTES:
+-- This function waits for the result message of an upload.
+*/
+int readResult(int socket)
+{
+    char packet[BUFFER_LENGTH];
+    int result = -1;
+
+    if (readAll(&socket, packet, BUFFER_LENGTH) == 0)
+    {
+        memmove((void*)&result, packet, sizeof(int));
+    }
+
+    return result;
+}
+
+/*
+-- FUNCTION: copyChunk
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Takes the offset to write at.
+--
+-- INTERFACE: static int copyChunk(int socket, int file, char *buffer,
+--                                 int length, off_t *offset);
+--
+-- RETURNS: the number of bytes written, 0 on end of file or -1 on failure
+--
+-- NOTES:
+-- This function is the copy path. It reads one chunk from the socket into the
+-- buffer and writes all of it to the file.
+*/
+static int copyChunk(int socket, int file, char *buffer, int length,
+                     off_t *offset)
+{
+    int bytesRead = 0;
+
+    if ((bytesRead = read(socket, buffer, length)) <= 0)
+    {
+        return bytesRead;
+    }
+
+    return writeAll(file, buffer, bytesRead, offset) == -1 ? -1 : bytesRead;
+}
+
+/*
+-- FUNCTION: drainPipe
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Takes the offset to write at.
+--
+-- INTERFACE: static int drainPipe(int *pipe, int file, char *buffer,
+--                                 int count, off_t *offset);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function copies the count bytes left in the pipe to the file through
+-- the buffer. It is used when the data reached the pipe but the file does not
+-- accept splice.
+*/
+static int drainPipe(int *pipe, int file, char *buffer, int count,
+                     off_t *offset)
+{
+    int bytesRead = 0;
+
+    while (count > 0)
+    {
+        if ((bytesRead = read(pipe[0], buffer, count)) <= 0)
+        {
+            return -1;
+        }
+        if (writeAll(file, buffer, bytesRead, offset) == -1)
+        {
+            return -1;
+        }
+        count -= bytesRead;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: writeAll
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Writes at the offset with pwrite if there
+-- is one.
+-- October 17, 2026 - No longer static, delta.c and store.c write with it.
+--
+-- INTERFACE: int writeAll(int file, const char *buffer, int count,
+--                         off_t *offset);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function writes the whole buffer to the file, retrying short writes.
+-- With an offset the buffer is written there and the offset is moved past it.
+*/
+int writeAll(int file, const char *buffer, int count, off_t *offset)
+{
+    int bytesWritten = 0;
+
+    while (count > 0)
+    {
+        bytesWritten = offset == NULL ? write(file, buffer, count) :
+            pwrite(file, buffer, count, *offset);
+        if (bytesWritten == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (offset != NULL)
+        {
+            *offset += bytesWritten;
+        }
+        buffer += bytesWritten;
+        count -= bytesWritten;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: startReceive
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void startReceive(struct writeBehind *behind, int file,
+--                               off_t offset, off_t length);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function is called once the receiver knows it is about to write
+-- length bytes to the file at offset. The blocks are allocated without
+-- changing the size of the file, so a transfer that dies part way still
+-- leaves only what arrived, which is what a resume looks at. A file system
+-- that can not allocate ahead simply allocates as the data is written.
+-- The write behind of the file starts at offset.
+*/
+void startReceive(struct writeBehind *behind, int file, off_t offset,
+                  off_t length)
+{
+    behind->file = file;
+    behind->submitted = offset;
+    behind->pending = offset;
+
+    if (length > 0)
+    {
+        fallocate(file, FALLOC_FL_KEEP_SIZE, offset, length);
+    }
+}
+
+/*
+-- FUNCTION: writeBehind
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void writeBehind(struct writeBehind *behind, off_t offset);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function is called whenever the receiver has written up to offset.
+-- Once WRITE_BEHIND bytes are dirty their writeback is started. The stretch
+-- started the time before has had all that time to reach the disk, so
+-- waiting for it rarely blocks, and it is then dropped from the page cache.
+-- Writes that are not in order, like a resumed or striped file, only make
+-- the stretches uneven.
+*/
+void writeBehind(struct writeBehind *behind, off_t offset)
+{
+    if (offset - behind->pending < WRITE_BEHIND)
+    {
+        return;
+    }
+
+    sync_file_range(behind->file, behind->pending, offset - behind->pending,
+        SYNC_FILE_RANGE_WRITE);
+    if (behind->pending > behind->submitted)
+    {
+        sync_file_range(behind->file, behind->submitted,
+            behind->pending - behind->submitted, SYNC_FILE_RANGE_WAIT_BEFORE |
+            SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        posix_fadvise(behind->file, behind->submitted,
+            behind->pending - behind->submitted, POSIX_FADV_DONTNEED);
+    }
+
+    behind->submitted = behind->pending;
+    behind->pending = offset;
+}
+
+/*
+-- FUNCTION: setDirectSize
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void setDirectSize(off_t size);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function sets the size from which files are received with direct
+-- writes, 0 for never.
+*/
+void setDirectSize(off_t size)
+{
+    directSize = size;
+}
+
+/*
+-- FUNCTION: receiveDirectly
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int receiveDirectly(off_t length);
+--
+-- RETURNS: 1 if a body of length bytes is received with receiveDirect, 0
+--          otherwise
+--
+-- NOTES:
+-- This function tells a receiver whether a body is long enough to be
+-- received with direct writes.
+*/
+int receiveDirectly(off_t length)
+{
+    return directSize > 0 && length >= directSize;
+}
+
+/*
+-- FUNCTION: receiveDirect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int receiveDirect(int socket, int file, char *buffer,
+--                              int length, off_t *offset);
+--
+-- RETURNS: the number of bytes written to the file, 0 if the peer closed the
+--          connection or -1 on failure
+--
+-- NOTES:
+-- This function is receiveChunk with direct writes, for a blocking socket.
+-- Direct writes need an aligned offset, length and buffer, so it receives
+-- up to length bytes, fewer to reach the next DIRECT_ALIGN boundary of the
+-- file first or to keep the length a multiple of it. Those aligned chunks
+-- skip the page cache. The unaligned start and end of the body, and the last
+-- bytes before the peer closed the connection, are written through the page
+-- cache, as is everything on a file system without direct writes.
+--
+-- The buffer, which must be aligned to DIRECT_ALIGN, is filled completely
+-- before it is written. The pool buffers are aligned to a page.
+*/
+int receiveDirect(int socket, int file, char *buffer, int length,
+                  off_t *offset)
+{
+    int head = (int)(*offset % DIRECT_ALIGN);
+    int bytesRead = 0;
+    int count = 0;
+
+    if (head > 0)
+    {
+        length = length < DIRECT_ALIGN - head ? length : DIRECT_ALIGN - head;
+    }
+    else if (length >= DIRECT_ALIGN)
+    {
+        length -= length % DIRECT_ALIGN;
+    }
+
+    while (count < length)
+    {
+        if ((bytesRead = read(socket, buffer + count, length - count)) <= 0)
+        {
+            if (bytesRead == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count == 0)
+            {
+                return bytesRead;
+            }
+            break;
+        }
+        count += bytesRead;
+    }
+
+    // Only a whole aligned chunk can skip the page cache
+    if (head == 0 && count == length && count % DIRECT_ALIGN == 0 &&
+        setDirect(file, 1) == 0)
+    {
+        if (pwrite(file, buffer, count, *offset) == count)
+        {
+            *offset += count;
+            return count;
+        }
+        if (errno != EINVAL)
+        {
+            return -1;
+        }
+    }
+    setDirect(file, 0);
+
+    return writeAll(file, buffer, count, offset) == -1 ? -1 : count;
+}
+
+/*
+-- FUNCTION: setMappedReceive
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void setMappedReceive(int mapped);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function sets whether bodies are received into a mapping of the
+-- file, see openMapping.
+*/
+void setMappedReceive(int mapped)
+{
+    mappedReceive = mapped;
+}
+
+/*
+-- FUNCTION: openMapping
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int openMapping(struct fileMapping *mapping, int file,
+--                             off_t size);
+--
+-- RETURNS: 0 if the body is received with receiveMapped or -1 if it is not
+--
+-- NOTES:
+-- This function gets a file, which must be open for reading and writing,
+-- ready to be received into a mapping when mapped receives are on. The file
+-- is given its full size, the size control message says it, and all of it
+-- is allocated. A write to a mapped page that can not get a block on disk
+-- kills the process with SIGBUS, so without the allocation the file is not
+-- mapped. The receiver must cut the file back to what arrived if the body
+-- ends early.
+*/
+int openMapping(struct fileMapping *mapping, int file, off_t size)
+{
+    mapping->file = file;
+    mapping->size = size;
+    mapping->window = NULL;
+    mapping->start = 0;
+    mapping->length = 0;
+
+    if (!mappedReceive || size <= 0 || fallocate(file, 0, 0, size) == -1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+-- FUNCTION: receiveMapped
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int receiveMapped(int socket, struct fileMapping *mapping,
+--                               int length, off_t *offset);
+--
+-- RETURNS: the number of bytes received into the file, 0 if the peer closed
+--          the connection or -1 on failure with errno set
+--
+-- NOTES:
+-- This function is receiveChunk for a file set up by openMapping. Up to
+-- length bytes are read from the socket straight into the mapped file at
+-- offset, fewer if the window ends first, so they never pass through a
+-- buffer of the program. When offset has left the window, the window is
+-- unmapped and the one holding offset is mapped, with hints that it is
+-- written in order and may use huge pages. The dirty pages a window leaves
+-- behind are written back like any others, see writeBehind.
+*/
+int receiveMapped(int socket, struct fileMapping *mapping, int length,
+                  off_t *offset)
+{
+    off_t start = *offset - *offset % MAP_WINDOW;
+    int bytesRead = 0;
+
+    if (mapping->window == NULL || start != mapping->start)
+    {
+        closeMapping(mapping);
+        mapping->length = mapping->size - start < MAP_WINDOW ?
+            mapping->size - start : MAP_WINDOW;
+        if ((mapping->window = mmap(NULL, mapping->length,
+            PROT_READ | PROT_WRITE, MAP_SHARED, mapping->file, start)) ==
+            MAP_FAILED)
+        {
+            mapping->window = NULL;
+            return -1;
+        }
+        madvise(mapping->window, mapping->length, MADV_SEQUENTIAL);
+        madvise(mapping->window, mapping->length, MADV_HUGEPAGE);
+        mapping->start = start;
+    }
+
+    if (length > mapping->start + (off_t)mapping->length - *offset)
+    {
+        length = mapping->start + mapping->length - *offset;
+    }
+    if ((bytesRead = read(socket, mapping->window + (*offset - start),
+        length)) > 0)
+    {
+        *offset += bytesRead;
+    }
+
+    return bytesRead;
+}
+
+/*
+-- FUNCTION: closeMapping
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void closeMapping(struct fileMapping *mapping);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function unmaps the window of a mapped receive, if one is mapped.
+*/
+void closeMapping(struct fileMapping *mapping)
+{
+    if (mapping->window != NULL)
+    {
+        munmap(mapping->window, mapping->length);
+        mapping->window = NULL;
+    }
+}
+
+/*
+-- FUNCTION: setDirect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int setDirect(int file, int direct);
+--
+-- RETURNS: 0 on success or -1 if the file can not be switched
+--
+-- NOTES:
+-- This function switches the writes to the file to direct writes or back to
+-- writes through the page cache, if they are not that already.
+*/
+static int setDirect(int file, int direct)
+{
+    int flags = fcntl(file, F_GETFL);
+
+    if (flags == -1)
+    {
+        return -1;
+    }
+    if (((flags & O_DIRECT) != 0) == direct)
+    {
+        return 0;
+    }
+
+    return fcntl(file, F_SETFL, direct ? flags | O_DIRECT :
+        flags & ~O_DIRECT);
+}
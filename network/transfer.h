@@ -0,0 +1,79 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <sys/types.h>
+
+// Bytes a receiver writes before it starts writing them back, and before it
+// waits for the bytes before them to be on disk
+#define WRITE_BEHIND	8388608
+
+// Alignment of the offsets, lengths and buffers of direct writes
+#define DIRECT_ALIGN	4096
+
+// Bytes of a file mapped at once by a mapped receive, a whole number of huge
+// pages
+#define MAP_WINDOW		67108864
+
+// What a receiver already has of a file, a prefix and the checksum of its end
+struct resumePoint
+{
+    off_t length;
+    unsigned int checksum;
+};
+
+// The writeback of a file being received: the bytes from submitted up to
+// pending are being written back, the bytes after pending are only dirty
+struct writeBehind
+{
+    int file;
+    off_t submitted;
+    off_t pending;
+};
+
+// The window of a file a mapped receive is writing into
+struct fileMapping
+{
+    int file;
+    off_t size;
+    char *window;
+    off_t start;
+    size_t length;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int openReceivePipe(int *pipe, int size);
+void closeReceivePipe(int *pipe);
+int receiveChunk(int socket, int file, int *pipe, char *buffer, int length,
+                 off_t *offset);
+int sendRange(int socket, int file, off_t offset, off_t length);
+void readStripe(const char *control, int *stripe, int *stripes);
+void stripeRange(off_t size, int stripe, int stripes, off_t *offset,
+                 off_t *length);
+int findResume(int file, struct resumePoint *resume, char *buffer, int size);
+off_t checkResume(int file, off_t fileSize, const struct resumePoint *resume,
+                  char *buffer, int size);
+void packResume(char *packet, const struct resumePoint *resume);
+void unpackResume(const char *packet, struct resumePoint *resume);
+int sendResult(int socket, int result);
+int readResult(int socket);
+int writeAll(int file, const char *buffer, int count, off_t *offset);
+void startReceive(struct writeBehind *behind, int file, off_t offset,
+                  off_t length);
+void writeBehind(struct writeBehind *behind, off_t offset);
+void setDirectSize(off_t size);
+int receiveDirectly(off_t length);
+int receiveDirect(int socket, int file, char *buffer, int length,
+                  off_t *offset);
+void setMappedReceive(int mapped);
+int openMapping(struct fileMapping *mapping, int file, off_t size);
+int receiveMapped(int socket, struct fileMapping *mapping, int length,
+                  off_t *offset);
+void closeMapping(struct fileMapping *mapping);
+#ifdef __cplusplus
+}
+#endif
+#endif
+
@@ -0,0 +1,456 @@
+/*
+-- SOURCE FILE: uring.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int uringSetup(struct uring *ring, unsigned int entries,
+--     unsigned int completions);
+-- void uringDestroy(struct uring *ring);
+-- struct io_uring_sqe *uringGetSqe(struct uring *ring);
+-- unsigned int uringSpace(struct uring *ring);
+-- void uringPrepare(struct io_uring_sqe *sqe, int operation, int fd,
+--     const void *address, unsigned int length, off_t offset,
+--     unsigned long long data);
+-- int uringSubmit(struct uring *ring, unsigned int wait);
+-- struct io_uring_cqe *uringPeek(struct uring *ring);
+-- void uringAdvance(struct uring *ring);
+-- int uringRegisterBuffers(struct uring *ring, const struct iovec *buffers,
+--     unsigned int count);
+-- int uringRegisterFiles(struct uring *ring, const int *files,
+--     unsigned int count);
+-- int uringSupports(struct uring *ring, const unsigned char *operations,
+--     unsigned int count);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Probes the operations of the kernel.
+--
+-- NOTES:
+-- This file contains a small wrapper around the io_uring system calls, in the
+-- same spirit as the socket wrappers in network.c. Operations are prepared in
+-- the submission queue with uringGetSqe and uringPrepare and handed to the
+-- kernel in one batch by uringSubmit, which also waits for completions. The
+-- results are read from the completion queue with uringPeek and uringAdvance.
+--
+-- The system calls are made directly, no library is needed. On a kernel
+-- without io_uring uringSetup fails and the caller falls back to epoll. A
+-- kernel that has io_uring may still lack some of its operations, which the
+-- caller checks with uringSupports.
+*/
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uring.h"
+
+// Operations asked about by a probe, enough for every opcode there is
+#define PROBE_OPS 256
+
+/*
+-- FUNCTION: uringSetup
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int uringSetup(struct uring *ring, unsigned int entries,
+--                           unsigned int completions);
+--
+-- RETURNS: 0 on success or -1 if io_uring is not available
+--
+-- NOTES:
+-- This function creates an io_uring instance with room for entries
+-- submissions and completions completions and maps its queues. The completion
+-- queue is made larger than the submission queue so every connection can have
+-- operations in flight without the queue overflowing.
+*/
+int uringSetup(struct uring *ring, unsigned int entries,
+    unsigned int completions)
+{
+    struct io_uring_params params;
+    char *sq = NULL;
+    char *cq = NULL;
+
+    memset(ring, 0, sizeof(struct uring));
+    memset(&params, 0, sizeof(struct io_uring_params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = completions;
+
+    if ((ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params)) == -1)
+    {
+        return -1;
+    }
+    ring->features = params.features;
+
+    ring->sqRingSize = params.sq_off.array +
+        params.sq_entries * sizeof(unsigned int);
+    ring->cqRingSize = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // Newer kernels map both rings with a single mmap
+    if (ring->features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cqRingSize > ring->sqRingSize)
+        {
+            ring->sqRingSize = ring->cqRingSize;
+        }
+        ring->cqRingSize = 0;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED)
+    {
+        close(ring->fd);
+        return -1;
+    }
+    if (ring->cqRingSize == 0)
+    {
+        ring->cqRing = ring->sqRing;
+    }
+    else
+    {
+        ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED)
+        {
+            munmap(ring->sqRing, ring->sqRingSize);
+            close(ring->fd);
+            return -1;
+        }
+    }
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqesSize,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+        IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        if (ring->cqRingSize != 0)
+        {
+            munmap(ring->cqRing, ring->cqRingSize);
+        }
+        munmap(ring->sqRing, ring->sqRingSize);
+        close(ring->fd);
+        return -1;
+    }
+
+    sq = (char*)ring->sqRing;
+    cq = (char*)ring->cqRing;
+    ring->sqHead = (unsigned int*)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned int*)(sq + params.sq_off.tail);
+    ring->sqMask = *(unsigned int*)(sq + params.sq_off.ring_mask);
+    ring->sqEntries = params.sq_entries;
+    ring->sqArray = (unsigned int*)(sq + params.sq_off.array);
+    ring->sqLocalTail = *ring->sqTail;
+    ring->cqHead = (unsigned int*)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned int*)(cq + params.cq_off.tail);
+    ring->cqMask = *(unsigned int*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    return 0;
+}
+
+/*
+-- FUNCTION: uringDestroy
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void uringDestroy(struct uring *ring);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function unmaps the queues and closes the instance. Operations still
+-- in flight are cancelled by the kernel.
+*/
+void uringDestroy(struct uring *ring)
+{
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRingSize != 0)
+    {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+}
+
+/*
+-- FUNCTION: uringGetSqe
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: struct io_uring_sqe *uringGetSqe(struct uring *ring);
+--
+-- RETURNS: a cleared submission queue entry or NULL if the queue is full
+--
+-- NOTES:
+-- This function reserves the next entry of the submission queue. If the queue
+-- is full the entries prepared so far are submitted first to make room.
+*/
+struct io_uring_sqe *uringGetSqe(struct uring *ring)
+{
+    struct io_uring_sqe *sqe = NULL;
+    unsigned int head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+
+    if (ring->sqLocalTail - head >= ring->sqEntries)
+    {
+        if (uringSubmit(ring, 0) == -1)
+        {
+            return NULL;
+        }
+        head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+        if (ring->sqLocalTail - head >= ring->sqEntries)
+        {
+            return NULL;
+        }
+    }
+
+    sqe = &ring->sqes[ring->sqLocalTail & ring->sqMask];
+    ring->sqArray[ring->sqLocalTail & ring->sqMask] =
+        ring->sqLocalTail & ring->sqMask;
+    ring->sqLocalTail++;
+    ring->toSubmit++;
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    return sqe;
+}
+
+/*
+-- FUNCTION: uringSpace
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: unsigned int uringSpace(struct uring *ring);
+--
+-- RETURNS: the number of free entries in the submission queue
+--
+-- NOTES:
+-- Operations that are linked must be submitted together. Callers check that
+-- there is room for the whole chain before preparing it, otherwise
+-- uringGetSqe could submit the first half of the chain on its own.
+*/
+unsigned int uringSpace(struct uring *ring)
+{
+    return ring->sqEntries - (ring->sqLocalTail -
+        __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE));
+}
+
+/*
+-- FUNCTION: uringPrepare
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void uringPrepare(struct io_uring_sqe *sqe, int operation,
+--                              int fd, const void *address,
+--                              unsigned int length, off_t offset,
+--                              unsigned long long data);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function fills in the fields every operation has. The data is handed
+-- back unchanged in the completion. Flags specific to an operation, such as
+-- the message flags of a send, are set by the caller afterwards.
+*/
+void uringPrepare(struct io_uring_sqe *sqe, int operation, int fd,
+    const void *address, unsigned int length, off_t offset,
+    unsigned long long data)
+{
+    sqe->opcode = (unsigned char)operation;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long long)(unsigned long)address;
+    sqe->len = length;
+    sqe->off = (unsigned long long)offset;
+    sqe->user_data = data;
+}
+
+/*
+-- FUNCTION: uringSubmit
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int uringSubmit(struct uring *ring, unsigned int wait);
+--
+-- RETURNS: the number of entries submitted or -1 on failure with errno set
+--
+-- NOTES:
+-- This function hands every prepared entry to the kernel and, if wait is not
+-- zero, blocks until at least wait completions are available. Both happen in
+-- a single system call.
+*/
+int uringSubmit(struct uring *ring, unsigned int wait)
+{
+    int submitted = 0;
+
+    __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+
+    if ((submitted = (int)syscall(__NR_io_uring_enter, ring->fd,
+        ring->toSubmit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL,
+        0)) == -1)
+    {
+        return -1;
+    }
+    ring->toSubmit -= submitted;
+
+    return submitted;
+}
+
+/*
+-- FUNCTION: uringPeek
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: struct io_uring_cqe *uringPeek(struct uring *ring);
+--
+-- RETURNS: the oldest completion or NULL if there is none
+--
+-- NOTES:
+-- This function looks at the completion queue without waiting. The completion
+-- stays in the queue until uringAdvance is called.
+*/
+struct io_uring_cqe *uringPeek(struct uring *ring)
+{
+    unsigned int head = *ring->cqHead;
+
+    if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    return &ring->cqes[head & ring->cqMask];
+}
+
+/*
+-- FUNCTION: uringAdvance
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void uringAdvance(struct uring *ring);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function gives the oldest completion back to the kernel.
+*/
+void uringAdvance(struct uring *ring)
+{
+    __atomic_store_n(ring->cqHead, *ring->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+/*
+-- FUNCTION: uringRegisterBuffers
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int uringRegisterBuffers(struct uring *ring,
+--                                     const struct iovec *buffers,
+--                                     unsigned int count);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function pins the buffers in memory so the kernel does not have to map
+-- them for every read or write. Registered buffers are used with the fixed
+-- read and write operations and their index in the array.
+*/
+int uringRegisterBuffers(struct uring *ring, const struct iovec *buffers,
+    unsigned int count)
+{
+    return (int)syscall(__NR_io_uring_register, ring->fd,
+        IORING_REGISTER_BUFFERS, buffers, count) == -1 ? -1 : 0;
+}
+
+/*
+-- FUNCTION: uringRegisterFiles
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int uringRegisterFiles(struct uring *ring, const int *files,
+--                                   unsigned int count);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function registers a table of file descriptors. Entries of -1 are
+-- empty slots that can be filled later with IORING_OP_FILES_UPDATE. An
+-- operation flagged with IOSQE_FIXED_FILE names a slot instead of a
+-- descriptor, which saves the kernel looking the descriptor up every time.
+*/
+int uringRegisterFiles(struct uring *ring, const int *files,
+    unsigned int count)
+{
+    return (int)syscall(__NR_io_uring_register, ring->fd,
+        IORING_REGISTER_FILES, files, count) == -1 ? -1 : 0;
+}
+
+/*
+-- FUNCTION: uringSupports
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int uringSupports(struct uring *ring,
+--                              const unsigned char *operations,
+--                              unsigned int count);
+--
+-- RETURNS: 1 if the kernel supports every operation, 0 otherwise
+--
+-- NOTES:
+-- This function asks the kernel which operations the ring supports with
+-- IORING_REGISTER_PROBE. An operation the kernel does not know fails every
+-- time it is submitted, so a caller that needs it should not use the ring.
+-- A kernel too old to be probed supports none of them.
+*/
+int uringSupports(struct uring *ring, const unsigned char *operations,
+    unsigned int count)
+{
+    struct io_uring_probe *probe = NULL;
+    int supported = 1;
+    unsigned int i = 0;
+
+    if ((probe = (struct io_uring_probe*)calloc(1,
+        sizeof(struct io_uring_probe) +
+        PROBE_OPS * sizeof(struct io_uring_probe_op))) == NULL)
+    {
+        return 0;
+    }
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE,
+        probe, PROBE_OPS) == -1)
+    {
+        free(probe);
+        return 0;
+    }
+
+    for (i = 0; i < count && supported; i++)
+    {
+        supported = operations[i] <= probe->last_op &&
+            (probe->ops[operations[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    free(probe);
+    return supported;
+}
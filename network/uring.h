@@ -0,0 +1,57 @@
+#ifndef URING_H
+#define URING_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+// An io_uring instance with its mapped submission and completion queues
+struct uring
+{
+    int fd;
+    unsigned int features;
+    unsigned int *sqHead;
+    unsigned int *sqTail;
+    unsigned int sqMask;
+    unsigned int sqEntries;
+    unsigned int *sqArray;
+    unsigned int sqLocalTail;
+    unsigned int toSubmit;
+    struct io_uring_sqe *sqes;
+    unsigned int *cqHead;
+    unsigned int *cqTail;
+    unsigned int cqMask;
+    struct io_uring_cqe *cqes;
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int uringSetup(struct uring *ring, unsigned int entries,
+    unsigned int completions);
+void uringDestroy(struct uring *ring);
+struct io_uring_sqe *uringGetSqe(struct uring *ring);
+unsigned int uringSpace(struct uring *ring);
+void uringPrepare(struct io_uring_sqe *sqe, int operation, int fd,
+    const void *address, unsigned int length, off_t offset,
+    unsigned long long data);
+int uringSubmit(struct uring *ring, unsigned int wait);
+struct io_uring_cqe *uringPeek(struct uring *ring);
+void uringAdvance(struct uring *ring);
+int uringRegisterBuffers(struct uring *ring, const struct iovec *buffers,
+    unsigned int count);
+int uringRegisterFiles(struct uring *ring, const int *files,
+    unsigned int count);
+int uringSupports(struct uring *ring, const unsigned char *operations,
+    unsigned int count);
+#ifdef __cplusplus
+}
+#endif
+#endif
+
@@ -0,0 +1,509 @@
+/*
+-- SOURCE FILE: verify.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int startVerifier(struct verifier *verifier, int file, off_t offset,
+--                   off_t length, int receiving);
+-- int stopVerifier(struct verifier *verifier);
+-- int chunkLeft(const struct verifier *verifier, off_t count, int size);
+-- int sendChecksums(int socket, struct verifier *verifier, off_t count);
+-- int takeChecksums(int socket, struct verifier *verifier, off_t count);
+-- int sendVerified(int socket, int file, off_t offset, off_t length);
+-- static void *hashChunks(void *argument);
+-- static int hashChunk(struct verifier *verifier, off_t offset, off_t length,
+--                      unsigned int *sum);
+-- static off_t chunkEnd(const struct verifier *verifier, off_t count);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- NOTES:
+-- This file contains verified transfers. A client asks for them with
+-- FLAG_VERIFY. The body is then followed every VERIFY_CHUNK bytes by the
+-- CRC32C of that chunk, see checksum.c, and the last chunk also by the CRC32C
+-- of the whole body. The receiver checks every chunk as it arrives and the
+-- whole body at the end, and a mismatch fails the transfer. Chunks are counted
+-- in bytes of the file, so a compressed body has its checksums after the
+-- frame that ends a chunk.
+--
+-- Neither end looks at the data as it moves, the sender uses sendfile and the
+-- receiver splice. Instead each end has a thread that reads the range back
+-- from the file with pread and checksums it. The sender's thread runs ahead of
+-- sendfile, so it also reads the file into the page cache before sendfile
+-- needs it. The receiver's thread runs behind the socket, checking each chunk
+-- once it is on disk and its checksum has arrived, so what is checked is what
+-- was written. The threads and the caller hand checksums over in a ring of
+-- VERIFY_SLOTS slots.
+--
+-- The receiver keeps the length of the body that checked out, so a receiver
+-- can cut a file back to it and a resumed transfer carries on from there.
+*/
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "network.h"
+#include "verify.h"
+#include "transfer.h"
+#include "checksum.h"
+
+// Bytes the hashing thread reads from the file at a time
+#define HASH_READ	262144
+
+static void *hashChunks(void *argument);
+static int hashChunk(struct verifier *verifier, off_t offset, off_t length,
+                     unsigned int *sum);
+static off_t chunkEnd(const struct verifier *verifier, off_t count);
+
+/*
+-- FUNCTION: startVerifier
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int startVerifier(struct verifier *verifier, int file,
+--                              off_t offset, off_t length, int receiving);
+--
+-- RETURNS: 0 on success or -1 if the thread could not be started
+--
+-- NOTES:
+-- This function starts the hashing thread on length bytes of the file
+-- starting at offset, the range the body is moved for. A receiver's file must
+-- be open for reading as well as writing.
+*/
+int startVerifier(struct verifier *verifier, int file, off_t offset,
+                  off_t length, int receiving)
+{
+    bzero(verifier, sizeof(struct verifier));
+    verifier->file = file;
+    verifier->offset = offset;
+    verifier->length = length;
+    verifier->receiving = receiving;
+    if ((verifier->buffer = (char*)malloc(HASH_READ)) == NULL)
+    {
+        return -1;
+    }
+
+    pthread_mutex_init(&verifier->lock, NULL);
+    pthread_cond_init(&verifier->ready, NULL);
+    pthread_cond_init(&verifier->freed, NULL);
+    if (pthread_create(&verifier->thread, NULL, hashChunks, verifier) != 0)
+    {
+        pthread_cond_destroy(&verifier->freed);
+        pthread_cond_destroy(&verifier->ready);
+        pthread_mutex_destroy(&verifier->lock);
+        free(verifier->buffer);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: stopVerifier
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int stopVerifier(struct verifier *verifier);
+--
+-- RETURNS: 0 if every chunk checked out or -1 if not
+--
+-- NOTES:
+-- This function stops the hashing thread and waits for it. A receiver's
+-- thread first checks the chunks whose checksums have arrived, so once the
+-- whole body is received this says whether it was right. Afterwards checked
+-- holds the bytes of the body at the start of the range that are known to be
+-- right.
+*/
+int stopVerifier(struct verifier *verifier)
+{
+    pthread_mutex_lock(&verifier->lock);
+    verifier->stop = 1;
+    pthread_cond_broadcast(&verifier->ready);
+    pthread_cond_broadcast(&verifier->freed);
+    pthread_mutex_unlock(&verifier->lock);
+    pthread_join(verifier->thread, NULL);
+
+    pthread_cond_destroy(&verifier->freed);
+    pthread_cond_destroy(&verifier->ready);
+    pthread_mutex_destroy(&verifier->lock);
+    free(verifier->buffer);
+    verifier->buffer = NULL;
+
+    if (verifier->failed ||
+        (verifier->receiving && verifier->checked < verifier->length))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+-- FUNCTION: chunkLeft
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int chunkLeft(const struct verifier *verifier, off_t count,
+--                          int size);
+--
+-- RETURNS: the bytes a receiver may take next
+--
+-- NOTES:
+-- This function cuts size, the bytes a receiver wants to take from the socket
+-- after count bytes of the body, to the end of the chunk they are in, so the
+-- checksum after it is not taken for data. Without a verifier size is
+-- returned as it is.
+*/
+int chunkLeft(const struct verifier *verifier, off_t count, int size)
+{
+    if (verifier == NULL || chunkEnd(verifier, count) - count >= size)
+    {
+        return size;
+    }
+
+    return (int)(chunkEnd(verifier, count) - count);
+}
+
+/*
+-- FUNCTION: sendChecksums
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendChecksums(int socket, struct verifier *verifier,
+--                              off_t count);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function is called by the sender after count bytes of the body were
+-- sent. When they end a chunk its checksum is taken from the thread, waiting
+-- for it if the thread is behind, and sent. The last one is sent with the
+-- whole checksum. A thread that could not read the file is a failure. Without
+-- a verifier nothing is sent.
+*/
+int sendChecksums(int socket, struct verifier *verifier, off_t count)
+{
+    char trailer[VERIFY_LAST];
+    int size = VERIFY_SUM;
+
+    if (verifier == NULL || count <= verifier->done ||
+        count != chunkEnd(verifier, verifier->done))
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&verifier->lock);
+    while (verifier->filled == 0 && !verifier->failed)
+    {
+        pthread_cond_wait(&verifier->ready, &verifier->lock);
+    }
+    if (verifier->failed)
+    {
+        pthread_mutex_unlock(&verifier->lock);
+        return -1;
+    }
+    memmove(trailer, (void*)&verifier->sums[verifier->head], sizeof(int));
+    verifier->head = (verifier->head + 1) % VERIFY_SLOTS;
+    verifier->filled--;
+    pthread_cond_signal(&verifier->freed);
+    pthread_mutex_unlock(&verifier->lock);
+
+    // The whole checksum is ready once the last chunk's is
+    if (count == verifier->length)
+    {
+        memmove(trailer + VERIFY_SUM, (void*)&verifier->whole, sizeof(int));
+        size = VERIFY_LAST;
+    }
+    verifier->done = count;
+    return sendAll(&socket, trailer, size);
+}
+
+/*
+-- FUNCTION: takeChecksums
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int takeChecksums(int socket, struct verifier *verifier,
+--                              off_t count);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function is called by the receiver after count bytes of the body are
+-- in the file. When they end a chunk its checksum is read from the socket and
+-- handed to the thread, waiting for a free slot if the thread is behind. A
+-- chunk the thread already found wrong fails the transfer here, so it stops
+-- within a few chunks of the damage. Without a verifier nothing is read.
+*/
+int takeChecksums(int socket, struct verifier *verifier, off_t count)
+{
+    char trailer[VERIFY_LAST];
+    int size = VERIFY_SUM;
+    int tail = 0;
+
+    if (verifier == NULL || count <= verifier->done ||
+        count != chunkEnd(verifier, verifier->done))
+    {
+        return 0;
+    }
+
+    if (count == verifier->length)
+    {
+        size = VERIFY_LAST;
+    }
+    if (readAll(&socket, trailer, size) == -1)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&verifier->lock);
+    while (verifier->filled == VERIFY_SLOTS && !verifier->failed)
+    {
+        pthread_cond_wait(&verifier->freed, &verifier->lock);
+    }
+    if (verifier->failed)
+    {
+        pthread_mutex_unlock(&verifier->lock);
+        return -1;
+    }
+    if (size == VERIFY_LAST)
+    {
+        memmove((void*)&verifier->expected, trailer + VERIFY_SUM,
+            sizeof(int));
+    }
+    tail = (verifier->head + verifier->filled) % VERIFY_SLOTS;
+    memmove((void*)&verifier->sums[tail], trailer, sizeof(int));
+    verifier->filled++;
+    pthread_cond_signal(&verifier->ready);
+    pthread_mutex_unlock(&verifier->lock);
+
+    verifier->done = count;
+    return 0;
+}
+
+/*
+-- FUNCTION: sendVerified
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendVerified(int socket, int file, off_t offset,
+--                             off_t length);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function is sendRange with checksums. The range is sent a chunk at a
+-- time with sendfile, each followed by its checksum from the hashing thread.
+*/
+int sendVerified(int socket, int file, off_t offset, off_t length)
+{
+    struct verifier verifier;
+    off_t count = 0;
+    off_t size = 0;
+    int result = 0;
+
+    if (startVerifier(&verifier, file, offset, length, 0) == -1)
+    {
+        return -1;
+    }
+
+    while (count < length && result == 0)
+    {
+        size = chunkEnd(&verifier, count) - count;
+        if (sendRange(socket, file, offset + count, size) == -1)
+        {
+            result = -1;
+            break;
+        }
+        count += size;
+        result = sendChecksums(socket, &verifier, count);
+    }
+
+    if (stopVerifier(&verifier) == -1)
+    {
+        result = -1;
+    }
+    return result;
+}
+
+/*
+-- FUNCTION: hashChunks
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void *hashChunks(void *argument);
+--
+-- RETURNS: NULL
+--
+-- NOTES:
+-- This is the hashing thread. A sender's thread checksums the chunks in order
+-- and puts each checksum in the ring, waiting whenever every slot is full. A
+-- receiver's thread waits for the checksum of each chunk to be put in the
+-- ring, then checksums the chunk and compares, and after the last chunk
+-- compares the whole checksum. Either thread stops at the first failure, a
+-- sender's as soon as it is told to stop and a receiver's once the ring is
+-- empty as well.
+*/
+static void *hashChunks(void *argument)
+{
+    struct verifier *verifier = (struct verifier*)argument;
+    unsigned int sum = 0;
+    off_t count = 0;
+    off_t end = 0;
+
+    for (; count < verifier->length; count = end)
+    {
+        end = chunkEnd(verifier, count);
+
+        pthread_mutex_lock(&verifier->lock);
+        while (!verifier->stop && (verifier->receiving ?
+            verifier->filled == 0 : verifier->filled == VERIFY_SLOTS))
+        {
+            pthread_cond_wait(verifier->receiving ? &verifier->ready :
+                &verifier->freed, &verifier->lock);
+        }
+        if (verifier->stop &&
+            (!verifier->receiving || verifier->filled == 0))
+        {
+            pthread_mutex_unlock(&verifier->lock);
+            break;
+        }
+        pthread_mutex_unlock(&verifier->lock);
+
+        if (hashChunk(verifier, verifier->offset + count, end - count,
+            &sum) == -1)
+        {
+            break;
+        }
+
+        pthread_mutex_lock(&verifier->lock);
+        if (!verifier->receiving)
+        {
+            verifier->sums[(verifier->head + verifier->filled) %
+                VERIFY_SLOTS] = sum;
+            verifier->filled++;
+            pthread_cond_signal(&verifier->ready);
+        }
+        else if (sum != verifier->sums[verifier->head] ||
+            (end == verifier->length && verifier->whole !=
+            verifier->expected))
+        {
+            verifier->failed = 1;
+        }
+        else
+        {
+            verifier->head = (verifier->head + 1) % VERIFY_SLOTS;
+            verifier->filled--;
+            verifier->checked = end;
+            pthread_cond_signal(&verifier->freed);
+        }
+        pthread_mutex_unlock(&verifier->lock);
+        if (verifier->failed)
+        {
+            break;
+        }
+    }
+
+    // Wake a caller waiting on a thread that is gone
+    pthread_mutex_lock(&verifier->lock);
+    if (count < verifier->length && !verifier->stop)
+    {
+        verifier->failed = 1;
+    }
+    pthread_cond_broadcast(&verifier->ready);
+    pthread_cond_broadcast(&verifier->freed);
+    pthread_mutex_unlock(&verifier->lock);
+    return NULL;
+}
+
+/*
+-- FUNCTION: hashChunk
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int hashChunk(struct verifier *verifier, off_t offset,
+--                                 off_t length, unsigned int *sum);
+--
+-- RETURNS: 0 on success or -1 if the file could not be read
+--
+-- NOTES:
+-- This function checksums length bytes of the file starting at offset into
+-- sum and adds them to the whole checksum, reading the file once for both.
+-- A failure to read is recorded in the verifier.
+*/
+static int hashChunk(struct verifier *verifier, off_t offset, off_t length,
+                     unsigned int *sum)
+{
+    ssize_t bytesRead = 0;
+
+    *sum = 0;
+    while (length > 0)
+    {
+        bytesRead = pread(verifier->file, verifier->buffer,
+            length < HASH_READ ? length : HASH_READ, offset);
+        if (bytesRead <= 0)
+        {
+            if (bytesRead == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            pthread_mutex_lock(&verifier->lock);
+            verifier->failed = 1;
+            pthread_mutex_unlock(&verifier->lock);
+            return -1;
+        }
+        *sum = crc32c(*sum, verifier->buffer, bytesRead);
+        verifier->whole = crc32c(verifier->whole, verifier->buffer,
+            bytesRead);
+        offset += bytesRead;
+        length -= bytesRead;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: chunkEnd
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static off_t chunkEnd(const struct verifier *verifier,
+--                                  off_t count);
+--
+-- RETURNS: the bytes of the body at the end of the chunk
+--
+-- NOTES:
+-- This function works out where the chunk that the byte count of the body
+-- is in ends. Chunks are counted from the start of the body, the last one
+-- ends with the body and may be shorter.
+*/
+static off_t chunkEnd(const struct verifier *verifier, off_t count)
+{
+    off_t end = (count / VERIFY_CHUNK + 1) * VERIFY_CHUNK;
+
+    return end < verifier->length ? end : verifier->length;
+}
@@ -0,0 +1,55 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <sys/types.h>
+#include <pthread.h>
+
+// Bytes of the body between checksums, a whole number of compressed blocks
+#define VERIFY_CHUNK	4194304
+
+// Checksums the hashing thread can get ahead of the socket or fall behind it
+#define VERIFY_SLOTS	4
+
+// Bytes of a chunk checksum, and of the last one with the whole checksum
+#define VERIFY_SUM		4
+#define VERIFY_LAST		8
+
+// The thread that checksums the range of a file a body is moved for, and the
+// ring of chunk checksums it shares with the caller, guarded by the lock
+struct verifier
+{
+    int file;
+    off_t offset;
+    off_t length;
+    int receiving;
+    char *buffer;
+    unsigned int sums[VERIFY_SLOTS];
+    int head;
+    int filled;
+    int stop;
+    off_t done;
+    off_t checked;
+    unsigned int whole;
+    unsigned int expected;
+    int failed;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_cond_t freed;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int startVerifier(struct verifier *verifier, int file, off_t offset,
+                  off_t length, int receiving);
+int stopVerifier(struct verifier *verifier);
+int chunkLeft(const struct verifier *verifier, off_t count, int size);
+int sendChecksums(int socket, struct verifier *verifier, off_t count);
+int takeChecksums(int socket, struct verifier *verifier, off_t count);
+int sendVerified(int socket, int file, off_t offset, off_t length);
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,1346 @@
+/*
+-- SOURCE FILE: filecache.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int startFileCache(int capacity, long long hotCapacity);
+-- struct cachedFile *openCached(const char *path, const char **contents);
+-- void releaseCached(struct cachedFile *entry);
+-- void readFileCacheStats(struct fileCacheStats *stats);
+-- int fillCachedVector(struct iovec *vector, const char *contents,
+--                      const char *header, int headerSent, off_t offset,
+--                      off_t end);
+-- static int startShard(struct cacheShard *shard, int capacity,
+--                       long long hotCapacity);
+-- static void *watchCached(void *argument);
+-- static void dropWatched(int watch);
+-- static void reportRequested(int signal);
+-- static void printFileCacheStats();
+-- static struct cachedFile *findCached(struct cacheShard *shard,
+--                                      const char *path);
+-- static int checkCached(struct cacheShard *shard,
+--                        struct cachedFile *entry);
+-- static int addCached(struct cacheShard *shard, struct cachedFile *entry);
+-- static void dropCached(struct cacheShard *shard,
+--                        struct cachedFile *entry);
+-- static void destroyCached(struct cacheShard *shard,
+--                           struct cachedFile *entry);
+-- static void watchFile(struct cachedFile *entry, const char *path);
+-- static void unwatchCached(struct cachedFile *entry);
+-- static struct watchUsers **findWatch(int watch);
+-- static int admitHot(struct cacheShard *shard, struct cachedFile *entry,
+--                     unsigned int hash);
+-- static void loadHot(struct cacheShard *shard, struct cachedFile *entry,
+--                    const char **contents);
+-- static void addSketch(struct cacheShard *shard, unsigned int hash);
+-- static unsigned int countSketch(struct cacheShard *shard,
+--                                 unsigned int hash);
+-- static unsigned int hashPath(const char *path);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Keeps small hot files in memory.
+-- October 17, 2026 - Splits the cache into shards by the hash of the path
+-- and finds the files of an event by their watch.
+--
+-- NOTES:
+-- This file contains the cache of open files of the event driven servers. A
+-- popular file would otherwise be opened, looked at with fstat and closed
+-- again by every client that gets it. Instead the descriptor and the result
+-- of fstat are kept and shared by every transfer of the file, which is safe
+-- as every transfer reads at its own offsets. The cache holds at most its
+-- capacity of files and drops the one used longest ago that no transfer is
+-- using. Every reactor thread uses the same cache.
+--
+-- So that the threads do not all wait on one lock, the cache is split into
+-- up to CACHE_SHARDS shards by the hash of the path. Each shard has its own
+-- lock, table, list from the file used last to the one used longest ago,
+-- share of the capacity and of the bytes kept in memory, and sketch. A get
+-- only takes the lock of the shard of its path.
+--
+-- Every cached file is watched with inotify by a thread of the cache, and any
+-- change to it, to its attributes or its links, and moving it drops it from
+-- the cache, so the next client opens it again. Transfers already using it
+-- go on with the descriptor they have, like an open file that is changed
+-- under them. Without inotify every use of a cached file checks with stat
+-- that the path still names the same file, unchanged. Every shard keeps its
+-- cached files in a second table by watch, so an event finds its files
+-- without going through the cache. The same file under two paths, which may
+-- be in two shards, shares its watch, so how many files use each watch is
+-- counted in a table of its own, behind a lock that is always taken last.
+--
+-- Small cached files that are asked for often also have their contents kept
+-- in memory, up to a budget of bytes. Such a file is sent with its size
+-- control message in one writev rather than a send and a sendfile. Which
+-- files get in is decided like TinyLFU: every request counts the path in a
+-- small sketch of how often paths are asked for, with counters that are
+-- halved now and then so old popularity fades. A file only takes the place
+-- of files kept in memory when it is asked for more often than each of them,
+-- so a scan through many files once does not push out the few hot ones.
+--
+-- The server prints what the cache has done when it gets SIGUSR1, which the
+-- thread of the cache is the only one to take.
+*/
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "filecache.h"
+#include "../network/network.h"
+
+// Bytes of events read at once
+#define CACHE_EVENTS 4096
+
+// Events of a cached file
+#define CACHED_EVENTS (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | \
+    IN_MOVE_SELF | IN_DELETE_SELF)
+
+// Counters of the frequency sketch per file of the cache, at least
+#define SKETCH_COUNTERS 8
+#define MIN_SKETCH_WIDTH 4096
+
+// Counters of the sketch a path counts in, and the most a counter holds
+#define SKETCH_DEPTH 4
+#define SKETCH_LIMIT 15
+
+// Most shards of the cache, a power of two, and the bits of the hash of a
+// path that pick its shard, above those that pick its chain
+#define CACHE_SHARDS 16
+#define SHARD_SHIFT 24
+
+// Chains of the table of watches
+#define WATCH_BUCKETS 1024
+
+// A part of the cache, the files whose paths hash to it. The table of
+// cached files by path, the table of them by watch and the list of them from
+// the one used last to the one used longest ago are guarded by the lock. The
+// sketch counts how often paths were asked for since it was last halved.
+struct cacheShard
+{
+    struct cachedFile **buckets;
+    struct cachedFile **watched;
+    int bucketCount;
+    struct cachedFile *newest;
+    struct cachedFile *oldest;
+    int count;
+    int capacity;
+    unsigned char *sketch;
+    unsigned int sketchMask;
+    unsigned int samples;
+    struct fileCacheStats stats;
+    pthread_mutex_t lock;
+};
+
+// How many files, cached or not, use a watch
+struct watchUsers
+{
+    int watch;
+    int users;
+    struct watchUsers *next;
+};
+
+// The shards, and the watches by number guarded by their own lock
+struct fileCache
+{
+    struct cacheShard shards[CACHE_SHARDS];
+    int shardCount;
+    int notify;
+    int started;
+    struct watchUsers *watches[WATCH_BUCKETS];
+    pthread_mutex_t watchLock;
+    pthread_t thread;
+};
+
+static int startShard(struct cacheShard *shard, int capacity,
+                      long long hotCapacity);
+static void *watchCached(void *argument);
+static void dropWatched(int watch);
+static void reportRequested(int signal);
+static void printFileCacheStats();
+static struct cachedFile *findCached(struct cacheShard *shard,
+                                     const char *path);
+static int checkCached(struct cacheShard *shard, struct cachedFile *entry);
+static int addCached(struct cacheShard *shard, struct cachedFile *entry);
+static void dropCached(struct cacheShard *shard, struct cachedFile *entry);
+static void destroyCached(struct cacheShard *shard,
+                          struct cachedFile *entry);
+static void watchFile(struct cachedFile *entry, const char *path);
+static void unwatchCached(struct cachedFile *entry);
+static struct watchUsers **findWatch(int watch);
+static int admitHot(struct cacheShard *shard, struct cachedFile *entry,
+                    unsigned int hash);
+static void loadHot(struct cacheShard *shard, struct cachedFile *entry,
+                    const char **contents);
+static void addSketch(struct cacheShard *shard, unsigned int hash);
+static unsigned int countSketch(struct cacheShard *shard, unsigned int hash);
+static unsigned int hashPath(const char *path);
+
+// The cache of this server, one shard until it is started
+static struct fileCache fileCache = {
+    .shards = {{ .lock = PTHREAD_MUTEX_INITIALIZER }},
+    .shardCount = 1,
+    .notify = -1,
+    .watchLock = PTHREAD_MUTEX_INITIALIZER
+};
+
+// Set by SIGUSR1 until the cache statistics are printed
+static volatile sig_atomic_t reportWanted = 0;
+
+/*
+-- FUNCTION: startFileCache
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Keeps up to hotCapacity bytes of small files
+-- in memory.
+-- October 17, 2026 - Splits the files and the bytes between the shards.
+--
+-- INTERFACE: int startFileCache(int capacity, long long hotCapacity);
+--
+-- RETURNS: 0 on success or -1 if files are never cached
+--
+-- NOTES:
+-- This function sets up a cache of at most capacity files, of which at most
+-- hotCapacity bytes are kept in memory, and starts the thread that watches
+-- them. It must be called before any other thread is started, they inherit
+-- the blocked SIGUSR1 from the calling thread. A capacity of 0 turns the
+-- cache off, every file is opened for its transfer, and a hotCapacity of 0
+-- keeps no files in memory.
+--
+-- The capacity and hotCapacity are split evenly between the shards, so a
+-- shard holds at least one file. A shard that is full drops its own files
+-- even while another shard has room.
+*/
+int startFileCache(int capacity, long long hotCapacity)
+{
+    struct sigaction action;
+    sigset_t report;
+    int shards = 0;
+    int i = 0;
+
+    if (fileCache.started || capacity <= 0)
+    {
+        return capacity <= 0 ? -1 : 0;
+    }
+
+    for (shards = 1; shards * 2 <= CACHE_SHARDS && shards * 2 <= capacity;
+        shards *= 2)
+    {
+    }
+    for (i = 0; i < shards; i++)
+    {
+        if (startShard(&fileCache.shards[i],
+            capacity / shards + (i < capacity % shards),
+            hotCapacity / shards + (i < hotCapacity % shards)) == -1)
+        {
+            return -1;
+        }
+    }
+    fileCache.shardCount = shards;
+    fileCache.started = 1;
+
+    if ((fileCache.notify = inotify_init1(IN_CLOEXEC)) == -1)
+    {
+        perror("Cached Files Are Checked With stat");
+        return 0;
+    }
+
+    // Only the thread of the cache takes SIGUSR1, it interrupts its read
+    bzero(&action, sizeof(struct sigaction));
+    action.sa_handler = reportRequested;
+    sigaction(SIGUSR1, &action, NULL);
+    sigemptyset(&report);
+    sigaddset(&report, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &report, NULL);
+
+    if (pthread_create(&fileCache.thread, NULL, watchCached, &fileCache) != 0)
+    {
+        perror("Cached Files Are Checked With stat");
+        close(fileCache.notify);
+        fileCache.notify = -1;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: startShard
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int startShard(struct cacheShard *shard, int capacity,
+--                                  long long hotCapacity);
+--
+-- RETURNS: 0 on success or -1 if its tables can not be made
+--
+-- NOTES:
+-- This function sets up a shard of at most capacity files, of which at most
+-- hotCapacity bytes are kept in memory. A shard that can not keep files in
+-- memory still caches them open.
+*/
+static int startShard(struct cacheShard *shard, int capacity,
+                      long long hotCapacity)
+{
+    pthread_mutex_init(&shard->lock, NULL);
+
+    // Twice as many chains as files keeps them short
+    shard->capacity = capacity;
+    for (shard->bucketCount = 1; shard->bucketCount < capacity * 2;
+        shard->bucketCount *= 2)
+    {
+    }
+    if ((shard->buckets = (struct cachedFile**)calloc(
+        shard->bucketCount, sizeof(struct cachedFile*))) == NULL ||
+        (shard->watched = (struct cachedFile**)calloc(
+        shard->bucketCount, sizeof(struct cachedFile*))) == NULL)
+    {
+        free(shard->buckets);
+        shard->buckets = NULL;
+        return -1;
+    }
+
+    // Enough counters that few hot paths share all theirs with another path
+    for (shard->sketchMask = MIN_SKETCH_WIDTH;
+        shard->sketchMask < (unsigned int)capacity * SKETCH_COUNTERS;
+        shard->sketchMask *= 2)
+    {
+    }
+    if (hotCapacity > 0 && (shard->sketch = (unsigned char*)calloc(
+        shard->sketchMask, sizeof(unsigned char))) != NULL)
+    {
+        shard->stats.hotCapacity = hotCapacity;
+    }
+    shard->sketchMask--;
+
+    return 0;
+}
+
+/*
+-- FUNCTION: openCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Gives the contents of a file kept in memory.
+--
+-- INTERFACE: struct cachedFile *openCached(const char *path,
+--                                          const char **contents);
+--
+-- RETURNS: the open file, or NULL with errno set if it can not be opened
+--
+-- NOTES:
+-- This function gives the open file path, from the cache if it is there and
+-- opened and added to the cache otherwise. The file must be given back with
+-- releaseCached and never closed. A file that can not be cached, because
+-- every cached file is in use or it can not be watched, is opened for the
+-- caller alone and closed when it is given back.
+--
+-- When contents is not NULL it is set to the whole file if the file is kept
+-- in memory, or NULL. A file let in by admitHot is read into memory here.
+-- The contents stay as they are until the file is given back, even if the
+-- file changes.
+--
+-- A missed file is watched before it is looked at with fstat, so a change
+-- made after that is always seen, and the path is looked at once more to
+-- make sure the watch is on the file that was opened. Only the lock of the
+-- shard of the path is taken.
+*/
+struct cachedFile *openCached(const char *path, const char **contents)
+{
+    struct cachedFile *entry = NULL;
+    struct cachedFile *other = NULL;
+    struct cacheShard *shard = NULL;
+    struct stat statBuffer;
+    unsigned int hash = hashPath(path);
+    int index = (hash >> SHARD_SHIFT) & (fileCache.shardCount - 1);
+    int load = 0;
+    int error = 0;
+
+    shard = &fileCache.shards[index];
+    if (contents != NULL)
+    {
+        *contents = NULL;
+    }
+
+    pthread_mutex_lock(&shard->lock);
+    if (contents != NULL && shard->sketch != NULL)
+    {
+        addSketch(shard, hash);
+    }
+    if ((entry = findCached(shard, path)) != NULL &&
+        checkCached(shard, entry) == 0)
+    {
+        // Used last, so it is the last to be dropped
+        if (entry != shard->newest)
+        {
+            entry->newer->older = entry->older;
+            if (entry->older != NULL)
+            {
+                entry->older->newer = entry->newer;
+            }
+            else
+            {
+                shard->oldest = entry->newer;
+            }
+            entry->newer = NULL;
+            entry->older = shard->newest;
+            shard->newest->newer = entry;
+            shard->newest = entry;
+        }
+        entry->users++;
+        shard->stats.hits++;
+        if (contents != NULL && entry->contents != NULL)
+        {
+            *contents = entry->contents;
+            shard->stats.hotHits++;
+        }
+        load = contents != NULL && admitHot(shard, entry, hash);
+        pthread_mutex_unlock(&shard->lock);
+        if (load)
+        {
+            loadHot(shard, entry, contents);
+        }
+        return entry;
+    }
+    shard->stats.misses++;
+    pthread_mutex_unlock(&shard->lock);
+
+    if ((entry = (struct cachedFile*)calloc(1,
+        sizeof(struct cachedFile))) == NULL)
+    {
+        return NULL;
+    }
+    entry->watch = -1;
+    entry->users = 1;
+    entry->shard = index;
+    if ((entry->file = open(path, O_RDONLY)) == -1 ||
+        (entry->path = strdup(path)) == NULL)
+    {
+        error = errno;
+        destroyCached(shard, entry);
+        errno = error;
+        return NULL;
+    }
+    watchFile(entry, path);
+    if (fstat(entry->file, &entry->statBuffer) == -1)
+    {
+        error = errno;
+        destroyCached(shard, entry);
+        errno = error;
+        return NULL;
+    }
+
+    // A watch on another file than the one opened must not be trusted
+    if (fileCache.notify != -1 && (entry->watch == -1 ||
+        stat(path, &statBuffer) == -1 ||
+        statBuffer.st_ino != entry->statBuffer.st_ino ||
+        statBuffer.st_dev != entry->statBuffer.st_dev))
+    {
+        unwatchCached(entry);
+        return entry;
+    }
+
+    pthread_mutex_lock(&shard->lock);
+    if (fileCache.started && (other = findCached(shard, path)) != NULL)
+    {
+        // Another thread cached it first
+        other->users++;
+        unwatchCached(entry);
+        destroyCached(shard, entry);
+        entry = other;
+    }
+    else if (fileCache.started && addCached(shard, entry) == -1)
+    {
+        unwatchCached(entry);
+    }
+    if (contents != NULL && entry->contents != NULL)
+    {
+        *contents = entry->contents;
+        shard->stats.hotHits++;
+    }
+    load = contents != NULL && admitHot(shard, entry, hash);
+    pthread_mutex_unlock(&shard->lock);
+    if (load)
+    {
+        loadHot(shard, entry, contents);
+    }
+
+    return entry;
+}
+
+/*
+-- FUNCTION: releaseCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Locks the shard of the file alone.
+--
+-- INTERFACE: void releaseCached(struct cachedFile *entry);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function gives back a file from openCached. A file that is not in the
+-- cache any more is closed once the last transfer gives it back.
+*/
+void releaseCached(struct cachedFile *entry)
+{
+    struct cacheShard *shard = &fileCache.shards[entry->shard];
+
+    pthread_mutex_lock(&shard->lock);
+    if (--entry->users == 0 && !entry->cached)
+    {
+        destroyCached(shard, entry);
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+/*
+-- FUNCTION: readFileCacheStats
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Adds up the shards.
+--
+-- INTERFACE: void readFileCacheStats(struct fileCacheStats *stats);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function copies what the cache has done so far into stats. The
+-- shards are read one after the other, so the sum is not one moment of the
+-- whole cache.
+*/
+void readFileCacheStats(struct fileCacheStats *stats)
+{
+    struct cacheShard *shard = NULL;
+    int i = 0;
+
+    bzero(stats, sizeof(struct fileCacheStats));
+    for (i = 0; i < fileCache.shardCount; i++)
+    {
+        shard = &fileCache.shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->invalidations += shard->stats.invalidations;
+        stats->evictions += shard->stats.evictions;
+        stats->hotHits += shard->stats.hotHits;
+        stats->hotAdmissions += shard->stats.hotAdmissions;
+        stats->hotRejections += shard->stats.hotRejections;
+        stats->hotBytes += shard->stats.hotBytes;
+        stats->hotCapacity += shard->stats.hotCapacity;
+        stats->count += shard->count;
+        stats->capacity += shard->capacity;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+/*
+-- FUNCTION: fillCachedVector
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int fillCachedVector(struct iovec *vector,
+--                                 const char *contents, const char *header,
+--                                 int headerSent, off_t offset, off_t end);
+--
+-- RETURNS: the entries of vector filled in
+--
+-- NOTES:
+-- This function points vector, which must hold two entries, at what is left
+-- to send of a file kept in memory: the rest of the size control message in
+-- header after the headerSent bytes already sent, and the contents from
+-- offset up to end. The two go out together in one writev.
+*/
+int fillCachedVector(struct iovec *vector, const char *contents,
+                     const char *header, int headerSent, off_t offset,
+                     off_t end)
+{
+    int count = 0;
+
+    if (headerSent < BUFFER_LENGTH)
+    {
+        vector[count].iov_base = (void*)(header + headerSent);
+        vector[count].iov_len = BUFFER_LENGTH - headerSent;
+        count++;
+    }
+    if (offset < end)
+    {
+        vector[count].iov_base = (void*)(contents + offset);
+        vector[count].iov_len = end - offset;
+        count++;
+    }
+
+    return count;
+}
+
+/*
+-- FUNCTION: watchCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Finds the files of an event by their watch.
+--
+-- INTERFACE: static void *watchCached(void *argument);
+--
+-- RETURNS: NULL once the events can not be read any more
+--
+-- NOTES:
+-- This is the thread of the cache, argument is the cache. It drops every
+-- cached file an event is about. When the kernel ran out of room for events
+-- every file is dropped. The statistics are printed when SIGUSR1 interrupts
+-- the read. Each shard is locked on its own, never all of them at once.
+*/
+static void *watchCached(void *argument)
+{
+    char events[CACHE_EVENTS]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct fileCache *cache = (struct fileCache*)argument;
+    const struct inotify_event *event = NULL;
+    struct cacheShard *shard = NULL;
+    sigset_t report;
+    ssize_t length = 0;
+    ssize_t offset = 0;
+    int i = 0;
+
+    sigemptyset(&report);
+    sigaddset(&report, SIGUSR1);
+    pthread_sigmask(SIG_UNBLOCK, &report, NULL);
+
+    while (1)
+    {
+        if ((length = read(cache->notify, events, CACHE_EVENTS)) <= 0)
+        {
+            if (length == -1 && errno == EINTR)
+            {
+                if (reportWanted)
+                {
+                    reportWanted = 0;
+                    printFileCacheStats();
+                }
+                continue;
+            }
+            perror("Cached Files Are No Longer Watched");
+            break;
+        }
+
+        for (offset = 0; offset < length;
+            offset += sizeof(struct inotify_event) + event->len)
+        {
+            event = (const struct inotify_event*)(events + offset);
+            if (!(event->mask & IN_Q_OVERFLOW))
+            {
+                dropWatched(event->wd);
+                continue;
+            }
+            for (i = 0; i < cache->shardCount; i++)
+            {
+                shard = &cache->shards[i];
+                pthread_mutex_lock(&shard->lock);
+                while (shard->oldest != NULL)
+                {
+                    shard->stats.invalidations++;
+                    dropCached(shard, shard->oldest);
+                }
+                pthread_mutex_unlock(&shard->lock);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+-- FUNCTION: dropWatched
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void dropWatched(int watch);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function drops every cached file that uses watch. The file may be
+-- cached under paths of several shards, so the table of watches of each
+-- shard is looked in, under the lock of that shard alone.
+*/
+static void dropWatched(int watch)
+{
+    struct cacheShard *shard = NULL;
+    struct cachedFile *entry = NULL;
+    struct cachedFile *next = NULL;
+    int i = 0;
+
+    for (i = 0; i < fileCache.shardCount; i++)
+    {
+        shard = &fileCache.shards[i];
+        pthread_mutex_lock(&shard->lock);
+        for (entry = shard->watched[(unsigned int)watch &
+            (shard->bucketCount - 1)]; entry != NULL; entry = next)
+        {
+            next = entry->watchNext;
+            if (entry->watch == watch)
+            {
+                shard->stats.invalidations++;
+                dropCached(shard, entry);
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+/*
+-- FUNCTION: reportRequested
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void reportRequested(int signal);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This is the handler of SIGUSR1. The statistics are printed by the thread
+-- of the cache once its read is interrupted.
+*/
+static void reportRequested(int signal)
+{
+    reportWanted = signal == SIGUSR1;
+}
+
+/*
+-- FUNCTION: printFileCacheStats
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void printFileCacheStats();
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function prints what the cache has done, to size it with -c. Misses
+-- well above the capacity while files are dropped mean it is too small.
+*/
+static void printFileCacheStats()
+{
+    struct fileCacheStats stats;
+
+    readFileCacheStats(&stats);
+    printf("File cache: %llu hits, %llu misses, %llu invalidations, "
+        "%llu evictions, %d of %d files\n", stats.hits, stats.misses,
+        stats.invalidations, stats.evictions, stats.count, stats.capacity);
+    printf("Hot files: %llu hits, %llu admitted, %llu rejected, "
+        "%lld of %lld bytes\n", stats.hotHits, stats.hotAdmissions,
+        stats.hotRejections, stats.hotBytes, stats.hotCapacity);
+    fflush(stdout);
+}
+
+/*
+-- FUNCTION: findCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static struct cachedFile *findCached(struct cacheShard *shard,
+--                                                const char *path);
+--
+-- RETURNS: the cached file path or NULL if it is not cached
+--
+-- NOTES:
+-- This function looks the path up in the table of its shard. The shard must
+-- be locked.
+*/
+static struct cachedFile *findCached(struct cacheShard *shard,
+                                     const char *path)
+{
+    struct cachedFile *entry = NULL;
+
+    if (!fileCache.started)
+    {
+        return NULL;
+    }
+    for (entry = shard->buckets[hashPath(path) &
+        (shard->bucketCount - 1)]; entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->path, path) == 0)
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+-- FUNCTION: checkCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int checkCached(struct cacheShard *shard,
+--                                   struct cachedFile *entry);
+--
+-- RETURNS: 0 if the cached file can be used or -1 if it was dropped
+--
+-- NOTES:
+-- This function checks a cached file that is not watched, whose path must
+-- still name the same file with the same size and time of last change. A
+-- watched file is always current. The shard must be locked.
+*/
+static int checkCached(struct cacheShard *shard, struct cachedFile *entry)
+{
+    struct stat statBuffer;
+
+    if (entry->watch != -1)
+    {
+        return 0;
+    }
+    if (stat(entry->path, &statBuffer) == 0 &&
+        statBuffer.st_ino == entry->statBuffer.st_ino &&
+        statBuffer.st_dev == entry->statBuffer.st_dev &&
+        statBuffer.st_size == entry->statBuffer.st_size &&
+        statBuffer.st_mtim.tv_sec == entry->statBuffer.st_mtim.tv_sec &&
+        statBuffer.st_mtim.tv_nsec == entry->statBuffer.st_mtim.tv_nsec)
+    {
+        return 0;
+    }
+
+    shard->stats.invalidations++;
+    dropCached(shard, entry);
+    return -1;
+}
+
+/*
+-- FUNCTION: addCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Adds a watched file to the table of watches.
+--
+-- INTERFACE: static int addCached(struct cacheShard *shard,
+--                                 struct cachedFile *entry);
+--
+-- RETURNS: 0 on success or -1 if every cached file is in use
+--
+-- NOTES:
+-- This function adds an opened file to its shard as the one used last. A
+-- full shard first drops the file used longest ago that no transfer is
+-- using. The shard must be locked.
+*/
+static int addCached(struct cacheShard *shard, struct cachedFile *entry)
+{
+    struct cachedFile *oldest = shard->oldest;
+    unsigned int bucket = hashPath(entry->path) & (shard->bucketCount - 1);
+
+    if (shard->count >= shard->capacity)
+    {
+        while (oldest != NULL && oldest->users > 0)
+        {
+            oldest = oldest->newer;
+        }
+        if (oldest == NULL)
+        {
+            return -1;
+        }
+        shard->stats.evictions++;
+        dropCached(shard, oldest);
+    }
+
+    entry->next = shard->buckets[bucket];
+    shard->buckets[bucket] = entry;
+    if (entry->watch != -1)
+    {
+        bucket = (unsigned int)entry->watch & (shard->bucketCount - 1);
+        entry->watchNext = shard->watched[bucket];
+        shard->watched[bucket] = entry;
+    }
+    entry->older = shard->newest;
+    entry->newer = NULL;
+    if (shard->newest != NULL)
+    {
+        shard->newest->newer = entry;
+    }
+    else
+    {
+        shard->oldest = entry;
+    }
+    shard->newest = entry;
+    entry->cached = 1;
+    shard->count++;
+
+    return 0;
+}
+
+/*
+-- FUNCTION: dropCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Takes the file out of the table of watches.
+--
+-- INTERFACE: static void dropCached(struct cacheShard *shard,
+--                                  struct cachedFile *entry);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function takes a file out of its shard and stops watching it. It is
+-- closed now if no transfer is using it, or when the last one gives it back.
+-- The shard must be locked.
+*/
+static void dropCached(struct cacheShard *shard, struct cachedFile *entry)
+{
+    struct cachedFile **link = shard->buckets +
+        (hashPath(entry->path) & (shard->bucketCount - 1));
+
+    while (*link != entry)
+    {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    if (entry->watch != -1)
+    {
+        link = shard->watched +
+            ((unsigned int)entry->watch & (shard->bucketCount - 1));
+        while (*link != entry)
+        {
+            link = &(*link)->watchNext;
+        }
+        *link = entry->watchNext;
+    }
+
+    if (entry->newer != NULL)
+    {
+        entry->newer->older = entry->older;
+    }
+    else
+    {
+        shard->newest = entry->older;
+    }
+    if (entry->older != NULL)
+    {
+        entry->older->newer = entry->newer;
+    }
+    else
+    {
+        shard->oldest = entry->newer;
+    }
+
+    entry->cached = 0;
+    shard->count--;
+    if (entry->users == 0)
+    {
+        destroyCached(shard, entry);
+    }
+}
+
+/*
+-- FUNCTION: destroyCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void destroyCached(struct cacheShard *shard,
+--                                     struct cachedFile *entry);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function stops watching a file, closes it and frees its entry and
+-- the contents kept in memory. The shard must be locked if the file was
+-- ever in it.
+*/
+static void destroyCached(struct cacheShard *shard,
+                          struct cachedFile *entry)
+{
+    unwatchCached(entry);
+    if (entry->file != -1)
+    {
+        close(entry->file);
+    }
+    if (entry->contents != NULL)
+    {
+        shard->stats.hotBytes -= entry->statBuffer.st_size;
+        free(entry->contents);
+    }
+    free(entry->path);
+    free(entry);
+}
+
+/*
+-- FUNCTION: unwatchCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts the files of a watch instead of
+-- looking for them in the cache.
+--
+-- INTERFACE: static void unwatchCached(struct cachedFile *entry);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function stops watching a file that is not in the cache. The same
+-- file opened under two paths shares one watch, which is only removed once
+-- no file uses it. It takes the lock of the watches, so a shard may be
+-- locked when it is called.
+*/
+static void unwatchCached(struct cachedFile *entry)
+{
+    struct watchUsers **link = NULL;
+    struct watchUsers *users = NULL;
+
+    if (entry->watch == -1)
+    {
+        return;
+    }
+    pthread_mutex_lock(&fileCache.watchLock);
+    link = findWatch(entry->watch);
+    if (*link != NULL && --(*link)->users == 0)
+    {
+        users = *link;
+        *link = users->next;
+        inotify_rm_watch(fileCache.notify, entry->watch);
+        free(users);
+    }
+    pthread_mutex_unlock(&fileCache.watchLock);
+    entry->watch = -1;
+}
+
+/*
+-- FUNCTION: watchFile
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void watchFile(struct cachedFile *entry,
+--                                  const char *path);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function watches the file at path for entry and counts it as a user
+-- of the watch, or leaves entry unwatched if it can not. The watch is added
+-- and counted under the lock of the watches, so it can not be removed by
+-- unwatchCached in between.
+*/
+static void watchFile(struct cachedFile *entry, const char *path)
+{
+    struct watchUsers **link = NULL;
+    struct watchUsers *users = NULL;
+
+    if (!fileCache.started || fileCache.notify == -1)
+    {
+        return;
+    }
+    pthread_mutex_lock(&fileCache.watchLock);
+    if ((entry->watch = inotify_add_watch(fileCache.notify, path,
+        CACHED_EVENTS)) != -1)
+    {
+        link = findWatch(entry->watch);
+        if (*link != NULL)
+        {
+            (*link)->users++;
+        }
+        else if ((users = (struct watchUsers*)malloc(
+            sizeof(struct watchUsers))) != NULL)
+        {
+            users->watch = entry->watch;
+            users->users = 1;
+            users->next = NULL;
+            *link = users;
+        }
+        else
+        {
+            inotify_rm_watch(fileCache.notify, entry->watch);
+            entry->watch = -1;
+        }
+    }
+    pthread_mutex_unlock(&fileCache.watchLock);
+}
+
+/*
+-- FUNCTION: findWatch
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static struct watchUsers **findWatch(int watch);
+--
+-- RETURNS: the link to the users of watch, which is NULL if it has none
+--
+-- NOTES:
+-- This function looks watch up in the table of watches, where a new one can
+-- be added at the link. The watches must be locked.
+*/
+static struct watchUsers **findWatch(int watch)
+{
+    struct watchUsers **link = &fileCache.watches[(unsigned int)watch %
+        WATCH_BUCKETS];
+
+    while (*link != NULL && (*link)->watch != watch)
+    {
+        link = &(*link)->next;
+    }
+
+    return link;
+}
+
+/*
+-- FUNCTION: admitHot
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int admitHot(struct cacheShard *shard,
+--                                struct cachedFile *entry,
+--                                unsigned int hash);
+--
+-- RETURNS: 1 if the file is to be read into memory, 0 otherwise
+--
+-- NOTES:
+-- This function decides whether a small cached file, whose path hashes to
+-- hash, is kept in memory. While the budget has room every such file gets
+-- in. Otherwise the files kept in memory that were used longest ago and that
+-- no transfer is using make room for it, but only if it was asked for more
+-- often than every one of them. Its bytes are counted at once so two threads
+-- can not both fill the same room, and loadHot reads it. Each shard keeps
+-- its own share of the bytes. The shard must be locked.
+*/
+static int admitHot(struct cacheShard *shard, struct cachedFile *entry,
+                    unsigned int hash)
+{
+    struct cachedFile *victim = NULL;
+    off_t size = entry->statBuffer.st_size;
+    long long freed = 0;
+    unsigned int frequency = 0;
+
+    if (shard->sketch == NULL || !entry->cached ||
+        entry->contents != NULL || entry->loading ||
+        !S_ISREG(entry->statBuffer.st_mode) || size <= 0 ||
+        size > HOT_FILE_SIZE || size > shard->stats.hotCapacity)
+    {
+        return 0;
+    }
+
+    // Every file it would push out must be colder than it
+    frequency = countSketch(shard, hash);
+    for (victim = shard->oldest; victim != NULL &&
+        shard->stats.hotBytes - freed + size >
+        shard->stats.hotCapacity; victim = victim->newer)
+    {
+        if (victim->contents == NULL || victim->users > 0)
+        {
+            continue;
+        }
+        if (countSketch(shard, hashPath(victim->path)) >= frequency)
+        {
+            shard->stats.hotRejections++;
+            return 0;
+        }
+        freed += victim->statBuffer.st_size;
+    }
+    if (shard->stats.hotBytes - freed + size > shard->stats.hotCapacity)
+    {
+        shard->stats.hotRejections++;
+        return 0;
+    }
+
+    for (victim = shard->oldest; victim != NULL && freed > 0;
+        victim = victim->newer)
+    {
+        if (victim->contents != NULL && victim->users == 0)
+        {
+            free(victim->contents);
+            victim->contents = NULL;
+            shard->stats.hotBytes -= victim->statBuffer.st_size;
+            freed -= victim->statBuffer.st_size;
+        }
+    }
+
+    shard->stats.hotBytes += size;
+    entry->loading = 1;
+    return 1;
+}
+
+/*
+-- FUNCTION: loadHot
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void loadHot(struct cacheShard *shard,
+--                               struct cachedFile *entry,
+--                               const char **contents);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function reads a file admitHot let in into memory, without holding
+-- the lock of its shard, and sets contents to it. A file that was dropped
+-- from the cache while it was read, or could not be read whole, is not kept
+-- and its bytes are given back to the budget of its shard.
+*/
+static void loadHot(struct cacheShard *shard, struct cachedFile *entry,
+                    const char **contents)
+{
+    off_t size = entry->statBuffer.st_size;
+    char *buffer = (char*)malloc(size);
+
+    if (buffer != NULL && pread(entry->file, buffer, size, 0) != size)
+    {
+        free(buffer);
+        buffer = NULL;
+    }
+
+    pthread_mutex_lock(&shard->lock);
+    entry->loading = 0;
+    if (buffer != NULL && entry->cached)
+    {
+        entry->contents = buffer;
+        *contents = buffer;
+        shard->stats.hotAdmissions++;
+        buffer = NULL;
+    }
+    else
+    {
+        shard->stats.hotBytes -= size;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    free(buffer);
+}
+
+/*
+-- FUNCTION: addSketch
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void addSketch(struct cacheShard *shard,
+--                                 unsigned int hash);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function counts a request for the path that hashes to hash. Only the
+-- smallest of its counters go up, which keeps paths that share a counter
+-- with a hot path from looking hot themselves. Once as many requests were
+-- counted as the sketch has counters every counter is halved, so a file that
+-- was popular a while ago loses out to one that is popular now. The shard
+-- must be locked.
+*/
+static void addSketch(struct cacheShard *shard, unsigned int hash)
+{
+    unsigned int smallest = countSketch(shard, hash);
+    unsigned int step = (hash >> 17) | (hash << 15) | 1;
+    unsigned int i = 0;
+
+    for (i = 0; i < SKETCH_DEPTH && smallest < SKETCH_LIMIT; i++)
+    {
+        if (shard->sketch[(hash + i * step) & shard->sketchMask] ==
+            smallest)
+        {
+            shard->sketch[(hash + i * step) & shard->sketchMask]++;
+        }
+    }
+
+    if (++shard->samples > shard->sketchMask)
+    {
+        for (i = 0; i <= shard->sketchMask; i++)
+        {
+            shard->sketch[i] >>= 1;
+        }
+        shard->samples = 0;
+    }
+}
+
+/*
+-- FUNCTION: countSketch
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static unsigned int countSketch(struct cacheShard *shard,
+--                                           unsigned int hash);
+--
+-- RETURNS: how often the path was asked for, about
+--
+-- NOTES:
+-- This function gives the smallest counter of the path that hashes to hash.
+-- It can count too many when every counter of the path is shared, never too
+-- few. The shard must be locked.
+*/
+static unsigned int countSketch(struct cacheShard *shard, unsigned int hash)
+{
+    unsigned int step = (hash >> 17) | (hash << 15) | 1;
+    unsigned int smallest = SKETCH_LIMIT;
+    unsigned int i = 0;
+
+    for (i = 0; i < SKETCH_DEPTH; i++)
+    {
+        if (shard->sketch[(hash + i * step) & shard->sketchMask] <
+            smallest)
+        {
+            smallest = shard->sketch[(hash + i * step) &
+                shard->sketchMask];
+        }
+    }
+
+    return smallest;
+}
+
+/*
+-- FUNCTION: hashPath
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static unsigned int hashPath(const char *path);
+--
+-- RETURNS: the hash of the path
+--
+-- NOTES:
+-- This function hashes a path with FNV-1a to pick its shard, from the high
+-- bits, and its chain in the table of the shard, from the low bits.
+*/
+static unsigned int hashPath(const char *path)
+{
+    unsigned int hash = 2166136261U;
+
+    while (*path != '\0')
+    {
+        hash = (hash ^ (unsigned char)*path++) * 16777619U;
+    }
+
+    return hash;
+}
@@ -0,0 +1,65 @@
+#ifndef FILECACHE_H
+#define FILECACHE_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+// Files kept open by default, changed with the -c option
+#define FILE_CACHE_SIZE 1024
+
+// Bytes of small files kept in memory by default, changed with the -H option
+#define HOT_CACHE_SIZE (32 * 1024 * 1024)
+
+// Largest file kept in memory
+#define HOT_FILE_SIZE 65536
+
+// An open file and what fstat said about it, shared by every transfer of it
+struct cachedFile
+{
+    int file;
+    struct stat statBuffer;
+    char *path;
+    int users;
+    int watch;
+    int cached;
+    char *contents;
+    int loading;
+    int shard;
+    struct cachedFile *next;
+    struct cachedFile *watchNext;
+    struct cachedFile *newer;
+    struct cachedFile *older;
+};
+
+// What the cache has done since the server started
+struct fileCacheStats
+{
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long invalidations;
+    unsigned long long evictions;
+    unsigned long long hotHits;
+    unsigned long long hotAdmissions;
+    unsigned long long hotRejections;
+    long long hotBytes;
+    long long hotCapacity;
+    int count;
+    int capacity;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int startFileCache(int capacity, long long hotCapacity);
+struct cachedFile *openCached(const char *path, const char **contents);
+void releaseCached(struct cachedFile *entry);
+void readFileCacheStats(struct fileCacheStats *stats);
+int fillCachedVector(struct iovec *vector, const char *contents,
+                     const char *header, int headerSent, off_t offset,
+                     off_t end);
+#ifdef __cplusplus
+}
+#endif
+#endif
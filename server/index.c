@@ -0,0 +1,1090 @@
+/*
+-- SOURCE FILE: index.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int startIndex(const char *directory);
+-- int sendListing(int socket, const char *prefix, char *buffer,
+--                 char *hashBuffer, int size);
+-- static void *watchShare(void *argument);
+-- static void applyEvent(const struct inotify_event *event);
+-- static void rebuildIndex();
+-- static int addTree(const char *path);
+-- static void updateFile(const char *path);
+-- static void removeFiles(const char *path, int tree);
+-- static int setEntry(const char *name, const struct stat *statBuffer);
+-- static int findSorted(const char *name);
+-- static int findFirst(const char *name, int length, int after);
+-- static int finishBatch();
+-- static int compareEntries(const void *first, const void *second);
+-- static void addWatch(const char *path);
+-- static int findWatch(int watch);
+-- static void dropWatches(const char *path);
+-- static int sendPage(int socket, int start, int count, int flags,
+--                     char *buffer, char *hashBuffer, int size);
+-- static int appendBytes(int socket, char *buffer, int size, int *used,
+--                        const char *bytes, int length);
+-- static void lockIndex();
+-- static void unlockIndex();
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- NOTES:
+-- This file contains the index of the files the server shares, the name,
+-- size and time of last change of every regular file under the share
+-- directory, kept in memory so a listing never reads the directory. Names are
+-- relative to the share directory, and files and directories starting with a
+-- dot are left out, so the chunk store and partial uploads are never listed.
+--
+-- The index is built once when the server starts and kept current by a
+-- thread that watches every directory of the share with inotify. Every event
+-- changes the one file it is about, and a directory that appears is added
+-- with everything in it. When the kernel drops events the index is built
+-- again.
+--
+-- The entries are kept sorted by name, so the files under a prefix are next
+-- to each other and a page of them is found with a binary search. Files
+-- added by a run of events go to the end of the array and files removed are
+-- only marked, then the whole run is merged into the sorted entries at once,
+-- which keeps a storm of uploads from moving the array for every file.
+--
+-- A listing is served by a child process, which works on the copy of the
+-- index it got from the fork. The index is locked around every fork, so the
+-- copy is never caught half way through a change, and the child finishes a
+-- run the thread had not merged yet on its own copy. A listing made while
+-- the index is first built only has the files found so far. Without inotify
+-- the child reads the share directory itself.
+*/
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "index.h"
+#include "../network/network.h"
+#include "../network/list.h"
+#include "../network/checksum.h"
+
+// Bytes of events read at once, every event read is applied as one run
+#define EVENT_BUFFER 65536
+
+// Size of an entry that was removed but is not dropped from the array yet
+#define ENTRY_REMOVED -1
+
+// Events of a watched directory
+#define WATCH_EVENTS (IN_CREATE | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE | \
+    IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+
+// Entries added since the last merge can name the same file, the one with the
+// latest stamp is kept
+struct indexEntry
+{
+    char *name;
+    off_t size;
+    time_t modified;
+    unsigned int stamp;
+};
+
+struct indexWatch
+{
+    int watch;
+    char *path;
+};
+
+// The entries before sorted are in order, the ones after it were added since
+struct shareIndex
+{
+    char directory[FILENAME_MAX];
+    struct indexEntry *entries;
+    int count;
+    int sorted;
+    int removed;
+    int capacity;
+    unsigned int stamp;
+    struct indexWatch *watches;
+    int watchCount;
+    int watchCapacity;
+    int notify;
+    int started;
+    int full;
+    pthread_mutex_t lock;
+    pthread_t thread;
+};
+
+static void *watchShare(void *argument);
+static void applyEvent(const struct inotify_event *event);
+static void rebuildIndex();
+static int addTree(const char *path);
+static void updateFile(const char *path);
+static void removeFiles(const char *path, int tree);
+static int setEntry(const char *name, const struct stat *statBuffer);
+static int findSorted(const char *name);
+static int findFirst(const char *name, int length, int after);
+static int finishBatch();
+static int compareEntries(const void *first, const void *second);
+static void addWatch(const char *path);
+static int findWatch(int watch);
+static void dropWatches(const char *path);
+static int sendPage(int socket, int start, int count, int flags,
+                    char *buffer, char *hashBuffer, int size);
+static int appendBytes(int socket, char *buffer, int size, int *used,
+                       const char *bytes, int length);
+static void lockIndex();
+static void unlockIndex();
+
+// The index of this server, a child works on its own copy
+static struct shareIndex shareIndex = {
+    .notify = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/*
+-- FUNCTION: startIndex
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int startIndex(const char *directory);
+--
+-- RETURNS: 0 if the index is kept or -1 if every listing has to read the
+--          directory
+--
+-- NOTES:
+-- This function starts the thread that builds the index of the directory,
+-- which must end in a slash, and keeps it current. It is called once by the
+-- server before it forks any child.
+*/
+int startIndex(const char *directory)
+{
+    snprintf(shareIndex.directory, FILENAME_MAX, "%s", directory);
+    pthread_atfork(lockIndex, unlockIndex, unlockIndex);
+
+    if ((shareIndex.notify = inotify_init1(IN_CLOEXEC)) == -1)
+    {
+        perror("Cannot Watch The Share Directory");
+        return -1;
+    }
+    if (pthread_create(&shareIndex.thread, NULL, watchShare,
+        &shareIndex) != 0)
+    {
+        perror("Cannot Start The Index Thread");
+        close(shareIndex.notify);
+        shareIndex.notify = -1;
+        return -1;
+    }
+
+    shareIndex.started = 1;
+    return 0;
+}
+
+/*
+-- FUNCTION: sendListing
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int sendListing(int socket, const char *prefix, char *buffer,
+--                            char *hashBuffer, int size);
+--
+-- RETURNS: 0 once the client is done or -1 on failure
+--
+-- NOTES:
+-- This function serves the pages of the files whose names start with prefix
+-- until the client closes the connection, see list.c. The entries are
+-- gathered in buffer and files are checksummed with hashBuffer, both size
+-- bytes long. It must only be called in a child, it changes the index
+-- without the thread knowing.
+*/
+int sendListing(int socket, const char *prefix, char *buffer,
+                char *hashBuffer, int size)
+{
+    char after[FILENAME_MAX];
+    int length = (int)strlen(prefix);
+    int limit = 0;
+    int flags = 0;
+    unsigned int matches = 0;
+    int first = 0;
+    int start = 0;
+    int end = 0;
+
+    if (!shareIndex.started)
+    {
+        addTree("");
+    }
+    if (finishBatch() == -1)
+    {
+        return -1;
+    }
+    first = findFirst(prefix, -1, 0);
+    end = findFirst(prefix, length, 1);
+    matches = (unsigned int)(end - first);
+
+    while (readListRequest(socket, after, &limit, &flags) == 0)
+    {
+        start = after[0] == '\0' ? first : findFirst(after, -1, 1);
+        start = start > first ? start : first;
+        start = start < end ? start : end;
+        limit = end - start < limit ? end - start : limit;
+
+        memmove(buffer, (void*)&matches, sizeof(int));
+        memmove(buffer + sizeof(int), (void*)&limit, sizeof(int));
+        buffer[2 * sizeof(int)] = start + limit < end;
+        if (sendPage(socket, start, limit, flags, buffer, hashBuffer,
+            size) == -1)
+        {
+            return -1;
+        }
+        printf("Listed %d of %u files under \"%s\"\n", limit, matches,
+            prefix);
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: watchShare
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void *watchShare(void *argument);
+--
+-- RETURNS: NULL once the events can not be read any more
+--
+-- NOTES:
+-- This is the thread of the index, argument is the index. It builds the index and then applies the
+-- events of the share directory as they come, merging each run of them into
+-- the sorted entries.
+*/
+static void *watchShare(void *argument)
+{
+    char events[EVENT_BUFFER]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct shareIndex *index = (struct shareIndex*)argument;
+    const struct inotify_event *event = NULL;
+    ssize_t length = 0;
+    ssize_t offset = 0;
+
+    addTree("");
+    lockIndex();
+    finishBatch();
+    printf("Indexed %d files in %s\n", index->count, index->directory);
+    fflush(stdout);
+    unlockIndex();
+
+    while (1)
+    {
+        if ((length = read(index->notify, events, EVENT_BUFFER)) <= 0)
+        {
+            if (length == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            perror("The Share Index Is No Longer Kept");
+            break;
+        }
+
+        for (offset = 0; offset < length;
+            offset += sizeof(struct inotify_event) + event->len)
+        {
+            event = (const struct inotify_event*)(events + offset);
+            applyEvent(event);
+        }
+
+        lockIndex();
+        finishBatch();
+        unlockIndex();
+    }
+
+    return NULL;
+}
+
+/*
+-- FUNCTION: applyEvent
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void applyEvent(const struct inotify_event *event);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function changes the index for one event. A file that is created,
+-- written, changed or moved in is looked at again and one that is deleted or
+-- moved out is removed. A directory that is created or moved in is added
+-- with everything in it and one that goes away is removed with everything
+-- in it.
+*/
+static void applyEvent(const struct inotify_event *event)
+{
+    char path[FILENAME_MAX];
+    int i = 0;
+
+    if (event->mask & IN_Q_OVERFLOW)
+    {
+        rebuildIndex();
+        return;
+    }
+    if ((i = findWatch(event->wd)) == -1)
+    {
+        return;
+    }
+    if (event->mask & IN_IGNORED)
+    {
+        free(shareIndex.watches[i].path);
+        memmove(shareIndex.watches + i, shareIndex.watches + i + 1,
+            sizeof(struct indexWatch) * (--shareIndex.watchCount - i));
+        return;
+    }
+    if (event->len == 0 || event->name[0] == '.' ||
+        snprintf(path, FILENAME_MAX, "%s%s%s", shareIndex.watches[i].path,
+        shareIndex.watches[i].path[0] == '\0' ? "" : "/",
+        event->name) >= FILENAME_MAX)
+    {
+        return;
+    }
+
+    if (event->mask & IN_ISDIR)
+    {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO))
+        {
+            addTree(path);
+        }
+        else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+        {
+            dropWatches(path);
+            removeFiles(path, 1);
+        }
+    }
+    else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+    {
+        removeFiles(path, 0);
+    }
+    else
+    {
+        updateFile(path);
+    }
+}
+
+/*
+-- FUNCTION: rebuildIndex
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void rebuildIndex();
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function throws the index and every watch away and builds it again.
+-- It is called when the kernel ran out of room for events, so some changes
+-- were never seen.
+*/
+static void rebuildIndex()
+{
+    int i = 0;
+
+    fprintf(stderr, "Share events were lost, indexing again\n");
+    dropWatches("");
+
+    lockIndex();
+    for (i = 0; i < shareIndex.count; i++)
+    {
+        free(shareIndex.entries[i].name);
+    }
+    shareIndex.count = 0;
+    shareIndex.sorted = 0;
+    shareIndex.removed = 0;
+    unlockIndex();
+
+    addTree("");
+}
+
+/*
+-- FUNCTION: addTree
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int addTree(const char *path);
+--
+-- RETURNS: 0 on success or -1 if the index ran out of memory
+--
+-- NOTES:
+-- This function watches the directory path, relative to the share directory
+-- and empty for the share directory itself, and adds every regular file in
+-- it and in the directories under it. The directory is watched before it is
+-- read, so a file made while it is read is seen one way or the other. Names
+-- starting with a dot and links are skipped.
+*/
+static int addTree(const char *path)
+{
+    char child[FILENAME_MAX];
+    char fullPath[FILENAME_MAX];
+    struct stat statBuffer;
+    struct dirent *entry = NULL;
+    DIR *directory = NULL;
+    int result = 0;
+
+    addWatch(path);
+    snprintf(fullPath, FILENAME_MAX, "%s%s", shareIndex.directory, path);
+    if ((directory = opendir(fullPath)) == NULL)
+    {
+        return 0;
+    }
+
+    while (result == 0 && (entry = readdir(directory)) != NULL)
+    {
+        if (entry->d_name[0] == '.' ||
+            snprintf(child, FILENAME_MAX, "%s%s%s", path,
+            path[0] == '\0' ? "" : "/", entry->d_name) >= FILENAME_MAX ||
+            snprintf(fullPath, FILENAME_MAX, "%s%s", shareIndex.directory,
+            child) >= FILENAME_MAX || lstat(fullPath, &statBuffer) == -1)
+        {
+            continue;
+        }
+        if (S_ISDIR(statBuffer.st_mode))
+        {
+            result = addTree(child);
+        }
+        else if (S_ISREG(statBuffer.st_mode))
+        {
+            lockIndex();
+            result = setEntry(child, &statBuffer);
+            unlockIndex();
+        }
+    }
+
+    closedir(directory);
+    return result;
+}
+
+/*
+-- FUNCTION: updateFile
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - A path too long to look at is removed.
+--
+-- INTERFACE: static void updateFile(const char *path);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function looks at the file path again and sets its entry, or removes
+-- it if it is no longer a regular file. A path that does not fit in
+-- FILENAME_MAX once the share directory is put in front of it can not be
+-- looked at and is removed too.
+*/
+static void updateFile(const char *path)
+{
+    char fullPath[FILENAME_MAX];
+    struct stat statBuffer;
+
+    if (snprintf(fullPath, FILENAME_MAX, "%s%s", shareIndex.directory,
+        path) >= FILENAME_MAX || lstat(fullPath, &statBuffer) == -1 ||
+        !S_ISREG(statBuffer.st_mode))
+    {
+        removeFiles(path, 0);
+        return;
+    }
+
+    lockIndex();
+    if (setEntry(path, &statBuffer) == -1)
+    {
+        fprintf(stderr, "Cannot Index %s\n", path);
+    }
+    unlockIndex();
+}
+
+/*
+-- FUNCTION: removeFiles
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void removeFiles(const char *path, int tree);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function removes the file path from the index, or every file under
+-- the directory path when tree is set. Sorted entries are only marked, they
+-- are dropped when the run is merged. Entries added since are searched one
+-- by one, there are few of them, swapped with the last one and dropped at
+-- once.
+*/
+static void removeFiles(const char *path, int tree)
+{
+    char under[FILENAME_MAX];
+    struct indexEntry *entries = NULL;
+    int length = 0;
+    int i = 0;
+
+    if (snprintf(under, FILENAME_MAX, "%s/", path) >= FILENAME_MAX)
+    {
+        return;
+    }
+    length = (int)strlen(under);
+
+    lockIndex();
+    entries = shareIndex.entries;
+    if (tree)
+    {
+        for (i = findFirst(under, -1, 0); i < shareIndex.sorted &&
+            strncmp(entries[i].name, under, length) == 0; i++)
+        {
+            if (entries[i].size != ENTRY_REMOVED)
+            {
+                entries[i].size = ENTRY_REMOVED;
+                shareIndex.removed++;
+            }
+        }
+    }
+    else if ((i = findSorted(path)) != -1 &&
+        entries[i].size != ENTRY_REMOVED)
+    {
+        entries[i].size = ENTRY_REMOVED;
+        shareIndex.removed++;
+    }
+
+    for (i = shareIndex.sorted; i < shareIndex.count; i++)
+    {
+        if (tree ? strncmp(entries[i].name, under, length) != 0 :
+            strcmp(entries[i].name, path) != 0)
+        {
+            continue;
+        }
+        free(entries[i].name);
+        entries[i--] = entries[--shareIndex.count];
+    }
+    unlockIndex();
+}
+
+/*
+-- FUNCTION: setEntry
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int setEntry(const char *name,
+--                                const struct stat *statBuffer);
+--
+-- RETURNS: 0 on success or -1 if the index ran out of memory
+--
+-- NOTES:
+-- This function sets the size and time of the entry of the file name. A
+-- file that is not in the sorted entries is added to the end without looking
+-- for it among the others added since, so building the index is not
+-- quadratic, and the merge keeps the latest of them. The index must be
+-- locked.
+*/
+static int setEntry(const char *name, const struct stat *statBuffer)
+{
+    struct indexEntry *entries = NULL;
+    int i = 0;
+
+    if ((i = findSorted(name)) == -1)
+    {
+        if (shareIndex.count == shareIndex.capacity)
+        {
+            shareIndex.capacity = shareIndex.capacity == 0 ? 1024 :
+                shareIndex.capacity * 2;
+            if ((entries = (struct indexEntry*)realloc(shareIndex.entries,
+                sizeof(struct indexEntry) * shareIndex.capacity)) == NULL)
+            {
+                shareIndex.capacity = shareIndex.count;
+                return -1;
+            }
+            shareIndex.entries = entries;
+        }
+        if ((shareIndex.entries[shareIndex.count].name = strdup(name)) ==
+            NULL)
+        {
+            return -1;
+        }
+        i = shareIndex.count++;
+    }
+    else if (shareIndex.entries[i].size == ENTRY_REMOVED)
+    {
+        shareIndex.removed--;
+    }
+
+    shareIndex.entries[i].size = statBuffer->st_size;
+    shareIndex.entries[i].modified = statBuffer->st_mtime;
+    shareIndex.entries[i].stamp = shareIndex.stamp++;
+    return 0;
+}
+
+/*
+-- FUNCTION: findSorted
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int findSorted(const char *name);
+--
+-- RETURNS: the sorted entry of the file name, removed or not, or -1 if there
+--          is none
+--
+-- NOTES:
+-- This function searches the sorted entries for the file name.
+*/
+static int findSorted(const char *name)
+{
+    int i = findFirst(name, -1, 0);
+
+    if (i < shareIndex.sorted && strcmp(shareIndex.entries[i].name, name) == 0)
+    {
+        return i;
+    }
+
+    return -1;
+}
+
+/*
+-- FUNCTION: findFirst
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int findFirst(const char *name, int length, int after);
+--
+-- RETURNS: the first sorted entry past name, or the number of sorted entries
+--
+-- NOTES:
+-- This function finds the first sorted entry whose name is not before name,
+-- or with after set the first one that comes after it. With a length of -1
+-- whole names are compared, otherwise only their first length bytes, so the
+-- first entry after a prefix is the first one past every name under it.
+*/
+static int findFirst(const char *name, int length, int after)
+{
+    int low = 0;
+    int high = shareIndex.sorted;
+    int middle = 0;
+    int order = 0;
+
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        order = length == -1 ? strcmp(shareIndex.entries[middle].name, name) :
+            strncmp(shareIndex.entries[middle].name, name, length);
+        if (order < 0 || (after && order == 0))
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/*
+-- FUNCTION: finishBatch
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int finishBatch();
+--
+-- RETURNS: 0 on success or -1 if there was no memory to merge into
+--
+-- NOTES:
+-- This function sorts the entries added since the last run and merges them
+-- into the sorted entries, dropping the ones marked removed and all but the
+-- latest entry added for a file on the way. The
+-- index must be locked, or be the copy of a child.
+*/
+static int finishBatch()
+{
+    struct indexEntry *entries = shareIndex.entries;
+    struct indexEntry *merged = NULL;
+    int i = 0;
+    int j = shareIndex.sorted;
+    int count = 0;
+
+    if (shareIndex.sorted == shareIndex.count && shareIndex.removed == 0)
+    {
+        return 0;
+    }
+    qsort(entries + shareIndex.sorted, shareIndex.count - shareIndex.sorted,
+        sizeof(struct indexEntry), compareEntries);
+    if ((merged = (struct indexEntry*)malloc(sizeof(struct indexEntry) *
+        shareIndex.capacity)) == NULL)
+    {
+        return -1;
+    }
+
+    while (i < shareIndex.sorted || j < shareIndex.count)
+    {
+        if (i < shareIndex.sorted && entries[i].size == ENTRY_REMOVED)
+        {
+            free(entries[i++].name);
+        }
+        else if (j + 1 < shareIndex.count &&
+            strcmp(entries[j].name, entries[j + 1].name) == 0)
+        {
+            // Only the latest entry added for a file is kept
+            free(entries[j++].name);
+        }
+        else if (j == shareIndex.count || (i < shareIndex.sorted &&
+            strcmp(entries[i].name, entries[j].name) < 0))
+        {
+            merged[count++] = entries[i++];
+        }
+        else
+        {
+            merged[count++] = entries[j++];
+        }
+    }
+
+    free(entries);
+    shareIndex.entries = merged;
+    shareIndex.count = count;
+    shareIndex.sorted = count;
+    shareIndex.removed = 0;
+    return 0;
+}
+
+/*
+-- FUNCTION: compareEntries
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int compareEntries(const void *first,
+--                                      const void *second);
+--
+-- RETURNS: the order of the entries, see strcmp(3)
+--
+-- NOTES:
+-- This function orders entries for qsort, by name and then from the earliest
+-- to the latest added.
+*/
+static int compareEntries(const void *first, const void *second)
+{
+    const struct indexEntry *one = (const struct indexEntry*)first;
+    const struct indexEntry *other = (const struct indexEntry*)second;
+    int order = strcmp(one->name, other->name);
+
+    if (order != 0)
+    {
+        return order;
+    }
+    return one->stamp < other->stamp ? -1 : one->stamp > other->stamp;
+}
+
+/*
+-- FUNCTION: addWatch
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void addWatch(const char *path);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function watches the directory path and remembers the path of the
+-- watch, keeping the watches in order so events find theirs with a binary
+-- search. A directory that can not be watched is only reported once the
+-- kernel runs out of watches, its files are indexed but not kept current.
+*/
+static void addWatch(const char *path)
+{
+    char fullPath[FILENAME_MAX];
+    struct indexWatch *watches = NULL;
+    char *copy = NULL;
+    int watch = 0;
+    int i = 0;
+
+    snprintf(fullPath, FILENAME_MAX, "%s%s", shareIndex.directory, path);
+    if (shareIndex.notify == -1 ||
+        (watch = inotify_add_watch(shareIndex.notify, fullPath,
+        WATCH_EVENTS)) == -1)
+    {
+        if (shareIndex.notify != -1 && errno == ENOSPC && !shareIndex.full)
+        {
+            fprintf(stderr, "Out of inotify watches, %s is not kept "
+                "current\n", fullPath);
+            shareIndex.full = 1;
+        }
+        return;
+    }
+    if ((copy = strdup(path)) == NULL)
+    {
+        return;
+    }
+
+    // Watching a directory twice gives back the same watch
+    if ((i = findWatch(watch)) != -1)
+    {
+        free(shareIndex.watches[i].path);
+        shareIndex.watches[i].path = copy;
+        return;
+    }
+    if (shareIndex.watchCount == shareIndex.watchCapacity)
+    {
+        shareIndex.watchCapacity = shareIndex.watchCapacity == 0 ? 64 :
+            shareIndex.watchCapacity * 2;
+        if ((watches = (struct indexWatch*)realloc(shareIndex.watches,
+            sizeof(struct indexWatch) * shareIndex.watchCapacity)) == NULL)
+        {
+            shareIndex.watchCapacity = shareIndex.watchCount;
+            free(copy);
+            return;
+        }
+        shareIndex.watches = watches;
+    }
+
+    for (i = shareIndex.watchCount; i > 0 &&
+        shareIndex.watches[i - 1].watch > watch; i--)
+    {
+        shareIndex.watches[i] = shareIndex.watches[i - 1];
+    }
+    shareIndex.watches[i].watch = watch;
+    shareIndex.watches[i].path = copy;
+    shareIndex.watchCount++;
+}
+
+/*
+-- FUNCTION: findWatch
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int findWatch(int watch);
+--
+-- RETURNS: the position of the watch or -1 if it is not known
+--
+-- NOTES:
+-- This function searches the watches, which are kept in order.
+*/
+static int findWatch(int watch)
+{
+    int low = 0;
+    int high = shareIndex.watchCount - 1;
+    int middle = 0;
+
+    while (low <= high)
+    {
+        middle = low + (high - low) / 2;
+        if (shareIndex.watches[middle].watch == watch)
+        {
+            return middle;
+        }
+        if (shareIndex.watches[middle].watch < watch)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+/*
+-- FUNCTION: dropWatches
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void dropWatches(const char *path);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function stops watching the directory path and every directory under
+-- it, or every directory when path is empty. A directory moved elsewhere in
+-- the share is watched again under its new path when it is added.
+*/
+static void dropWatches(const char *path)
+{
+    int length = (int)strlen(path);
+    int count = 0;
+    int i = 0;
+
+    for (i = 0; i < shareIndex.watchCount; i++)
+    {
+        if (length == 0 || (strncmp(shareIndex.watches[i].path, path,
+            length) == 0 && (shareIndex.watches[i].path[length] == '\0' ||
+            shareIndex.watches[i].path[length] == '/')))
+        {
+            inotify_rm_watch(shareIndex.notify, shareIndex.watches[i].watch);
+            free(shareIndex.watches[i].path);
+            continue;
+        }
+        shareIndex.watches[count++] = shareIndex.watches[i];
+    }
+
+    shareIndex.watchCount = count;
+}
+
+/*
+-- FUNCTION: sendPage
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int sendPage(int socket, int start, int count,
+--                                int flags, char *buffer, char *hashBuffer,
+--                                int size);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function sends the page of count entries from start, gathered in
+-- buffer after the page header the caller put at its start. With the LIST_HASH flag every file of the page is checksummed with
+-- hashBuffer, a file that can not be read is sent without its checksum.
+*/
+static int sendPage(int socket, int start, int count, int flags,
+                    char *buffer, char *hashBuffer, int size)
+{
+    char entry[LISTED_ENTRY + LISTED_HASH + FILENAME_MAX];
+    char path[FILENAME_MAX];
+    struct indexEntry *current = NULL;
+    const char *previous = NULL;
+    unsigned int hash = 0;
+    int hashed = 0;
+    int file = 0;
+    int used = PAGE_HEADER;
+    int i = 0;
+
+    for (i = start; i < start + count; i++)
+    {
+        current = shareIndex.entries + i;
+        hashed = 0;
+        if ((flags & LIST_HASH) && snprintf(path, FILENAME_MAX, "%s%s",
+            shareIndex.directory, current->name) < FILENAME_MAX &&
+            (file = open(path, O_RDONLY)) != -1)
+        {
+            hashed = checksumFile(file, 0, current->size, hashBuffer, size,
+                &hash) == 0;
+            close(file);
+        }
+        if (appendBytes(socket, buffer, size, &used, entry,
+            packListed(entry, previous, current->name, current->size,
+            (long long)current->modified, hashed ? &hash : NULL)) == -1)
+        {
+            return -1;
+        }
+        previous = current->name;
+    }
+
+    return used > 0 ? sendAll(&socket, buffer, used) : 0;
+}
+
+/*
+-- FUNCTION: appendBytes
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int appendBytes(int socket, char *buffer, int size,
+--                                   int *used, const char *bytes,
+--                                   int length);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function adds length bytes to the used bytes of buffer, sending the
+-- buffer first when they do not fit. Bytes that do not fit in an empty buffer
+-- either are sent on their own.
+*/
+static int appendBytes(int socket, char *buffer, int size, int *used,
+                       const char *bytes, int length)
+{
+    if (*used + length > size)
+    {
+        if (sendAll(&socket, buffer, *used) == -1)
+        {
+            return -1;
+        }
+        *used = 0;
+    }
+    if (length > size)
+    {
+        return sendAll(&socket, bytes, length);
+    }
+
+    memmove(buffer + *used, bytes, length);
+    *used += length;
+    return 0;
+}
+
+/*
+-- FUNCTION: lockIndex
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void lockIndex();
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function locks the index. It is also called before every fork, so a
+-- child never gets a copy of the index half way through a change.
+*/
+static void lockIndex()
+{
+    pthread_mutex_lock(&shareIndex.lock);
+}
+
+/*
+-- FUNCTION: unlockIndex
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void unlockIndex();
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function unlocks the index. It is also called after every fork, in
+-- the parent and in the child.
+*/
+static void unlockIndex()
+{
+    pthread_mutex_unlock(&shareIndex.lock);
+}
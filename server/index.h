@@ -0,0 +1,14 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int startIndex(const char *directory);
+int sendListing(int socket, const char *prefix, char *buffer,
+                char *hashBuffer, int size);
+#ifdef __cplusplus
+}
+#endif
+#endif
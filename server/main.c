@@ -1,36 +1,143 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "server.h"
+#include "filecache.h"
+#include "../network/network.h"
+#include "../network/buffer.h"
+#include "../network/transfer.h"
 
 #define DEFAULT_PORT 7001
+#define USAGE "Usage: %s -p [port] -m [fork|epoll|reactor|uring] " \
+    "-t [threads] -d [low-high data ports] -b [chunk size, e.g. 1m] " \
+    "-c [files kept open] -H [bytes of hot files in memory, e.g. 32m] " \
+    "-O [uploads written directly from this size, e.g. 1g] " \
+    "-W (uploads received into a mapping) -T [tcp|unix] " \
+    "-s [metrics file, written every second]\n"
 
 int main(int argc, char **argv);
 
 int main(int argc, char **argv)
 {
-    // Initialize port and give default option in case of no user input
-    int port = DEFAULT_PORT;
+    // Initialize options and give defaults in case of no user input
+    struct serverOptions options;
     int option = 0;
+    long long direct = 0;
+    const struct transport *transport = NULL;
+
+    options.port = DEFAULT_PORT;
+    options.mode = MODE_FORK;
+    options.threads = 0;
+    options.dataLow = 0;
+    options.dataHigh = 0;
+    options.chunkSize = DEF_CHUNK_SIZE;
+    options.cacheSize = FILE_CACHE_SIZE;
+    options.hotSize = HOT_CACHE_SIZE;
+    options.metricsFile = NULL;
 
     // Parse command line parameters using getopt
-    while ((option = getopt(argc, argv, "p:")) != -1)
+    while ((option = getopt(argc, argv, "p:m:t:d:b:c:H:O:WT:s:")) != -1)
     {
         switch (option)
         {
             case 'p':
-                port = atoi(optarg);
+                options.port = atoi(optarg);
+                break;
+            case 't':
+                options.threads = atoi(optarg);
+                break;
+            case 'c':
+                options.cacheSize = atoi(optarg);
+                break;
+            case 'O':
+                if ((direct = parseSize(optarg)) == -1)
+                {
+                    fprintf(stderr, USAGE, argv[0]);
+                    return 0;
+                }
+                setDirectSize(direct);
+                break;
+            case 'W':
+                setMappedReceive(1);
+                break;
+            case 's':
+                options.metricsFile = optarg;
+                break;
+            case 'T':
+                // The memory transport only reaches this process
+                if ((transport = findTransport(optarg)) == NULL ||
+                    transport == &memoryTransport)
+                {
+                    fprintf(stderr, USAGE, argv[0]);
+                    return 0;
+                }
+                setTransport(transport);
+                break;
+            case 'H':
+                if ((options.hotSize = parseSize(optarg)) == -1)
+                {
+                    fprintf(stderr, USAGE, argv[0]);
+                    return 0;
+                }
+                break;
+            case 'b':
+                if ((options.chunkSize = parseChunkSize(optarg)) == -1)
+                {
+                    fprintf(stderr, USAGE, argv[0]);
+                    return 0;
+                }
+                break;
+            case 'd':
+                if (sscanf(optarg, "%d-%d", &options.dataLow,
+                    &options.dataHigh) != 2 || options.dataLow <= 0 ||
+                    options.dataHigh < options.dataLow)
+                {
+                    fprintf(stderr, USAGE, argv[0]);
+                    return 0;
+                }
+                break;
+            case 'm':
+                if (strcmp(optarg, "fork") == 0)
+                {
+                    options.mode = MODE_FORK;
+                }
+                else if (strcmp(optarg, "epoll") == 0)
+                {
+                    options.mode = MODE_EPOLL;
+                }
+                else if (strcmp(optarg, "reactor") == 0)
+                {
+                    options.mode = MODE_REACTOR;
+                }
+                else if (strcmp(optarg, "uring") == 0)
+                {
+                    options.mode = MODE_URING;
+                }
+                else
+                {
+                    fprintf(stderr, USAGE, argv[0]);
+                    return 0;
+                }
                 break;
             default:
-                fprintf(stderr, "Usage: %s -p [port]\n", argv[0]);
+                fprintf(stderr, USAGE, argv[0]);
                 return 0;
         }
     }
-    
+
+    // The ring accepts and connects with IPv4 addresses of its own
+    if (options.mode == MODE_URING &&
+        !(getTransport()->flags & TRANSPORT_INET))
+    {
+        fprintf(stderr, "The uring mode only runs over tcp\n");
+        return 0;
+    }
+
     // Start server
-    server(port);
-    
+    server(&options);
+
     return 0;
 }
 
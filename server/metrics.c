@@ -0,0 +1,444 @@
+/*
+-- SOURCE FILE: metrics.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int startMetrics(const char *path);
+-- void useMetricsShard(int shard);
+-- void countMetric(int counter, long long value);
+-- void timeMetric(int histogram, long long microseconds);
+-- long long metricsClock();
+-- static void *writeMetrics(void *argument);
+-- static void addShards(struct metricsShard *total);
+-- static int printMetrics(char *text, const struct metricsShard *total);
+-- static int printHistogram(char *text, int length, const char *name,
+--                           const char *help,
+--                           const struct histogram *histogram);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- NOTES:
+-- This file contains the metrics of the server: counters of connections,
+-- transfers, bytes and errors, and histograms of how long it takes from
+-- accepting a client to its data connection, to connect back to a client and
+-- to move a file. They are written every METRICS_INTERVAL seconds to the file
+-- given with -s, in the text format of Prometheus, so a collector can pick
+-- them up and alert when the throughput drops.
+--
+-- Counting must cost next to nothing on the paths that move data, so nothing
+-- is locked. Every reactor thread counts in a shard of its own, a counter is
+-- a single atomic add to a cache line no other thread writes, and the thread
+-- that writes the file adds the shards up. A shard of the histograms is the
+-- same array of buckets the load generator uses, see histogram.c.
+--
+-- The shards live in a shared anonymous mapping made before the server
+-- starts any thread or process, so the children of the fork mode and the
+-- children the event driven modes fork for long commands count into the
+-- same shards as their parent. Those share shard 0, or the shard of the
+-- thread that forked them, which is why the adds are atomic even though a
+-- thread mostly has its shard to itself. Only the parent writes the file.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "metrics.h"
+
+static void *writeMetrics(void *argument);
+static void addShards(struct metricsShard *total);
+static int printMetrics(char *text, const struct metricsShard *total);
+static int printHistogram(char *text, int length, const char *name,
+                          const char *help,
+                          const struct histogram *histogram);
+
+// Upper bounds of the buckets written for every histogram, in microseconds
+static const long long metricBounds[] = {100, 250, 500, 1000, 2500, 5000,
+    10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000,
+    10000000, 30000000, 60000000, 300000000};
+
+// Every shard, shared with the children, NULL until the metrics are started
+static struct metricsShard *metricsShards = NULL;
+
+// The shard of this thread, NULL for shard 0
+static __thread struct metricsShard *localShard = NULL;
+
+/*
+-- FUNCTION: startMetrics
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int startMetrics(const char *path);
+--
+-- RETURNS: 0 on success or -1 if nothing is counted
+--
+-- NOTES:
+-- This function maps the shards and starts the thread that writes them to the
+-- file at path. It must be called before the server starts any other thread
+-- or process. Until it is called counting does nothing.
+*/
+int startMetrics(const char *path)
+{
+    pthread_t thread;
+    void *shards = NULL;
+
+    if (metricsShards != NULL)
+    {
+        return 0;
+    }
+    if ((shards = mmap(NULL, sizeof(struct metricsShard) * METRICS_SHARDS,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)) ==
+        MAP_FAILED)
+    {
+        return -1;
+    }
+    metricsShards = (struct metricsShard*)shards;
+
+    if (pthread_create(&thread, NULL, writeMetrics, (void*)path) != 0)
+    {
+        munmap(shards, sizeof(struct metricsShard) * METRICS_SHARDS);
+        metricsShards = NULL;
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+/*
+-- FUNCTION: useMetricsShard
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void useMetricsShard(int shard);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function makes the calling thread count in a shard of its own. The
+-- reactor threads call it with their index, shard 0 is left to processes,
+-- so every thread past the last shard shares one with another thread.
+*/
+void useMetricsShard(int shard)
+{
+    if (metricsShards != NULL)
+    {
+        localShard = &metricsShards[shard % (METRICS_SHARDS - 1) + 1];
+    }
+}
+
+/*
+-- FUNCTION: countMetric
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void countMetric(int counter, long long value);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function adds value to a counter of the shard of the calling thread.
+*/
+void countMetric(int counter, long long value)
+{
+    struct metricsShard *shard = localShard;
+
+    if (shard == NULL && (shard = metricsShards) == NULL)
+    {
+        return;
+    }
+    __sync_fetch_and_add(&shard->counters[counter], value);
+}
+
+/*
+-- FUNCTION: timeMetric
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void timeMetric(int histogram, long long microseconds);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function counts a time in a histogram of the shard of the calling
+-- thread. It is recordValue of histogram.c done with atomic adds, and the
+-- largest time is raised with a compare and swap that only loops while
+-- another process raises it at the same time.
+*/
+void timeMetric(int histogram, long long microseconds)
+{
+    struct metricsShard *shard = localShard;
+    struct histogram *times = NULL;
+    long long max = 0;
+
+    if (shard == NULL && (shard = metricsShards) == NULL)
+    {
+        return;
+    }
+    if (microseconds < 0)
+    {
+        microseconds = 0;
+    }
+
+    times = &shard->histograms[histogram];
+    __sync_fetch_and_add(&times->counts[bucketOf(microseconds)], 1);
+    __sync_fetch_and_add(&times->total, 1);
+    __sync_fetch_and_add(&times->sum, microseconds);
+    while ((max = times->max) < microseconds &&
+        !__sync_bool_compare_and_swap(&times->max, max, microseconds))
+    {
+    }
+}
+
+/*
+-- FUNCTION: metricsClock
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: long long metricsClock();
+--
+-- RETURNS: the monotonic time in microseconds
+--
+-- NOTES:
+-- The times given to timeMetric are differences of this clock, which does
+-- not jump when the time of day is set.
+*/
+long long metricsClock()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/*
+-- FUNCTION: writeMetrics
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void *writeMetrics(void *argument);
+--
+-- RETURNS: never
+--
+-- NOTES:
+-- This function is the thread that writes the metrics file, its argument is
+-- the path of the file. The text is written to a file next to it which is
+-- then renamed over it, so a reader never sees half of it.
+*/
+static void *writeMetrics(void *argument)
+{
+    const char *path = (const char*)argument;
+    struct metricsShard *total = NULL;
+    char *text = NULL;
+    char *temporary = NULL;
+    int length = 0;
+    int file = 0;
+
+    if ((total = (struct metricsShard*)malloc(
+        sizeof(struct metricsShard))) == NULL ||
+        (text = (char*)malloc(METRICS_TEXT_LENGTH)) == NULL ||
+        (temporary = (char*)malloc(strlen(path) + 5)) == NULL)
+    {
+        fprintf(stderr, "Cannot Allocate Metrics\n");
+        return NULL;
+    }
+    sprintf(temporary, "%s.tmp", path);
+
+    while (1)
+    {
+        addShards(total);
+        length = printMetrics(text, total);
+        if ((file = open(temporary, O_WRONLY | O_CREAT | O_TRUNC,
+            00400 | 00200 | 00040 | 00004)) == -1)
+        {
+            perror("Cannot Write Metrics");
+        }
+        else
+        {
+            if (write(file, text, length) != length ||
+                rename(temporary, path) == -1)
+            {
+                perror("Cannot Write Metrics");
+            }
+            close(file);
+        }
+        sleep(METRICS_INTERVAL);
+    }
+    return NULL;
+}
+
+/*
+-- FUNCTION: addShards
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void addShards(struct metricsShard *total);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function adds up every shard into total. The shards keep changing
+-- while they are read, so a histogram can be a few values ahead of another,
+-- which the next write puts right. The total of a histogram is added up from
+-- its buckets, which are counted first, so it always matches them.
+*/
+static void addShards(struct metricsShard *total)
+{
+    struct histogram *times = NULL;
+    const struct histogram *shardTimes = NULL;
+    int shard = 0;
+    int i = 0;
+    int bucket = 0;
+
+    memset(total, 0, sizeof(struct metricsShard));
+    for (shard = 0; shard < METRICS_SHARDS; shard++)
+    {
+        for (i = 0; i < METRIC_COUNTERS; i++)
+        {
+            total->counters[i] += metricsShards[shard].counters[i];
+        }
+        for (i = 0; i < METRIC_HISTOGRAMS; i++)
+        {
+            times = &total->histograms[i];
+            shardTimes = &metricsShards[shard].histograms[i];
+            if (shardTimes->total == 0)
+            {
+                continue;
+            }
+            for (bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+            {
+                times->counts[bucket] += shardTimes->counts[bucket];
+                times->total += shardTimes->counts[bucket];
+            }
+            times->sum += shardTimes->sum;
+            if (shardTimes->max > times->max)
+            {
+                times->max = shardTimes->max;
+            }
+        }
+    }
+}
+
+/*
+-- FUNCTION: printMetrics
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int printMetrics(char *text,
+--                                    const struct metricsShard *total);
+--
+-- RETURNS: the length of the text
+--
+-- NOTES:
+-- This function prints the metrics in total into text in the text format of
+-- Prometheus. The transfers in progress are the ones started that have not
+-- finished either way.
+*/
+static int printMetrics(char *text, const struct metricsShard *total)
+{
+    const long long *counters = total->counters;
+    int length = 0;
+
+    length += snprintf(text + length, METRICS_TEXT_LENGTH - length,
+        "# HELP sft_connections_total Control connections accepted.\n"
+        "# TYPE sft_connections_total counter\n"
+        "sft_connections_total %lld\n"
+        "# HELP sft_transfers_total Transfers finished, by result.\n"
+        "# TYPE sft_transfers_total counter\n"
+        "sft_transfers_total{result=\"ok\"} %lld\n"
+        "sft_transfers_total{result=\"failed\"} %lld\n"
+        "# HELP sft_active_transfers Transfers in progress.\n"
+        "# TYPE sft_active_transfers gauge\n"
+        "sft_active_transfers %lld\n"
+        "# HELP sft_received_bytes_total File bytes received from clients.\n"
+        "# TYPE sft_received_bytes_total counter\n"
+        "sft_received_bytes_total %lld\n"
+        "# HELP sft_sent_bytes_total File bytes sent to clients.\n"
+        "# TYPE sft_sent_bytes_total counter\n"
+        "sft_sent_bytes_total %lld\n"
+        "# HELP sft_errors_total Data connections that could not be made.\n"
+        "# TYPE sft_errors_total counter\n"
+        "sft_errors_total{kind=\"connect_back\"} %lld\n"
+        "sft_errors_total{kind=\"passive_accept\"} %lld\n",
+        counters[METRIC_CONNECTIONS], counters[METRIC_COMPLETED],
+        counters[METRIC_FAILED], counters[METRIC_STARTED] -
+        counters[METRIC_COMPLETED] - counters[METRIC_FAILED],
+        counters[METRIC_BYTES_IN], counters[METRIC_BYTES_OUT],
+        counters[METRIC_CONNECT_ERRORS], counters[METRIC_PASSIVE_ERRORS]);
+
+    length = printHistogram(text, length, "sft_first_byte_seconds",
+        "Seconds from accepting a client to the start of its transfer.",
+        &total->histograms[METRIC_FIRST_BYTE]);
+    length = printHistogram(text, length, "sft_connect_back_seconds",
+        "Seconds to connect back to a client.",
+        &total->histograms[METRIC_CONNECT_BACK]);
+    length = printHistogram(text, length, "sft_transfer_duration_seconds",
+        "Seconds a transfer took.", &total->histograms[METRIC_DURATION]);
+    return length;
+}
+
+/*
+-- FUNCTION: printHistogram
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int printHistogram(char *text, int length,
+--                                      const char *name, const char *help,
+--                                      const struct histogram *histogram);
+--
+-- RETURNS: the length of the text
+--
+-- NOTES:
+-- This function prints a histogram of microseconds after the first length
+-- characters of text, as a Prometheus histogram of seconds with the buckets
+-- in metricBounds. The count of a bucket leaves out the values that share a
+-- bucket of the histogram with its bound, see countUpTo.
+*/
+static int printHistogram(char *text, int length, const char *name,
+                          const char *help,
+                          const struct histogram *histogram)
+{
+    unsigned int i = 0;
+
+    length += snprintf(text + length, METRICS_TEXT_LENGTH - length,
+        "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    for (i = 0; i < sizeof(metricBounds) / sizeof(metricBounds[0]); i++)
+    {
+        length += snprintf(text + length, METRICS_TEXT_LENGTH - length,
+            "%s_bucket{le=\"%g\"} %lld\n", name, metricBounds[i] / 1e6,
+            countUpTo(histogram, metricBounds[i]));
+    }
+    length += snprintf(text + length, METRICS_TEXT_LENGTH - length,
+        "%s_bucket{le=\"+Inf\"} %lld\n%s_sum %.6f\n%s_count %lld\n", name,
+        histogram->total, name, histogram->sum / 1e6, name,
+        histogram->total);
+    return length;
+}
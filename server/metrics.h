@@ -0,0 +1,52 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "../network/histogram.h"
+
+// Seconds between writes of the metrics file
+#define METRICS_INTERVAL 1
+
+// Room for the text of every metric
+#define METRICS_TEXT_LENGTH 16384
+
+// Every reactor thread counts in a shard of its own, processes and the
+// threads beyond the last shard count in shard 0
+#define METRICS_SHARDS 64
+
+// Counters
+#define METRIC_CONNECTIONS 0
+#define METRIC_STARTED 1
+#define METRIC_COMPLETED 2
+#define METRIC_FAILED 3
+#define METRIC_BYTES_IN 4
+#define METRIC_BYTES_OUT 5
+#define METRIC_CONNECT_ERRORS 6
+#define METRIC_PASSIVE_ERRORS 7
+#define METRIC_COUNTERS 8
+
+// Histograms, all of microseconds
+#define METRIC_FIRST_BYTE 0
+#define METRIC_CONNECT_BACK 1
+#define METRIC_DURATION 2
+#define METRIC_HISTOGRAMS 3
+
+// What one thread has counted, on cache lines of its own
+struct metricsShard
+{
+    long long counters[METRIC_COUNTERS];
+    struct histogram histograms[METRIC_HISTOGRAMS];
+} __attribute__((aligned(64)));
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int startMetrics(const char *path);
+void useMetricsShard(int shard);
+void countMetric(int counter, long long value);
+void timeMetric(int histogram, long long microseconds);
+long long metricsClock();
+#ifdef __cplusplus
+}
+#endif
+#endif
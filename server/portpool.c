@@ -0,0 +1,201 @@
+/*
+-- SOURCE FILE: portpool.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int initializePortPool(struct portPool *pool, int low, int high);
+-- void destroyPortPool(struct portPool *pool);
+-- void rotatePortPool(struct portPool *pool, int steps);
+-- int bindDataPort(struct portPool *pool, int *socket);
+-- void releaseDataPort(struct portPool *pool, int port);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- NOTES:
+-- This file contains the allocator for the local ports of the data
+-- connections. Without a range the kernel picks an ephemeral port for every
+-- data connection. With a range the free ports are kept in a ring and handed
+-- out oldest first, so a port that was just released has the most time to
+-- leave TIME_WAIT before it is used again. Ports that are still taken by
+-- another socket are skipped and put back at the end of the ring.
+--
+-- A pool is not locked. Every reactor thread owns a pool for its own slice of
+-- the range, and forked children work on their own copy.
+*/
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "portpool.h"
+#include "../network/network.h"
+
+/*
+-- FUNCTION: initializePortPool
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int initializePortPool(struct portPool *pool, int low, int high);
+--
+-- RETURNS: 0 on success, -1 if the ring could not be allocated
+--
+-- NOTES:
+-- This function fills the pool with every port from low to high. A low port
+-- of 0 creates an empty pool that lets the kernel choose.
+*/
+int initializePortPool(struct portPool *pool, int low, int high)
+{
+    int i = 0;
+
+    pool->low = low;
+    pool->high = high;
+    pool->ports = NULL;
+    pool->head = 0;
+    pool->count = 0;
+
+    if (low <= 0 || high < low)
+    {
+        return 0;
+    }
+
+    if ((pool->ports = (int*)malloc(sizeof(int) * (high - low + 1))) == NULL)
+    {
+        return -1;
+    }
+    for (i = low; i <= high; i++)
+    {
+        pool->ports[pool->count++] = i;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: destroyPortPool
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void destroyPortPool(struct portPool *pool);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function frees the ring of the pool.
+*/
+void destroyPortPool(struct portPool *pool)
+{
+    free(pool->ports);
+    pool->ports = NULL;
+    pool->count = 0;
+}
+
+/*
+-- FUNCTION: rotatePortPool
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void rotatePortPool(struct portPool *pool, int steps);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function moves the head of the ring. Forked children start from
+-- different points in their copy of the pool so they rarely try the same port.
+-- Only a full pool can be rotated.
+*/
+void rotatePortPool(struct portPool *pool, int steps)
+{
+    int size = pool->high - pool->low + 1;
+
+    if (pool->ports != NULL && pool->count == size)
+    {
+        pool->head = (pool->head + (steps % size)) % size;
+    }
+}
+
+/*
+-- FUNCTION: bindDataPort
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int bindDataPort(struct portPool *pool, int *socket);
+--
+-- RETURNS: the port the socket was bound to, 0 if the pool is empty and the
+--          socket was left for the kernel to bind, or -1 on failure
+--
+-- NOTES:
+-- This function binds the socket to the oldest free port of the pool. Ports
+-- already in use are returned to the end of the ring and the next one is tried
+-- until every port has been tried once.
+*/
+int bindDataPort(struct portPool *pool, int *socket)
+{
+    int size = pool->high - pool->low + 1;
+    int tries = pool->count;
+    int port = 0;
+
+    if (pool->ports == NULL)
+    {
+        return 0;
+    }
+
+    while (tries-- > 0)
+    {
+        port = pool->ports[pool->head];
+        pool->head = (pool->head + 1) % size;
+        pool->count--;
+
+        if (bindAddress(&port, socket) == 0)
+        {
+            return port;
+        }
+
+        releaseDataPort(pool, port);
+        if (errno != EADDRINUSE)
+        {
+            return -1;
+        }
+    }
+
+    errno = EADDRINUSE;
+    return -1;
+}
+
+/*
+-- FUNCTION: releaseDataPort
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void releaseDataPort(struct portPool *pool, int port);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function puts a port back at the end of the ring. Ports that were not
+-- handed out by the pool are ignored.
+*/
+void releaseDataPort(struct portPool *pool, int port)
+{
+    int size = pool->high - pool->low + 1;
+
+    if (pool->ports == NULL || port < pool->low || port > pool->high ||
+        pool->count == size)
+    {
+        return;
+    }
+
+    pool->ports[(pool->head + pool->count) % size] = port;
+    pool->count++;
+}
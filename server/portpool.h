@@ -0,0 +1,27 @@
+#ifndef PORTPOOL_H
+#define PORTPOOL_H
+
+// A ring of free data ports, an empty range means kernel chosen ports
+struct portPool
+{
+    int low;
+    int high;
+    int *ports;
+    int head;
+    int count;
+};
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int initializePortPool(struct portPool *pool, int low, int high);
+void destroyPortPool(struct portPool *pool);
+void rotatePortPool(struct portPool *pool, int steps);
+int bindDataPort(struct portPool *pool, int *socket);
+void releaseDataPort(struct portPool *pool, int port);
+#ifdef __cplusplus
+}
+#endif
+#endif
+
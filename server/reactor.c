@@ -0,0 +1,1858 @@
+/*
+-- SOURCE FILE: reactor.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- void reactorServer(struct serverOptions *options);
+-- void stopReactors();
+-- static void setupReactor(struct reactor *reactor, int port, int reusePort,
+--                          int dataLow, int dataHigh, int chunkSize);
+-- static void *reactorThread(void *argument);
+-- static void runReactor(struct reactor *reactor);
+-- static void acceptClients(struct reactor *reactor);
+-- static void handleEvent(struct reactor *reactor, struct connection *conn,
+--                         unsigned int events);
+-- static int readControl(struct reactor *reactor, struct connection *conn);
+-- static int forkCommand(struct reactor *reactor, struct connection *conn);
+-- static int startPassive(struct reactor *reactor, struct connection *conn);
+-- static int sendReply(struct reactor *reactor, struct connection *conn);
+-- static int acceptData(struct reactor *reactor, struct connection *conn);
+-- static int serviceMux(struct reactor *reactor, struct connection *conn,
+--                       unsigned int events);
+-- static int startConnect(struct reactor *reactor, struct connection *conn);
+-- static int finishConnect(struct reactor *reactor, struct connection *conn);
+-- static int startTransfer(struct reactor *reactor, struct connection *conn,
+--                          int operation);
+-- static int sendHeader(struct reactor *reactor, struct connection *conn);
+-- static int sendBody(struct reactor *reactor, struct connection *conn);
+-- static int sendCached(struct connection *conn);
+-- static int sendResume(struct reactor *reactor, struct connection *conn);
+-- static int readHeader(struct connection *conn);
+-- static int readBody(struct reactor *reactor, struct connection *conn);
+-- static void scheduleRetry(struct reactor *reactor, struct connection *conn);
+-- static void runRetries(struct reactor *reactor);
+-- static void checkSessions(struct reactor *reactor);
+-- static int watchSocket(struct reactor *reactor, struct connection *conn,
+--                        int operation, unsigned int events);
+-- static void dropSocket(struct reactor *reactor, struct connection *conn);
+-- static void closeConnection(struct reactor *reactor,
+--                             struct connection *conn);
+-- static void endTransfer(struct connection *conn, int success);
+-- static long long currentTime();
+-- static void systemFatal(const char* message);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Uploads are spliced to disk, see transfer.c.
+-- October 17, 2026 - Transfers can be a single stripe of a file.
+-- October 17, 2026 - Transfers can be resumed.
+-- October 17, 2026 - Delta uploads are handed to a child process.
+-- October 17, 2026 - So are deduplicated uploads.
+-- October 17, 2026 - So are compressed transfers.
+-- October 17, 2026 - So are verified transfers.
+-- October 17, 2026 - So are batches.
+-- October 17, 2026 - So are listings.
+-- October 17, 2026 - Downloads use the cache of open files, see filecache.c.
+-- October 17, 2026 - Small hot files are sent from memory.
+-- October 17, 2026 - Uploads are preallocated and written behind.
+-- October 17, 2026 - Multiplexed sessions are kept alive and closed when idle.
+-- October 17, 2026 - Every reactor counts its transfers, see metrics.c.
+-- October 17, 2026 - Sockets are taken out of epoll before they are closed.
+-- October 17, 2026 - The reactors can be stopped, see stopReactors.
+--
+-- NOTES:
+-- This file contains the event driven mode of the server. Instead of forking a
+-- process for every client, one process watches the listening socket and every
+-- control and transfer socket with epoll. All sockets are non blocking and each
+-- client is a small state machine that is advanced whenever its socket becomes
+-- readable or writable:
+--
+-- STATE_CONTROL -> STATE_CONNECT -> STATE_SEND_HEADER -> STATE_SEND_BODY
+--                                -> STATE_GET_HEADER  -> STATE_GET_BODY
+--
+-- A resumed upload first sends the resume point of the partial file in
+-- STATE_SEND_RESUME and then goes on to STATE_GET_HEADER. A download of a
+-- file the cache keeps in memory goes to STATE_SEND_CACHED instead of
+-- STATE_SEND_HEADER, which sends the size control message and the body
+-- together.
+--
+-- A passive transfer replaces STATE_CONNECT with STATE_REPLY, which sends the
+-- data port to the client, and STATE_ACCEPT, which waits for the client to
+-- connect to it.
+--
+-- A multiplexed client stays in STATE_MUX on its control socket and all of its
+-- transfers are driven by the session in mux.c. Every reactor keeps a list of
+-- its sessions and checks them about once a second, which pings the clients
+-- that went quiet and lets go of the ones that stopped answering or were idle
+-- for MUX_IDLE_TIMEOUT.
+--
+-- A delta upload spends most of its time checksumming and rebuilding the file,
+-- see delta.c, which would hold up every other client of the loop. It is
+-- handed to a forked child that runs serveCommand, as in the fork mode. So is
+-- a deduplicated upload, see store.c, which hashes every chunk it receives,
+-- and a transfer the client wants compressed, see compress.c, whose sender
+-- compresses on a thread of its own. A transfer the client wants verified,
+-- see verify.c, checksums its body on a thread of its own as well. A batch,
+-- see batch.c, moves many files back to back on one connection and is
+-- forked too, it is a long run of small transfers best done blocking. A
+-- listing is forked so the child can page through its own copy of the index,
+-- see index.c.
+--
+-- File bodies are moved in chunks of at most the chunk size per wakeup so a
+-- single large transfer can not starve the other clients. A download opens
+-- its file through the cache of open files, see filecache.c, so a file many
+-- clients get is only opened and looked at once.
+--
+-- In the reactor mode several event loops run side by side, one per thread
+-- and each pinned to its own CPU. Every reactor owns its listening socket
+-- (bound with SO_REUSEPORT so the kernel balances new clients between them),
+-- its epoll instance, its receive pipe and buffer, its slice of the data ports
+-- and its connections, so nothing is shared or locked once the threads are
+-- running.
+--
+-- A server run inside another program, as the load generator does, is
+-- stopped with stopReactors. Every reactor watches one event that it makes
+-- readable, and leaves its loop at the next wakeup.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "server.h"
+#include "portpool.h"
+#include "filecache.h"
+#include "metrics.h"
+#include "../network/network.h"
+#include "../network/mux.h"
+#include "../network/transfer.h"
+#include "../network/buffer.h"
+
+#define MAX_EVENTS 64
+
+// Connection states
+#define STATE_CONTROL 0
+#define STATE_CONNECT 1
+#define STATE_RETRY 2
+#define STATE_SEND_HEADER 3
+#define STATE_SEND_BODY 4
+#define STATE_GET_HEADER 5
+#define STATE_GET_BODY 6
+#define STATE_REPLY 7
+#define STATE_ACCEPT 8
+#define STATE_MUX 9
+#define STATE_SEND_RESUME 10
+#define STATE_SEND_CACHED 11
+
+struct connection
+{
+    int socket;
+    int listenSocket;
+    int dataPort;
+    int file;
+    struct cachedFile *cached;
+    const char *contents;
+    int state;
+    int command;
+    int retries;
+    int port;
+    char ip[16];
+    char fileName[BUFFER_LENGTH];
+    char buffer[BUFFER_LENGTH];
+    int bufferCount;
+    int stripe;
+    int stripes;
+    int resume;
+    struct resumePoint resumePoint;
+    struct writeBehind behind;
+    off_t fileSize;
+    off_t offset;
+    off_t end;
+    long long retryTime;
+    long long accepted;
+    long long connecting;
+    long long started;
+    struct connection *nextRetry;
+    struct muxSession *mux;
+    struct connection *nextSession;
+    struct connection *previousSession;
+    unsigned int events;
+};
+
+struct reactor
+{
+    int epoll;
+    int listenSocket;
+    int index;
+    int cpu;
+    pthread_t thread;
+    int receivePipe[2];
+    struct bufferPool buffers;
+    char *scratch;
+    struct portPool ports;
+    struct connection *retries;
+    struct connection *sessions;
+    long long nextCheck;
+};
+
+static void setupReactor(struct reactor *reactor, int port, int reusePort,
+                         int dataLow, int dataHigh, int chunkSize);
+static void *reactorThread(void *argument);
+static void runReactor(struct reactor *reactor);
+static void acceptClients(struct reactor *reactor);
+static void handleEvent(struct reactor *reactor, struct connection *conn,
+                        unsigned int events);
+static int readControl(struct reactor *reactor, struct connection *conn);
+static int forkCommand(struct reactor *reactor, struct connection *conn);
+static int startPassive(struct reactor *reactor, struct connection *conn);
+static int sendReply(struct reactor *reactor, struct connection *conn);
+static int acceptData(struct reactor *reactor, struct connection *conn);
+static int serviceMux(struct reactor *reactor, struct connection *conn,
+                      unsigned int events);
+static int startConnect(struct reactor *reactor, struct connection *conn);
+static int finishConnect(struct reactor *reactor, struct connection *conn);
+static int startTransfer(struct reactor *reactor, struct connection *conn,
+                         int operation);
+static int sendHeader(struct reactor *reactor, struct connection *conn);
+static int sendBody(struct reactor *reactor, struct connection *conn);
+static int sendCached(struct connection *conn);
+static int sendResume(struct reactor *reactor, struct connection *conn);
+static int readHeader(struct connection *conn);
+static int readBody(struct reactor *reactor, struct connection *conn);
+static void scheduleRetry(struct reactor *reactor, struct connection *conn);
+static void runRetries(struct reactor *reactor);
+static void checkSessions(struct reactor *reactor);
+static int watchSocket(struct reactor *reactor, struct connection *conn,
+                       int operation, unsigned int events);
+static void dropSocket(struct reactor *reactor, struct connection *conn);
+static void closeConnection(struct reactor *reactor,
+                            struct connection *conn);
+static void endTransfer(struct connection *conn, int success);
+static long long currentTime();
+static void systemFatal(const char* message);
+
+// Set by stopReactors. The event wakes every reactor, which knows it by its
+// address as the data of the entry.
+static volatile int stopRequested = 0;
+static int stopEvent = -1;
+
+/*
+-- FUNCTION: reactorServer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Runs one reactor per thread in the reactor
+-- mode.
+-- October 17, 2026 - Splits the range of data ports between the reactors.
+-- October 17, 2026 - Ignores SIGCHLD for the children of forkCommand.
+-- October 17, 2026 - Runs one reactor unless the transport can share the port.
+-- October 17, 2026 - Numbers the reactors for their metrics shards.
+-- October 17, 2026 - Creates the event that stops the reactors.
+--
+-- INTERFACE: void reactorServer(struct serverOptions *options);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function sets up the reactors and runs them until the server is shut
+-- down or stopReactors is called. The epoll mode runs a single reactor on the calling thread, the
+-- reactor mode starts one thread per reactor. Without a thread count the
+-- reactor mode starts one reactor per online CPU. Every reactor gets an equal
+-- slice of the data port range. The reactors share the port by each binding
+-- it, which only TCP allows, so over another transport there is one reactor.
+*/
+void reactorServer(struct serverOptions *options)
+{
+    struct reactor *reactors = NULL;
+    int threads = 1;
+    int cpus = 1;
+    int slice = 0;
+    int dataLow = 0;
+    int dataHigh = 0;
+    int i = 0;
+
+    // A client closing early must not take the whole server down
+    signal(SIGPIPE, SIG_IGN);
+
+    // Children serving forked uploads are reaped by the kernel
+    signal(SIGCHLD, SIG_IGN);
+
+    if ((cpus = (int)sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+    {
+        cpus = 1;
+    }
+    if (options->mode == MODE_REACTOR)
+    {
+        threads = options->threads > 0 ? options->threads : cpus;
+    }
+    if (threads > 1 && !(getTransport()->flags & TRANSPORT_REUSE_PORT))
+    {
+        fprintf(stderr, "One reactor runs over the %s transport\n",
+            getTransport()->name);
+        threads = 1;
+    }
+    if (options->dataLow > 0)
+    {
+        if ((slice = (options->dataHigh - options->dataLow + 1) / threads) < 1)
+        {
+            fprintf(stderr, "Need at least one data port per reactor\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if ((reactors = (struct reactor*)calloc(threads,
+        sizeof(struct reactor))) == NULL)
+    {
+        systemFatal("Cannot Allocate Reactors");
+    }
+    if (stopEvent == -1 && (stopEvent = eventfd(0, EFD_CLOEXEC)) == -1)
+    {
+        systemFatal("Cannot Create Stop Event");
+    }
+
+    // Bind every listening socket before starting so failures show up now
+    for (i = 0; i < threads; i++)
+    {
+        if (slice > 0)
+        {
+            dataLow = options->dataLow + i * slice;
+            dataHigh = i == threads - 1 ? options->dataHigh :
+                dataLow + slice - 1;
+        }
+        setupReactor(&reactors[i], options->port, threads > 1, dataLow,
+            dataHigh, options->chunkSize);
+        reactors[i].index = i;
+        reactors[i].cpu = i % cpus;
+    }
+
+    if (threads == 1)
+    {
+        runReactor(&reactors[0]);
+    }
+    else
+    {
+        printf("Starting %d reactors on %d CPUs\n", threads, cpus);
+        for (i = 0; i < threads; i++)
+        {
+            if (pthread_create(&reactors[i].thread, NULL, reactorThread,
+                &reactors[i]) != 0)
+            {
+                systemFatal("Cannot Start Reactor Thread");
+            }
+        }
+        for (i = 0; i < threads; i++)
+        {
+            pthread_join(reactors[i].thread, NULL);
+        }
+    }
+
+    for (i = 0; i < threads; i++)
+    {
+        closeReceivePipe(reactors[i].receivePipe);
+        returnBuffer(&reactors[i].buffers, reactors[i].scratch);
+        destroyBufferPool(&reactors[i].buffers);
+        destroyPortPool(&reactors[i].ports);
+        close(reactors[i].epoll);
+        close(reactors[i].listenSocket);
+    }
+    free(reactors);
+    printf("Server Closing!\n");
+}
+
+/*
+-- FUNCTION: stopReactors
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void stopReactors();
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function asks every reactor to leave its loop, after which
+-- reactorServer cleans up and returns. It can be called from any thread.
+-- Connections still open are left as they are, the caller is about to exit.
+*/
+void stopReactors()
+{
+    uint64_t one = 1;
+
+    stopRequested = 1;
+    if (stopEvent != -1 && write(stopEvent, &one, sizeof(one)) == -1)
+    {
+        perror("Cannot Stop Reactors");
+    }
+}
+
+/*
+-- FUNCTION: setupReactor
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Creates the receive pipe.
+-- October 17, 2026 - Takes the chunk size and creates the buffer pool.
+--
+-- INTERFACE: static void setupReactor(struct reactor *reactor, int port,
+--                                     int reusePort, int dataLow,
+--                                     int dataHigh, int chunkSize);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function creates the non blocking listening socket, the epoll instance,
+-- the receive pipe, the buffer pool with the receive buffer and the data port
+-- pool of a reactor. The listening socket and the stop event are the only
+-- entries in the epoll instance that have no connection attached.
+*/
+static void setupReactor(struct reactor *reactor, int port, int reusePort,
+                         int dataLow, int dataHigh, int chunkSize)
+{
+    struct epoll_event event;
+
+    initializeServer(&reactor->listenSocket, &port, reusePort);
+    if (makeSocketNonBlocking(&reactor->listenSocket) == -1)
+    {
+        systemFatal("Cannot Make Socket Non Blocking");
+    }
+
+    if ((reactor->epoll = epoll_create1(0)) == -1)
+    {
+        systemFatal("Cannot Create Epoll Instance");
+    }
+
+    bzero(&event, sizeof(struct epoll_event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    if (epoll_ctl(reactor->epoll, EPOLL_CTL_ADD, reactor->listenSocket,
+        &event) == -1)
+    {
+        systemFatal("Cannot Watch Listening Socket");
+    }
+    event.data.ptr = (void*)&stopEvent;
+    if (epoll_ctl(reactor->epoll, EPOLL_CTL_ADD, stopEvent, &event) == -1)
+    {
+        systemFatal("Cannot Watch Stop Event");
+    }
+
+    // Without a pipe the uploads are copied through the receive buffer
+    initializeBufferPool(&reactor->buffers, chunkSize);
+    openReceivePipe(reactor->receivePipe, reactor->buffers.size);
+    if ((reactor->scratch = takeBuffer(&reactor->buffers)) == NULL)
+    {
+        systemFatal("Cannot Allocate Receive Buffer");
+    }
+
+    if (initializePortPool(&reactor->ports, dataLow, dataHigh) == -1)
+    {
+        systemFatal("Cannot Allocate Data Ports");
+    }
+}
+
+/*
+-- FUNCTION: reactorThread
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void *reactorThread(void *argument);
+--
+-- RETURNS: NULL
+--
+-- NOTES:
+-- This is the thread function of a reactor. It pins the thread to the CPU of
+-- the reactor so its connections stay in the same caches and then runs the
+-- event loop. Failing to pin is not fatal.
+*/
+static void *reactorThread(void *argument)
+{
+    struct reactor *reactor = (struct reactor*)argument;
+    cpu_set_t cpuSet;
+
+    CPU_ZERO(&cpuSet);
+    CPU_SET(reactor->cpu, &cpuSet);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+        &cpuSet) != 0)
+    {
+        fprintf(stderr, "Unable To Pin Reactor To CPU %d\n", reactor->cpu);
+    }
+
+    runReactor(reactor);
+    return NULL;
+}
+
+/*
+-- FUNCTION: runReactor
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Checks the multiplexed sessions.
+-- October 17, 2026 - Counts in the metrics shard of the reactor.
+-- October 17, 2026 - Returns once stopReactors is called.
+--
+-- INTERFACE: static void runReactor(struct reactor *reactor);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This is the event loop. It waits for socket events and dispatches them to
+-- the connection they belong to. While connect backs are waiting to be retried
+-- the wait is bounded so the retries are started on time, and while there are
+-- multiplexed sessions it is bounded so they are checked. The loop counts in
+-- the metrics shard of its reactor.
+*/
+static void runReactor(struct reactor *reactor)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int timeout = 0;
+    int count = 0;
+    int i = 0;
+
+    useMetricsShard(reactor->index);
+    while (!stopRequested)
+    {
+        timeout = reactor->sessions == NULL ? -1 : MUX_CHECK_INTERVAL;
+        if (reactor->retries != NULL)
+        {
+            timeout = CONNECT_RETRY_DELAY;
+        }
+        count = epoll_wait(reactor->epoll, events, MAX_EVENTS, timeout);
+        if (count == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            systemFatal("Epoll Wait Failed");
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            if (events[i].data.ptr == (void*)&stopEvent)
+            {
+                continue;
+            }
+            if (events[i].data.ptr == NULL)
+            {
+                acceptClients(reactor);
+            }
+            else
+            {
+                handleEvent(reactor, (struct connection*)events[i].data.ptr,
+                    events[i].events);
+            }
+        }
+
+        runRetries(reactor);
+        checkSessions(reactor);
+    }
+}
+
+/*
+-- FUNCTION: acceptClients
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts the client and when it was accepted.
+--
+-- INTERFACE: static void acceptClients(struct reactor *reactor);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function accepts every pending client and starts watching its control
+-- socket for the control packet.
+*/
+static void acceptClients(struct reactor *reactor)
+{
+    struct connection *conn = NULL;
+    unsigned short clientPort = 0;
+    char clientIp[16];
+    int socket = 0;
+
+    while ((socket = acceptConnectionIpPort(&reactor->listenSocket, clientIp,
+        &clientPort)) != -1)
+    {
+        if ((conn = (struct connection*)calloc(1,
+            sizeof(struct connection))) == NULL)
+        {
+            close(socket);
+            continue;
+        }
+
+        conn->socket = socket;
+        conn->listenSocket = -1;
+        conn->file = -1;
+        conn->state = STATE_CONTROL;
+        conn->port = (int)clientPort;
+        conn->accepted = metricsClock();
+        strcpy(conn->ip, clientIp);
+        countMetric(METRIC_CONNECTIONS, 1);
+
+        if (makeSocketNonBlocking(&conn->socket) == -1 ||
+            watchSocket(reactor, conn, EPOLL_CTL_ADD, EPOLLIN) == -1)
+        {
+            perror("Can't Watch Client");
+            closeConnection(reactor, conn);
+        }
+    }
+
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        perror("Can't Accept Client");
+    }
+}
+
+/*
+-- FUNCTION: handleEvent
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Resumes a transfer that died part way.
+-- October 17, 2026 - Reads what arrived before a hang up.
+-- October 17, 2026 - Counts the end of the transfer.
+--
+-- INTERFACE: static void handleEvent(struct reactor *reactor,
+--                                    struct connection *conn,
+--                                    unsigned int events);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function advances the state machine of a connection. Every state
+-- handler returns 1 when the transfer is complete, 0 when it has to wait for
+-- the next event and -1 when the connection failed. The transfer is counted
+-- once the connection is done either way.
+*/
+static void handleEvent(struct reactor *reactor, struct connection *conn,
+                        unsigned int events)
+{
+    int result = 0;
+
+    // A Unix domain socket hangs up as soon as its peer closes, what the peer
+    // sent before is still read first
+    if ((events & (EPOLLERR | EPOLLHUP)) && !(events & EPOLLIN) &&
+        conn->state != STATE_CONNECT && conn->state != STATE_GET_BODY &&
+        conn->state != STATE_MUX)
+    {
+        result = -1;
+    }
+    else
+    {
+        switch (conn->state)
+        {
+        case STATE_CONTROL:
+            result = readControl(reactor, conn);
+            break;
+        case STATE_CONNECT:
+            result = finishConnect(reactor, conn);
+            break;
+        case STATE_REPLY:
+            result = sendReply(reactor, conn);
+            break;
+        case STATE_ACCEPT:
+            result = acceptData(reactor, conn);
+            break;
+        case STATE_MUX:
+            result = serviceMux(reactor, conn, events);
+            break;
+        case STATE_SEND_HEADER:
+            result = sendHeader(reactor, conn);
+            break;
+        case STATE_SEND_BODY:
+            result = sendBody(reactor, conn);
+            break;
+        case STATE_SEND_CACHED:
+            result = sendCached(conn);
+            break;
+        case STATE_SEND_RESUME:
+            result = sendResume(reactor, conn);
+            break;
+        case STATE_GET_HEADER:
+            result = readHeader(conn);
+            break;
+        case STATE_GET_BODY:
+            result = readBody(reactor, conn);
+            break;
+        }
+    }
+
+    if (result == 1)
+    {
+        printf("Closing client connection\n");
+        endTransfer(conn, 1);
+        closeConnection(reactor, conn);
+    }
+    else if (result == -1)
+    {
+        endTransfer(conn, 0);
+        fprintf(stderr, "Transfer of %s with %s failed\n", conn->fileName,
+            conn->ip);
+        closeConnection(reactor, conn);
+    }
+}
+
+/*
+-- FUNCTION: readControl
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Reads the stripe of the file.
+-- October 17, 2026 - Reads the resume point.
+-- October 17, 2026 - Forks for delta uploads.
+-- October 17, 2026 - Forks for deduplicated uploads.
+-- October 17, 2026 - Forks for compressed transfers.
+-- October 17, 2026 - Forks for verified transfers.
+-- October 17, 2026 - Forks for batches.
+-- October 17, 2026 - Forks for listings.
+-- October 17, 2026 - Adds a multiplexed session to the list of sessions.
+-- October 17, 2026 - Counts the streams of the session as they open.
+--
+-- INTERFACE: static int readControl(struct reactor *reactor,
+--                                   struct connection *conn);
+--
+-- RETURNS: 0 while waiting for data, -1 on failure
+--
+-- NOTES:
+-- This function collects the control packet. Once it is complete either the
+-- control socket is closed and the connect back to the client is started, or
+-- for a passive transfer the data port is advertised to the client. A delta
+-- or deduplicated upload, a compressed or verified transfer and a batch are
+-- handed to a child process.
+*/
+static int readControl(struct reactor *reactor, struct connection *conn)
+{
+    int bytesRead = 0;
+    int flags = 0;
+
+    bytesRead = readData(&conn->socket, conn->buffer + conn->bufferCount,
+        BUFFER_LENGTH - conn->bufferCount);
+    if (bytesRead == 0)
+    {
+        return -1;
+    }
+    if (bytesRead == -1)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    conn->bufferCount += bytesRead;
+    if (conn->bufferCount < BUFFER_LENGTH)
+    {
+        return 0;
+    }
+
+    // Add 1 to buffer to move past the control byte
+    conn->command = (int)conn->buffer[0];
+    conn->buffer[MAX_NAME_LENGTH + 1] = '\0';
+    strcpy(conn->fileName, conn->buffer + 1);
+    memmove((void*)&flags, conn->buffer + CONTROL_FLAGS, sizeof(int));
+    readStripe(conn->buffer, &conn->stripe, &conn->stripes);
+    unpackResume(conn->buffer + CONTROL_RESUME, &conn->resumePoint);
+    conn->resume = (flags & FLAG_RESUME) && conn->stripes == 1;
+    printf("Filename is %s and the command is %d\n", conn->fileName,
+        conn->command);
+
+    if (conn->command == MULTIPLEX)
+    {
+        if ((conn->mux = muxCreate(conn->socket, 1, DEF_DIR,
+            reportStream)) == NULL)
+        {
+            return -1;
+        }
+        conn->mux->opened = countStream;
+        conn->state = STATE_MUX;
+        conn->events = EPOLLIN;
+        conn->nextSession = reactor->sessions;
+        if (reactor->sessions != NULL)
+        {
+            reactor->sessions->previousSession = conn;
+        }
+        reactor->sessions = conn;
+        return 0;
+    }
+
+    if (conn->command == BATCH_GET || conn->command == BATCH_SEND ||
+        conn->command == REQUEST_LIST)
+    {
+        return forkCommand(reactor, conn);
+    }
+    if (conn->command != GET_FILE && conn->command != SEND_FILE)
+    {
+        return 1;
+    }
+
+    if ((flags & FLAG_VERIFY) || (conn->stripes == 1 &&
+        ((flags & FLAG_COMPRESS) || (conn->command == SEND_FILE &&
+        (flags & (FLAG_DELTA | FLAG_DEDUP))))))
+    {
+        return forkCommand(reactor, conn);
+    }
+
+    if (flags & FLAG_PASSIVE)
+    {
+        return startPassive(reactor, conn);
+    }
+
+    // Close the command socket
+    dropSocket(reactor, conn);
+
+    return startConnect(reactor, conn);
+}
+
+/*
+-- FUNCTION: forkCommand
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Passes the time the client was accepted on.
+--
+-- INTERFACE: static int forkCommand(struct reactor *reactor,
+--                                   struct connection *conn);
+--
+-- RETURNS: 1, the connection is done as far as the reactor is concerned
+--
+-- NOTES:
+-- This function forks a child that serves the connection with serveCommand
+-- in the same way as the fork mode. The child moves the control socket to the
+-- lowest free descriptor and closes every other descriptor it inherited, so
+-- the sockets of the reactor's other clients are really closed once the
+-- reactor closes them. The parent takes the socket out of epoll, which only
+-- forgets a socket once every copy of it is closed.
+*/
+static int forkCommand(struct reactor *reactor, struct connection *conn)
+{
+    int processId = 0;
+    int socket = 0;
+
+    if ((processId = fork()) == 0)
+    {
+        socket = dup2(conn->socket, STDERR_FILENO + 1);
+        close_range(STDERR_FILENO + 2, ~0U, 0);
+        serveCommand(socket, conn->buffer, conn->ip, conn->port,
+            &reactor->ports, conn->accepted);
+        exit(EXIT_SUCCESS);
+    }
+    if (processId == -1)
+    {
+        perror("Fork Failed To Create Child To Deal With Client");
+    }
+
+    // The child keeps the socket open, epoll would go on reporting it
+    watchSocket(reactor, conn, EPOLL_CTL_DEL, 0);
+    return 1;
+}
+
+/*
+-- FUNCTION: startPassive
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int startPassive(struct reactor *reactor,
+--                                    struct connection *conn);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function opens a listening socket on a data port for a passive
+-- transfer and starts sending the port to the client on the control socket.
+*/
+static int startPassive(struct reactor *reactor, struct connection *conn)
+{
+    if ((conn->dataPort = createPassiveSocket(&conn->listenSocket,
+        &reactor->ports)) == -1)
+    {
+        conn->dataPort = 0;
+        perror("Cannot Create Passive Socket");
+        return -1;
+    }
+    if (makeSocketNonBlocking(&conn->listenSocket) == -1)
+    {
+        return -1;
+    }
+
+    // Control message with the data port
+    bzero(conn->buffer, BUFFER_LENGTH);
+    memmove(conn->buffer, (void*)&conn->dataPort, sizeof(int));
+    conn->bufferCount = 0;
+    conn->state = STATE_REPLY;
+
+    return watchSocket(reactor, conn, EPOLL_CTL_MOD, EPOLLOUT);
+}
+
+/*
+-- FUNCTION: sendReply
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int sendReply(struct reactor *reactor,
+--                                 struct connection *conn);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function sends the data port to the client. Once it is sent the control
+-- socket is closed and the listening socket takes its place in epoll.
+*/
+static int sendReply(struct reactor *reactor, struct connection *conn)
+{
+    int bytesSent = 0;
+
+    bytesSent = sendData(&conn->socket, conn->buffer + conn->bufferCount,
+        BUFFER_LENGTH - conn->bufferCount);
+    if (bytesSent == -1)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    conn->bufferCount += bytesSent;
+    if (conn->bufferCount < BUFFER_LENGTH)
+    {
+        return 0;
+    }
+
+    dropSocket(reactor, conn);
+    conn->socket = conn->listenSocket;
+    conn->listenSocket = -1;
+    conn->state = STATE_ACCEPT;
+
+    return watchSocket(reactor, conn, EPOLL_CTL_ADD, EPOLLIN);
+}
+
+/*
+-- FUNCTION: acceptData
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts a failed data connection.
+--
+-- INTERFACE: static int acceptData(struct reactor *reactor,
+--                                  struct connection *conn);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function accepts the data connection of a passive transfer. Only a
+-- connection from the address of the client is accepted. The data port goes
+-- back to the pool as soon as the listening socket is closed.
+*/
+static int acceptData(struct reactor *reactor, struct connection *conn)
+{
+    char peerIp[16];
+    int socket = 0;
+
+    if ((socket = acceptConnectionIp(&conn->socket, peerIp)) == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return 0;
+        }
+        countMetric(METRIC_PASSIVE_ERRORS, 1);
+        return -1;
+    }
+    if (strcmp(peerIp, conn->ip) != 0)
+    {
+        fprintf(stderr, "Data connection from %s, expected %s\n", peerIp,
+            conn->ip);
+        countMetric(METRIC_PASSIVE_ERRORS, 1);
+        close(socket);
+        return -1;
+    }
+
+    dropSocket(reactor, conn);
+    releaseDataPort(&reactor->ports, conn->dataPort);
+    conn->dataPort = 0;
+    conn->socket = socket;
+    if (makeSocketNonBlocking(&conn->socket) == -1)
+    {
+        return -1;
+    }
+
+    return startTransfer(reactor, conn, EPOLL_CTL_ADD);
+}
+
+/*
+-- FUNCTION: serviceMux
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int serviceMux(struct reactor *reactor,
+--                                  struct connection *conn,
+--                                  unsigned int events);
+--
+-- RETURNS: 1 when the client disconnected, 0 while the session continues, -1
+--          on failure
+--
+-- NOTES:
+-- This function reads and sends frames for a multiplexed session. The socket
+-- is only watched for writing while the session has something to send.
+*/
+static int serviceMux(struct reactor *reactor, struct connection *conn,
+                      unsigned int events)
+{
+    unsigned int wanted = EPOLLIN;
+
+    if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) &&
+        muxRead(conn->mux) == -1)
+    {
+        return 1;
+    }
+    if (muxWrite(conn->mux) == -1)
+    {
+        return -1;
+    }
+
+    if (muxWantsWrite(conn->mux))
+    {
+        wanted |= EPOLLOUT;
+    }
+    if (wanted != conn->events)
+    {
+        conn->events = wanted;
+        return watchSocket(reactor, conn, EPOLL_CTL_MOD, wanted);
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: startConnect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts failures and when connecting started.
+--
+-- INTERFACE: static int startConnect(struct reactor *reactor,
+--                                    struct connection *conn);
+--
+-- RETURNS: 0 while connecting, -1 on failure
+--
+-- NOTES:
+-- This function starts a non blocking connect back to the client. A refused
+-- connection means the client is not listening yet, so it is retried later.
+-- The time to connect back is counted from the first attempt.
+*/
+static int startConnect(struct reactor *reactor, struct connection *conn)
+{
+    if (conn->connecting == 0)
+    {
+        conn->connecting = metricsClock();
+    }
+    if ((conn->dataPort = createTransferSocket(&conn->socket,
+        &reactor->ports)) == -1)
+    {
+        conn->socket = -1;
+        conn->dataPort = 0;
+        countMetric(METRIC_CONNECT_ERRORS, 1);
+        return -1;
+    }
+    if (makeSocketNonBlocking(&conn->socket) == -1)
+    {
+        return -1;
+    }
+
+    if (connectToIp(&conn->port, &conn->socket, conn->ip) == 0)
+    {
+        return startTransfer(reactor, conn, EPOLL_CTL_ADD);
+    }
+
+    if (errno == ECONNREFUSED)
+    {
+        scheduleRetry(reactor, conn);
+        return 0;
+    }
+    if (errno != EINPROGRESS)
+    {
+        countMetric(METRIC_CONNECT_ERRORS, 1);
+        return -1;
+    }
+
+    conn->state = STATE_CONNECT;
+    return watchSocket(reactor, conn, EPOLL_CTL_ADD, EPOLLOUT);
+}
+
+/*
+-- FUNCTION: finishConnect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts a failed connect back.
+--
+-- INTERFACE: static int finishConnect(struct reactor *reactor,
+--                                     struct connection *conn);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function is called once the non blocking connect has completed. It
+-- checks the result of the connect and starts the transfer.
+*/
+static int finishConnect(struct reactor *reactor, struct connection *conn)
+{
+    int error = 0;
+    socklen_t length = sizeof(error);
+
+    if (getsockopt(conn->socket, SOL_SOCKET, SO_ERROR, &error, &length) == -1)
+    {
+        return -1;
+    }
+
+    if (error == ECONNREFUSED)
+    {
+        scheduleRetry(reactor, conn);
+        return 0;
+    }
+    if (error != 0)
+    {
+        errno = error;
+        countMetric(METRIC_CONNECT_ERRORS, 1);
+        return -1;
+    }
+
+    return startTransfer(reactor, conn, EPOLL_CTL_MOD);
+}
+
+/*
+-- FUNCTION: startTransfer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moves the range of the stripe only.
+-- October 17, 2026 - Resumes a transfer that died part way.
+-- October 17, 2026 - Downloads are opened through the file cache.
+-- October 17, 2026 - Sends a file kept in memory with sendCached.
+-- October 17, 2026 - Counts the transfer and times the connect back.
+--
+-- INTERFACE: static int startTransfer(struct reactor *reactor,
+--                                     struct connection *conn, int operation);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function opens the file for the command and moves the connection to
+-- the first state of the transfer. A file being sent is announced with a
+-- control message holding the size of the file. The operation tells whether
+-- the socket is already watched by epoll, which is not the case when the
+-- connect completed immediately.
+--
+-- Only the range of the stripe is moved. A file received in stripes is not
+-- truncated, the other stripes are being written to it at the same time.
+--
+-- A resumed download starts where the partial file of the client ends if the
+-- checksums of its end match. A resumed upload first sends the resume point
+-- of the partial file here to the client.
+--
+-- The transfer is counted as started here, with the time it took to connect
+-- back and the time since the client was accepted.
+*/
+static int startTransfer(struct reactor *reactor, struct connection *conn,
+                         int operation)
+{
+    char fileNamePath[FILENAME_MAX];
+
+    printf("Connected to Client: %s\n", conn->ip);
+
+    conn->started = metricsClock();
+    if (conn->connecting != 0)
+    {
+        timeMetric(METRIC_CONNECT_BACK, conn->started - conn->connecting);
+    }
+    timeMetric(METRIC_FIRST_BYTE, conn->started - conn->accepted);
+    countMetric(METRIC_STARTED, 1);
+
+    bzero(conn->buffer, BUFFER_LENGTH);
+    conn->bufferCount = 0;
+    conn->offset = 0;
+
+    if (conn->command == GET_FILE)
+    {
+        printf("Sending %s to client now...\n", conn->fileName);
+        if ((conn->cached = openCached(conn->fileName, &conn->contents)) == NULL)
+        {
+            perror("Problem Opening File");
+            return -1;
+        }
+        conn->file = conn->cached->file;
+
+        // Control message with the size of the file and where it starts
+        conn->fileSize = conn->cached->statBuffer.st_size;
+        stripeRange(conn->fileSize, conn->stripe, conn->stripes,
+            &conn->offset, &conn->end);
+        conn->end += conn->offset;
+        if (conn->resume)
+        {
+            conn->offset = checkResume(conn->file, conn->fileSize,
+                &conn->resumePoint, reactor->scratch, reactor->buffers.size);
+            conn->end = conn->fileSize;
+            printf("Resuming %s at %zd\n", conn->fileName, conn->offset);
+        }
+        memmove(conn->buffer, (void*)&conn->fileSize, sizeof(off_t));
+        memmove(conn->buffer + HEADER_OFFSET, (void*)&conn->offset,
+            sizeof(off_t));
+        conn->state = conn->contents != NULL ? STATE_SEND_CACHED :
+            STATE_SEND_HEADER;
+        return watchSocket(reactor, conn, operation, EPOLLOUT);
+    }
+
+    printf("Getting %s from client now...\n", conn->fileName);
+    sprintf(fileNamePath, "%s%s", DEF_DIR, conn->fileName);
+    if ((conn->file = open(fileNamePath, (conn->resume ? O_RDWR : O_WRONLY) |
+        O_CREAT, 00400 | 00200 | 00100)) == -1)
+    {
+        perror("Unable To Create File");
+        return -1;
+    }
+
+    // Tell the client how much of the file is already here
+    if (conn->resume)
+    {
+        findResume(conn->file, &conn->resumePoint, reactor->scratch,
+            reactor->buffers.size);
+        packResume(conn->buffer, &conn->resumePoint);
+        conn->state = STATE_SEND_RESUME;
+        return watchSocket(reactor, conn, operation, EPOLLOUT);
+    }
+    conn->state = STATE_GET_HEADER;
+    return watchSocket(reactor, conn, operation, EPOLLIN);
+}
+
+/*
+-- FUNCTION: sendHeader
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Takes the reactor for sendBody.
+--
+-- INTERFACE: static int sendHeader(struct reactor *reactor,
+--                                 struct connection *conn);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function sends as much of the size control message as the socket will
+-- take and moves on to the file body once all of it is sent.
+*/
+static int sendHeader(struct reactor *reactor, struct connection *conn)
+{
+    int bytesSent = 0;
+
+    bytesSent = sendData(&conn->socket, conn->buffer + conn->bufferCount,
+        BUFFER_LENGTH - conn->bufferCount);
+    if (bytesSent == -1)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    conn->bufferCount += bytesSent;
+    if (conn->bufferCount < BUFFER_LENGTH)
+    {
+        return 0;
+    }
+
+    conn->state = STATE_SEND_BODY;
+    return sendBody(reactor, conn);
+}
+
+/*
+-- FUNCTION: sendBody
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Sends up to the chunk size of the reactor.
+-- October 17, 2026 - Moves the range of the stripe only.
+-- October 17, 2026 - Counts the bytes sent.
+--
+-- INTERFACE: static int sendBody(struct reactor *reactor,
+--                               struct connection *conn);
+--
+-- RETURNS: 1 when the file is sent, 0 while waiting, -1 on failure
+--
+-- NOTES:
+-- This function sends the next chunk of the file with sendfile. The offset is
+-- kept in the connection so the transfer continues where it left off on the
+-- next writable event.
+*/
+static int sendBody(struct reactor *reactor, struct connection *conn)
+{
+    off_t remaining = conn->end - conn->offset;
+    ssize_t bytesSent = 0;
+
+    if (remaining > 0)
+    {
+        bytesSent = sendfile(conn->socket, conn->file, &conn->offset,
+            remaining < reactor->buffers.size ? remaining :
+            reactor->buffers.size);
+        if (bytesSent == -1)
+        {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        if (bytesSent == 0)
+        {
+            // The file shrunk while we were sending it
+            return -1;
+        }
+        countMetric(METRIC_BYTES_OUT, bytesSent);
+    }
+
+    return conn->offset >= conn->end ? 1 : 0;
+}
+
+/*
+-- FUNCTION: sendCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts the bytes sent.
+--
+-- INTERFACE: static int sendCached(struct connection *conn);
+--
+-- RETURNS: 1 when the file is sent, 0 while waiting, -1 on failure
+--
+-- NOTES:
+-- This function sends a file the cache keeps in memory. What is left of the
+-- size control message and of the body goes out in one writev, so a small
+-- file usually takes a single system call and leaves in as few packets as
+-- the two fill.
+*/
+static int sendCached(struct connection *conn)
+{
+    struct iovec vector[2];
+    int headerLeft = BUFFER_LENGTH - conn->bufferCount;
+    ssize_t bytesSent = 0;
+
+    bytesSent = writev(conn->socket, vector, fillCachedVector(vector,
+        conn->contents, conn->buffer, conn->bufferCount, conn->offset,
+        conn->end));
+    if (bytesSent == -1)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    if (bytesSent < headerLeft)
+    {
+        conn->bufferCount += bytesSent;
+        return 0;
+    }
+
+    conn->bufferCount = BUFFER_LENGTH;
+    conn->offset += bytesSent - headerLeft;
+    countMetric(METRIC_BYTES_OUT, bytesSent - headerLeft);
+    return conn->offset >= conn->end ? 1 : 0;
+}
+
+/*
+-- FUNCTION: sendResume
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int sendResume(struct reactor *reactor,
+--                                  struct connection *conn);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function sends the resume point of a partial upload to the client and
+-- then waits for the size control message of the file.
+*/
+static int sendResume(struct reactor *reactor, struct connection *conn)
+{
+    int bytesSent = 0;
+
+    bytesSent = sendData(&conn->socket, conn->buffer + conn->bufferCount,
+        BUFFER_LENGTH - conn->bufferCount);
+    if (bytesSent == -1)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    conn->bufferCount += bytesSent;
+    if (conn->bufferCount < BUFFER_LENGTH)
+    {
+        return 0;
+    }
+
+    bzero(conn->buffer, BUFFER_LENGTH);
+    conn->bufferCount = 0;
+    conn->state = STATE_GET_HEADER;
+
+    return watchSocket(reactor, conn, EPOLL_CTL_MOD, EPOLLIN);
+}
+
+/*
+-- FUNCTION: readHeader
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moves the range of the stripe only.
+-- October 17, 2026 - Resumes a transfer that died part way.
+-- October 17, 2026 - Preallocates the file.
+--
+-- INTERFACE: static int readHeader(struct connection *conn);
+--
+-- RETURNS: 1 for an empty stripe, 0 while waiting, -1 on failure
+--
+-- NOTES:
+-- This function collects the control message with the size of the file the
+-- client is about to send. A file received in stripes is set to its full size
+-- so every stripe can be written at its offset. Any other file is cut back to
+-- where the transfer starts, which is the offset of a resumed upload.
+*/
+static int readHeader(struct connection *conn)
+{
+    int bytesRead = 0;
+
+    bytesRead = readData(&conn->socket, conn->buffer + conn->bufferCount,
+        BUFFER_LENGTH - conn->bufferCount);
+    if (bytesRead == 0)
+    {
+        return -1;
+    }
+    if (bytesRead == -1)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    conn->bufferCount += bytesRead;
+    if (conn->bufferCount < BUFFER_LENGTH)
+    {
+        return 0;
+    }
+
+    // Retrieve file size from the buffer
+    memmove((void*)&conn->fileSize, conn->buffer, sizeof(off_t));
+    printf("File size is %zd\n", conn->fileSize);
+    stripeRange(conn->fileSize, conn->stripe, conn->stripes, &conn->offset,
+        &conn->end);
+    conn->end += conn->offset;
+    if (conn->resume)
+    {
+        memmove((void*)&conn->offset, conn->buffer + HEADER_OFFSET,
+            sizeof(off_t));
+        if (conn->offset < 0 || conn->offset > conn->resumePoint.length ||
+            conn->offset > conn->fileSize)
+        {
+            fprintf(stderr, "Invalid resume offset from %s\n", conn->ip);
+            return -1;
+        }
+        conn->end = conn->fileSize;
+        printf("Resuming %s at %zd\n", conn->fileName, conn->offset);
+    }
+
+    // Drop what is not kept, the stripes of a file all set its full size
+    if (ftruncate(conn->file, conn->stripes > 1 ? conn->fileSize :
+        conn->offset) == -1)
+    {
+        perror("Unable To Size File");
+        return -1;
+    }
+    startReceive(&conn->behind, conn->file, conn->offset,
+        conn->end - conn->offset);
+    conn->state = STATE_GET_BODY;
+
+    return conn->offset >= conn->end ? 1 : 0;
+}
+
+/*
+-- FUNCTION: readBody
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Splices the chunk to disk through the pipe of
+-- the reactor.
+-- October 17, 2026 - Moves the range of the stripe only.
+-- October 17, 2026 - Writes the file behind, see transfer.c.
+-- October 17, 2026 - Counts the bytes received.
+--
+-- INTERFACE: static int readBody(struct reactor *reactor,
+--                                struct connection *conn);
+--
+-- RETURNS: 1 when the file is received, 0 while waiting, -1 on failure
+--
+-- NOTES:
+-- This function moves the next chunk of the file from the socket to disk
+-- through the pipe of the reactor. The pipe is empty again when the function
+-- returns, so every connection of the reactor can use it. The receive buffer
+-- is only used if splice is not available.
+*/
+static int readBody(struct reactor *reactor, struct connection *conn)
+{
+    off_t remaining = conn->end - conn->offset;
+    int bytesRead = 0;
+
+    bytesRead = receiveChunk(conn->socket, conn->file, reactor->receivePipe,
+        reactor->scratch, remaining < reactor->buffers.size ? remaining :
+        reactor->buffers.size, &conn->offset);
+    if (bytesRead == 0)
+    {
+        return -1;
+    }
+    if (bytesRead == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return 0;
+        }
+        perror("Unable To Receive File");
+        return -1;
+    }
+
+    countMetric(METRIC_BYTES_IN, bytesRead);
+    writeBehind(&conn->behind, conn->offset);
+    if (conn->offset < conn->end)
+    {
+        return 0;
+    }
+
+    printf("Getting %s successful.\n", conn->fileName);
+    return 1;
+}
+
+/*
+-- FUNCTION: scheduleRetry
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts a client that never listened.
+--
+-- INTERFACE: static void scheduleRetry(struct reactor *reactor,
+--                                      struct connection *conn);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function queues a refused connect back so it is tried again after
+-- CONNECT_RETRY_DELAY milliseconds with a new socket. Connections that run out
+-- of retries are closed.
+*/
+static void scheduleRetry(struct reactor *reactor, struct connection *conn)
+{
+    if (conn->socket != -1)
+    {
+        dropSocket(reactor, conn);
+    }
+    releaseDataPort(&reactor->ports, conn->dataPort);
+    conn->dataPort = 0;
+
+    if (++conn->retries > CONNECT_RETRIES)
+    {
+        fprintf(stderr, "Unable To Connect To Client: %s\n", conn->ip);
+        countMetric(METRIC_CONNECT_ERRORS, 1);
+        closeConnection(reactor, conn);
+        return;
+    }
+
+    conn->state = STATE_RETRY;
+    conn->retryTime = currentTime() + CONNECT_RETRY_DELAY;
+    conn->nextRetry = reactor->retries;
+    reactor->retries = conn;
+}
+
+/*
+-- FUNCTION: runRetries
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void runRetries(struct reactor *reactor);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function restarts every queued connect back that is due.
+*/
+static void runRetries(struct reactor *reactor)
+{
+    struct connection *pending = reactor->retries;
+    struct connection *conn = NULL;
+    long long now = 0;
+
+    if (pending == NULL)
+    {
+        return;
+    }
+
+    now = currentTime();
+    reactor->retries = NULL;
+    while (pending != NULL)
+    {
+        conn = pending;
+        pending = pending->nextRetry;
+        conn->nextRetry = NULL;
+
+        if (conn->retryTime > now)
+        {
+            conn->nextRetry = reactor->retries;
+            reactor->retries = conn;
+        }
+        else if (startConnect(reactor, conn) == -1)
+        {
+            fprintf(stderr, "Unable To Connect To Client: %s\n", conn->ip);
+            closeConnection(reactor, conn);
+        }
+    }
+}
+
+/*
+-- FUNCTION: checkSessions
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void checkSessions(struct reactor *reactor);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function runs the keep alive of every multiplexed session, at most once
+-- every MUX_CHECK_INTERVAL. Sessions that were idle for too long or whose
+-- client stopped answering are closed. A session that queued a PING is
+-- serviced right away so it is sent.
+*/
+static void checkSessions(struct reactor *reactor)
+{
+    struct connection *conn = reactor->sessions;
+    struct connection *next = NULL;
+    long long now = 0;
+    int result = 0;
+
+    if (conn == NULL || (now = currentTime()) < reactor->nextCheck)
+    {
+        return;
+    }
+    reactor->nextCheck = now + MUX_CHECK_INTERVAL;
+
+    while (conn != NULL)
+    {
+        next = conn->nextSession;
+        result = muxCheck(conn->mux);
+        if (result == MUX_IDLE)
+        {
+            printf("Closing idle session\n");
+            closeConnection(reactor, conn);
+        }
+        else if (result == MUX_DEAD)
+        {
+            fprintf(stderr, "Client stopped responding: %s\n", conn->ip);
+            closeConnection(reactor, conn);
+        }
+        else if (serviceMux(reactor, conn, 0) != 0)
+        {
+            closeConnection(reactor, conn);
+        }
+        conn = next;
+    }
+}
+
+/*
+-- FUNCTION: watchSocket
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int watchSocket(struct reactor *reactor,
+--                                   struct connection *conn, int operation,
+--                                   unsigned int events);
+--
+-- RETURNS: the result of the epoll_ctl function
+--
+-- NOTES:
+-- This is the wrapper function for adding the socket of a connection to the
+-- epoll instance or changing the events it is watched for.
+*/
+static int watchSocket(struct reactor *reactor, struct connection *conn,
+                       int operation, unsigned int events)
+{
+    struct epoll_event event;
+
+    bzero(&event, sizeof(struct epoll_event));
+    event.events = events;
+    event.data.ptr = conn;
+
+    return epoll_ctl(reactor->epoll, operation, conn->socket, &event);
+}
+
+/*
+-- FUNCTION: dropSocket
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void dropSocket(struct reactor *reactor,
+--                                  struct connection *conn);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function takes the socket of a connection out of the epoll instance
+-- and closes it. Closing alone only removes it once every descriptor of the
+-- socket is closed, and another one may still be open in this process, as
+-- with the memory transport, or in a child. epoll would then go on reporting
+-- the socket with a connection that was freed.
+*/
+static void dropSocket(struct reactor *reactor, struct connection *conn)
+{
+    epoll_ctl(reactor->epoll, EPOLL_CTL_DEL, conn->socket, NULL);
+    close(conn->socket);
+    conn->socket = -1;
+}
+
+/*
+-- FUNCTION: closeConnection
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Gives a cached file back to the cache.
+-- October 17, 2026 - Takes the socket out of epoll with dropSocket.
+-- October 17, 2026 - Removes a multiplexed session from the list.
+--
+-- INTERFACE: static void closeConnection(struct reactor *reactor,
+--                                        struct connection *conn);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function closes the sockets and file of a connection, returns its data
+-- port to the pool and frees it.
+*/
+static void closeConnection(struct reactor *reactor,
+                            struct connection *conn)
+{
+    if (conn->socket != -1)
+    {
+        dropSocket(reactor, conn);
+    }
+    if (conn->listenSocket != -1)
+    {
+        close(conn->listenSocket);
+    }
+    releaseDataPort(&reactor->ports, conn->dataPort);
+    if (conn->mux != NULL)
+    {
+        muxDestroy(conn->mux);
+        if (conn->previousSession != NULL)
+        {
+            conn->previousSession->nextSession = conn->nextSession;
+        }
+        else
+        {
+            reactor->sessions = conn->nextSession;
+        }
+        if (conn->nextSession != NULL)
+        {
+            conn->nextSession->previousSession = conn->previousSession;
+        }
+    }
+    if (conn->cached != NULL)
+    {
+        releaseCached(conn->cached);
+    }
+    else if (conn->file != -1)
+    {
+        close(conn->file);
+    }
+    free(conn);
+}
+
+/*
+-- FUNCTION: endTransfer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void endTransfer(struct connection *conn, int success);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function counts the end of the transfer of a connection and how long
+-- it took, if startTransfer started one. Forked commands and multiplexed
+-- sessions are counted elsewhere.
+*/
+static void endTransfer(struct connection *conn, int success)
+{
+    if (conn->started == 0)
+    {
+        return;
+    }
+    countMetric(success ? METRIC_COMPLETED : METRIC_FAILED, 1);
+    timeMetric(METRIC_DURATION, metricsClock() - conn->started);
+    conn->started = 0;
+}
+
+/*
+-- FUNCTION: currentTime
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static long long currentTime();
+--
+-- RETURNS: the monotonic time in milliseconds
+--
+-- NOTES:
+-- This function is used to time the connect back retries and the checks of
+-- the multiplexed sessions.
+*/
+static long long currentTime()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/*
+-- FUNCTION: systemFatal
+--
+-- DATE: March 12, 2011
+--
+-- REVISIONS: (Date and Description)
+--
+-- DESIGNER: Aman Abdulla
+--
+-- PROGRAMMER: Luke Queenan
+--
+-- INTERFACE: static void systemFatal(const char* message);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function displays an error message and shuts down the program.
+*/
+static void systemFatal(const char* message)
+{
+    perror(message);
+    exit(EXIT_FAILURE);
+}
@@ -4,12 +4,32 @@
 -- PROGRAM: Super File Transfer
 --
 -- FUNCTIONS:
--- void server (int port);
--- void initializeServer(int *listenSocket, int *port);
--- void createTransferSocket(int *socket);
--- void processConnection(int socket, char *ip, int port);
--- void getFile(int socket, char *fileName);
--- void sendFile(int socket, char *fileName);
+-- void server(struct serverOptions *options);
+-- void initializeServer(int *listenSocket, int *port, int reusePort);
+-- int createTransferSocket(int *socket, struct portPool *ports);
+-- int createPassiveSocket(int *socket, struct portPool *ports);
+-- void processConnection(int socket, char *ip, int port,
+--                        struct portPool *ports, long long accepted);
+-- void serveCommand(int socket, char *buffer, char *ip, int port,
+--                   struct portPool *ports, long long accepted);
+-- static int acceptPassive(int socket, char *ip, struct portPool *ports);
+-- static void processMultiplexed(int socket);
+-- void countStream(struct muxStream *stream);
+-- void reportStream(struct muxStream *stream, int success);
+-- int getFile(int socket, char *fileName, int stripe, int stripes,
+--             int resume, int compress, int verify);
+-- void sendFile(int socket, char *fileName, int stripe, int stripes,
+--               const struct resumePoint *resume, int compress,
+--               int verify);
+-- void getDelta(int socket, char *fileName);
+-- void getChunked(int socket, char *fileName);
+-- void getBatch(int socket);
+-- void sendBatch(int socket);
+-- void listFiles(int socket, char *prefix);
+-- static void reportEntry(const char *name, off_t size, int success);
+-- static int openTemporary(const char *path, char *tempPath);
+-- static void beginTransfer();
+-- static void endTransfer(int success);
 -- static void systemFatal(const char* message);
 --
 -- DATE: Ocotober 2, 2011
@@ -26,13 +46,31 @@
 -- requested, the server will accept and then fork a new process to handle the
 -- client connection. The server then continues to listen. The child process
 -- reads the control packet and then calls the corresponding function, getFile
--- or sendFile.
+-- or sendFile. A multiplexed client keeps the control socket open and sends
+-- all of its commands and files over it as frames, see mux.c. A client can
+-- split a file into stripes, each sent over its own connection, and every
+-- connection only moves its own byte range of the file. A client can also
+-- resume a transfer that died part way, see transfer.c, and upload only what
+-- changed in a file the server already has, see delta.c. Deduplicated
+-- uploads keep their data in the chunk store, see store.c. A file that
+-- compresses well can be sent compressed, see compress.c. A client can have
+-- every body checksummed as it moves, see verify.c. Many files can be moved
+-- in one batch over one connection, see batch.c. The files the server shares
+-- are listed from an index kept in memory, see index.c. The event driven
+-- modes keep the files their clients get open, see filecache.c. Every mode
+-- counts its connections, transfers and bytes, see metrics.c.
+--
+-- Every buffer a process uses comes from its pool of page aligned buffers, one
+-- transfer chunk long, see buffer.c. The chunk size is set with the -b option.
+--
+-- The fork model is only one of the server modes. When the epoll or reactor
+-- mode is selected the server hands off to reactorServer in reactor.c, which
+-- runs every connection inside event loops in a single process.
 */
 
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/sendfile.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -40,33 +78,123 @@
 #include <dirent.h>
 #include <strings.h>
 #include <string.h>
+#include <poll.h>
 
 #include "server.h"
+#include "portpool.h"
+#include "store.h"
+#include "index.h"
+#include "filecache.h"
+#include "metrics.h"
 #include "../network/network.h"
+#include "../network/mux.h"
+#include "../network/transfer.h"
+#include "../network/delta.h"
+#include "../network/compress.h"
+#include "../network/verify.h"
+#include "../network/batch.h"
+#include "../network/buffer.h"
 
-#define GET_FILE 0
-#define SEND_FILE 1
-#define REQUEST_LIST 2
-#define TRANSFER_PORT 7000
-#define DEF_DIR "./share/"
-
-void initializeServer(int *listenSocket, int *port);
-void createTransferSocket(int *socket);
-void processConnection(int socket, char *ip, int port);
-void getFile(int socket, char *fileName);
-void sendFile(int socket, char *fileName);
+void processConnection(int socket, char *ip, int port,
+                       struct portPool *ports, long long accepted);
+static int acceptPassive(int socket, char *ip, struct portPool *ports);
+static void processMultiplexed(int socket);
+int getFile(int socket, char *fileName, int stripe, int stripes,
+            int resume, int compress, int verify);
+void sendFile(int socket, char *fileName, int stripe, int stripes,
+              const struct resumePoint *resume, int compress, int verify);
+void getDelta(int socket, char *fileName);
+void getChunked(int socket, char *fileName);
+void getBatch(int socket);
+void sendBatch(int socket);
+void listFiles(int socket, char *prefix);
+static void reportEntry(const char *name, off_t size, int success);
+static int openTemporary(const char *path, char *tempPath);
+static void beginTransfer();
+static void endTransfer(int success);
 static void systemFatal(const char* message);
 
-void server(int port)
+// The buffers of this process, every child works on its own copy
+static struct bufferPool buffers;
+
+// When the transfer of this process started, 0 when there is none
+static long long transferStarted = 0;
+
+/*
+-- FUNCTION: server
+--
+-- DATE: September 25, 2011
+--
+-- REVISIONS: October 17, 2026 - Takes the server options and hands off to the
+-- event driven server when the epoll mode is selected.
+-- October 17, 2026 - The reactor mode is handed off as well.
+-- October 17, 2026 - Sets up the pool of data ports.
+-- October 17, 2026 - Sets up the pool of transfer buffers.
+-- October 17, 2026 - Hands off to the io_uring server.
+-- October 17, 2026 - Starts the index of the share directory.
+-- October 17, 2026 - Starts the file cache of the event driven modes.
+-- October 17, 2026 - Gives the file cache its budget of hot files.
+-- October 17, 2026 - Starts the metrics before any child.
+--
+-- DESIGNER: Luke Queenan
+--
+-- PROGRAMMER: Luke Queenan
+--
+-- INTERFACE: void server(struct serverOptions *options);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This is the entry point of the server. In the fork mode the function accepts
+-- clients and forks a process to deal with each one of them.
+*/
+void server(struct serverOptions *options)
 {
     int listenSocket = 0;
     int socket = 0;
     int processId = 0;
+    long long accepted = 0;
     char clientIp[16];
     unsigned short *clientPort = NULL;
+    struct portPool ports;
+    
+    // The event driven servers fork children that use these buffers as well
+    initializeBufferPool(&buffers, options->chunkSize);
+    
+    // Only the event driven servers share their open files between clients,
+    // started first so no other thread takes the signal of the cache
+    if (options->mode != MODE_FORK)
+    {
+        startFileCache(options->cacheSize, options->hotSize);
+    }
+    
+    // Every mode forks its listings, the children copy the index
+    startIndex(DEF_DIR);
+    
+    // The children of every mode count into the shards, so they come first
+    if (options->metricsFile != NULL && startMetrics(options->metricsFile) ==
+        -1)
+    {
+        fprintf(stderr, "Cannot Start Metrics\n");
+    }
+    
+    if (options->mode == MODE_URING)
+    {
+        uringServer(options);
+        return;
+    }
+    if (options->mode != MODE_FORK)
+    {
+        reactorServer(options);
+        return;
+    }
     
     // Set up the server
-    initializeServer(&listenSocket, &port);
+    initializeServer(&listenSocket, &options->port, 0);
+    if (initializePortPool(&ports, options->dataLow, options->dataHigh) == -1)
+    {
+        systemFatal("Cannot Allocate Data Ports");
+    }
     
     // Loop to monitor the server socket
     while (1)
@@ -78,14 +206,19 @@ void server(int port)
         {
             systemFatal("Can't Accept Client");
         }
+        accepted = metricsClock();
+        countMetric(METRIC_CONNECTIONS, 1);
 
         // Spawn process to deal with client
         processId = fork();
         if (processId == 0)
         {
             close(listenSocket);
+            // Start somewhere else in the data ports than the other children
+            rotatePortPool(&ports, (int)getpid());
             // Process the child connection
-            processConnection(socket, clientIp, (int)*clientPort);
+            processConnection(socket, clientIp, (int)*clientPort, &ports,
+                accepted);
             // Once we are done, exit
             free(clientPort);
             return;
@@ -112,62 +245,407 @@ void server(int port)
 --
 -- DATE: September 25, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - Retry the connect back while the client is
+-- still setting up its listening socket.
+-- October 17, 2026 - Data connections use ports from the pool and the client
+-- can ask for a passive data connection.
+-- October 17, 2026 - Hands multiplexed sessions to processMultiplexed.
+-- October 17, 2026 - The control packet is read into a pooled buffer.
+-- October 17, 2026 - The command is carried out by serveCommand.
+-- October 17, 2026 - Passes the time the client was accepted on.
 --
 -- DESIGNER: Luke Queenan
 --
 -- PROGRAMMER: Luke Queenan
 --
--- INTERFACE: void processConnection(int socket, char *ip, int port);
+-- INTERFACE: void processConnection(int socket, char *ip, int port,
+--                                   struct portPool *ports,
+--                                   long long accepted);
 --
 -- RETURNS: void
 --
 -- NOTES:
--- This function is called after a client has connected to the server. The
--- function will determine the type of connection (getting a file or retrieving
--- a file) and call the appropriate function.
+-- This function is called after a client has connected to the server. It
+-- reads the control packet and hands it to serveCommand, with the time of
+-- metricsClock the client was accepted at.
 */
-void processConnection(int socket, char *ip, int port)
+void processConnection(int socket, char *ip, int port,
+                       struct portPool *ports, long long accepted)
 {
-    int transferSocket = 0;
-    char *buffer = (char*)malloc(sizeof(char) * BUFFER_LENGTH);
+    char *buffer = NULL;
+
+    if ((buffer = takeBuffer(&buffers)) == NULL)
+    {
+        systemFatal("Cannot Allocate Buffer");
+    }
 
     // Read data from the client
     readData(&socket, buffer, BUFFER_LENGTH);
+    serveCommand(socket, buffer, ip, port, ports, accepted);
+    returnBuffer(&buffers, buffer);
+}
+
+/*
+-- FUNCTION: serveCommand
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Passes the stripe of the file on.
+-- October 17, 2026 - Passes the resume point on.
+-- October 17, 2026 - Hands delta uploads to getDelta.
+-- October 17, 2026 - Hands deduplicated uploads to getChunked.
+-- October 17, 2026 - Passes on whether the client takes compressed bodies.
+-- October 17, 2026 - Passes on whether the client verifies bodies.
+-- October 17, 2026 - Hands batches to getBatch and sendBatch.
+-- October 17, 2026 - Hands listings to listFiles.
+-- October 17, 2026 - Counts the transfer and times the data connection.
+--
+-- INTERFACE: void serveCommand(int socket, char *buffer, char *ip, int port,
+--                              struct portPool *ports, long long accepted);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function carries out the command in the control packet in buffer. The
+-- function will determine the type of connection (getting a file or retrieving
+-- a file) and call the appropriate function. Normally the server connects back
+-- to the client, but with the passive flag the server advertises a data port
+-- and waits for the client to connect to it instead. The control socket is
+-- closed when the function returns.
+--
+-- The io_uring server forks and calls this function for the commands it does
+-- not handle itself.
+--
+-- Accepted is the time of metricsClock the control connection was accepted
+-- at, the time until the data connection is up is counted from it. Files and
+-- batches are counted as transfers, a listing is not.
+*/
+void serveCommand(int socket, char *buffer, char *ip, int port,
+                  struct portPool *ports, long long accepted)
+{
+    int transferSocket = 0;
+    int dataPort = 0;
+    int retries = 0;
+    int flags = 0;
+    int stripe = 0;
+    int stripes = 0;
+    int resume = 0;
+    int delta = 0;
+    int dedup = 0;
+    int compress = 0;
+    int verify = 0;
+    int success = 1;
+    long long connecting = 0;
+    struct resumePoint resumePoint;
+
+    buffer[MAX_NAME_LENGTH + 1] = '\0';
+    memmove((void*)&flags, buffer + CONTROL_FLAGS, sizeof(int));
+    readStripe(buffer, &stripe, &stripes);
+    unpackResume(buffer + CONTROL_RESUME, &resumePoint);
+    
+    // Stripes are never resumed, each one is too short to be worth it
+    resume = (flags & FLAG_RESUME) && stripes == 1;
+    delta = (flags & FLAG_DELTA) && stripes == 1;
+    dedup = (flags & FLAG_DEDUP) && stripes == 1;
+    compress = (flags & FLAG_COMPRESS) && stripes == 1;
+    verify = flags & FLAG_VERIFY;
     printf("Filename is %s and the command is %d\n", buffer + 1, buffer[0]);
-    // Close the command socket
-    close(socket);
     
-    // Connect to the client
-    createTransferSocket(&transferSocket);
-    if (connectToServer(&port, &transferSocket, ip) == -1)
+    if (buffer[0] == MULTIPLEX)
     {
-        systemFatal("Unable To Connect To Client");
+        processMultiplexed(socket);
+        close(socket);
+        return;
+    }
+    
+    if (flags & FLAG_PASSIVE)
+    {
+        // The client connects to us, the command socket is closed afterwards
+        transferSocket = acceptPassive(socket, ip, ports);
+        close(socket);
+    }
+    else
+    {
+        // Close the command socket
+        close(socket);
+        
+        // Connect to the client, it only listens once the command was sent
+        connecting = metricsClock();
+        if ((dataPort = createTransferSocket(&transferSocket, ports)) == -1)
+        {
+            systemFatal("Cannot Create Transfer Socket");
+        }
+        while (connectToServer(&port, &transferSocket, ip) == -1)
+        {
+            if (errno != ECONNREFUSED || ++retries > CONNECT_RETRIES)
+            {
+                countMetric(METRIC_CONNECT_ERRORS, 1);
+                systemFatal("Unable To Connect To Client");
+            }
+            close(transferSocket);
+            releaseDataPort(ports, dataPort);
+            usleep(CONNECT_RETRY_DELAY * 1000);
+            if ((dataPort = createTransferSocket(&transferSocket,
+                ports)) == -1)
+            {
+                systemFatal("Cannot Create Transfer Socket");
+            }
+        }
+        timeMetric(METRIC_CONNECT_BACK, metricsClock() - connecting);
     }
     
     printf("Connected to Client: %s\n", ip);
+    timeMetric(METRIC_FIRST_BYTE, metricsClock() - accepted);
+    if (buffer[0] != REQUEST_LIST)
+    {
+        beginTransfer();
+    }
     
     switch ((int)buffer[0])
     {
     case GET_FILE:
         // Add 1 to buffer to move past the control byte
         printf("Sending %s to client now...\n", buffer + 1);
-        sendFile(transferSocket, buffer + 1);
+        sendFile(transferSocket, buffer + 1, stripe, stripes,
+            resume ? &resumePoint : NULL, compress, verify);
         break;
     case SEND_FILE:
         // Add 1 to buffer to move past the control byte
         printf("Getting %s from client now...\n", buffer + 1);
-        getFile(transferSocket, buffer + 1);
-        printf("Getting %s successful.\n", buffer + 1);
+        if (delta)
+        {
+            getDelta(transferSocket, buffer + 1);
+            break;
+        }
+        if (dedup)
+        {
+            getChunked(transferSocket, buffer + 1);
+            break;
+        }
+        success = getFile(transferSocket, buffer + 1, stripe, stripes,
+            resume, compress, verify) == 0;
+        printf("Getting %s %s.\n", buffer + 1,
+            success ? "successful" : "failed");
+        break;
+    case BATCH_GET:
+        sendBatch(transferSocket);
+        break;
+    case BATCH_SEND:
+        getBatch(transferSocket);
         break;
     case REQUEST_LIST:
+        listFiles(transferSocket, buffer + 1);
         break;
     }
     
+    endTransfer(success);
+    
     // Free local variables and sockets
     printf("Closing client connection\n");
-    free(buffer);
     close(transferSocket);
+    releaseDataPort(ports, dataPort);
+}
+
+/*
+-- FUNCTION: processMultiplexed
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Keeps the session alive and closes it when
+-- idle.
+-- October 17, 2026 - Counts the streams as they open.
+--
+-- INTERFACE: static void processMultiplexed(int socket);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function serves a multiplexed client on its control socket until the
+-- client disconnects. The socket is polled and the session reads frames when
+-- it is readable and sends frames when it has something to send.
+--
+-- The poll wakes up at least every MUX_CHECK_INTERVAL to run the keep alive.
+-- A client that stopped answering or left the session idle for
+-- MUX_IDLE_TIMEOUT is let go, which ends this process.
+*/
+static void processMultiplexed(int socket)
+{
+    struct muxSession *session = NULL;
+    struct pollfd pollSocket;
+    int result = 0;
+    
+    if (makeSocketNonBlocking(&socket) == -1 ||
+        (session = muxCreate(socket, 1, DEF_DIR, reportStream)) == NULL)
+    {
+        systemFatal("Cannot Start Multiplexed Session");
+    }
+    session->opened = countStream;
+    
+    while (1)
+    {
+        pollSocket.fd = socket;
+        pollSocket.events = POLLIN | (muxWantsWrite(session) ? POLLOUT : 0);
+        if (poll(&pollSocket, 1, MUX_CHECK_INTERVAL) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            systemFatal("Poll Failed");
+        }
+        
+        if ((pollSocket.revents & (POLLIN | POLLHUP | POLLERR)) &&
+            muxRead(session) == -1)
+        {
+            break;
+        }
+        if (muxWrite(session) == -1)
+        {
+            break;
+        }
+        
+        result = muxCheck(session);
+        if (result == MUX_IDLE)
+        {
+            printf("Closing idle session\n");
+            break;
+        }
+        if (result == MUX_DEAD)
+        {
+            fprintf(stderr, "Client stopped responding\n");
+            break;
+        }
+    }
+    
+    muxDestroy(session);
+}
+
+/*
+-- FUNCTION: countStream
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void countStream(struct muxStream *stream);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function is called by a multiplexed session whenever one of its
+-- streams opens, including one that could not be opened and fails at once.
+-- The stream is counted as a started transfer, in progress until
+-- reportStream counts its end.
+*/
+void countStream(struct muxStream *stream)
+{
+    (void)stream;
+    countMetric(METRIC_STARTED, 1);
+}
+
+/*
+-- FUNCTION: reportStream
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts the stream.
+-- October 17, 2026 - Times the stream, countStream counts it starting.
+--
+-- INTERFACE: void reportStream(struct muxStream *stream, int success);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function is called by a multiplexed session whenever one of its
+-- streams finishes. The stream is counted as a finished transfer. Its
+-- duration runs from the frame that asked for it to now, and the time to
+-- its first byte from that frame to its first DATA frame. The times of the
+-- session are on the clock of metricsClock.
+*/
+void reportStream(struct muxStream *stream, int success)
+{
+    long long now = metricsClock();
+
+    printf("%s %s %s\n", stream->sending ? "Sending" : "Getting", stream->name,
+        success ? "successful." : "failed.");
+    if (stream->firstByte != 0)
+    {
+        timeMetric(METRIC_FIRST_BYTE, stream->firstByte - stream->opened);
+    }
+    timeMetric(METRIC_DURATION, now - stream->opened);
+    countMetric(success ? METRIC_COMPLETED : METRIC_FAILED, 1);
+    countMetric(stream->sending ? METRIC_BYTES_OUT : METRIC_BYTES_IN,
+        stream->offset);
+}
+
+/*
+-- FUNCTION: acceptPassive
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The control message uses a pooled buffer.
+-- October 17, 2026 - Counts a client that did not connect.
+--
+-- INTERFACE: static int acceptPassive(int socket, char *ip,
+--                                     struct portPool *ports);
+--
+-- RETURNS: the transfer socket
+--
+-- NOTES:
+-- This function opens a listening socket on a data port, sends the port to the
+-- client in a control message and waits up to PASSIVE_TIMEOUT milliseconds for
+-- the client to connect. Only a connection from the address of the client is
+-- accepted.
+*/
+static int acceptPassive(int socket, char *ip, struct portPool *ports)
+{
+    int listenSocket = 0;
+    int transferSocket = 0;
+    int dataPort = 0;
+    char peerIp[16];
+    struct pollfd pollSocket;
+    char *buffer = NULL;
+    
+    if ((buffer = takeBuffer(&buffers)) == NULL)
+    {
+        systemFatal("Cannot Allocate Buffer");
+    }
+    if ((dataPort = createPassiveSocket(&listenSocket, ports)) == -1)
+    {
+        systemFatal("Cannot Create Passive Socket");
+    }
+    
+    // Send a control message with the data port
+    bzero(buffer, BUFFER_LENGTH);
+    memmove(buffer, (void*)&dataPort, sizeof(int));
+    if (sendData(&socket, buffer, BUFFER_LENGTH) == -1)
+    {
+        systemFatal("Cannot Send Data Port");
+    }
+    
+    // Wait for the client to connect
+    pollSocket.fd = listenSocket;
+    pollSocket.events = POLLIN;
+    if (poll(&pollSocket, 1, PASSIVE_TIMEOUT) != 1)
+    {
+        countMetric(METRIC_PASSIVE_ERRORS, 1);
+        systemFatal("Client Did Not Connect To Data Port");
+    }
+    if ((transferSocket = acceptConnectionIp(&listenSocket, peerIp)) == -1)
+    {
+        systemFatal("Can't Accept Client");
+    }
+    if (strcmp(peerIp, ip) != 0)
+    {
+        fprintf(stderr, "Data connection from %s, expected %s\n", peerIp, ip);
+        exit(EXIT_FAILURE);
+    }
+    
+    close(listenSocket);
+    releaseDataPort(ports, dataPort);
+    returnBuffer(&buffers, buffer);
+    
+    return transferSocket;
 }
 
 /*
@@ -175,64 +653,231 @@ void processConnection(int socket, char *ip, int port)
 --
 -- DATE: September 25, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - The file data is spliced from the socket to
+-- the file instead of being copied through a 275 byte buffer and stdio.
+-- October 17, 2026 - Moves the file in chunks of the pool's buffer size.
+-- October 17, 2026 - Receives a single stripe of the file.
+-- October 17, 2026 - Resumes a transfer that died part way.
+-- October 17, 2026 - Decodes a compressed body.
+-- October 17, 2026 - Checks the checksums of a verified body.
+-- October 17, 2026 - Preallocates the file, writes it behind and writes very
+-- large files directly.
+-- October 17, 2026 - Receives into a mapping of the file.
+-- October 17, 2026 - Counts the bytes and returns whether the body arrived.
 --
 -- DESIGNER: Luke Queenan
 --
 -- PROGRAMMER: Luke Queenan
 --
--- INTERFACE: void getFile(int socket, char *fileName);
+-- INTERFACE: int getFile(int socket, char *fileName, int stripe,
+--                        int stripes, int resume, int compress,
+--                        int verify);
 --
--- RETURNS: void
+-- RETURNS: 0 if the whole body arrived and checked out, -1 otherwise
 --
 -- NOTES:
--- This function is used to retrieve a file from a client.
+-- This function is used to retrieve a file from a client. The data goes from
+-- the socket to the file through a pipe with splice, see transfer.c. The copy
+-- path is only used if splice is not available.
+--
+-- When the file comes in stripes the other stripes are written to the same
+-- file by other connections at the same time. The file is then not truncated
+-- when it is opened but set to its full size, and this stripe is written at
+-- its own offset.
+--
+-- When the client resumes, the server first sends the resume point of what it
+-- has of the file. The size control message then says where the client starts
+-- and the file is cut back to that point before the rest is received.
+--
+-- A client that asked for compressed transfers may send a compressed body,
+-- which the size control message says. Its frames are decoded to the file,
+-- see compress.c.
+--
+-- A client that verifies sends the checksums of the body with it, see
+-- verify.c, and is sent a result message once the body is checked. A file
+-- that did not check out is cut back to the part that did, so resuming the
+-- upload sends the rest again.
+--
+-- The blocks of the body are allocated before it arrives and it is written
+-- back as it comes in, see writeBehind. A plain body of at least the size
+-- given with -O is written around the page cache, see receiveDirect. A
+-- verified body is not, the verifier reads it back through the same file.
+-- With -W any other plain body is read from the socket straight into a
+-- mapping of the file, see receiveMapped, and a whole file that ended early
+-- is cut back to what arrived so it can be resumed.
 */
-void getFile(int socket, char *fileName)
+int getFile(int socket, char *fileName, int stripe, int stripes,
+            int resume, int compress, int verify)
 {
-    char *buffer = (char*)malloc(sizeof(char) * BUFFER_LENGTH);
-    int count = 0;
+    struct resumePoint resumePoint;
+    struct frameDecoder decoder;
+    struct verifier verifier;
+    char *buffer = NULL;
+    off_t count = 0;
     int bytesRead = 0;
     off_t fileSize = 0;
-    FILE *file = NULL;
+    off_t offset = 0;
+    off_t length = 0;
+    off_t start = 0;
+    int file = 0;
+    int flags = 0;
+    int result = 0;
+    int direct = 0;
+    int mapped = 0;
+    int receivePipe[2];
+    struct writeBehind behind;
+    struct fileMapping mapping;
     char* fileNamePath = (char*)malloc(sizeof(char) * FILENAME_MAX);
     
+    if ((buffer = takeBuffer(&buffers)) == NULL)
+    {
+        systemFatal("Cannot Allocate Buffer");
+    }
+    
+    // Open the file, readable and writable by the owner only, a mapping of
+    // it needs both
+    sprintf(fileNamePath, "%s%s", DEF_DIR, fileName);
+    if ((file = open(fileNamePath, O_RDWR | O_CREAT,
+        00400 | 00200 | 00100)) == -1)
+    {
+        systemFatal("Unable To Create File");
+    }
+    
+    // Tell the client how much of the file is already here
+    if (resume)
+    {
+        findResume(file, &resumePoint, buffer, buffers.size);
+        bzero(buffer, BUFFER_LENGTH);
+        packResume(buffer, &resumePoint);
+        if (sendData(&socket, buffer, BUFFER_LENGTH) == -1)
+        {
+            systemFatal("Cannot Send Resume Point");
+        }
+    }
+    
     // Get the control packet with the file size
     readData(&socket, buffer, BUFFER_LENGTH);
     
     // Retrieve file size from the buffer
     memmove((void*)&fileSize, buffer, sizeof(off_t));
     printf("File size is %zd\n", fileSize);
+    stripeRange(fileSize, stripe, stripes, &offset, &length);
+    if (resume)
+    {
+        memmove((void*)&offset, buffer + HEADER_OFFSET, sizeof(off_t));
+        if (offset < 0 || offset > resumePoint.length || offset > fileSize)
+        {
+            systemFatal("Invalid Resume Offset");
+        }
+        length = fileSize - offset;
+        printf("Resuming %s at %zd\n", fileName, offset);
+    }
+    if (compress)
+    {
+        memmove((void*)&flags, buffer + HEADER_FLAGS, sizeof(int));
+    }
+    if ((flags & BODY_COMPRESSED) && openDecoder(&decoder) == -1)
+    {
+        systemFatal("Cannot Allocate Decoder");
+    }
     
-    // Open the file
-    sprintf(fileNamePath, "%s%s", DEF_DIR, fileName);
-    file = fopen(fileNamePath, "wb");
-    if (file == NULL)
+    // Drop what is not kept, the stripes of a file all set its full size
+    if (ftruncate(file, stripes > 1 ? fileSize : offset) == -1)
     {
-        systemFatal("Unable To Create File");
+        systemFatal("Unable To Size File");
+    }
+    startReceive(&behind, file, offset, length);
+    direct = !(flags & BODY_COMPRESSED) && !verify && receiveDirectly(length);
+    mapped = !(flags & BODY_COMPRESSED) && !direct &&
+        openMapping(&mapping, file, fileSize) == 0;
+    start = offset;
+    if (verify && startVerifier(&verifier, file, offset, length, 1) == -1)
+    {
+        systemFatal("Cannot Start Verifier");
     }
 
-    // Read from the socket and write the file to disk
-    while (count < (fileSize - BUFFER_LENGTH))
+    // Move the data from the socket to the disk
+    openReceivePipe(receivePipe, buffers.size);
+    while (count < length)
     {
-        bytesRead = readData(&socket, buffer, BUFFER_LENGTH);
-        printf("Got %d bytes...\n", bytesRead);
-        fwrite(buffer, sizeof(char), bytesRead, file);
+        if (flags & BODY_COMPRESSED)
+        {
+            bytesRead = receiveFrame(socket, file, receivePipe, &decoder,
+                length - count < COMPRESS_BLOCK ? length - count :
+                COMPRESS_BLOCK, &offset);
+        }
+        else if (direct)
+        {
+            bytesRead = receiveDirect(socket, file, buffer,
+                chunkLeft(verify ? &verifier : NULL, count,
+                length - count < buffers.size ? length - count :
+                buffers.size), &offset);
+        }
+        else if (mapped)
+        {
+            bytesRead = receiveMapped(socket, &mapping,
+                chunkLeft(verify ? &verifier : NULL, count,
+                length - count < buffers.size ? length - count :
+                buffers.size), &offset);
+        }
+        else
+        {
+            bytesRead = receiveChunk(socket, file, receivePipe, buffer,
+                chunkLeft(verify ? &verifier : NULL, count,
+                length - count < buffers.size ? length - count :
+                buffers.size), &offset);
+        }
+        if (bytesRead <= 0)
+        {
+            fprintf(stderr, "Transfer of %s ended early\n", fileName);
+            break;
+        }
         count += bytesRead;
+        countMetric(METRIC_BYTES_IN, bytesRead);
+        writeBehind(&behind, offset);
+        if (takeChecksums(socket, verify ? &verifier : NULL, count) == -1)
+        {
+            break;
+        }
+    }
+    printf("Got %zd bytes\n", count);
+    closeReceivePipe(receivePipe);
+    if (flags & BODY_COMPRESSED)
+    {
+        closeDecoder(&decoder);
+    }
+    if (mapped)
+    {
+        closeMapping(&mapping);
+        if (stripes == 1 && count < length && ftruncate(file, offset) == -1)
+        {
+            fprintf(stderr, "Unable To Cut Back %s\n", fileName);
+        }
+    }
+
+    // Keep what checked out and tell the client
+    if (verify)
+    {
+        result = stopVerifier(&verifier) == -1 || count < length ? -1 : 0;
+        if (result == -1)
+        {
+            fprintf(stderr, "Checksum of %s failed after %zd bytes\n",
+                fileName, verifier.checked);
+            if (stripes == 1 &&
+                ftruncate(file, start + verifier.checked) == -1)
+            {
+                fprintf(stderr, "Unable To Cut Back %s\n", fileName);
+            }
+        }
+        sendResult(socket, result);
     }
-    
-    // Retrieve any left over data and write it out
-    bytesRead = readData(&socket, buffer, fileSize - count);
-    printf("Got %d bytes...\n", bytesRead);
-    fwrite(buffer, sizeof(char), bytesRead, file);
 
     // Close the file
-    fclose(file);
-    
-    // Change the permission on the new file to allow access
-    chmod(fileName, 00400 | 00200 | 00100);
+    close(file);
     
-    free(buffer);
+    free(fileNamePath);
+    returnBuffer(&buffers, buffer);
+    return count < length || result == -1 ? -1 : 0;
 }
 
 /*
@@ -240,25 +885,60 @@ void getFile(int socket, char *fileName)
 --
 -- DATE: September 25, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - The control message uses a pooled buffer.
+-- October 17, 2026 - Sends a single stripe of the file.
+-- October 17, 2026 - Resumes a transfer that died part way.
+-- October 17, 2026 - Sends a compressed body when it is worth it.
+-- October 17, 2026 - Sends the checksums of a verified body.
+-- October 17, 2026 - Counts the bytes sent.
 --
 -- DESIGNER: Luke Queenan
 --
 -- PROGRAMMER: Luke Queenan
 --
--- INTERFACE: void sendFile(int socket, char *fileName);
+-- INTERFACE: void sendFile(int socket, char *fileName, int stripe,
+--                          int stripes,
+--                          const struct resumePoint *resume,
+--                          int compress, int verify);
 --
 -- RETURNS: void
 --
 -- NOTES:
 -- This function is used to send a file to a client. The function will open a
--- file and use the function sendFile to transmit the file to the client.
+-- file and use the function sendFile to transmit the file to the client. The
+-- size control message always holds the size of the whole file, the client
+-- works out the range of the stripe from it.
+--
+-- With a resume point from the client the transfer starts where the client
+-- left off if its end matches the file, see checkResume. The offset it starts
+-- at follows the size in the control message.
+--
+-- When the client takes compressed bodies and a sample of the file shrinks,
+-- the body is sent compressed, see compress.c. Otherwise it is sent with
+-- sendfile.
+--
+-- When the client verifies, the checksums of the body are sent with it,
+-- worked out by a thread that reads the file ahead of the socket, see
+-- verify.c.
 */
-void sendFile(int socket, char *fileName)
+void sendFile(int socket, char *fileName, int stripe, int stripes,
+              const struct resumePoint *resume, int compress, int verify)
 {
+    struct compressStats stats;
+    struct verifier verifier;
+    int result = 0;
     int file = 0;
+    int flags = 0;
+    off_t offset = 0;
+    off_t length = 0;
     struct stat statBuffer;
-    char *buffer = (char*)calloc(BUFFER_LENGTH, sizeof(char));
+    char *buffer = NULL;
+    
+    if ((buffer = takeBuffer(&buffers)) == NULL)
+    {
+        systemFatal("Cannot Allocate Buffer");
+    }
+    bzero(buffer, BUFFER_LENGTH);
     
     // Open the file for reading
     if ((file = open(fileName, O_RDONLY)) == -1)
@@ -272,19 +952,60 @@ void sendFile(int socket, char *fileName)
         systemFatal("Problem Getting File Information");
     }
     
-    // Send a control message with the size of the file
+    // Work out what to send, a stripe or the rest of a resumed file
+    stripeRange(statBuffer.st_size, stripe, stripes, &offset, &length);
+    if (resume != NULL)
+    {
+        offset = checkResume(file, statBuffer.st_size, resume, buffer,
+            buffers.size);
+        length = statBuffer.st_size - offset;
+        printf("Resuming %s at %zd\n", fileName, offset);
+        bzero(buffer, BUFFER_LENGTH);
+    }
+    
+    // Send a control message with the size of the file and where it starts
+    if (compress && worthCompressing(file, offset, length))
+    {
+        flags |= BODY_COMPRESSED;
+    }
     memmove(buffer, (void*)&statBuffer.st_size, sizeof(off_t));
+    memmove(buffer + HEADER_OFFSET, (void*)&offset, sizeof(off_t));
+    memmove(buffer + HEADER_FLAGS, (void*)&flags, sizeof(int));
     sendData(&socket, buffer, BUFFER_LENGTH);
     
     // Send the file to the client
-    if (sendfile(socket, file, NULL, statBuffer.st_size) == -1)
+    if (flags & BODY_COMPRESSED)
+    {
+        if (verify && startVerifier(&verifier, file, offset, length, 0) == -1)
+        {
+            systemFatal("Cannot Start Verifier");
+        }
+        result = sendCompressed(socket, file, offset, length, &stats,
+            verify ? &verifier : NULL);
+        if (verify && stopVerifier(&verifier) == -1)
+        {
+            result = -1;
+        }
+        if (result == -1)
+        {
+            systemFatal("Unable To Send File");
+        }
+        printf("Sent %zd bytes compressed to %zd\n", stats.raw, stats.sent);
+        countMetric(METRIC_BYTES_OUT, stats.sent);
+    }
+    else if ((verify ? sendVerified(socket, file, offset, length) :
+        sendRange(socket, file, offset, length)) == -1)
     {
         systemFatal("Unable To Send File");
     }
+    else
+    {
+        countMetric(METRIC_BYTES_OUT, length);
+    }
     
     // Close the file
     close(file);
-    free(buffer);
+    returnBuffer(&buffers, buffer);
 }
 
 /*
@@ -292,44 +1013,92 @@ void sendFile(int socket, char *fileName)
 --
 -- DATE: September 29, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - The socket is bound to a port from the pool of
+-- data ports, or left for the kernel to bind, instead of the fixed port 7000.
+-- Errors are returned so the event driven server can survive them.
 --
 -- DESIGNER: Luke Queenan
 --
 -- PROGRAMMER: Luke Queenan
 --
--- INTERFACE: void createTransferSocket(int *socket);
+-- INTERFACE: int createTransferSocket(int *socket, struct portPool *ports);
 --
--- RETURNS: void
+-- RETURNS: the port the socket is bound to, 0 if the kernel will choose the
+--          port when connecting, or -1 on failure
 --
 -- NOTES:
--- This function creates a transfer socket for the server to communicate with
--- the client. The socket is bound to port 7000.
+-- This function creates a transfer socket for the server to connect back to
+-- the client. When the pool has no range the socket is not bound at all, which
+-- lets the kernel share local ports between connections to different clients.
 */
-void createTransferSocket(int *socket)
+int createTransferSocket(int *socket, struct portPool *ports)
 {
-    int *defaultPort = (int*)malloc(sizeof(int));
-    *defaultPort = TRANSFER_PORT;
+    int port = 0;
     
     // Create a TCP socket
     if ((*socket = tcpSocket()) == -1)
     {
-        systemFatal("Cannot Create Socket!");
+        return -1;
     }
     
-    // Allow the socket to be reused immediately after exit
-    if (setReuse(socket) == -1)
+    // Allow the socket to be reused immediately after exit, then bind it
+    if (setReuse(socket) == -1 || (port = bindDataPort(ports, socket)) == -1)
     {
-        systemFatal("Cannot Set Socket To Reuse");
+        close(*socket);
+        return -1;
     }
     
-    // Bind an address to the socket
-    if (bindAddress(defaultPort, socket) == -1)
+    return port;
+}
+
+/*
+-- FUNCTION: createPassiveSocket
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: int createPassiveSocket(int *socket, struct portPool *ports);
+--
+-- RETURNS: the port the socket listens on, or -1 on failure
+--
+-- NOTES:
+-- This function creates a socket listening on a data port for a passive
+-- transfer. Without a range in the pool the kernel picks an ephemeral port.
+*/
+int createPassiveSocket(int *socket, struct portPool *ports)
+{
+    int port = 0;
+    
+    // Create a TCP socket
+    if ((*socket = tcpSocket()) == -1)
     {
-        systemFatal("Cannot Bind Address To Socket");
+        return -1;
     }
     
-    free(defaultPort);
+    if (setReuse(socket) == -1 || (port = bindDataPort(ports, socket)) == -1)
+    {
+        close(*socket);
+        return -1;
+    }
+    
+    // Let the kernel choose an ephemeral port
+    if (port == 0 && (bindAddress(&port, socket) == -1 ||
+        (port = getSocketPort(socket)) == -1))
+    {
+        close(*socket);
+        return -1;
+    }
+    
+    // Set the socket to listen for the client
+    if (setListen(socket) == -1)
+    {
+        close(*socket);
+        releaseDataPort(ports, port);
+        return -1;
+    }
+    
+    return port;
 }
 
 /*
@@ -339,12 +1108,15 @@ void createTransferSocket(int *socket)
 --
 -- REVISIONS: September 22, 2011 - Added some extra comments about failure and
 -- a function call to set the socket into non blocking mode.
+-- October 17, 2026 - Added the reusePort argument so several reactor threads
+-- can each bind their own listening socket to the same port.
 --
 -- DESIGNER: Luke Queenan
 --
 -- PROGRAMMER: Luke Queenan
 --
--- INTERFACE: void initializeServer(int *listenSocket, int *port);
+-- INTERFACE: void initializeServer(int *listenSocket, int *port,
+--                                  int reusePort);
 --
 -- RETURNS: void
 --
@@ -354,7 +1126,7 @@ void createTransferSocket(int *socket)
 -- setting it to listen. If an error occurs, the function calls "systemFatal"
 -- with an error message.
 */
-void initializeServer(int *listenSocket, int *port)
+void initializeServer(int *listenSocket, int *port, int reusePort)
 {
     // Create a TCP socket
     if ((*listenSocket = tcpSocket()) == -1)
@@ -368,6 +1140,12 @@ void initializeServer(int *listenSocket, int *port)
         systemFatal("Cannot Set Socket To Reuse");
     }
     
+    // Share the port with the listening sockets of the other reactors
+    if (reusePort && setReusePort(&(*listenSocket)) == -1)
+    {
+        systemFatal("Cannot Set Socket To Reuse Port");
+    }
+    
     // Bind an address to the socket
     if (bindAddress(&(*port), &(*listenSocket)) == -1)
     {
@@ -381,12 +1159,389 @@ void initializeServer(int *listenSocket, int *port)
     }
 }
 
+/*
+-- FUNCTION: getDelta
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The rebuilt file gets a unique name in the
+-- directory of the file.
+--
+-- INTERFACE: void getDelta(int socket, char *fileName);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function receives a file as a delta against the copy already in the
+-- share directory, see delta.c. The signature of the copy is sent to the
+-- client and the file is rebuilt from the client's instructions into a
+-- hidden file of its own next to it, see openTemporary. Only once the
+-- rebuilt file checks out does it replace the copy, so a failed upload
+-- leaves the old file as it was. The client is told whether it worked.
+*/
+void getDelta(int socket, char *fileName)
+{
+    struct deltaBasis signature;
+    char *buffer = NULL;
+    char *fileNamePath = (char*)malloc(sizeof(char) * FILENAME_MAX);
+    char *tempPath = (char*)malloc(sizeof(char) * (FILENAME_MAX + 16));
+    int basis = 0;
+    int file = 0;
+    int result = -1;
+    
+    if ((buffer = takeBuffer(&buffers)) == NULL)
+    {
+        systemFatal("Cannot Allocate Buffer");
+    }
+    
+    // The copy here is the basis, there may not be one
+    sprintf(fileNamePath, "%s%s", DEF_DIR, fileName);
+    basis = open(fileNamePath, O_RDONLY);
+    if ((file = openTemporary(fileNamePath, tempPath)) == -1)
+    {
+        systemFatal("Unable To Create File");
+    }
+    
+    if (sendSignature(socket, basis, buffer, buffers.size, &signature) == 0)
+    {
+        printf("Sent the signature of %zd bytes in %d blocks\n",
+            signature.size, signature.blockCount);
+        result = receiveDelta(socket, basis, file, &signature, buffer,
+            buffers.size);
+    }
+    close(file);
+    if (basis != -1)
+    {
+        close(basis);
+    }
+    
+    // Keep the old copy unless the new one is complete
+    if (result == 0 && rename(tempPath, fileNamePath) == -1)
+    {
+        result = -1;
+    }
+    if (result == -1)
+    {
+        fprintf(stderr, "Delta upload of %s failed\n", fileName);
+        unlink(tempPath);
+    }
+    sendResult(socket, result);
+    
+    free(fileNamePath);
+    free(tempPath);
+    returnBuffer(&buffers, buffer);
+}
+
+/*
+-- FUNCTION: getChunked
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The manifest gets a unique name in the
+-- directory of the file.
+-- October 17, 2026 - The file is rebuilt from its chunks.
+-- October 17, 2026 - The store renames the file so it can index it.
+--
+-- INTERFACE: void getChunked(int socket, char *fileName);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function receives a deduplicated upload, see store.c. The chunks the
+-- index of the store does not know are received and the rest are copied from
+-- the files of the share that hold them, into a hidden file of its own next
+-- to the file, see openTemporary. Only once every chunk is written does the
+-- store rename it over the file, so a failed upload leaves the old file as
+-- it was and the share only ever holds plain files. The client is told
+-- whether it worked.
+*/
+void getChunked(int socket, char *fileName)
+{
+    char *buffer = NULL;
+    char *fileNamePath = (char*)malloc(sizeof(char) * FILENAME_MAX);
+    char *tempPath = (char*)malloc(sizeof(char) * (FILENAME_MAX + 16));
+    int file = 0;
+    int result = -1;
+    
+    if ((buffer = takeBuffer(&buffers)) == NULL)
+    {
+        systemFatal("Cannot Allocate Buffer");
+    }
+    
+    sprintf(fileNamePath, "%s%s", DEF_DIR, fileName);
+    if ((file = openTemporary(fileNamePath, tempPath)) == -1)
+    {
+        systemFatal("Unable To Create File");
+    }
+    
+    result = receiveChunked(socket, file, buffer, tempPath, fileNamePath);
+    close(file);
+    
+    if (result == -1)
+    {
+        fprintf(stderr, "Deduplicated upload of %s failed\n", fileName);
+        unlink(tempPath);
+    }
+    sendResult(socket, result);
+    
+    free(fileNamePath);
+    free(tempPath);
+    returnBuffer(&buffers, buffer);
+}
+
+/*
+-- FUNCTION: getBatch
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void getBatch(int socket);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function receives a batch of files from a client into the share
+-- directory, see batch.c, and replies with a result message, 0 if every file
+-- was kept and -1 if any was not.
+*/
+void getBatch(int socket)
+{
+    struct batchStats stats;
+    char *buffer = NULL;
+    int receivePipe[2];
+    int result = 0;
+    
+    if ((buffer = takeBuffer(&buffers)) == NULL)
+    {
+        systemFatal("Cannot Allocate Buffer");
+    }
+    
+    openReceivePipe(receivePipe, buffers.size);
+    result = receiveEntries(socket, DEF_DIR, receivePipe, buffer,
+        buffers.size, &stats, reportEntry);
+    closeReceivePipe(receivePipe);
+    printf("Got %d files, %zd bytes\n", stats.files, stats.bytes);
+    if (result == -1)
+    {
+        fprintf(stderr, "Batch ended early\n");
+    }
+    sendResult(socket, result == 0 && stats.failures == 0 ? 0 : -1);
+    
+    returnBuffer(&buffers, buffer);
+}
+
+/*
+-- FUNCTION: sendBatch
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void sendBatch(int socket);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function reads the names a client wants and sends it the files they
+-- name as one batch, see batch.c. A name is a file, a directory or a pattern.
+-- A name that leaves the directory or names nothing is sent as it is, and
+-- the batch sends it as missing.
+*/
+void sendBatch(int socket)
+{
+    struct batchList names;
+    struct batchList files;
+    struct batchStats stats;
+    int i = 0;
+    
+    bzero(&names, sizeof(struct batchList));
+    bzero(&files, sizeof(struct batchList));
+    if (readNames(socket, &names) == -1)
+    {
+        systemFatal("Cannot Read Batch");
+    }
+    
+    for (i = 0; i < names.count; i++)
+    {
+        if ((checkName(names.names[i]) == -1 ||
+            addPaths(&files, "", names.names[i]) <= 0) &&
+            addName(&files, names.names[i]) == -1)
+        {
+            systemFatal("Cannot Allocate Batch");
+        }
+    }
+    
+    if (sendEntries(socket, "", &files, &stats, reportEntry) == -1)
+    {
+        fprintf(stderr, "Batch ended early\n");
+    }
+    printf("Sent %d files, %zd bytes\n", stats.files, stats.bytes);
+    
+    freeNames(&names);
+    freeNames(&files);
+}
+
+/*
+-- FUNCTION: listFiles
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: void listFiles(int socket, char *prefix);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function sends the client the pages it asks for of the shared files
+-- whose names start with prefix, see index.c.
+*/
+void listFiles(int socket, char *prefix)
+{
+    char *buffer = takeBuffer(&buffers);
+    char *hashBuffer = takeBuffer(&buffers);
+    
+    if (buffer == NULL || hashBuffer == NULL)
+    {
+        systemFatal("Cannot Allocate Buffer");
+    }
+    
+    printf("Listing files under \"%s\"\n", prefix);
+    if (sendListing(socket, prefix, buffer, hashBuffer, buffers.size) == -1)
+    {
+        fprintf(stderr, "Listing Failed\n");
+    }
+    
+    returnBuffer(&buffers, hashBuffer);
+    returnBuffer(&buffers, buffer);
+}
+
+/*
+-- FUNCTION: reportEntry
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void reportEntry(const char *name, off_t size,
+--                                    int success);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function is called for every file of a batch. Only the files that
+-- failed are printed, a batch can hold thousands of files.
+*/
+static void reportEntry(const char *name, off_t size, int success)
+{
+    if (size == ENTRY_MISSING)
+    {
+        fprintf(stderr, "Batch file %s was not found\n", name);
+    }
+    else if (!success)
+    {
+        fprintf(stderr, "Batch file %s of %zd bytes failed\n", name, size);
+    }
+}
+
+/*
+-- FUNCTION: openTemporary
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Gives the file the mode of a file getFile
+-- creates.
+--
+-- INTERFACE: static int openTemporary(const char *path, char *tempPath);
+--
+-- RETURNS: the open file or -1 on failure
+--
+-- NOTES:
+-- This function creates a hidden file with a unique name in the directory of
+-- path, for a file that is put together before it is renamed over path. It
+-- has to be in the same directory for the rename to work, and unique so two
+-- uploads of the same file never write into the same file. Its name is left
+-- in tempPath, which needs room for FILENAME_MAX + 16 characters. mkstemp
+-- makes the file readable and writable by the owner only, it is given the
+-- mode getFile creates uploads with so every upload ends up the same.
+*/
+static int openTemporary(const char *path, char *tempPath)
+{
+    const char *name = strrchr(path, '/');
+    int directory = name == NULL ? 0 : (int)(name - path) + 1;
+    int file = 0;
+    int error = 0;
+
+    sprintf(tempPath, "%.*s.%s.XXXXXX", directory, path, path + directory);
+    if ((file = mkstemp(tempPath)) == -1)
+    {
+        return -1;
+    }
+    if (fchmod(file, 00400 | 00200 | 00100) == -1)
+    {
+        error = errno;
+        close(file);
+        unlink(tempPath);
+        errno = error;
+        return -1;
+    }
+    return file;
+}
+
+/*
+-- FUNCTION: beginTransfer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void beginTransfer();
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function counts the start of the transfer of this process.
+*/
+static void beginTransfer()
+{
+    countMetric(METRIC_STARTED, 1);
+    transferStarted = metricsClock();
+}
+
+/*
+-- FUNCTION: endTransfer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void endTransfer(int success);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function counts the end of the transfer of this process and how long
+-- it took, if one was started. Most failures end the process through
+-- systemFatal, which calls it as well.
+*/
+static void endTransfer(int success)
+{
+    if (transferStarted == 0)
+    {
+        return;
+    }
+    countMetric(success ? METRIC_COMPLETED : METRIC_FAILED, 1);
+    timeMetric(METRIC_DURATION, metricsClock() - transferStarted);
+    transferStarted = 0;
+}
+
 /*
 -- FUNCTION: systemFatal
 --
 -- DATE: March 12, 2011
 --
--- REVISIONS: (Date and Description)
+-- REVISIONS: October 17, 2026 - Counts a transfer in progress as failed.
 --
 -- DESIGNER: Aman Abdulla
 --
@@ -397,11 +1552,13 @@ void initializeServer(int *listenSocket, int *port)
 -- RETURNS: void
 --
 -- NOTES:
--- This function displays an error message and shuts down the program.
+-- This function displays an error message and shuts down the program. A
+-- transfer in progress is counted as failed.
 */
 static void systemFatal(const char* message)
 {
     perror(message);
+    endTransfer(0);
     exit(EXIT_FAILURE);
 }
 
@@ -3,14 +3,54 @@
 
 #define DEF_PORT 7001
 
+#define DEF_DIR "./share/"
+
+// Server modes
+#define MODE_FORK 0
+#define MODE_EPOLL 1
+#define MODE_REACTOR 2
+#define MODE_URING 3
+
+// Connect back retries while the client sets up its listening socket
+#define CONNECT_RETRIES 50
+#define CONNECT_RETRY_DELAY 10
+
+// Milliseconds to wait for a client to connect to a passive data port
+#define PASSIVE_TIMEOUT 10000
+
+struct serverOptions
+{
+    int port;
+    int mode;
+    int threads;
+    int dataLow;
+    int dataHigh;
+    int chunkSize;
+    int cacheSize;
+    long long hotSize;
+    const char *metricsFile;
+};
+
+struct portPool;
+struct muxStream;
+
 // Function Prototypes
 #ifdef __cplusplus
 extern "C" {
 #endif
-void server (int port);
+void server(struct serverOptions *options);
+void reactorServer(struct serverOptions *options);
+void stopReactors();
+void uringServer(struct serverOptions *options);
+void initializeServer(int *listenSocket, int *port, int reusePort);
+int createTransferSocket(int *socket, struct portPool *ports);
+int createPassiveSocket(int *socket, struct portPool *ports);
+void serveCommand(int socket, char *buffer, char *ip, int port,
+                  struct portPool *ports, long long accepted);
+void countStream(struct muxStream *stream);
+void reportStream(struct muxStream *stream, int success);
 #ifdef __cplusplus
 }
 #endif
 #endif
 
-
@@ -0,0 +1,1022 @@
+/*
+-- SOURCE FILE: store.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- int receiveChunked(int socket, int file, char *buffer,
+--                    const char *tempPath, const char *path);
+-- static unsigned char *readManifest(int socket, char *buffer,
+--                                    off_t *fileSize, int *count);
+-- static int markMissing(const unsigned char *entries, int count,
+--                        unsigned char *missing,
+--                        struct chunkSource *sources,
+--                        struct sourceFiles *files);
+-- static int scanBucket(int bucket, const unsigned char *entries,
+--                       const int *slots, int mask,
+--                       struct chunkSource *sources,
+--                       struct sourceFiles *files);
+-- static int receiveChunks(int socket, int file,
+--                          const unsigned char *entries, int count,
+--                          const struct chunkSource *sources,
+--                          const struct sourceFiles *files, char *chunk);
+-- static int copyRun(int file, struct chunkRun *run,
+--                    const unsigned char *entries,
+--                    const struct sourceFiles *files, char *chunk);
+-- static int copyRange(int source, off_t offset, int file, off_t length,
+--                      char *chunk);
+-- static int indexChunks(const char *path, int file,
+--                        const unsigned char *entries, int count,
+--                        const struct chunkSource *sources);
+-- static int findSource(struct sourceFiles *files, const char *path);
+-- static void freeSources(struct sourceFiles *files);
+-- static int readAt(int file, char *buffer, int length, off_t offset);
+-- static void bucketPath(char *path, int bucket);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - The store is an index of the chunks in the
+-- share instead of a copy of every chunk.
+--
+-- NOTES:
+-- This file contains the chunk store behind the share directory and the
+-- server side of a deduplicated upload, see dedup.c. The store keeps no
+-- chunks of its own. It is an index of where every chunk of an earlier
+-- deduplicated upload is in the share, the hash of the chunk, the file it is
+-- in and its offset there. A client only sends the chunks of a file that the
+-- index does not know, the rest are copied from the files that hold them.
+--
+-- The index is cut into a file for every first byte of the hashes under
+-- STORE_DIR, so an upload only reads the buckets of its own chunks. A record
+-- also holds the inode and the time the file was last changed when it was
+-- indexed. A file that has been changed, replaced or removed since no longer
+-- matches its records, and they are dropped the next time their bucket is
+-- read, so the index never grows with chunks the share does not have. Every
+-- bucket is locked while it is read or written, by the servers of every
+-- upload.
+--
+-- The uploaded file is a plain file in the share, so downloads, batches,
+-- listings and the file cache see it as it was sent. Chunks are copied with
+-- copy_file_range, which lets a file system that can share extents between
+-- files, like XFS or Btrfs, share the ones of the source instead of writing
+-- them again. Anywhere else a chunk is on disk once for every file it is
+-- part of, as with any upload, and the index costs about 1% of the files.
+-- What is copied is hashed again afterwards, a source that changed after it
+-- was indexed fails the upload rather than the file getting the wrong data.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include "store.h"
+#include "../network/network.h"
+#include "../network/transfer.h"
+#include "../network/checksum.h"
+#include "../network/dedup.h"
+
+// Layout of a record of the index, the path of the file comes after it
+#define RECORD_OFFSET		16
+#define RECORD_INODE		24
+#define RECORD_SECONDS		32
+#define RECORD_NANOSECONDS	40
+#define RECORD_PATH		48
+#define RECORD_HEADER		52
+
+// Where a chunk comes from when it is not a file of the share
+#define SOURCE_MISSING	-2
+#define SOURCE_UPLOAD	-1
+
+// Where the data of a chunk of an upload comes from
+struct chunkSource
+{
+    int first;
+    int file;
+    off_t offset;
+};
+
+// A file the index points to, as it was when the upload started
+struct sourceFile
+{
+    char *path;
+    unsigned long key;
+    unsigned long long inode;
+    long long seconds;
+    long long nanoseconds;
+    int exists;
+};
+
+// The files the index points to, with an open addressed table of their paths
+struct sourceFiles
+{
+    struct sourceFile *files;
+    int *slots;
+    int count;
+    int size;
+};
+
+// Chunks that follow each other in their source and are copied in one go
+struct chunkRun
+{
+    int file;
+    int first;
+    int last;
+    off_t offset;
+    off_t length;
+    off_t position;
+};
+
+static unsigned char *readManifest(int socket, char *buffer,
+                                   off_t *fileSize, int *count);
+static int markMissing(const unsigned char *entries, int count,
+                       unsigned char *missing, struct chunkSource *sources,
+                       struct sourceFiles *files);
+static int scanBucket(int bucket, const unsigned char *entries,
+                      const int *slots, int mask,
+                      struct chunkSource *sources,
+                      struct sourceFiles *files);
+static int receiveChunks(int socket, int file,
+                         const unsigned char *entries, int count,
+                         const struct chunkSource *sources,
+                         const struct sourceFiles *files, char *chunk);
+static int copyRun(int file, struct chunkRun *run,
+                   const unsigned char *entries,
+                   const struct sourceFiles *files, char *chunk);
+static int copyRange(int source, off_t offset, int file, off_t length,
+                     char *chunk);
+static int indexChunks(const char *path, int file,
+                       const unsigned char *entries, int count,
+                       const struct chunkSource *sources);
+static int findSource(struct sourceFiles *files, const char *path);
+static void freeSources(struct sourceFiles *files);
+static int readAt(int file, char *buffer, int length, off_t offset);
+static void bucketPath(char *path, int bucket);
+
+/*
+-- FUNCTION: receiveChunked
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Replaces path with the file and indexes its
+-- chunks.
+--
+-- INTERFACE: int receiveChunked(int socket, int file, char *buffer,
+--                               const char *tempPath, const char *path);
+--
+-- RETURNS: 0 if the whole file is written and replaces path or -1 otherwise
+--
+-- NOTES:
+-- This function reads the manifest of the client, asks for the chunks the
+-- index does not know and writes the file to file, opened at tempPath, from
+-- the chunks that arrive and the ones copied from the share. Once it is
+-- complete it is renamed to path and its chunks are added to the index. A
+-- file that cannot be indexed is still uploaded, later uploads just do not
+-- find its chunks. The buffer holds the headers and must be at least
+-- BUFFER_LENGTH bytes.
+*/
+int receiveChunked(int socket, int file, char *buffer,
+                   const char *tempPath, const char *path)
+{
+    struct sourceFiles files;
+    struct chunkSource *sources = NULL;
+    unsigned char *entries = NULL;
+    unsigned char *missing = NULL;
+    char *chunk = NULL;
+    off_t fileSize = 0;
+    int count = 0;
+    int wanted = 0;
+    int result = -1;
+
+    if ((entries = readManifest(socket, buffer, &fileSize, &count)) == NULL)
+    {
+        return -1;
+    }
+
+    bzero(&files, sizeof(struct sourceFiles));
+    missing = (unsigned char*)calloc(count / 8 + 1, 1);
+    sources = (struct chunkSource*)malloc(sizeof(struct chunkSource) *
+        (count + 1));
+    chunk = (char*)malloc(CDC_MAX_CHUNK);
+    if (missing != NULL && sources != NULL && chunk != NULL &&
+        (wanted = markMissing(entries, count, missing, sources,
+        &files)) != -1)
+    {
+        printf("%d of %d chunks are not stored yet\n", wanted, count);
+        bzero(buffer, BUFFER_LENGTH);
+        memmove(buffer, (void*)&wanted, sizeof(int));
+        if (sendAll(&socket, buffer, BUFFER_LENGTH) == 0 &&
+            sendAll(&socket, (char*)missing, count / 8 + 1) == 0 &&
+            receiveChunks(socket, file, entries, count, sources, &files,
+            chunk) == 0 && rename(tempPath, path) == 0)
+        {
+            result = 0;
+        }
+    }
+
+    // Later uploads can take the chunks from the new file
+    if (result == 0 &&
+        indexChunks(path, file, entries, count, sources) == -1)
+    {
+        fprintf(stderr, "Cannot index the chunks of %s\n", path);
+    }
+
+    freeSources(&files);
+    free(chunk);
+    free(sources);
+    free(missing);
+    free(entries);
+    return result;
+}
+
+/*
+-- FUNCTION: readManifest
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static unsigned char *readManifest(int socket, char *buffer,
+--                                               off_t *fileSize,
+--                                               int *count);
+--
+-- RETURNS: the manifest entries, to be freed, or NULL on failure
+--
+-- NOTES:
+-- This function reads the manifest header into buffer and the entries after
+-- it. The chunk count is checked against the size of the file before
+-- anything is allocated, and the chunk lengths have to add up to it.
+*/
+static unsigned char *readManifest(int socket, char *buffer,
+                                   off_t *fileSize, int *count)
+{
+    unsigned char *entries = NULL;
+    off_t total = 0;
+    int length = 0;
+    int i = 0;
+
+    if (readAll(&socket, buffer, BUFFER_LENGTH) == -1)
+    {
+        return NULL;
+    }
+    memmove((void*)fileSize, buffer, sizeof(off_t));
+    memmove((void*)count, buffer + MANIFEST_COUNT, sizeof(int));
+
+    // Every chunk but the last one is between the smallest and largest size
+    if (*fileSize < 0 || *count < 0 || *count > MAX_MANIFEST_ENTRIES ||
+        *count > *fileSize / CDC_MIN_CHUNK + 1 ||
+        *count < (*fileSize + CDC_MAX_CHUNK - 1) / CDC_MAX_CHUNK)
+    {
+        return NULL;
+    }
+
+    entries = (unsigned char*)malloc(*count * CHUNK_ENTRY_SIZE + 1);
+    if (entries == NULL)
+    {
+        return NULL;
+    }
+    if (readAll(&socket, (char*)entries, *count * CHUNK_ENTRY_SIZE) == -1)
+    {
+        free(entries);
+        return NULL;
+    }
+
+    for (i = 0; i < *count; i++)
+    {
+        memmove((void*)&length, entries + i * CHUNK_ENTRY_SIZE +
+            CHUNK_HASH_SIZE, sizeof(int));
+        if (length <= 0 || length > CDC_MAX_CHUNK)
+        {
+            break;
+        }
+        total += length;
+    }
+    if (i < *count || total != *fileSize)
+    {
+        free(entries);
+        return NULL;
+    }
+
+    return entries;
+}
+
+/*
+-- FUNCTION: markMissing
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Looks the chunks up in the index and fills
+-- in where each one comes from.
+--
+-- INTERFACE: static int markMissing(const unsigned char *entries, int count,
+--                                   unsigned char *missing,
+--                                   struct chunkSource *sources,
+--                                   struct sourceFiles *files);
+--
+-- RETURNS: the number of missing chunks or -1 on failure
+--
+-- NOTES:
+-- This function fills in sources with where every chunk of the manifest
+-- comes from and sets the bit in missing of every chunk the client has to
+-- send. A chunk that is in the file more than once is only asked for the
+-- first time, later ones come from where the first one is. The hashes seen
+-- so far are kept in an open addressed table keyed by their first bytes,
+-- which are as random as the rest of them, and only the buckets of the index
+-- that hold some of them are read.
+*/
+static int markMissing(const unsigned char *entries, int count,
+                       unsigned char *missing, struct chunkSource *sources,
+                       struct sourceFiles *files)
+{
+    unsigned char buckets[256];
+    const unsigned char *hash = NULL;
+    unsigned long long key = 0;
+    off_t position = 0;
+    int *slots = NULL;
+    int length = 0;
+    int first = 0;
+    int mask = 1;
+    int slot = 0;
+    int wanted = 0;
+    int i = 0;
+
+    while (mask < count * 2)
+    {
+        mask <<= 1;
+    }
+    if ((slots = (int*)calloc(mask, sizeof(int))) == NULL)
+    {
+        return -1;
+    }
+    mask--;
+
+    bzero(buckets, sizeof(buckets));
+    for (i = 0; i < count; i++)
+    {
+        hash = entries + i * CHUNK_ENTRY_SIZE;
+        memmove((void*)&key, hash, sizeof(key));
+        slot = (int)(key & mask);
+        while (slots[slot] != 0 && memcmp(entries + (slots[slot] - 1) *
+            CHUNK_ENTRY_SIZE, hash, CHUNK_HASH_SIZE) != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        if (slots[slot] == 0)
+        {
+            slots[slot] = i + 1;
+            buckets[hash[0]] = 1;
+        }
+        sources[i].first = slots[slot] - 1;
+        sources[i].file = SOURCE_MISSING;
+        sources[i].offset = 0;
+    }
+
+    for (i = 0; i < 256; i++)
+    {
+        if (buckets[i] &&
+            scanBucket(i, entries, slots, mask, sources, files) == -1)
+        {
+            free(slots);
+            return -1;
+        }
+    }
+    free(slots);
+
+    for (i = 0; i < count; i++)
+    {
+        first = sources[i].first;
+        if (first != i)
+        {
+            // Chunks that are not in the index are in the file by now
+            sources[i].file = sources[first].file == SOURCE_MISSING ?
+                SOURCE_UPLOAD : sources[first].file;
+            sources[i].offset = sources[first].offset;
+        }
+        else if (sources[i].file == SOURCE_MISSING)
+        {
+            sources[i].offset = position;
+            missing[i / 8] |= 1 << (i % 8);
+            wanted++;
+        }
+        memmove((void*)&length, entries + i * CHUNK_ENTRY_SIZE +
+            CHUNK_HASH_SIZE, sizeof(int));
+        position += length;
+    }
+
+    return wanted;
+}
+
+/*
+-- FUNCTION: scanBucket
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int scanBucket(int bucket,
+--                                  const unsigned char *entries,
+--                                  const int *slots, int mask,
+--                                  struct chunkSource *sources,
+--                                  struct sourceFiles *files);
+--
+-- RETURNS: 0 on success or -1 if the bucket cannot be read
+--
+-- NOTES:
+-- This function reads a bucket of the index under its lock and sets the
+-- source of every chunk in slots that it finds in a file that has not
+-- changed since it was indexed. The records of files that changed, and a
+-- record cut short by a server that died writing it, are dropped from the
+-- bucket before it is unlocked.
+*/
+static int scanBucket(int bucket, const unsigned char *entries,
+                      const int *slots, int mask,
+                      struct chunkSource *sources,
+                      struct sourceFiles *files)
+{
+    char path[FILENAME_MAX];
+    struct stat status;
+    struct sourceFile *source = NULL;
+    unsigned char *records = NULL;
+    unsigned char *record = NULL;
+    unsigned long long inode = 0;
+    unsigned long long key = 0;
+    long long seconds = 0;
+    long long nanoseconds = 0;
+    off_t offset = 0;
+    off_t start = 0;
+    int length = 0;
+    int size = 0;
+    int done = 0;
+    int kept = 0;
+    int found = 0;
+    int slot = 0;
+    int file = 0;
+    int result = 0;
+
+    bucketPath(path, bucket);
+    if ((file = open(path, O_RDWR)) == -1)
+    {
+        return errno == ENOENT ? 0 : -1;
+    }
+    if (flock(file, LOCK_EX) == -1 || fstat(file, &status) == -1 ||
+        (size = (int)status.st_size) != status.st_size ||
+        (records = (unsigned char*)malloc(size + 1)) == NULL ||
+        readAt(file, (char*)records, size, 0) == -1)
+    {
+        free(records);
+        close(file);
+        return -1;
+    }
+
+    while (done + RECORD_HEADER <= size)
+    {
+        record = records + done;
+        memmove((void*)&length, record + RECORD_PATH, sizeof(int));
+        if (length <= 0 || length >= FILENAME_MAX ||
+            length > size - done - RECORD_HEADER)
+        {
+            break;
+        }
+        memmove(path, record + RECORD_HEADER, length);
+        path[length] = '\0';
+        if ((found = findSource(files, path)) == -1)
+        {
+            result = -1;
+            break;
+        }
+        source = files->files + found;
+        memmove((void*)&offset, record + RECORD_OFFSET, sizeof(off_t));
+        memmove((void*)&inode, record + RECORD_INODE, sizeof(inode));
+        memmove((void*)&seconds, record + RECORD_SECONDS, sizeof(seconds));
+        memmove((void*)&nanoseconds, record + RECORD_NANOSECONDS,
+            sizeof(nanoseconds));
+        done += RECORD_HEADER + length;
+        if (!source->exists || source->inode != inode ||
+            source->seconds != seconds || source->nanoseconds != nanoseconds)
+        {
+            continue;
+        }
+
+        memmove((void*)&key, record, sizeof(key));
+        slot = (int)(key & mask);
+        while (slots[slot] != 0 && memcmp(entries + (slots[slot] - 1) *
+            CHUNK_ENTRY_SIZE, record, CHUNK_HASH_SIZE) != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        if (slots[slot] != 0 && sources[slots[slot] - 1].file ==
+            SOURCE_MISSING)
+        {
+            sources[slots[slot] - 1].file = found;
+            sources[slots[slot] - 1].offset = offset;
+        }
+        memmove(records + kept, record, RECORD_HEADER + length);
+        kept += RECORD_HEADER + length;
+    }
+
+    // Leave the bucket as it was if not every record was looked at
+    if (result == 0 && kept < size && ((kept > 0 &&
+        writeAll(file, (char*)records, kept, &start) == -1) ||
+        ftruncate(file, kept) == -1))
+    {
+        result = -1;
+    }
+
+    free(records);
+    close(file);
+    return result;
+}
+
+/*
+-- FUNCTION: receiveChunks
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Copies the chunks the client does not send
+-- from the files of the share.
+--
+-- INTERFACE: static int receiveChunks(int socket, int file,
+--                                     const unsigned char *entries,
+--                                     int count,
+--                                     const struct chunkSource *sources,
+--                                     const struct sourceFiles *files,
+--                                     char *chunk);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function goes through the chunks of the file in manifest order and
+-- appends each one to file. A chunk that was asked for is received from the
+-- client into the chunk buffer of CDC_MAX_CHUNK bytes and its hash is
+-- checked before it is written. The others are gathered into runs of chunks
+-- that follow each other in the same source, which are copied in one go, so
+-- a file that is mostly the same as one in the share is mostly one copy.
+*/
+static int receiveChunks(int socket, int file,
+                         const unsigned char *entries, int count,
+                         const struct chunkSource *sources,
+                         const struct sourceFiles *files, char *chunk)
+{
+    unsigned char hash[CHUNK_HASH_SIZE];
+    struct chunkRun run;
+    const unsigned char *entry = NULL;
+    off_t position = 0;
+    int length = 0;
+    int i = 0;
+
+    bzero(&run, sizeof(struct chunkRun));
+    for (i = 0; i < count; i++)
+    {
+        entry = entries + i * CHUNK_ENTRY_SIZE;
+        memmove((void*)&length, entry + CHUNK_HASH_SIZE, sizeof(int));
+        if (run.length > 0 && (sources[i].file != run.file ||
+            sources[i].offset != run.offset + run.length))
+        {
+            if (copyRun(file, &run, entries, files, chunk) == -1)
+            {
+                return -1;
+            }
+        }
+
+        if (sources[i].file == SOURCE_MISSING)
+        {
+            if (readAll(&socket, chunk, length) == -1)
+            {
+                return -1;
+            }
+            hash128(chunk, length, hash);
+            if (memcmp(hash, entry, CHUNK_HASH_SIZE) != 0 ||
+                writeAll(file, chunk, length, NULL) == -1)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            if (run.length == 0)
+            {
+                run.file = sources[i].file;
+                run.first = i;
+                run.offset = sources[i].offset;
+                run.position = position;
+            }
+            run.last = i;
+            run.length += length;
+        }
+        position += length;
+    }
+
+    return run.length > 0 ? copyRun(file, &run, entries, files, chunk) : 0;
+}
+
+/*
+-- FUNCTION: copyRun
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int copyRun(int file, struct chunkRun *run,
+--                               const unsigned char *entries,
+--                               const struct sourceFiles *files,
+--                               char *chunk);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function appends a run of chunks to file from its source, a file of
+-- the share or an earlier part of file, and empties the run. Each chunk is
+-- then read back and hashed, so a source that was changed after it was
+-- looked up cannot put the wrong data in the file.
+*/
+static int copyRun(int file, struct chunkRun *run,
+                   const unsigned char *entries,
+                   const struct sourceFiles *files, char *chunk)
+{
+    unsigned char hash[CHUNK_HASH_SIZE];
+    const unsigned char *entry = NULL;
+    off_t position = run->position;
+    int source = file;
+    int length = 0;
+    int result = 0;
+    int i = 0;
+
+    if (run->file != SOURCE_UPLOAD &&
+        (source = open(files->files[run->file].path, O_RDONLY)) == -1)
+    {
+        return -1;
+    }
+    result = copyRange(source, run->offset, file, run->length, chunk);
+    if (source != file)
+    {
+        close(source);
+    }
+
+    for (i = run->first; result == 0 && i <= run->last; i++)
+    {
+        entry = entries + i * CHUNK_ENTRY_SIZE;
+        memmove((void*)&length, entry + CHUNK_HASH_SIZE, sizeof(int));
+        if (readAt(file, chunk, length, position) == -1)
+        {
+            result = -1;
+            break;
+        }
+        hash128(chunk, length, hash);
+        if (memcmp(hash, entry, CHUNK_HASH_SIZE) != 0)
+        {
+            result = -1;
+        }
+        position += length;
+    }
+
+    run->length = 0;
+    return result;
+}
+
+/*
+-- FUNCTION: copyRange
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int copyRange(int source, off_t offset, int file,
+--                                 off_t length, char *chunk);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function appends length bytes of source from offset to file. It uses
+-- copy_file_range so the data stays in the kernel, and the file system can
+-- share the extents of the source where it is able to. Where the call is not
+-- supported, between file systems or on an older kernel, the data goes
+-- through the chunk buffer instead.
+*/
+static int copyRange(int source, off_t offset, int file, off_t length,
+                     char *chunk)
+{
+    ssize_t copied = 0;
+    int part = 0;
+
+    while (length > 0)
+    {
+        copied = copy_file_range(source, &offset, file, NULL, length, 0);
+        if (copied == -1 && (errno == EXDEV || errno == EINVAL ||
+            errno == ENOSYS || errno == EOPNOTSUPP))
+        {
+            break;
+        }
+        if (copied == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (copied <= 0)
+        {
+            return -1;
+        }
+        length -= copied;
+    }
+
+    while (length > 0)
+    {
+        part = length < CDC_MAX_CHUNK ? (int)length : CDC_MAX_CHUNK;
+        if (readAt(source, chunk, part, offset) == -1 ||
+            writeAll(file, chunk, part, NULL) == -1)
+        {
+            return -1;
+        }
+        offset += part;
+        length -= part;
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: indexChunks
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int indexChunks(const char *path, int file,
+--                                   const unsigned char *entries,
+--                                   int count,
+--                                   const struct chunkSource *sources);
+--
+-- RETURNS: 0 on success or -1 on failure
+--
+-- NOTES:
+-- This function adds a record for every distinct chunk of the file at path,
+-- open as file, to the index. The records are sorted by bucket first so
+-- every bucket is locked and appended to once. The records of the file path
+-- held before are left for the next reads of their buckets to drop.
+*/
+static int indexChunks(const char *path, int file,
+                       const unsigned char *entries, int count,
+                       const struct chunkSource *sources)
+{
+    char bucketName[FILENAME_MAX];
+    int starts[257];
+    struct stat status;
+    unsigned char *records = NULL;
+    unsigned char *record = NULL;
+    unsigned long long inode = 0;
+    long long seconds = 0;
+    long long nanoseconds = 0;
+    off_t position = 0;
+    int pathLength = strlen(path);
+    int recordSize = RECORD_HEADER + pathLength;
+    int length = 0;
+    int bucket = 0;
+    int bucketFile = 0;
+    int index = 0;
+    int result = 0;
+    int i = 0;
+
+    if (pathLength >= FILENAME_MAX || fstat(file, &status) == -1 ||
+        (mkdir(STORE_DIR, 00700) == -1 && errno != EEXIST))
+    {
+        return -1;
+    }
+    inode = status.st_ino;
+    seconds = status.st_mtim.tv_sec;
+    nanoseconds = status.st_mtim.tv_nsec;
+
+    bzero(starts, sizeof(starts));
+    for (i = 0; i < count; i++)
+    {
+        if (sources[i].first == i)
+        {
+            starts[entries[i * CHUNK_ENTRY_SIZE] + 1]++;
+        }
+    }
+    for (bucket = 0; bucket < 256; bucket++)
+    {
+        starts[bucket + 1] += starts[bucket];
+    }
+    records = (unsigned char*)malloc((size_t)starts[256] * recordSize + 1);
+    if (records == NULL)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        memmove((void*)&length, entries + i * CHUNK_ENTRY_SIZE +
+            CHUNK_HASH_SIZE, sizeof(int));
+        if (sources[i].first == i)
+        {
+            bucket = entries[i * CHUNK_ENTRY_SIZE];
+            record = records + (size_t)starts[bucket]++ * recordSize;
+            memmove(record, entries + i * CHUNK_ENTRY_SIZE, CHUNK_HASH_SIZE);
+            memmove(record + RECORD_OFFSET, (void*)&position, sizeof(off_t));
+            memmove(record + RECORD_INODE, (void*)&inode, sizeof(inode));
+            memmove(record + RECORD_SECONDS, (void*)&seconds,
+                sizeof(seconds));
+            memmove(record + RECORD_NANOSECONDS, (void*)&nanoseconds,
+                sizeof(nanoseconds));
+            memmove(record + RECORD_PATH, (void*)&pathLength, sizeof(int));
+            memmove(record + RECORD_HEADER, path, pathLength);
+        }
+        position += length;
+    }
+
+    // The starts have moved on to the end of their bucket
+    for (bucket = 0, index = 0; bucket < 256 && result == 0; bucket++)
+    {
+        if (starts[bucket] == index)
+        {
+            continue;
+        }
+        bucketPath(bucketName, bucket);
+        if ((bucketFile = open(bucketName, O_WRONLY | O_CREAT | O_APPEND,
+            00400 | 00200)) == -1)
+        {
+            result = -1;
+            break;
+        }
+        if (flock(bucketFile, LOCK_EX) == -1 ||
+            writeAll(bucketFile, (char*)records + (size_t)index * recordSize,
+            (starts[bucket] - index) * recordSize, NULL) == -1)
+        {
+            result = -1;
+        }
+        close(bucketFile);
+        index = starts[bucket];
+    }
+
+    free(records);
+    return result;
+}
+
+/*
+-- FUNCTION: findSource
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int findSource(struct sourceFiles *files,
+--                                  const char *path);
+--
+-- RETURNS: the index of path in files or -1 if it cannot be added
+--
+-- NOTES:
+-- This function looks path up in the files the index pointed to so far and
+-- adds it the first time, with its inode and the time it was last changed,
+-- so every file is looked at once however many of its records are read.
+-- The table of paths doubles once it is half full.
+*/
+static int findSource(struct sourceFiles *files, const char *path)
+{
+    struct stat status;
+    struct sourceFile *source = NULL;
+    struct sourceFile *grown = NULL;
+    const char *next = NULL;
+    unsigned long key = 5381;
+    int *slots = NULL;
+    int size = 0;
+    int slot = 0;
+    int i = 0;
+
+    for (next = path; *next != '\0'; next++)
+    {
+        key = key * 33 + (unsigned char)*next;
+    }
+
+    if (files->count * 2 >= files->size)
+    {
+        size = files->size == 0 ? 64 : files->size * 2;
+        grown = (struct sourceFile*)realloc(files->files,
+            sizeof(struct sourceFile) * (size / 2));
+        if (grown == NULL)
+        {
+            return -1;
+        }
+        files->files = grown;
+        if ((slots = (int*)calloc(size, sizeof(int))) == NULL)
+        {
+            return -1;
+        }
+        for (i = 0; i < files->count; i++)
+        {
+            slot = (int)(files->files[i].key & (size - 1));
+            while (slots[slot] != 0)
+            {
+                slot = (slot + 1) & (size - 1);
+            }
+            slots[slot] = i + 1;
+        }
+        free(files->slots);
+        files->slots = slots;
+        files->size = size;
+    }
+
+    slot = (int)(key & (files->size - 1));
+    while (files->slots[slot] != 0)
+    {
+        source = files->files + files->slots[slot] - 1;
+        if (source->key == key && strcmp(source->path, path) == 0)
+        {
+            return files->slots[slot] - 1;
+        }
+        slot = (slot + 1) & (files->size - 1);
+    }
+
+    source = files->files + files->count;
+    if ((source->path = strdup(path)) == NULL)
+    {
+        return -1;
+    }
+    source->key = key;
+    source->exists = stat(path, &status) == 0 && S_ISREG(status.st_mode);
+    source->inode = status.st_ino;
+    source->seconds = status.st_mtim.tv_sec;
+    source->nanoseconds = status.st_mtim.tv_nsec;
+    files->slots[slot] = ++files->count;
+    return files->count - 1;
+}
+
+/*
+-- FUNCTION: freeSources
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void freeSources(struct sourceFiles *files);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function frees the paths and tables of files.
+*/
+static void freeSources(struct sourceFiles *files)
+{
+    int i = 0;
+
+    for (i = 0; i < files->count; i++)
+    {
+        free(files->files[i].path);
+    }
+    free(files->files);
+    free(files->slots);
+}
+
+/*
+-- FUNCTION: readAt
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int readAt(int file, char *buffer, int length,
+--                              off_t offset);
+--
+-- RETURNS: 0 on success or -1 if the file does not have length bytes there
+--
+-- NOTES:
+-- This function reads length bytes of file at offset into buffer.
+*/
+static int readAt(int file, char *buffer, int length, off_t offset)
+{
+    ssize_t bytesRead = 0;
+    int done = 0;
+
+    while (done < length && ((bytesRead = pread(file, buffer + done,
+        length - done, offset + done)) > 0 ||
+        (bytesRead == -1 && errno == EINTR)))
+    {
+        done += bytesRead > 0 ? (int)bytesRead : 0;
+    }
+
+    return done == length ? 0 : -1;
+}
+
+/*
+-- FUNCTION: bucketPath
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void bucketPath(char *path, int bucket);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function builds the path of the bucket of the index for the hashes
+-- that start with the byte bucket.
+*/
+static void bucketPath(char *path, int bucket)
+{
+    sprintf(path, "%s%02x.index", STORE_DIR, bucket);
+}
@@ -0,0 +1,16 @@
+#ifndef STORE_H
+#define STORE_H
+
+// Index of the chunks of deduplicated uploads, kept under the share directory
+#define STORE_DIR "./share/.store/"
+
+// Function Prototypes
+#ifdef __cplusplus
+extern "C" {
+#endif
+int receiveChunked(int socket, int file, char *buffer,
+                   const char *tempPath, const char *path);
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,1836 @@
+/*
+-- SOURCE FILE: uring.c
+--
+-- PROGRAM: Super File Transfer
+--
+-- FUNCTIONS:
+-- void uringServer(struct serverOptions *options);
+-- static int setupRing(struct ringReactor *reactor, int port, int reusePort,
+--                      int dataLow, int dataHigh, int chunkSize);
+-- static void *ringThread(void *argument);
+-- static void runRing(struct ringReactor *reactor);
+-- static void queueAccept(struct ringReactor *reactor);
+-- static void acceptClient(struct ringReactor *reactor, int socket);
+-- static int acceptFailed(struct ringReactor *reactor, int error);
+-- static void handleCompletion(struct ringReactor *reactor,
+--                              unsigned long long data, int result);
+-- static int readControl(struct ringReactor *reactor,
+--                        struct ringConnection *conn, int result);
+-- static int forkCommand(struct ringReactor *reactor,
+--                        struct ringConnection *conn);
+-- static int startConnect(struct ringReactor *reactor,
+--                         struct ringConnection *conn);
+-- static int finishConnect(struct ringReactor *reactor,
+--                          struct ringConnection *conn, int result);
+-- static int startTransfer(struct ringReactor *reactor,
+--                          struct ringConnection *conn);
+-- static int sendHeader(struct ringReactor *reactor,
+--                       struct ringConnection *conn, int result);
+-- static int sendBody(struct ringReactor *reactor,
+--                     struct ringConnection *conn, int result);
+-- static int sendCached(struct ringReactor *reactor,
+--                       struct ringConnection *conn, int result);
+-- static void queueCached(struct ringReactor *reactor,
+--                         struct ringConnection *conn);
+-- static int sendResume(struct ringReactor *reactor,
+--                       struct ringConnection *conn, int result);
+-- static int readHeader(struct ringReactor *reactor,
+--                       struct ringConnection *conn, int result);
+-- static int readBody(struct ringReactor *reactor,
+--                     struct ringConnection *conn, int result);
+-- static int writeBody(struct ringReactor *reactor,
+--                      struct ringConnection *conn, int result);
+-- static void queueChunk(struct ringReactor *reactor,
+--                        struct ringConnection *conn);
+-- static struct io_uring_sqe *queueSocket(struct ringReactor *reactor,
+--                                        struct ringConnection *conn,
+--                                        int operation, char *buffer,
+--                                        int length);
+-- static struct io_uring_sqe *queueFile(struct ringReactor *reactor,
+--                                      struct ringConnection *conn,
+--                                      int write, int length);
+-- static void clearSlot(struct ringReactor *reactor, int slot,
+--                       unsigned long long data);
+-- static int takeTransferBuffer(struct ringReactor *reactor,
+--                               struct ringConnection *conn);
+-- static void closeConnection(struct ringReactor *reactor,
+--                             struct ringConnection *conn);
+-- static void endTransfer(struct ringConnection *conn, int success);
+-- static struct io_uring_sqe *getSqe(struct ringReactor *reactor);
+-- static void systemFatal(const char* message);
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Transfers can be a single stripe of a file.
+-- October 17, 2026 - Transfers can be resumed.
+-- October 17, 2026 - Delta uploads are handed to a child process.
+-- October 17, 2026 - So are deduplicated uploads.
+-- October 17, 2026 - So are compressed transfers.
+-- October 17, 2026 - So are verified transfers.
+-- October 17, 2026 - So are batches.
+-- October 17, 2026 - So are listings.
+-- October 17, 2026 - Downloads use the cache of open files, see filecache.c.
+-- October 17, 2026 - Small hot files are sent from memory.
+-- October 17, 2026 - Uploads are preallocated and written behind.
+-- October 17, 2026 - Every ring counts its transfers, see metrics.c.
+-- October 17, 2026 - Falls back to epoll on a kernel without the operations
+-- it uses.
+--
+-- NOTES:
+-- This file contains the io_uring mode of the server. It follows the reactor
+-- in reactor.c, one event loop per thread with its own SO_REUSEPORT listening
+-- socket and slice of the data ports, but instead of waiting for sockets to
+-- become ready and then making a system call for every accept, recv, send
+-- and write, the loop queues those operations in the ring of the thread and
+-- hands all of them to the kernel with a single io_uring_enter, which also
+-- collects the results of earlier operations.
+--
+-- Every connection is a state machine that is advanced by the completion of
+-- its current operation:
+--
+-- STATE_CONTROL -> STATE_CONNECT -> STATE_SEND_HEADER -> STATE_SEND_BODY
+--                                -> STATE_GET_HEADER  -> STATE_GET_BODY
+--                                                     <-> STATE_WRITE
+--
+-- A resumed upload first sends the resume point of the partial file in
+-- STATE_SEND_RESUME and then goes on to STATE_GET_HEADER. A download of a
+-- file the cache keeps in memory goes to STATE_SEND_CACHED instead, whose
+-- single sendmsg carries the size control message and the body.
+--
+-- Sockets are installed in a table of fixed files and file data moves through
+-- buffers registered with the ring, so the kernel does not look up the socket
+-- or map the buffer on every operation. A chunk of a download is read from
+-- the file and sent as a linked pair of operations. When the kernel refuses
+-- the registrations the loop uses plain descriptors and pool buffers instead.
+-- A download opens its file through the cache of open files, see filecache.c,
+-- which every thread shares.
+--
+-- Passive transfers, multiplexed sessions, batches and listings are rare and
+-- long lived. They are handed to a forked child that runs serveCommand, as in the
+-- fork mode. So are delta and deduplicated uploads and compressed and verified
+-- transfers, which are bound by checksumming, hashing and compressing rather
+-- than I/O.
+--
+-- On a kernel without io_uring, or without any of the operations in
+-- RING_OPERATIONS, the server falls back to the epoll reactor.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "server.h"
+#include "portpool.h"
+#include "filecache.h"
+#include "metrics.h"
+#include "../network/network.h"
+#include "../network/transfer.h"
+#include "../network/buffer.h"
+#include "../network/uring.h"
+
+#define RING_ENTRIES 256
+#define RING_COMPLETIONS 8192
+#define RING_FILES 1024
+#define RING_BUFFERS 64
+#define RING_BUFFER_MEMORY 16777216
+
+// A completion handler queues at most this many operations
+#define RING_ROOM 4
+
+// Every operation the rings submit, the kernel must support all of them
+#define RING_OPERATIONS { IORING_OP_ACCEPT, IORING_OP_CONNECT, \
+    IORING_OP_RECV, IORING_OP_SEND, IORING_OP_SENDMSG, IORING_OP_TIMEOUT, \
+    IORING_OP_READ, IORING_OP_WRITE, IORING_OP_READ_FIXED, \
+    IORING_OP_WRITE_FIXED, IORING_OP_FILES_UPDATE }
+
+// Milliseconds to wait before accepting again when out of descriptors
+#define ACCEPT_RETRY_DELAY 100
+
+// Connection states
+#define STATE_CONTROL 0
+#define STATE_CONNECT 1
+#define STATE_RETRY 2
+#define STATE_SEND_HEADER 3
+#define STATE_SEND_BODY 4
+#define STATE_GET_HEADER 5
+#define STATE_GET_BODY 6
+#define STATE_WRITE 7
+#define STATE_SEND_RESUME 8
+#define STATE_SEND_CACHED 9
+
+// The low bits of the completion data tell what kind of operation finished
+#define TAG_CONNECTION 0
+#define TAG_ACCEPT 1
+#define TAG_SLOT 2
+#define TAG_LINKED 3
+#define TAG_MASK 3ULL
+
+// An accept tagged with this bit is the wait before the next accept
+#define ACCEPT_DELAYED 4ULL
+
+struct ringConnection
+{
+    int socket;
+    int slot;
+    int installed;
+    int file;
+    struct cachedFile *cached;
+    const char *contents;
+    struct msghdr message;
+    struct iovec vector[2];
+    int state;
+    int command;
+    int retries;
+    int port;
+    int dataPort;
+    char ip[16];
+    char fileName[BUFFER_LENGTH];
+    char control[BUFFER_LENGTH];
+    int controlCount;
+    char *buffer;
+    int bufferIndex;
+    int length;
+    int done;
+    int stripe;
+    int stripes;
+    int resume;
+    struct resumePoint resumePoint;
+    struct writeBehind behind;
+    off_t fileSize;
+    off_t offset;
+    off_t end;
+    long long accepted;
+    long long connecting;
+    long long started;
+    struct sockaddr_in address;
+    struct __kernel_timespec delay;
+};
+
+struct ringReactor
+{
+    struct uring ring;
+    int listenSocket;
+    int index;
+    int cpu;
+    pthread_t thread;
+    struct portPool ports;
+    struct bufferPool buffers;
+    char *fixedBuffers[RING_BUFFERS];
+    int fixedBufferCount;
+    int freeBuffers[RING_BUFFERS];
+    int freeBufferCount;
+    int freeSlots[RING_FILES];
+    int freeSlotCount;
+    int emptySlot;
+    unsigned char linkFlags;
+    struct sockaddr_in acceptAddress;
+    socklen_t acceptLength;
+    struct __kernel_timespec acceptDelay;
+};
+
+static int setupRing(struct ringReactor *reactor, int port, int reusePort,
+                     int dataLow, int dataHigh, int chunkSize);
+static void *ringThread(void *argument);
+static void runRing(struct ringReactor *reactor);
+static void queueAccept(struct ringReactor *reactor);
+static void acceptClient(struct ringReactor *reactor, int socket);
+static int acceptFailed(struct ringReactor *reactor, int error);
+static void handleCompletion(struct ringReactor *reactor,
+                             unsigned long long data, int result);
+static int readControl(struct ringReactor *reactor,
+                       struct ringConnection *conn, int result);
+static int forkCommand(struct ringReactor *reactor,
+                       struct ringConnection *conn);
+static int startConnect(struct ringReactor *reactor,
+                        struct ringConnection *conn);
+static int finishConnect(struct ringReactor *reactor,
+                         struct ringConnection *conn, int result);
+static int startTransfer(struct ringReactor *reactor,
+                         struct ringConnection *conn);
+static int sendHeader(struct ringReactor *reactor,
+                      struct ringConnection *conn, int result);
+static int sendBody(struct ringReactor *reactor,
+                    struct ringConnection *conn, int result);
+static int sendCached(struct ringReactor *reactor,
+                      struct ringConnection *conn, int result);
+static void queueCached(struct ringReactor *reactor,
+                        struct ringConnection *conn);
+static int sendResume(struct ringReactor *reactor,
+                      struct ringConnection *conn, int result);
+static int readHeader(struct ringReactor *reactor,
+                      struct ringConnection *conn, int result);
+static int readBody(struct ringReactor *reactor,
+                    struct ringConnection *conn, int result);
+static int writeBody(struct ringReactor *reactor,
+                     struct ringConnection *conn, int result);
+static void queueChunk(struct ringReactor *reactor,
+                       struct ringConnection *conn);
+static struct io_uring_sqe *queueSocket(struct ringReactor *reactor,
+                                       struct ringConnection *conn,
+                                       int operation, char *buffer,
+                                       int length);
+static struct io_uring_sqe *queueFile(struct ringReactor *reactor,
+                                     struct ringConnection *conn,
+                                     int write, int length);
+static void clearSlot(struct ringReactor *reactor, int slot,
+                      unsigned long long data);
+static int takeTransferBuffer(struct ringReactor *reactor,
+                              struct ringConnection *conn);
+static void closeConnection(struct ringReactor *reactor,
+                            struct ringConnection *conn);
+static void endTransfer(struct ringConnection *conn, int success);
+static struct io_uring_sqe *getSqe(struct ringReactor *reactor);
+static void systemFatal(const char* message);
+
+/*
+-- FUNCTION: uringServer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Numbers the rings for their metrics shards.
+--
+-- INTERFACE: void uringServer(struct serverOptions *options);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function sets up one ring per thread and runs them until the server is
+-- shut down. The thread count and the data port slices work as in the
+-- reactor mode. If the first ring can not be created the kernel has no
+-- io_uring, or it is disabled, and the epoll reactor is run instead.
+*/
+void uringServer(struct serverOptions *options)
+{
+    struct ringReactor *reactors = NULL;
+    int threads = 1;
+    int cpus = 1;
+    int slice = 0;
+    int dataLow = 0;
+    int dataHigh = 0;
+    int i = 0;
+
+    // A client closing early must not take the whole server down, and the
+    // children serving passive and multiplexed clients are never waited for
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGCHLD, SIG_IGN);
+
+    if ((cpus = (int)sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+    {
+        cpus = 1;
+    }
+    threads = options->threads > 0 ? options->threads : cpus;
+    if (options->dataLow > 0)
+    {
+        if ((slice = (options->dataHigh - options->dataLow + 1) / threads) < 1)
+        {
+            fprintf(stderr, "Need at least one data port per reactor\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if ((reactors = (struct ringReactor*)calloc(threads,
+        sizeof(struct ringReactor))) == NULL)
+    {
+        systemFatal("Cannot Allocate Reactors");
+    }
+
+    // Bind every listening socket before starting so failures show up now
+    for (i = 0; i < threads; i++)
+    {
+        if (slice > 0)
+        {
+            dataLow = options->dataLow + i * slice;
+            dataHigh = i == threads - 1 ? options->dataHigh :
+                dataLow + slice - 1;
+        }
+        if (setupRing(&reactors[i], options->port, threads > 1, dataLow,
+            dataHigh, options->chunkSize) == -1)
+        {
+            if (i > 0)
+            {
+                systemFatal("Cannot Create Ring");
+            }
+            perror("io_uring is not available, using epoll");
+            free(reactors);
+            options->mode = threads > 1 ? MODE_REACTOR : MODE_EPOLL;
+            options->threads = threads;
+            reactorServer(options);
+            return;
+        }
+        reactors[i].index = i;
+        reactors[i].cpu = i % cpus;
+    }
+
+    if (threads == 1)
+    {
+        runRing(&reactors[0]);
+    }
+    else
+    {
+        printf("Starting %d rings on %d CPUs\n", threads, cpus);
+        for (i = 0; i < threads; i++)
+        {
+            if (pthread_create(&reactors[i].thread, NULL, ringThread,
+                &reactors[i]) != 0)
+            {
+                systemFatal("Cannot Start Ring Thread");
+            }
+        }
+        for (i = 0; i < threads; i++)
+        {
+            pthread_join(reactors[i].thread, NULL);
+        }
+    }
+
+    for (i = 0; i < threads; i++)
+    {
+        uringDestroy(&reactors[i].ring);
+        while (reactors[i].fixedBufferCount > 0)
+        {
+            free(reactors[i].fixedBuffers[--reactors[i].fixedBufferCount]);
+        }
+        destroyBufferPool(&reactors[i].buffers);
+        destroyPortPool(&reactors[i].ports);
+        close(reactors[i].listenSocket);
+    }
+    free(reactors);
+    printf("Server Closing!\n");
+}
+
+/*
+-- FUNCTION: setupRing
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Probes the operations of the kernel.
+--
+-- INTERFACE: static int setupRing(struct ringReactor *reactor, int port,
+--                                 int reusePort, int dataLow, int dataHigh,
+--                                 int chunkSize);
+--
+-- RETURNS: 0 on success or -1 if the ring could not be created or the
+--          kernel lacks one of its operations
+--
+-- NOTES:
+-- This function creates the ring, checks that the kernel supports every
+-- operation in RING_OPERATIONS, registers the transfer buffers and an empty
+-- table of fixed files with it and sets up the listening socket, the buffer
+-- pool and the data port pool. Only as many buffers are registered as fit in
+-- RING_BUFFER_MEMORY. If either registration fails the ring still works,
+-- with plain descriptors or pool buffers.
+*/
+static int setupRing(struct ringReactor *reactor, int port, int reusePort,
+                     int dataLow, int dataHigh, int chunkSize)
+{
+    static const unsigned char operations[] = RING_OPERATIONS;
+    struct iovec buffers[RING_BUFFERS];
+    int files[RING_FILES];
+    int count = 0;
+    int i = 0;
+
+    if (uringSetup(&reactor->ring, RING_ENTRIES, RING_COMPLETIONS) == -1)
+    {
+        return -1;
+    }
+    if (!uringSupports(&reactor->ring, operations, sizeof(operations)))
+    {
+        uringDestroy(&reactor->ring);
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    if (reactor->ring.features & IORING_FEAT_CQE_SKIP)
+    {
+        reactor->linkFlags = IOSQE_CQE_SKIP_SUCCESS;
+    }
+
+    initializeBufferPool(&reactor->buffers, chunkSize);
+    if ((count = RING_BUFFER_MEMORY / reactor->buffers.size) > RING_BUFFERS)
+    {
+        count = RING_BUFFERS;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if ((reactor->fixedBuffers[i] = takeBuffer(&reactor->buffers)) == NULL)
+        {
+            systemFatal("Cannot Allocate Buffer");
+        }
+        buffers[i].iov_base = reactor->fixedBuffers[i];
+        buffers[i].iov_len = reactor->buffers.size;
+        reactor->freeBuffers[i] = i;
+    }
+    reactor->fixedBufferCount = count;
+    if (count > 0 && uringRegisterBuffers(&reactor->ring, buffers,
+        count) == 0)
+    {
+        reactor->freeBufferCount = count;
+    }
+
+    reactor->emptySlot = -1;
+    for (i = 0; i < RING_FILES; i++)
+    {
+        files[i] = -1;
+        reactor->freeSlots[i] = RING_FILES - 1 - i;
+    }
+    if (uringRegisterFiles(&reactor->ring, files, RING_FILES) == 0)
+    {
+        reactor->freeSlotCount = RING_FILES;
+    }
+
+    initializeServer(&reactor->listenSocket, &port, reusePort);
+
+    if (initializePortPool(&reactor->ports, dataLow, dataHigh) == -1)
+    {
+        systemFatal("Cannot Allocate Data Ports");
+    }
+
+    return 0;
+}
+
+/*
+-- FUNCTION: ringThread
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void *ringThread(void *argument);
+--
+-- RETURNS: NULL
+--
+-- NOTES:
+-- This function is the body of a ring thread. It pins the thread to its CPU
+-- and runs the ring.
+*/
+static void *ringThread(void *argument)
+{
+    struct ringReactor *reactor = (struct ringReactor*)argument;
+    cpu_set_t cpuSet;
+
+    CPU_ZERO(&cpuSet);
+    CPU_SET(reactor->cpu, &cpuSet);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+        &cpuSet) != 0)
+    {
+        fprintf(stderr, "Cannot pin ring to CPU %d\n", reactor->cpu);
+    }
+
+    runRing(reactor);
+    return NULL;
+}
+
+/*
+-- FUNCTION: runRing
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts in the metrics shard of the ring.
+--
+-- INTERFACE: static void runRing(struct ringReactor *reactor);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function is the event loop of a ring. Every pass submits the
+-- operations queued by the previous pass, waits for at least one completion
+-- and handles every completion that is ready. The loop counts in the metrics
+-- shard of its ring.
+*/
+static void runRing(struct ringReactor *reactor)
+{
+    struct io_uring_cqe *cqe = NULL;
+    unsigned long long data = 0;
+    int result = 0;
+
+    useMetricsShard(reactor->index);
+    queueAccept(reactor);
+
+    while (1)
+    {
+        // EBUSY means completions are waiting for room in the queue
+        if (uringSubmit(&reactor->ring, 1) == -1 && errno != EINTR &&
+            errno != EBUSY && errno != EAGAIN)
+        {
+            systemFatal("Cannot Submit To Ring");
+        }
+
+        while ((cqe = uringPeek(&reactor->ring)) != NULL)
+        {
+            data = cqe->user_data;
+            result = cqe->res;
+            uringAdvance(&reactor->ring);
+
+            if (uringSpace(&reactor->ring) < RING_ROOM)
+            {
+                uringSubmit(&reactor->ring, 0);
+            }
+            handleCompletion(reactor, data, result);
+        }
+    }
+}
+
+/*
+-- FUNCTION: queueAccept
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void queueAccept(struct ringReactor *reactor);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function queues an accept on the listening socket. The address of the
+-- client is stored in the reactor until the accept completes.
+*/
+static void queueAccept(struct ringReactor *reactor)
+{
+    struct io_uring_sqe *sqe = getSqe(reactor);
+
+    reactor->acceptLength = sizeof(struct sockaddr_in);
+    uringPrepare(sqe, IORING_OP_ACCEPT, reactor->listenSocket,
+        &reactor->acceptAddress, 0, 0, TAG_ACCEPT);
+    sqe->addr2 = (unsigned long long)(unsigned long)&reactor->acceptLength;
+}
+
+/*
+-- FUNCTION: acceptClient
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts the client and when it was accepted.
+-- October 17, 2026 - Only accepts again right away after a failure that
+-- passes, see acceptFailed.
+--
+-- INTERFACE: static void acceptClient(struct ringReactor *reactor,
+--                                     int socket);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function handles a finished accept. The next accept is queued right
+-- away, then a connection is created for the new client, given a fixed file
+-- slot if one is free, and the read of its control message is queued.
+*/
+static void acceptClient(struct ringReactor *reactor, int socket)
+{
+    struct ringConnection *conn = NULL;
+
+    if (socket < 0)
+    {
+        if (acceptFailed(reactor, -socket) == 0)
+        {
+            queueAccept(reactor);
+        }
+        return;
+    }
+    queueAccept(reactor);
+
+    if ((conn = (struct ringConnection*)calloc(1,
+        sizeof(struct ringConnection))) == NULL)
+    {
+        close(socket);
+        return;
+    }
+
+    conn->socket = socket;
+    conn->file = -1;
+    conn->bufferIndex = -1;
+    conn->slot = reactor->freeSlotCount > 0 ?
+        reactor->freeSlots[--reactor->freeSlotCount] : -1;
+    inet_ntop(AF_INET, &reactor->acceptAddress.sin_addr, conn->ip,
+        sizeof(conn->ip));
+    conn->port = ntohs(reactor->acceptAddress.sin_port);
+    conn->accepted = metricsClock();
+    countMetric(METRIC_CONNECTIONS, 1);
+
+    conn->state = STATE_CONTROL;
+    queueSocket(reactor, conn, IORING_OP_RECV, conn->control, BUFFER_LENGTH);
+}
+
+/*
+-- FUNCTION: acceptFailed
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int acceptFailed(struct ringReactor *reactor,
+--                                    int error);
+--
+-- RETURNS: 0 if the next accept can be queued now, -1 otherwise
+--
+-- NOTES:
+-- This function deals with an accept that failed with error. A client that
+-- went away before it was accepted, or a signal, only costs that client.
+-- When the process or the system is out of descriptors or memory, accepting
+-- again would fail at once and keep the ring spinning, so the accept is
+-- queued again after ACCEPT_RETRY_DELAY instead. Any other error, such as
+-- EINVAL for a listening socket that was shut down, does not pass, and the
+-- ring stops accepting while it finishes the connections it has.
+*/
+static int acceptFailed(struct ringReactor *reactor, int error)
+{
+    struct io_uring_sqe *sqe = NULL;
+
+    errno = error;
+    switch (error)
+    {
+    case ECONNABORTED:
+    case EINTR:
+    case EAGAIN:
+    case EPROTO:
+    case EPERM:
+        return 0;
+    case EMFILE:
+    case ENFILE:
+    case ENOBUFS:
+    case ENOMEM:
+        perror("Can't Accept Client");
+        reactor->acceptDelay.tv_sec = 0;
+        reactor->acceptDelay.tv_nsec = ACCEPT_RETRY_DELAY * 1000000LL;
+        sqe = getSqe(reactor);
+        uringPrepare(sqe, IORING_OP_TIMEOUT, -1, &reactor->acceptDelay, 1, 0,
+            TAG_ACCEPT | ACCEPT_DELAYED);
+        return -1;
+    default:
+        perror("Can't Accept Client, No Longer Accepting");
+        return -1;
+    }
+}
+
+/*
+-- FUNCTION: handleCompletion
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Resumes a transfer that died part way.
+-- October 17, 2026 - Counts the end of the transfer.
+-- October 17, 2026 - Accepts again once the wait after a failed accept ends.
+--
+-- INTERFACE: static void handleCompletion(struct ringReactor *reactor,
+--                                         unsigned long long data,
+--                                         int result);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function dispatches a completion. The low bits of the data tell
+-- accepts, released fixed file slots and the first half of a linked pair
+-- apart from the operations that advance a connection. A failure in the
+-- first half of a pair cancels the second half, so only the second half is
+-- acted on. The state handlers return 1 when the connection is done, 0 while
+-- it continues and -1 on failure. The transfer is counted once the
+-- connection is done either way.
+*/
+static void handleCompletion(struct ringReactor *reactor,
+                             unsigned long long data, int result)
+{
+    struct ringConnection *conn = (struct ringConnection*)(unsigned long)
+        (data & ~TAG_MASK);
+    int status = 0;
+
+    switch ((int)(data & TAG_MASK))
+    {
+    case TAG_ACCEPT:
+        if (data & ACCEPT_DELAYED)
+        {
+            queueAccept(reactor);
+        }
+        else
+        {
+            acceptClient(reactor, result);
+        }
+        return;
+    case TAG_SLOT:
+        reactor->freeSlots[reactor->freeSlotCount++] = (int)(data >> 2);
+        return;
+    case TAG_LINKED:
+        return;
+    }
+
+    switch (conn->state)
+    {
+    case STATE_CONTROL:
+        status = readControl(reactor, conn, result);
+        break;
+    case STATE_CONNECT:
+        status = finishConnect(reactor, conn, result);
+        break;
+    case STATE_RETRY:
+        status = startConnect(reactor, conn);
+        break;
+    case STATE_SEND_HEADER:
+        status = sendHeader(reactor, conn, result);
+        break;
+    case STATE_SEND_BODY:
+        status = sendBody(reactor, conn, result);
+        break;
+    case STATE_SEND_CACHED:
+        status = sendCached(reactor, conn, result);
+        break;
+    case STATE_SEND_RESUME:
+        status = sendResume(reactor, conn, result);
+        break;
+    case STATE_GET_HEADER:
+        status = readHeader(reactor, conn, result);
+        break;
+    case STATE_GET_BODY:
+        status = readBody(reactor, conn, result);
+        break;
+    case STATE_WRITE:
+        status = writeBody(reactor, conn, result);
+        break;
+    }
+
+    if (status != 0)
+    {
+        endTransfer(conn, status == 1);
+        closeConnection(reactor, conn);
+    }
+}
+
+/*
+-- FUNCTION: readControl
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Reads the stripe of the file.
+-- October 17, 2026 - Reads the resume point.
+-- October 17, 2026 - Forks for delta uploads.
+-- October 17, 2026 - Forks for deduplicated uploads.
+-- October 17, 2026 - Forks for compressed transfers.
+-- October 17, 2026 - Forks for verified transfers.
+-- October 17, 2026 - Forks for batches.
+-- October 17, 2026 - Forks for listings.
+--
+-- INTERFACE: static int readControl(struct ringReactor *reactor,
+--                                   struct ringConnection *conn, int result);
+--
+-- RETURNS: 1 when the connection is done, 0 while it continues, -1 on failure
+--
+-- NOTES:
+-- This function collects the control message. Once all of it is in, a plain
+-- get or send closes the control socket and connects back to the client.
+-- Passive and multiplexed clients, batches, listings, delta and deduplicated
+-- uploads and compressed and verified transfers are handed to a child
+-- process.
+*/
+static int readControl(struct ringReactor *reactor,
+                       struct ringConnection *conn, int result)
+{
+    int flags = 0;
+
+    if (result <= 0)
+    {
+        return -1;
+    }
+
+    conn->controlCount += result;
+    if (conn->controlCount < BUFFER_LENGTH)
+    {
+        queueSocket(reactor, conn, IORING_OP_RECV,
+            conn->control + conn->controlCount,
+            BUFFER_LENGTH - conn->controlCount);
+        return 0;
+    }
+
+    conn->command = (int)conn->control[0];
+    memmove((void*)&flags, conn->control + CONTROL_FLAGS, sizeof(int));
+    readStripe(conn->control, &conn->stripe, &conn->stripes);
+    unpackResume(conn->control + CONTROL_RESUME, &conn->resumePoint);
+    conn->resume = (flags & FLAG_RESUME) && conn->stripes == 1;
+
+    if (conn->command == MULTIPLEX || conn->command == BATCH_GET ||
+        conn->command == BATCH_SEND || conn->command == REQUEST_LIST ||
+        ((flags & FLAG_PASSIVE) &&
+        (conn->command == GET_FILE || conn->command == SEND_FILE)) ||
+        (flags & FLAG_VERIFY) || (conn->stripes == 1 &&
+        ((flags & FLAG_COMPRESS) || (conn->command == SEND_FILE &&
+        (flags & (FLAG_DELTA | FLAG_DEDUP))))))
+    {
+        return forkCommand(reactor, conn);
+    }
+
+    // Add 1 to buffer to move past the control byte
+    conn->control[MAX_NAME_LENGTH + 1] = '\0';
+    strcpy(conn->fileName, conn->control + 1);
+    printf("Filename is %s and the command is %d\n", conn->fileName,
+        conn->command);
+
+    if (conn->command != GET_FILE && conn->command != SEND_FILE)
+    {
+        return 1;
+    }
+
+    // Close the command socket, the slot is used again for the transfer
+    close(conn->socket);
+    conn->socket = -1;
+    if (conn->installed)
+    {
+        clearSlot(reactor, conn->slot, (unsigned long)conn | TAG_LINKED);
+        conn->installed = 0;
+    }
+
+    return startConnect(reactor, conn);
+}
+
+/*
+-- FUNCTION: forkCommand
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Passes the time the client was accepted on.
+--
+-- INTERFACE: static int forkCommand(struct ringReactor *reactor,
+--                                   struct ringConnection *conn);
+--
+-- RETURNS: 1, the connection is done as far as the ring is concerned
+--
+-- NOTES:
+-- This function forks a child that serves the connection with serveCommand
+-- in the same way as the fork mode. The child moves the control socket to the
+-- lowest free descriptor and closes every other descriptor it inherited, so
+-- the sockets of the ring's other clients are really closed once the ring
+-- closes them.
+*/
+static int forkCommand(struct ringReactor *reactor,
+                       struct ringConnection *conn)
+{
+    int processId = 0;
+    int socket = 0;
+
+    if ((processId = fork()) == 0)
+    {
+        socket = dup2(conn->socket, STDERR_FILENO + 1);
+        close_range(STDERR_FILENO + 2, ~0U, 0);
+        serveCommand(socket, conn->control, conn->ip, conn->port,
+            &reactor->ports, conn->accepted);
+        exit(EXIT_SUCCESS);
+    }
+    if (processId == -1)
+    {
+        perror("Fork Failed To Create Child To Deal With Client");
+    }
+
+    return 1;
+}
+
+/*
+-- FUNCTION: startConnect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts failures and when connecting started.
+--
+-- INTERFACE: static int startConnect(struct ringReactor *reactor,
+--                                    struct ringConnection *conn);
+--
+-- RETURNS: 0 while the connect is in flight, -1 on failure
+--
+-- NOTES:
+-- This function creates a transfer socket with a data port from the pool and
+-- queues the connect back to the port the client connected from. The time to
+-- connect back is counted from the first attempt.
+*/
+static int startConnect(struct ringReactor *reactor,
+                        struct ringConnection *conn)
+{
+    struct io_uring_sqe *sqe = NULL;
+
+    if (conn->connecting == 0)
+    {
+        conn->connecting = metricsClock();
+    }
+    if ((conn->dataPort = createTransferSocket(&conn->socket,
+        &reactor->ports)) == -1)
+    {
+        perror("Cannot Create Transfer Socket");
+        countMetric(METRIC_CONNECT_ERRORS, 1);
+        conn->dataPort = 0;
+        conn->socket = -1;
+        return -1;
+    }
+
+    bzero(&conn->address, sizeof(struct sockaddr_in));
+    conn->address.sin_family = AF_INET;
+    conn->address.sin_port = htons(conn->port);
+    if (inet_pton(AF_INET, conn->ip, &conn->address.sin_addr) != 1)
+    {
+        return -1;
+    }
+
+    conn->state = STATE_CONNECT;
+    sqe = getSqe(reactor);
+    uringPrepare(sqe, IORING_OP_CONNECT, conn->socket, &conn->address, 0,
+        sizeof(struct sockaddr_in), (unsigned long)conn);
+    return 0;
+}
+
+/*
+-- FUNCTION: finishConnect
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts a failed connect back.
+--
+-- INTERFACE: static int finishConnect(struct ringReactor *reactor,
+--                                     struct ringConnection *conn,
+--                                     int result);
+--
+-- RETURNS: 0 while the connection continues, -1 on failure
+--
+-- NOTES:
+-- This function handles a finished connect back. A refused connect means the
+-- client is not listening yet, so a timeout of CONNECT_RETRY_DELAY
+-- milliseconds is queued and the connect is tried again with a new socket
+-- when it expires, up to CONNECT_RETRIES times.
+*/
+static int finishConnect(struct ringReactor *reactor,
+                         struct ringConnection *conn, int result)
+{
+    struct io_uring_sqe *sqe = NULL;
+
+    if (result == 0)
+    {
+        return startTransfer(reactor, conn);
+    }
+
+    close(conn->socket);
+    conn->socket = -1;
+    releaseDataPort(&reactor->ports, conn->dataPort);
+    conn->dataPort = 0;
+
+    if (result != -ECONNREFUSED || ++conn->retries > CONNECT_RETRIES)
+    {
+        fprintf(stderr, "Unable To Connect To Client: %s\n", conn->ip);
+        countMetric(METRIC_CONNECT_ERRORS, 1);
+        return -1;
+    }
+
+    conn->state = STATE_RETRY;
+    conn->delay.tv_sec = 0;
+    conn->delay.tv_nsec = CONNECT_RETRY_DELAY * 1000000LL;
+    sqe = getSqe(reactor);
+    uringPrepare(sqe, IORING_OP_TIMEOUT, -1, &conn->delay, 1, 0,
+        (unsigned long)conn);
+    return 0;
+}
+
+/*
+-- FUNCTION: startTransfer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moves the range of the stripe only.
+-- October 17, 2026 - Resumes a transfer that died part way.
+-- October 17, 2026 - Downloads are opened through the file cache.
+-- October 17, 2026 - Sends a file kept in memory with queueCached.
+-- October 17, 2026 - Counts the transfer and times the connect back.
+--
+-- INTERFACE: static int startTransfer(struct ringReactor *reactor,
+--                                     struct ringConnection *conn);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function opens the file of a connected transfer and queues the send or
+-- the read of the size control message. A file received in stripes is not
+-- truncated, the other stripes are being written to it at the same time.
+--
+-- A resumed transfer takes its buffer here to work out the checksum of the
+-- end of the partial file, see transfer.c. A resumed upload sends the resume
+-- point to the client before the size control message is read.
+--
+-- The transfer is counted as started here, with the time it took to connect
+-- back and the time since the client was accepted.
+*/
+static int startTransfer(struct ringReactor *reactor,
+                         struct ringConnection *conn)
+{
+    char fileNamePath[FILENAME_MAX];
+
+    printf("Connected to Client: %s\n", conn->ip);
+
+    conn->started = metricsClock();
+    timeMetric(METRIC_CONNECT_BACK, conn->started - conn->connecting);
+    timeMetric(METRIC_FIRST_BYTE, conn->started - conn->accepted);
+    countMetric(METRIC_STARTED, 1);
+
+    bzero(conn->control, BUFFER_LENGTH);
+    conn->controlCount = 0;
+    conn->offset = 0;
+
+    if (conn->command == GET_FILE)
+    {
+        printf("Sending %s to client now...\n", conn->fileName);
+        if ((conn->cached = openCached(conn->fileName, &conn->contents)) == NULL)
+        {
+            perror("Problem Opening File");
+            return -1;
+        }
+        conn->file = conn->cached->file;
+
+        // Control message with the size of the file and where it starts
+        conn->fileSize = conn->cached->statBuffer.st_size;
+        stripeRange(conn->fileSize, conn->stripe, conn->stripes,
+            &conn->offset, &conn->end);
+        conn->end += conn->offset;
+        if (conn->resume)
+        {
+            if (takeTransferBuffer(reactor, conn) == -1)
+            {
+                return -1;
+            }
+            conn->offset = checkResume(conn->file, conn->fileSize,
+                &conn->resumePoint, conn->buffer, reactor->buffers.size);
+            conn->end = conn->fileSize;
+            printf("Resuming %s at %zd\n", conn->fileName, conn->offset);
+        }
+        memmove(conn->control, (void*)&conn->fileSize, sizeof(off_t));
+        memmove(conn->control + HEADER_OFFSET, (void*)&conn->offset,
+            sizeof(off_t));
+        if (conn->contents != NULL)
+        {
+            conn->state = STATE_SEND_CACHED;
+            queueCached(reactor, conn);
+            return 0;
+        }
+        conn->state = STATE_SEND_HEADER;
+        queueSocket(reactor, conn, IORING_OP_SEND, conn->control,
+            BUFFER_LENGTH);
+        return 0;
+    }
+
+    printf("Getting %s from client now...\n", conn->fileName);
+    sprintf(fileNamePath, "%s%s", DEF_DIR, conn->fileName);
+    if ((conn->file = open(fileNamePath, (conn->resume ? O_RDWR : O_WRONLY) |
+        O_CREAT, 00400 | 00200 | 00100)) == -1)
+    {
+        perror("Unable To Create File");
+        return -1;
+    }
+
+    // Tell the client how much of the file is already here
+    if (conn->resume)
+    {
+        if (takeTransferBuffer(reactor, conn) == -1)
+        {
+            return -1;
+        }
+        findResume(conn->file, &conn->resumePoint, conn->buffer,
+            reactor->buffers.size);
+        packResume(conn->control, &conn->resumePoint);
+        conn->state = STATE_SEND_RESUME;
+        queueSocket(reactor, conn, IORING_OP_SEND, conn->control,
+            BUFFER_LENGTH);
+        return 0;
+    }
+    conn->state = STATE_GET_HEADER;
+    queueSocket(reactor, conn, IORING_OP_RECV, conn->control, BUFFER_LENGTH);
+    return 0;
+}
+
+/*
+-- FUNCTION: sendHeader
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moves the range of the stripe only.
+--
+-- INTERFACE: static int sendHeader(struct ringReactor *reactor,
+--                                  struct ringConnection *conn, int result);
+--
+-- RETURNS: 1 for an empty stripe, 0 while the transfer continues, -1 on
+--          failure
+--
+-- NOTES:
+-- This function handles a finished send of the size control message and
+-- starts on the range of the stripe once all of it is sent.
+*/
+static int sendHeader(struct ringReactor *reactor,
+                      struct ringConnection *conn, int result)
+{
+    if (result < 0)
+    {
+        return -1;
+    }
+
+    conn->controlCount += result;
+    if (conn->controlCount < BUFFER_LENGTH)
+    {
+        queueSocket(reactor, conn, IORING_OP_SEND,
+            conn->control + conn->controlCount,
+            BUFFER_LENGTH - conn->controlCount);
+        return 0;
+    }
+
+    if (conn->offset >= conn->end)
+    {
+        return 1;
+    }
+    if (takeTransferBuffer(reactor, conn) == -1)
+    {
+        return -1;
+    }
+
+    conn->state = STATE_SEND_BODY;
+    queueChunk(reactor, conn);
+    return 0;
+}
+
+/*
+-- FUNCTION: sendBody
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moves the range of the stripe only.
+-- October 17, 2026 - Counts the bytes sent.
+--
+-- INTERFACE: static int sendBody(struct ringReactor *reactor,
+--                                struct ringConnection *conn, int result);
+--
+-- RETURNS: 1 when the file is sent, 0 while waiting, -1 on failure
+--
+-- NOTES:
+-- This function handles the send of a chunk. A short send is continued from
+-- where it stopped, otherwise the next chunk is queued. A failed read of the
+-- chunk cancels the send, which ends up here as a failure as well.
+*/
+static int sendBody(struct ringReactor *reactor,
+                    struct ringConnection *conn, int result)
+{
+    if (result <= 0)
+    {
+        return -1;
+    }
+
+    conn->done += result;
+    countMetric(METRIC_BYTES_OUT, result);
+    if (conn->done < conn->length)
+    {
+        queueSocket(reactor, conn, IORING_OP_SEND, conn->buffer + conn->done,
+            conn->length - conn->done);
+        return 0;
+    }
+
+    conn->offset += conn->length;
+    if (conn->offset >= conn->end)
+    {
+        printf("Sending %s successful.\n", conn->fileName);
+        return 1;
+    }
+
+    queueChunk(reactor, conn);
+    return 0;
+}
+
+/*
+-- FUNCTION: sendCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts the bytes sent.
+--
+-- INTERFACE: static int sendCached(struct ringReactor *reactor,
+--                                  struct ringConnection *conn, int result);
+--
+-- RETURNS: 1 when the file is sent, 0 while waiting, -1 on failure
+--
+-- NOTES:
+-- This function handles a finished send of a file the cache keeps in memory
+-- and queues the rest if the socket did not take all of it.
+*/
+static int sendCached(struct ringReactor *reactor,
+                      struct ringConnection *conn, int result)
+{
+    int headerLeft = BUFFER_LENGTH - conn->controlCount;
+
+    if (result <= 0)
+    {
+        return -1;
+    }
+    if (result < headerLeft)
+    {
+        conn->controlCount += result;
+        queueCached(reactor, conn);
+        return 0;
+    }
+
+    conn->controlCount = BUFFER_LENGTH;
+    conn->offset += result - headerLeft;
+    countMetric(METRIC_BYTES_OUT, result - headerLeft);
+    if (conn->offset >= conn->end)
+    {
+        printf("Sending %s successful.\n", conn->fileName);
+        return 1;
+    }
+
+    queueCached(reactor, conn);
+    return 0;
+}
+
+/*
+-- FUNCTION: queueCached
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void queueCached(struct ringReactor *reactor,
+--                                   struct ringConnection *conn);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function queues one sendmsg of what is left of the size control
+-- message and of the body of a file kept in memory, so a small file takes a
+-- single operation instead of a send and a linked read and send.
+*/
+static void queueCached(struct ringReactor *reactor,
+                        struct ringConnection *conn)
+{
+    bzero(&conn->message, sizeof(struct msghdr));
+    conn->message.msg_iov = conn->vector;
+    conn->message.msg_iovlen = fillCachedVector(conn->vector, conn->contents,
+        conn->control, conn->controlCount, conn->offset, conn->end);
+    queueSocket(reactor, conn, IORING_OP_SENDMSG, (char*)&conn->message, 1);
+}
+
+/*
+-- FUNCTION: sendResume
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static int sendResume(struct ringReactor *reactor,
+--                                  struct ringConnection *conn, int result);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function handles a finished send of the resume point of a partial
+-- upload and queues the read of the size control message once all of it is
+-- sent.
+*/
+static int sendResume(struct ringReactor *reactor,
+                      struct ringConnection *conn, int result)
+{
+    if (result < 0)
+    {
+        return -1;
+    }
+
+    conn->controlCount += result;
+    if (conn->controlCount < BUFFER_LENGTH)
+    {
+        queueSocket(reactor, conn, IORING_OP_SEND,
+            conn->control + conn->controlCount,
+            BUFFER_LENGTH - conn->controlCount);
+        return 0;
+    }
+
+    bzero(conn->control, BUFFER_LENGTH);
+    conn->controlCount = 0;
+    conn->state = STATE_GET_HEADER;
+    queueSocket(reactor, conn, IORING_OP_RECV, conn->control, BUFFER_LENGTH);
+    return 0;
+}
+
+/*
+-- FUNCTION: readHeader
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moves the range of the stripe only.
+-- October 17, 2026 - Resumes a transfer that died part way.
+-- October 17, 2026 - Preallocates the file.
+--
+-- INTERFACE: static int readHeader(struct ringReactor *reactor,
+--                                  struct ringConnection *conn, int result);
+--
+-- RETURNS: 1 for an empty stripe, 0 while the transfer continues, -1 on
+--          failure
+--
+-- NOTES:
+-- This function collects the control message with the size of the file the
+-- client is about to send and queues the first receive of the body. A file
+-- received in stripes is set to its full size so every stripe can be written
+-- at its offset. Any other file is cut back to where the transfer starts,
+-- which is the offset of a resumed upload.
+*/
+static int readHeader(struct ringReactor *reactor,
+                      struct ringConnection *conn, int result)
+{
+    off_t remaining = 0;
+
+    if (result <= 0)
+    {
+        return -1;
+    }
+
+    conn->controlCount += result;
+    if (conn->controlCount < BUFFER_LENGTH)
+    {
+        queueSocket(reactor, conn, IORING_OP_RECV,
+            conn->control + conn->controlCount,
+            BUFFER_LENGTH - conn->controlCount);
+        return 0;
+    }
+
+    // Retrieve file size from the buffer
+    memmove((void*)&conn->fileSize, conn->control, sizeof(off_t));
+    printf("File size is %zd\n", conn->fileSize);
+    stripeRange(conn->fileSize, conn->stripe, conn->stripes, &conn->offset,
+        &conn->end);
+    conn->end += conn->offset;
+    if (conn->resume)
+    {
+        memmove((void*)&conn->offset, conn->control + HEADER_OFFSET,
+            sizeof(off_t));
+        if (conn->offset < 0 || conn->offset > conn->resumePoint.length ||
+            conn->offset > conn->fileSize)
+        {
+            fprintf(stderr, "Invalid resume offset from %s\n", conn->ip);
+            return -1;
+        }
+        conn->end = conn->fileSize;
+        printf("Resuming %s at %zd\n", conn->fileName, conn->offset);
+    }
+
+    // Drop what is not kept, the stripes of a file all set its full size
+    if (ftruncate(conn->file, conn->stripes > 1 ? conn->fileSize :
+        conn->offset) == -1)
+    {
+        perror("Unable To Size File");
+        return -1;
+    }
+    if (conn->offset >= conn->end)
+    {
+        return 1;
+    }
+    startReceive(&conn->behind, conn->file, conn->offset,
+        conn->end - conn->offset);
+    if (takeTransferBuffer(reactor, conn) == -1)
+    {
+        return -1;
+    }
+
+    remaining = conn->end - conn->offset;
+    conn->state = STATE_GET_BODY;
+    queueSocket(reactor, conn, IORING_OP_RECV, conn->buffer,
+        remaining < reactor->buffers.size ? remaining : reactor->buffers.size);
+    return 0;
+}
+
+/*
+-- FUNCTION: readBody
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Counts the bytes received.
+--
+-- INTERFACE: static int readBody(struct ringReactor *reactor,
+--                                struct ringConnection *conn, int result);
+--
+-- RETURNS: 0 while the transfer continues, -1 on failure
+--
+-- NOTES:
+-- This function handles a finished receive of file data and queues the write
+-- of it to disk.
+*/
+static int readBody(struct ringReactor *reactor,
+                    struct ringConnection *conn, int result)
+{
+    if (result <= 0)
+    {
+        return -1;
+    }
+
+    countMetric(METRIC_BYTES_IN, result);
+    conn->length = result;
+    conn->done = 0;
+    conn->state = STATE_WRITE;
+    queueFile(reactor, conn, 1, result);
+    return 0;
+}
+
+/*
+-- FUNCTION: writeBody
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moves the range of the stripe only.
+-- October 17, 2026 - Writes the file behind, see transfer.c.
+--
+-- INTERFACE: static int writeBody(struct ringReactor *reactor,
+--                                 struct ringConnection *conn, int result);
+--
+-- RETURNS: 1 when the file is received, 0 while waiting, -1 on failure
+--
+-- NOTES:
+-- This function handles a finished write to disk. A short write is continued,
+-- otherwise the next receive is queued until the whole file is in.
+*/
+static int writeBody(struct ringReactor *reactor,
+                     struct ringConnection *conn, int result)
+{
+    off_t remaining = 0;
+
+    if (result <= 0)
+    {
+        errno = -result;
+        perror("Unable To Write File");
+        return -1;
+    }
+
+    conn->done += result;
+    if (conn->done < conn->length)
+    {
+        queueFile(reactor, conn, 1, conn->length - conn->done);
+        return 0;
+    }
+
+    conn->offset += conn->length;
+    writeBehind(&conn->behind, conn->offset);
+    if (conn->offset >= conn->end)
+    {
+        printf("Getting %s successful.\n", conn->fileName);
+        return 1;
+    }
+
+    remaining = conn->end - conn->offset;
+    conn->state = STATE_GET_BODY;
+    queueSocket(reactor, conn, IORING_OP_RECV, conn->buffer,
+        remaining < reactor->buffers.size ? remaining : reactor->buffers.size);
+    return 0;
+}
+
+/*
+-- FUNCTION: queueChunk
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Moves the range of the stripe only.
+--
+-- INTERFACE: static void queueChunk(struct ringReactor *reactor,
+--                                   struct ringConnection *conn);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function queues the read of the next chunk of the file into the
+-- transfer buffer linked with the send of the buffer, so both take a single
+-- trip through the ring.
+*/
+static void queueChunk(struct ringReactor *reactor,
+                       struct ringConnection *conn)
+{
+    struct io_uring_sqe *sqe = NULL;
+    off_t remaining = conn->end - conn->offset;
+
+    conn->length = remaining < reactor->buffers.size ? remaining :
+        reactor->buffers.size;
+    conn->done = 0;
+
+    sqe = queueFile(reactor, conn, 0, conn->length);
+    sqe->flags |= IOSQE_IO_LINK | reactor->linkFlags;
+    sqe->user_data = (unsigned long)conn | TAG_LINKED;
+    queueSocket(reactor, conn, IORING_OP_SEND, conn->buffer, conn->length);
+}
+
+/*
+-- FUNCTION: queueSocket
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Sends with MSG_WAITALL for sendmsg as well.
+--
+-- INTERFACE: static struct io_uring_sqe *queueSocket(
+--                struct ringReactor *reactor, struct ringConnection *conn,
+--                int operation, char *buffer, int length);
+--
+-- RETURNS: the queued entry
+--
+-- NOTES:
+-- This function queues a send or receive on the socket of the connection.
+-- When the connection has a fixed file slot the socket is installed in it by
+-- a files update linked in front of the first operation, and every operation
+-- names the slot instead of the descriptor.
+*/
+static struct io_uring_sqe *queueSocket(struct ringReactor *reactor,
+                                       struct ringConnection *conn,
+                                       int operation, char *buffer,
+                                       int length)
+{
+    struct io_uring_sqe *sqe = NULL;
+
+    if (conn->slot != -1 && !conn->installed)
+    {
+        sqe = getSqe(reactor);
+        uringPrepare(sqe, IORING_OP_FILES_UPDATE, -1, &conn->socket, 1,
+            conn->slot, (unsigned long)conn | TAG_LINKED);
+        sqe->flags = IOSQE_IO_LINK | reactor->linkFlags;
+        conn->installed = 1;
+    }
+
+    sqe = getSqe(reactor);
+    uringPrepare(sqe, operation, conn->slot != -1 ? conn->slot : conn->socket,
+        buffer, length, 0, (unsigned long)conn);
+    if (conn->slot != -1)
+    {
+        sqe->flags = IOSQE_FIXED_FILE;
+    }
+    if (operation == IORING_OP_SEND || operation == IORING_OP_SENDMSG)
+    {
+        sqe->msg_flags = MSG_WAITALL;
+    }
+
+    return sqe;
+}
+
+/*
+-- FUNCTION: queueFile
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static struct io_uring_sqe *queueFile(
+--                struct ringReactor *reactor, struct ringConnection *conn,
+--                int write, int length);
+--
+-- RETURNS: the queued entry
+--
+-- NOTES:
+-- This function queues a read or write of length bytes between the file and
+-- the transfer buffer, starting done bytes into the current chunk. Buffers
+-- registered with the ring use the fixed read and write operations.
+*/
+static struct io_uring_sqe *queueFile(struct ringReactor *reactor,
+                                     struct ringConnection *conn,
+                                     int write, int length)
+{
+    struct io_uring_sqe *sqe = getSqe(reactor);
+    int operation = 0;
+
+    if (conn->bufferIndex != -1)
+    {
+        operation = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    }
+    else
+    {
+        operation = write ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+
+    uringPrepare(sqe, operation, conn->file, conn->buffer + conn->done,
+        length, conn->offset + conn->done, (unsigned long)conn);
+    if (conn->bufferIndex != -1)
+    {
+        sqe->buf_index = (unsigned short)conn->bufferIndex;
+    }
+
+    return sqe;
+}
+
+/*
+-- FUNCTION: clearSlot
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void clearSlot(struct ringReactor *reactor, int slot,
+--                                  unsigned long long data);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function queues a files update that empties a fixed file slot. The
+-- ring holds its own reference to an installed socket, so the socket is only
+-- really closed once its slot is cleared.
+*/
+static void clearSlot(struct ringReactor *reactor, int slot,
+                      unsigned long long data)
+{
+    struct io_uring_sqe *sqe = getSqe(reactor);
+
+    uringPrepare(sqe, IORING_OP_FILES_UPDATE, -1, &reactor->emptySlot, 1,
+        slot, data);
+}
+
+/*
+-- FUNCTION: takeTransferBuffer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Keeps a buffer taken earlier.
+--
+-- INTERFACE: static int takeTransferBuffer(struct ringReactor *reactor,
+--                                          struct ringConnection *conn);
+--
+-- RETURNS: 0 on success or -1 if no buffer could be allocated
+--
+-- NOTES:
+-- This function gives the connection a registered buffer, or a buffer from
+-- the pool once all registered buffers are in use. A resumed transfer already
+-- has its buffer and keeps it.
+*/
+static int takeTransferBuffer(struct ringReactor *reactor,
+                              struct ringConnection *conn)
+{
+    if (conn->buffer != NULL)
+    {
+        return 0;
+    }
+    if (reactor->freeBufferCount > 0)
+    {
+        conn->bufferIndex = reactor->freeBuffers[--reactor->freeBufferCount];
+        conn->buffer = reactor->fixedBuffers[conn->bufferIndex];
+        return 0;
+    }
+
+    return (conn->buffer = takeBuffer(&reactor->buffers)) == NULL ? -1 : 0;
+}
+
+/*
+-- FUNCTION: closeConnection
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: October 17, 2026 - Gives a cached file back to the cache.
+--
+-- INTERFACE: static void closeConnection(struct ringReactor *reactor,
+--                                        struct ringConnection *conn);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function closes the file and socket of a connection, gives back its
+-- data port and transfer buffer and frees it. The fixed file slot is only
+-- reused once the kernel reports it empty.
+*/
+static void closeConnection(struct ringReactor *reactor,
+                            struct ringConnection *conn)
+{
+    if (conn->cached != NULL)
+    {
+        releaseCached(conn->cached);
+    }
+    else if (conn->file != -1)
+    {
+        close(conn->file);
+    }
+    if (conn->socket != -1)
+    {
+        close(conn->socket);
+    }
+    if (conn->slot != -1)
+    {
+        clearSlot(reactor, conn->slot,
+            ((unsigned long long)conn->slot << 2) | TAG_SLOT);
+    }
+    releaseDataPort(&reactor->ports, conn->dataPort);
+
+    if (conn->bufferIndex != -1)
+    {
+        reactor->freeBuffers[reactor->freeBufferCount++] = conn->bufferIndex;
+    }
+    else
+    {
+        returnBuffer(&reactor->buffers, conn->buffer);
+    }
+
+    free(conn);
+}
+
+/*
+-- FUNCTION: endTransfer
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void endTransfer(struct ringConnection *conn,
+--                                    int success);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function counts the end of the transfer of a connection and how long
+-- it took, if startTransfer started one. Forked commands are counted by the
+-- child.
+*/
+static void endTransfer(struct ringConnection *conn, int success)
+{
+    if (conn->started == 0)
+    {
+        return;
+    }
+    countMetric(success ? METRIC_COMPLETED : METRIC_FAILED, 1);
+    timeMetric(METRIC_DURATION, metricsClock() - conn->started);
+    conn->started = 0;
+}
+
+/*
+-- FUNCTION: getSqe
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static struct io_uring_sqe *getSqe(struct ringReactor *reactor);
+--
+-- RETURNS: a free submission queue entry
+--
+-- NOTES:
+-- This function reserves a submission queue entry. The event loop makes room
+-- for RING_ROOM entries before every completion is handled, so running out
+-- means the ring itself failed.
+*/
+static struct io_uring_sqe *getSqe(struct ringReactor *reactor)
+{
+    struct io_uring_sqe *sqe = NULL;
+
+    if ((sqe = uringGetSqe(&reactor->ring)) == NULL)
+    {
+        systemFatal("Submission Queue Full");
+    }
+
+    return sqe;
+}
+
+/*
+-- FUNCTION: systemFatal
+--
+-- DATE: October 17, 2026
+--
+-- REVISIONS: (Date and Description)
+--
+-- INTERFACE: static void systemFatal(const char* message);
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- This function displays an error message and shuts down the program.
+*/
+static void systemFatal(const char* message)
+{
+    perror(message);
+    exit(EXIT_FAILURE);
+}